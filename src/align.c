@@ -14,10 +14,93 @@
  * .Call interface of S.  They include (see documentation below):
   SEXP *num_align( s_object *num_obj, s_object *align_pos, 
                        s_object *how_obj, s_object *match_tol );
+  SEXP num_seq_align( SEXP seq_pars, SEXP align_pos, SEXP how_obj, 
+                      SEXP match_tol );
+  SEXP time_seq_align( SEXP seq_pars, SEXP seq_start, SEXP rel_strs,
+                       SEXP align_pos, SEXP how_obj, SEXP match_tol,
+                       SEXP zone_list );
 *************************************************************************/
 
 #include "align.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* alignments at least this long are split into chunks for threads */
+#define ALIGN_CHUNK_MIN 100000
+
+/* how to set the outputs of an alignment, and where to put them */
+typedef struct align_out
+{
+  int how;
+  int error_how;
+  double match_tol;
+  Sint *na_data;
+  Sint *drop_data;
+  Sint *sub1_data;
+  Sint *sub2_data;
+  double *weight1_data;
+  double *weight2_data;
+} ALIGN_OUT;
+
+/* a regular sequence of original positions, whose elements are found
+   from their subscripts i (from 0) rather than stored, in one of the
+   forms below; the numeric forms are as seq makes them, and for times 
+   give fractional julian days */
+
+typedef struct seq_pos
+{
+  int form;
+  double from;
+  double to;
+  double by;
+  Sint len;
+  Sint inc;
+  RT_STEP step;
+} SEQ_POS;
+
+#define SEQ_FROM_BY 0   /* from + i * by */
+#define SEQ_TO_BY 1     /* to - ( len - 1 - i ) * by */
+#define SEQ_FROM_TO 2   /* from + i * by, with the last one to */
+#define SEQ_UP_TO 3     /* from + i * by, but no further than to */
+#define SEQ_REL 4       /* start plus i relative time steps */
+#define SEQ_REL_TO 5    /* start plus len - 1 - i relative time steps */
+
+/* data passed to time_align_steps */
+typedef struct time_align_data
+{
+  Sint *in_days;
+  Sint *in_ms;
+  Sint in_len;
+  Sint in_start;
+  Sint in_inc;
+  Sint *align_days;
+  Sint *align_ms;
+  Sint align_start;
+  Sint align_inc;
+  ALIGN_OUT out;
+} TIME_ALIGN_DATA;
+
+static int time_align_steps( TIME_ALIGN_DATA *ad, Sint step_from, 
+			     Sint step_to );
+static Sint num_gallop( double *nums, Sint len, Sint curr, Sint inc,
+			double target );
+static Sint time_gallop( Sint *days, Sint *ms, Sint len, Sint curr, 
+			 Sint inc, Sint target_day, Sint target_ms );
+static int time_key( Sint day, Sint ms, long long *key );
+static SEXP align_out_new( SEXP how_obj, SEXP match_tol, Sint align_len,
+			   int full_list, ALIGN_OUT *out, const char *fn );
+static void align_set( const ALIGN_OUT *out, Sint align_curr, Sint in_curr,
+		       Sint in_inc, int over_set, int under_set, 
+		       double diff_over, double diff_under );
+static void seq_pos_init( SEQ_POS *sp, SEXP seq_pars, const char *fn );
+static double seq_num( const SEQ_POS *sp, Sint i );
+static int seq_key( const SEQ_POS *sp, Sint i, long long *key );
+static Sint seq_num_find( const SEQ_POS *sp, double target );
+static int seq_key_find( const SEQ_POS *sp, long long target, 
+			 Sint *in_curr );
+
 /**********************************************************************
  * C Code DOCUMENTATION ************************************************
  **********************************************************************
@@ -59,7 +142,9 @@
    nearest positions from num_obj before and after the given position.
    If one of the two match within match_tol, the corresponding subscript 
    element of the return list is set to the appropriate subscript of
-   num_obj.  The first element of how_obj tells what to do if there
+   num_obj.  The nearest positions are found with num_gallop, so that
+   aligning a few positions to a long series does not step through all
+   of it.  The first element of how_obj tells what to do if there
    is no match: ``NA'' causes the NA element of the return list to be set
    to true; ``drop'' causes the drop element to be set to true; 
    ``nearest'' puts the subscript of the nearest position into the 
@@ -82,56 +167,28 @@ SEXP num_align( SEXP num_obj, SEXP align_pos,
 
   SEXP ret;
 
-  double *in_nums, *in_pos, *pmatch_tol, diff_under, diff_over;
+  double *in_nums, *in_pos, diff_under = 0, diff_over = 0;
 
-  Sint in_len, align_len, tmplen;
+  Sint in_len, align_len;
   Sint in_inc, in_start, in_curr;
   Sint align_inc, align_start, align_end, align_curr;
   int over_set, under_set;
 
-  int how, error_how;
-
-  Sint *na_data, *drop_data, *sub1_data, *sub2_data;
-  double *weight1_data, *weight2_data;
+  ALIGN_OUT out;
 
   /* extract input data*/
 
   if( !IS_NUMERIC( num_obj ) || (( in_len = length(num_obj) ) < 1) ||
-      !IS_NUMERIC( align_pos ) || (( align_len = length(align_pos) ) < 1) ||
-      !IS_CHARACTER( how_obj ) || (( tmplen = length(how_obj) ) < 2) ||
-      !IS_NUMERIC( match_tol ) || (( tmplen = length(match_tol) ) < 1))
+      !IS_NUMERIC( align_pos ) || (( align_len = length(align_pos) ) < 1))
     error( "invalid data in c function num_align" ); 
 
   in_nums = REAL( num_obj );
   in_pos = REAL( align_pos );
-  pmatch_tol = REAL( match_tol );
-
-  if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "NA" ))
-    how = 0;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "drop" ))
-    how = 1;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "nearest" ))
-    how = 2;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "before" ))
-    how = 3;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "after" ))
-    how = 4;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "interp" ))
-    how = 5;
-  else
-    error( "invalid third argument in C function num_align" );
-
-  if( !strcmp( CHAR(STRING_ELT(how_obj, 1)), "NA" ))
-    error_how = 0;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 1)), "drop" ))
-    error_how = 1;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 1)), "nearest" ))
-    error_how = 2;
-  else
-    error( "Invalid third argument in C function num_align" );
 
-  if(pmatch_tol[0] < 0)
-    error( "invalid fourth argument in C function num_align" );
+  /* create return list */
+
+  ret = align_out_new( how_obj, match_tol, align_len, 1, &out, 
+		       "num_align" );
 
   /* see if the inputs are increasing or decreasing series */
   in_start = align_start = 0;
@@ -163,25 +220,6 @@ SEXP num_align( SEXP num_obj, SEXP align_pos,
     }
   }
 
-  /* create return list */
-
-  if( how == 5 )
-  {
-    PROTECT(ret = NEW_LIST(6));
-    na_data = LOGICAL( SET_VECTOR_ELT(ret, 0 , NEW_LOGICAL(align_len)) );
-    drop_data = LOGICAL( SET_VECTOR_ELT(ret, 1 , NEW_LOGICAL(align_len)) );
-    weight1_data = REAL( SET_VECTOR_ELT(ret, 2 , NEW_NUMERIC(align_len)) );
-    sub1_data = INTEGER( SET_VECTOR_ELT(ret, 3 , NEW_INTEGER(align_len)) );
-    weight2_data = REAL( SET_VECTOR_ELT(ret, 4 , NEW_NUMERIC(align_len)) );
-    sub2_data = INTEGER( SET_VECTOR_ELT(ret, 5 , NEW_INTEGER(align_len)) );
-  } else
-  {
-    PROTECT(ret = NEW_LIST(6));
-    na_data = LOGICAL( SET_VECTOR_ELT(ret, 0 , NEW_LOGICAL(align_len)) );
-    drop_data = LOGICAL( SET_VECTOR_ELT(ret, 1 , NEW_LOGICAL(align_len)) );
-    sub1_data = INTEGER( SET_VECTOR_ELT(ret, 2 , NEW_INTEGER(align_len)) );
-  }
-
   /* go through the alignment positions and find the right indexes,
      NA or not values, and drop values */
 
@@ -190,9 +228,8 @@ SEXP num_align( SEXP num_obj, SEXP align_pos,
        align_curr += align_inc )
   {
     /* move along the nums series until we pass current pos position */
-    while(( in_curr  >= 0 ) && ( in_curr < in_len ) && 
-	  ( in_nums[ in_curr ] < in_pos[ align_curr ] ))
-      in_curr += in_inc;
+    in_curr = num_gallop( in_nums, in_len, in_curr, in_inc, 
+			  in_pos[ align_curr ] );
 
     /* see how far we are from the current position */
 
@@ -212,58 +249,8 @@ SEXP num_align( SEXP num_obj, SEXP align_pos,
       under_set = 1;
     }
 
-    na_data[ align_curr ] = 0;
-    drop_data[ align_curr ] = 0;
-    sub1_data[ align_curr ] = 1;
-    if( how == 5 )
-    {
-      weight1_data[ align_curr ] = 1.0;
-      sub2_data[ align_curr ] = 1;
-      weight2_data[ align_curr ] = 0.0;
-    }
-
-    /* is it a match? */
-    if( under_set && 
-       ( !over_set || ( diff_under < diff_over )) &&
-       ( diff_under <= *pmatch_tol ))
-      sub1_data[ align_curr ] = 1 + in_curr - in_inc; /* matches under */
-    else if( over_set && ( diff_over <= *pmatch_tol ))
-      sub1_data[ align_curr ] = 1 + in_curr;  /* matches over */
-    else if(( how == 0 ) || 
-	    (( error_how == 0 ) &&
-	     (( !under_set && (( how == 3 ) || ( how == 5 ))) ||
-	      ( !over_set && (( how == 4 ) || ( how == 5 ))))))
-      na_data[ align_curr ] = 1;  /* make it an NA on no match */
-    else if(( how == 1 ) || 
-	    (( error_how == 1 ) &&
-	     (( !under_set && (( how == 3 ) || ( how == 5 ))) ||
-	      ( !over_set && (( how == 4 ) || ( how == 5 ))))))
-      drop_data[ align_curr ] = 1;  /* drop on no match */
-    else if(( how == 2 ) || 
-	    (( error_how == 2 ) &&
-	     (( !under_set && (( how == 3 ) || ( how == 5 ))) ||
-	      ( !over_set && (( how == 4 ) || ( how == 5 ))))))
-    {
-      /* take nearest on no match */
-      if( !under_set )
-	sub1_data[ align_curr ] = 1 + in_curr;
-      else if( !over_set )
-	sub1_data[ align_curr ] = 1 + in_curr - in_inc;
-      else if( diff_under <= diff_over )
-	sub1_data[ align_curr ] = 1 + in_curr - in_inc;
-      else
-	sub1_data[ align_curr ] = 1 + in_curr;
-    } else if( how == 3 ) /* before */
-      sub1_data[ align_curr ] = 1 + in_curr - in_inc;
-    else if( how == 4 ) /* after */
-      sub1_data[ align_curr ] = 1 + in_curr;
-    else /* interp */
-    {
-      sub1_data[ align_curr ] = 1 + in_curr;
-      sub2_data[ align_curr ] = 1 + in_curr - in_inc;
-      weight1_data[ align_curr ] = diff_under / ( diff_over + diff_under );
-      weight2_data[ align_curr ] = diff_over / ( diff_over + diff_under );
-    }
+    align_set( &out, align_curr, in_curr, in_inc, over_set, under_set,
+	       diff_over, diff_under );
   }
 
   UNPROTECT(1);
@@ -314,8 +301,10 @@ SEXP num_align( SEXP num_obj, SEXP align_pos,
    If one of the two match within matchtol, after conversion of both
    times to numbers, the corresponding subscript element of the 
    return list is set to the appropriate subscript of
-   time_obj.  The first element of how_obj tells what to do if there
-   is no match: ``NA'' causes the NA element of the return list to be set
+   time_obj.  The nearest positions are found with time_gallop, and 
+   the differences are taken exactly in milliseconds with time_key
+   before they are converted to days.  The first element of how_obj
+   tells what to do if there is no match: ``NA'' causes the NA element of the return list to be set
    to true; ``drop'' causes the drop element to be set to true; 
    ``nearest'' puts the subscript of the nearest position into the 
    subscript element; ``before'' uses the position before; ``after''
@@ -336,18 +325,14 @@ SEXP time_align( SEXP time_obj, SEXP align_pos,
 
   SEXP ret;
 
-  double *pmatch_tol, diff_under, diff_over, over_num, 
-    under_num, align_num;
   Sint *in_days, *in_ms, *align_days, *align_ms;
 
-  Sint in_len, align_len, tmplen;
+  Sint in_len, align_len;
   Sint in_inc, in_start, in_curr;
-  Sint align_inc, align_start, align_end, align_curr;
-  int how, error_how;
-  int over_set, under_set;
-
-  Sint *na_data, *drop_data, *sub1_data, *sub2_data;
-  double *weight1_data, *weight2_data;
+  Sint align_inc, align_start, align_curr, align_prev;
+  Sint chunk, nchunk;
+  int all_ok;
+  TIME_ALIGN_DATA ad;
 
   /* extract input data*/
 
@@ -361,43 +346,9 @@ SEXP time_align( SEXP time_obj, SEXP align_pos,
       !align_days || !align_ms || !align_len )
     error( "Invalid second argument to c function time_align" );
 
-  if( !IS_NUMERIC( match_tol ) || (( tmplen = length(match_tol) ) < 1) ||
-      !IS_CHARACTER( how_obj ) || (( tmplen = length(how_obj) ) < 2)
-       )
-    error( "Invalid data in c function time_align" ); 
-  
-  if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "NA" ))
-    how = 0;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "drop" ))
-    how = 1;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "nearest" ))
-    how = 2;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "before" ))
-    how = 3;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "after" ))
-    how = 4;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 0)), "interp" ))
-    how = 5;
-  else
-    error( "Invalid third argument in C function time_align" );
-
-  if( !strcmp( CHAR(STRING_ELT(how_obj, 1)), "NA" ))
-    error_how = 0;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 1)), "drop" ))
-    error_how = 1;
-  else if( !strcmp( CHAR(STRING_ELT(how_obj, 1)), "nearest" ))
-    error_how = 2;
-  else
-    error( "invalid third argument in C function time_align" );
-
-  pmatch_tol = REAL( match_tol );
-  if(pmatch_tol[0] < 0)
-    error( "invalid fourth argument in C function num_align" );
-
   /* see if the inputs are increasing or decreasing series */
   in_start = align_start = 0;
   in_inc = align_inc = 1;
-  align_end = align_len - 1;
 
   for( in_curr = 1; in_curr < in_len; in_curr++ )
   {
@@ -427,50 +378,357 @@ SEXP time_align( SEXP time_obj, SEXP align_pos,
     {
       align_inc = -1;
       align_start = align_len - 1;
-      align_end = 0;
       break;
     }
   }
 
   /* create return list */
 
-  if( how == 5 )
+  ret = align_out_new( how_obj, match_tol, align_len, 0, &(ad.out),
+		       "time_align" );
+
+  /* go through the alignment positions and find the right indexes,
+     NA or not values, and drop values.  Long alignments are split into
+     chunks that are done in parallel, when OpenMP is available; each 
+     chunk finds its own starting input position, so the results do not
+     depend on the number of chunks, as long as the alignment positions
+     are in order.  Otherwise they are done in one chunk, so that the
+     input position only moves forward as it always has */
+
+  ad.in_days = in_days;
+  ad.in_ms = in_ms;
+  ad.in_len = in_len;
+  ad.in_start = in_start;
+  ad.in_inc = in_inc;
+  ad.align_days = align_days;
+  ad.align_ms = align_ms;
+  ad.align_start = align_start;
+  ad.align_inc = align_inc;
+
+  nchunk = 1;
+#ifdef _OPENMP
+  if( align_len >= ALIGN_CHUNK_MIN )
   {
-    PROTECT(ret = NEW_LIST(6));
-    na_data = LOGICAL( SET_VECTOR_ELT(ret, 0 , NEW_LOGICAL(align_len)) );
-    drop_data = LOGICAL( SET_VECTOR_ELT(ret, 1 , NEW_LOGICAL(align_len)) );
-    weight1_data = REAL( SET_VECTOR_ELT(ret, 2 , NEW_NUMERIC(align_len)) );
-    sub1_data = INTEGER( SET_VECTOR_ELT(ret, 3 , NEW_INTEGER(align_len)) );
-    weight2_data = REAL( SET_VECTOR_ELT(ret, 4 , NEW_NUMERIC(align_len)) );
-    sub2_data = INTEGER( SET_VECTOR_ELT(ret, 5 , NEW_INTEGER(align_len)) );
-  } else
+    /* check the order once, in the direction the steps go */
+    align_prev = align_start;
+    for( chunk = 1; chunk < align_len; chunk++ )
+    {
+      align_curr = align_prev + align_inc;
+      if(( align_days[ align_curr ] < align_days[ align_prev ] ) ||
+	 (( align_days[ align_curr ] == align_days[ align_prev ] ) &&
+	  ( align_ms[ align_curr ] < align_ms[ align_prev ] )))
+	break;
+      align_prev = align_curr;
+    }
+    nchunk = ( chunk < align_len ) ? 1 : 4 * omp_get_max_threads();
+    if( nchunk > align_len / ( ALIGN_CHUNK_MIN / 4 ))
+      nchunk = align_len / ( ALIGN_CHUNK_MIN / 4 );
+  }
+#endif
+
+  all_ok = 1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if( nchunk > 1 ) reduction(&&:all_ok)
+#endif
+  for( chunk = 0; chunk < nchunk; chunk++ )
   {
-    PROTECT(ret = NEW_LIST(3));
-    na_data = LOGICAL( SET_VECTOR_ELT(ret, 0 , NEW_LOGICAL(align_len)) );
-    drop_data = LOGICAL( SET_VECTOR_ELT(ret, 1 , NEW_LOGICAL(align_len)) );
-    sub1_data = INTEGER( SET_VECTOR_ELT(ret, 2 , NEW_INTEGER(align_len)) );
+    if( !time_align_steps( &ad, 
+			   (Sint) (( (double) align_len * chunk ) / nchunk ),
+			   (Sint) (( (double) align_len * ( chunk + 1 )) / 
+				   nchunk )))
+      all_ok = 0;
   }
 
-  /* go through the alignment positions and find the right indexes,
-     NA or not values, and drop values */
+  if( !all_ok ){
+    UNPROTECT(5);
+    error( "Cannot convert time to numeric in time_align" );
+  }
 
-  in_curr = in_start;
-  for( align_curr = align_start; align_curr != ( align_end + align_inc ); 
-       align_curr += align_inc )
+  UNPROTECT(5); //1+4 from time_get_pieces
+
+  return( ret );
+}
+
+
+
+
+
+/**********************************************************************
+ * C Code DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME num_seq_align
+
+   DESCRIPTION  Align a regular numeric sequence to new positions, 
+   without making the sequence.
+   To be called from R as 
+   \\
+   {\tt 
+    .Call("num_seq_align", seq.pars, new.pos, c( how, error.how ),
+          matchtol)
+   }
+
+   ARGUMENTS
+      IARG  seq_pars  The from, to, by, length, and form of the sequence
+      IARG  align_pos New positions to align to
+      IARG  how_obj   How to perform alignment (see num_align)
+      IARG  match_tol Tolerance for matching
+
+   RETURN Returns the same list as num_align would for the sequence.
+
+   ALGORITHM The subscript of the first element of the sequence that is 
+   not less than each new position is estimated as the distance from
+   the start divided by the step, and corrected by comparing it and 
+   the element before with the position, with the elements computed
+   as seq does.  The outputs are then set as in num_align.  Each 
+   position is found on its own, so the new positions need not be in
+   order, and the time taken does not depend on the sequence length.
+
+   EXCEPTIONS 
+
+   NOTE See also: num_align, time_seq_align
+
+**********************************************************************/
+SEXP num_seq_align( SEXP seq_pars, SEXP align_pos, SEXP how_obj, 
+		    SEXP match_tol )
+{
+  SEXP ret;
+  double *in_pos, diff_under = 0, diff_over = 0;
+  Sint align_len, align_curr, in_curr;
+  int over_set, under_set;
+  SEQ_POS sp;
+  ALIGN_OUT out;
+
+  if( !IS_NUMERIC( align_pos ) || (( align_len = length(align_pos) ) < 1))
+    error( "invalid data in c function num_seq_align" ); 
+  in_pos = REAL( align_pos );
+
+  seq_pos_init( &sp, seq_pars, "num_seq_align" );
+  if( sp.form >= SEQ_REL )
+    error( "Invalid sequence in c function num_seq_align" );
+
+  ret = align_out_new( how_obj, match_tol, align_len, 1, &out, 
+		       "num_seq_align" );
+
+  for( align_curr = 0; align_curr < align_len; align_curr++ )
   {
-    /* move along the input series until we pass current align position */
-    while(( in_curr  >= 0 ) && ( in_curr < in_len ) &&
-	  (( in_days[ in_curr ] < align_days[ align_curr ] ) ||
-	   (( in_days[ in_curr ] == align_days[ align_curr ] ) && 
-	    ( in_ms[ in_curr ] < align_ms[ align_curr ] ))))
-      in_curr += in_inc;
+    in_curr = seq_num_find( &sp, in_pos[ align_curr ] );
 
-    /* see how far we are from the current position */
+    over_set = under_set = 0;
+    if(( in_curr  >= 0 ) && ( in_curr < sp.len ))
+    {
+      diff_over = seq_num( &sp, in_curr ) - in_pos[ align_curr ];
+      over_set = 1;
+    }
+    if( (( in_curr - sp.inc ) >= 0 ) && (( in_curr - sp.inc ) < sp.len ))
+    {
+      diff_under = in_pos[ align_curr ] - seq_num( &sp, in_curr - sp.inc );
+      under_set = 1;
+    }
+
+    align_set( &out, align_curr, in_curr, sp.inc, over_set, under_set,
+	       diff_over, diff_under );
+  }
+
+  UNPROTECT(1);
+  return( ret );
+}
+
+/**********************************************************************
+ * C Code DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_seq_align
+
+   DESCRIPTION  Align a regular time sequence to new positions, 
+   without making the sequence.
+   To be called from R as 
+   \\
+   {\tt 
+    .Call("time_seq_align", seq.pars, start, rel.strs, new.pos, 
+          c( how, error.how ), matchtol, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  seq_pars  The from, to, by, length, and form of the sequence
+      IARG  seq_start For the relative time forms, the time the steps
+                      are added to
+      IARG  rel_strs  For the relative time forms, the relative time
+      IARG  align_pos New positions to align to
+      IARG  how_obj   How to perform alignment (see time_align)
+      IARG  match_tol Tolerance for matching
+      IARG  zone_list The list of R time zone objects
+
+   RETURN Returns the same list as time_align would for the sequence.
+
+   ALGORITHM As num_seq_align, with the elements of the numeric forms
+   converted to times as time_from_numeric does, and those of the 
+   relative time forms found with rtime_step_jms; the relative time 
+   must be one rtime_step_init accepts.  Differences are taken exactly
+   in milliseconds with time_key, as in time_align.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_align, num_seq_align, time_rel_seq_index
+
+**********************************************************************/
+SEXP time_seq_align( SEXP seq_pars, SEXP seq_start, SEXP rel_strs,
+		     SEXP align_pos, SEXP how_obj, SEXP match_tol,
+		     SEXP zone_list )
+{
+  SEXP ret;
+  Sint *align_days, *align_ms, *start_days, *start_ms;
+  Sint align_len, align_curr, in_curr, lng;
+  long long over_key, under_key, align_key;
+  double diff_under = 0, diff_over = 0;
+  int over_set, under_set, num_fields;
+  char *zone;
+  TZONE_STRUCT *tzone;
+  RT_FIELD fields[ RT_FIELD_BUF ];
+  SEQ_POS sp;
+  ALIGN_OUT out;
+
+  seq_pos_init( &sp, seq_pars, "time_seq_align" );
+  if( sp.form >= SEQ_REL )
+  {
+    if( !isString(rel_strs) || length(rel_strs) < 1L ||
+	( num_fields = rtime_parse( CHAR(STRING_ELT(rel_strs, 0)), fields,
+				    RT_FIELD_BUF )) < 0 )
+      error( "Invalid relative time in c function time_seq_align" );
+
+    if( !time_get_pieces( seq_start, NULL, &start_days, &start_ms, &lng, 
+			  NULL, &zone, NULL ) ||
+	!zone || !lng || !start_days || !start_ms )
+      error( "Invalid second argument to c function time_seq_align" );
+    tzone = find_zone( zone, zone_list );
+    if( !tzone || !rtime_step_init( &(sp.step), fields, num_fields, 
+				    *start_days, *start_ms, tzone )){
+      UNPROTECT(2); //from time_get_pieces
+      error( "Sequence is not regular in c function time_seq_align" );
+    }
+    UNPROTECT(2); //from time_get_pieces
+
+    /* the sequence goes the way the steps go, or back for SEQ_REL_TO */
+    sp.inc = (( sp.step.num > 0 ) == ( sp.form == SEQ_REL )) ? 1 : -1;
+    if( sp.len < 2 )
+      sp.inc = 1;
+  }
+
+  if( !time_get_pieces( align_pos, NULL, &align_days, &align_ms, 
+			&align_len, NULL, NULL, NULL ) ||
+      !align_days || !align_ms || !align_len )
+    error( "Invalid fourth argument to c function time_seq_align" );
+
+  ret = align_out_new( how_obj, match_tol, align_len, 0, &out, 
+		       "time_seq_align" );
+
+  for( align_curr = 0; align_curr < align_len; align_curr++ )
+  {
+    if( !time_key( align_days[ align_curr ], align_ms[ align_curr ], 
+		   &align_key ) ||
+	!seq_key_find( &sp, align_key, &in_curr ))
+    {
+      UNPROTECT(3);
+      error( "Cannot convert time to numeric in time_seq_align" );
+    }
+
+    over_set = under_set = 0;
+    if(( in_curr  >= 0 ) && ( in_curr < sp.len ))
+    {
+      if( !seq_key( &sp, in_curr, &over_key )){
+	UNPROTECT(3);
+	error( "Cannot convert time to numeric in time_seq_align" );
+      }
+      diff_over = (double) ( over_key - align_key ) / MS_PER_DAY; 
+      over_set = 1;
+    }
+    if( (( in_curr - sp.inc ) >= 0 ) && (( in_curr - sp.inc ) < sp.len ))
+    {
+      if( !seq_key( &sp, in_curr - sp.inc, &under_key )){
+	UNPROTECT(3);
+	error( "Cannot convert time to numeric in time_seq_align" );
+      }
+      diff_under = (double) ( align_key - under_key ) / MS_PER_DAY; 
+      under_set = 1;
+    }
+
+    align_set( &out, align_curr, in_curr, sp.inc, over_set, under_set,
+	       diff_over, diff_under );
+  }
+
+  UNPROTECT(3); //1+2 from time_get_pieces
+  return( ret );
+}
+
+/**********************************************************************
+ * C Code DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_align_steps
+
+   DESCRIPTION  Do the alignment for a range of steps through the 
+   alignment positions, for time_align.
+
+   ARGUMENTS
+      IARG  ad          The input and output data of time_align
+      IARG  step_from   The first step to do
+      IARG  step_to     One past the last step to do
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if a time
+   cannot be converted to a number.
+
+   ALGORITHM Step k is the alignment position align_start + k * align_inc,
+   so that the positions are visited in increasing order of time. The 
+   input position is found with time_gallop, starting from in_start; 
+   since it only moves forward, the first search takes time proportional
+   to the log of the input length.  When the alignment positions are in
+   order, each range depends only on its own steps: time_gallop returns
+   the first input position at or after the alignment position, 
+   whatever position before that it starts from, so restarting at 
+   in_start gives the same position as the serial walk from the end of
+   the previous range would have.  When they are not, the walk never 
+   moves back for a position earlier than the one before, so the result
+   depends on where it starts, and time_align does all the steps in one
+   range.  The outputs for each step are then calculated as described 
+   for time_align.
+   \\
+   \\
+   This function does not call any R functions, so that it can be
+   called on several ranges at once from different threads.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_align
+
+**********************************************************************/
+static int time_align_steps( TIME_ALIGN_DATA *ad, Sint step_from, 
+			     Sint step_to )
+{
+  double diff_under = 0, diff_over = 0;
+  long long over_key, under_key, align_key;
+  Sint *in_days, *in_ms, *align_days, *align_ms;
+  Sint in_len, in_inc, in_curr, align_curr, step;
+  int over_set, under_set;
 
+  in_days = ad->in_days;
+  in_ms = ad->in_ms;
+  in_len = ad->in_len;
+  in_inc = ad->in_inc;
+  align_days = ad->align_days;
+  align_ms = ad->align_ms;
 
-    if( !ms_to_fraction( align_ms[ align_curr ], &align_num ))
-	error( "Cannot convert time to numeric in time_align" );
-    align_num += align_days[ align_curr ];
+  in_curr = ad->in_start;
+  for( step = step_from; step < step_to; step++ )
+  {
+    align_curr = ad->align_start + step * ad->align_inc;
+
+    /* move along the input series until we pass current align position */
+    in_curr = time_gallop( in_days, in_ms, in_len, in_curr, in_inc,
+			   align_days[ align_curr ], align_ms[ align_curr ] );
+
+    /* see how far we are from the current position, using exact
+       millisecond keys, converted to days only for the differences */
+
+    if( !time_key( align_days[ align_curr ], align_ms[ align_curr ], 
+		   &align_key ))
+	return 0;
 
     /* over_set and under_set get set if we're inside the respective ends of 
        the time series; diff_over and diff_under store the difference
@@ -479,80 +737,491 @@ SEXP time_align( SEXP time_obj, SEXP align_pos,
     over_set = under_set = 0;
     if(( in_curr  >= 0 ) && ( in_curr < in_len ))
     {
-      if( !ms_to_fraction( in_ms[ in_curr ], &over_num ))
-	error( "Cannot convert time to numeric in time_align" );
-      over_num += in_days[ in_curr ];
-      diff_over = over_num - align_num; 
+      if( !time_key( in_days[ in_curr ], in_ms[ in_curr ], &over_key ))
+	return 0;
+      diff_over = (double) ( over_key - align_key ) / MS_PER_DAY; 
       over_set = 1;
     }
 
     if( (( in_curr - in_inc ) >= 0 ) && (( in_curr - in_inc ) < in_len ))
     {
-      if( !ms_to_fraction( in_ms[ in_curr - in_inc ], &under_num ))
-	error( "Cannot convert time to numeric in time_align" );
-      under_num += in_days[ in_curr - in_inc ];
-      diff_under = align_num - under_num; 
+      if( !time_key( in_days[ in_curr - in_inc ], in_ms[ in_curr - in_inc ],
+		     &under_key ))
+	return 0;
+      diff_under = (double) ( align_key - under_key ) / MS_PER_DAY; 
       under_set = 1;
     }
 
-    na_data[ align_curr ] = 0;
-    drop_data[ align_curr ] = 0;
-    sub1_data[ align_curr ] = 1;
-    if( how == 5 )
-    {
-      weight1_data[ align_curr ] = 1.0;
-      sub2_data[ align_curr ] = 1;
-      weight2_data[ align_curr ] = 0.0;
-    }
+    align_set( &( ad->out ), align_curr, in_curr, in_inc, over_set, 
+	       under_set, diff_over, diff_under );
+  }
 
-    /* is it a match? */
-    if( under_set && 
-       ( !over_set || ( diff_under < diff_over )) && /* better than over */
-       ( diff_under <= *pmatch_tol ))
-      sub1_data[ align_curr ] = 1 + in_curr - in_inc; /* matches under */
-    else if( over_set && ( diff_over <= *pmatch_tol ))
-      sub1_data[ align_curr ] = 1 + in_curr;  /* matches over */
-    else if(( how == 0 ) || 
-	    (( error_how == 0 ) &&
-	     (( !under_set && (( how == 3 ) || ( how == 5 ))) ||
-	      ( !over_set && (( how == 4 ) || ( how == 5 ))))))
-      na_data[ align_curr ] = 1;  /* make it an NA on no match */
-    else if(( how == 1 ) || 
-	    (( error_how == 1 ) &&
-	     (( !under_set && (( how == 3 ) || ( how == 5 ))) ||
-	      ( !over_set && (( how == 4 ) || ( how == 5 ))))))
-      drop_data[ align_curr ] = 1;  /* drop on no match */
-    else if(( how == 2 ) || 
-	    (( error_how == 2 ) &&
-	     (( !under_set && (( how == 3 ) || ( how == 5 ))) ||
-	      ( !over_set && (( how == 4 ) || ( how == 5 ))))))
-    {
-      /* take nearest on no match */
-      if( !under_set )  /* one end */
-	sub1_data[ align_curr ] = 1 + in_curr;
-      else if( !over_set ) /* other end */
-	sub1_data[ align_curr ] = 1 + in_curr - in_inc;
-      else if( diff_under <= diff_over ) 
-	sub1_data[ align_curr ] = 1 + in_curr - in_inc;
-      else
-	sub1_data[ align_curr ] = 1 + in_curr;
-    } else if( how == 3 ) /* before */
-      sub1_data[ align_curr ] = 1 + in_curr - in_inc;
-    else if( how == 4 ) /* after */
-      sub1_data[ align_curr ] = 1 + in_curr;
-    else /* interp */
-    {
-      sub1_data[ align_curr ] = 1 + in_curr;
-      sub2_data[ align_curr ] = 1 + in_curr - in_inc;
-      weight1_data[ align_curr ] = diff_under / ( diff_over + diff_under );
-      weight2_data[ align_curr ] = diff_over / ( diff_over + diff_under );
-    }
+  return 1;
+}
+
+/**********************************************************************
+ * C Code DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME num_gallop
+
+   DESCRIPTION  Advance a cursor along a monotonic numeric series until
+   it reaches a target value.
+
+   ARGUMENTS
+      IARG  nums      The numeric series
+      IARG  len       Length of the series
+      IARG  curr      Starting cursor position
+      IARG  inc       Direction the cursor moves in (1 or -1)
+      IARG  target    The value to reach
+
+   RETURN Returns the first position, starting at curr and moving by inc,
+   whose value is not less than target, or the position just past the
+   end of the series if there is none.
+
+   ALGORITHM Exponential (galloping) search:  steps of 1, 2, 4, ... are 
+   taken from curr until one reaches the target or passes the end, and
+   then the last interval is searched by bisection.  This takes time 
+   proportional to the log of the distance moved, and gives the same 
+   result as stepping by inc while the value is less than the target,
+   since the values increase in the direction of inc.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_gallop, num_align
+
+**********************************************************************/
+static Sint num_gallop( double *nums, Sint len, Sint curr, Sint inc,
+			double target )
+{
+  Sint lo, hi, mid, left;
+
+  /* number of steps before falling off the end */
+  left = ( inc > 0 ) ? len - curr : curr + 1;
+  if( left <= 0 || !( nums[curr] < target ))
+    return curr;
+
+  /* step lo is known to be less than target; find hi that is not */
+  lo = 0;
+  hi = 1;
+  while( hi < left && nums[ curr + hi * inc ] < target )
+  {
+    lo = hi;
+    hi = ( hi > left / 2 ) ? left : 2 * hi;
   }
+  if( hi > left )
+    hi = left;
 
-  UNPROTECT(5); //1+4 from time_get_pieces
+  while( hi - lo > 1 )
+  {
+    mid = lo + ( hi - lo ) / 2;
+    if( nums[ curr + mid * inc ] < target )
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return( curr + hi * inc );
+}
+
+/**********************************************************************
+ * C Code DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_gallop
+
+   DESCRIPTION  Advance a cursor along a monotonic time series until
+   it reaches a target time.
+
+   ARGUMENTS
+      IARG  days        Julian days of the time series
+      IARG  ms          Milliseconds of the time series
+      IARG  len         Length of the series
+      IARG  curr        Starting cursor position
+      IARG  inc         Direction the cursor moves in (1 or -1)
+      IARG  target_day  Julian day of the time to reach
+      IARG  target_ms   Milliseconds of the time to reach
+
+   RETURN Returns the first position, starting at curr and moving by inc,
+   whose time is not earlier than the target, or the position just past 
+   the end of the series if there is none.
+
+   ALGORITHM Like num_gallop, comparing the days and then the 
+   milliseconds.
+
+   EXCEPTIONS 
+
+   NOTE See also: num_gallop, time_align
+
+**********************************************************************/
+#define TIME_BEFORE(i) (( days[i] < target_day ) || \
+  (( days[i] == target_day ) && ( ms[i] < target_ms )))
+
+static Sint time_gallop( Sint *days, Sint *ms, Sint len, Sint curr, 
+			 Sint inc, Sint target_day, Sint target_ms )
+{
+  Sint lo, hi, mid, left;
+
+  left = ( inc > 0 ) ? len - curr : curr + 1;
+  if( left <= 0 || !TIME_BEFORE( curr ))
+    return curr;
+
+  lo = 0;
+  hi = 1;
+  while( hi < left && TIME_BEFORE( curr + hi * inc ))
+  {
+    lo = hi;
+    hi = ( hi > left / 2 ) ? left : 2 * hi;
+  }
+  if( hi > left )
+    hi = left;
+
+  while( hi - lo > 1 )
+  {
+    mid = lo + ( hi - lo ) / 2;
+    if( TIME_BEFORE( curr + mid * inc ))
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return( curr + hi * inc );
+}
+
+#undef TIME_BEFORE
+
+/**********************************************************************
+ * C Code DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_key
+
+   DESCRIPTION  Convert a julian day and milliseconds to an exact 64-bit
+   count of milliseconds since the start of January 1, 1960.
+
+   ARGUMENTS
+      IARG  day    The julian day
+      IARG  ms     The milliseconds since midnight
+      OARG  key    The milliseconds since 1960
+
+   RETURN Returns 1/0 for success/failure.  The routine fails for the 
+   same milliseconds that ms_to_fraction rejects.
+
+   ALGORITHM Milliseconds in a leap second are counted as the end of 
+   the day, as in ms_to_fraction, so that differences of keys divided
+   by the milliseconds in a day agree with differences of fractional
+   days, without rounding error.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_align
+
+**********************************************************************/
+static int time_key( Sint day, Sint ms, long long *key )
+{
+  if( !key || ( ms < 0 ) || ( ms >= ( MS_PER_DAY + 1000 )))
+    return 0;
+  if( ms > MS_PER_DAY )
+    ms = MS_PER_DAY;
+  *key = (long long) day * MS_PER_DAY + ms;
+  return 1;
+}
+
+/* the return list of an alignment, with the outputs in out set up from
+   how_obj and match_tol; the list has 6 elements for interpolation, and
+   otherwise 3, or 6 if full_list is set.  The list is left protected. */
+
+static SEXP align_out_new( SEXP how_obj, SEXP match_tol, Sint align_len,
+			   int full_list, ALIGN_OUT *out, const char *fn )
+{
+  SEXP ret;
+  const char *how_str;
+  static const char *how_names[] = { 
+    "NA", "drop", "nearest", "before", "after", "interp" 
+  };
+
+  if( !IS_CHARACTER( how_obj ) || ( length(how_obj) < 2 ) ||
+      !IS_NUMERIC( match_tol ) || ( length(match_tol) < 1 ))
+    error( "Invalid data in c function %s", fn ); 
+
+  how_str = CHAR(STRING_ELT(how_obj, 0));
+  for( out->how = 0; out->how < 6; out->how++ )
+    if( !strcmp( how_str, how_names[ out->how ] ))
+      break;
+  if( out->how >= 6 )
+    error( "Invalid third argument in C function %s", fn );
+
+  how_str = CHAR(STRING_ELT(how_obj, 1));
+  for( out->error_how = 0; out->error_how < 3; out->error_how++ )
+    if( !strcmp( how_str, how_names[ out->error_how ] ))
+      break;
+  if( out->error_how >= 3 )
+    error( "Invalid third argument in C function %s", fn );
+
+  out->match_tol = REAL( match_tol )[0];
+  if( out->match_tol < 0 )
+    error( "Invalid fourth argument in C function %s", fn );
+
+  out->sub2_data = NULL;
+  out->weight1_data = out->weight2_data = NULL;
+
+  if( out->how == 5 )
+  {
+    PROTECT(ret = NEW_LIST(6));
+    out->na_data = LOGICAL( SET_VECTOR_ELT(ret, 0 , NEW_LOGICAL(align_len)) );
+    out->drop_data = LOGICAL( SET_VECTOR_ELT(ret, 1 , NEW_LOGICAL(align_len)) );
+    out->weight1_data = REAL( SET_VECTOR_ELT(ret, 2 , NEW_NUMERIC(align_len)) );
+    out->sub1_data = INTEGER( SET_VECTOR_ELT(ret, 3 , NEW_INTEGER(align_len)) );
+    out->weight2_data = REAL( SET_VECTOR_ELT(ret, 4 , NEW_NUMERIC(align_len)) );
+    out->sub2_data = INTEGER( SET_VECTOR_ELT(ret, 5 , NEW_INTEGER(align_len)) );
+  } else
+  {
+    PROTECT(ret = NEW_LIST( full_list ? 6 : 3 ));
+    out->na_data = LOGICAL( SET_VECTOR_ELT(ret, 0 , NEW_LOGICAL(align_len)) );
+    out->drop_data = LOGICAL( SET_VECTOR_ELT(ret, 1 , NEW_LOGICAL(align_len)) );
+    out->sub1_data = INTEGER( SET_VECTOR_ELT(ret, 2 , NEW_INTEGER(align_len)) );
+  }
 
   return( ret );
 }
 
+/* set the outputs for alignment position align_curr, from the input
+   positions in_curr (the first not before it) and in_curr - in_inc (the
+   last before it), if they are inside the input series (over_set,
+   under_set), and their distances from it */
+
+static void align_set( const ALIGN_OUT *out, Sint align_curr, Sint in_curr,
+		       Sint in_inc, int over_set, int under_set, 
+		       double diff_over, double diff_under )
+{
+  out->na_data[ align_curr ] = 0;
+  out->drop_data[ align_curr ] = 0;
+  out->sub1_data[ align_curr ] = 1;
+  if( out->how == 5 )
+  {
+    out->weight1_data[ align_curr ] = 1.0;
+    out->sub2_data[ align_curr ] = 1;
+    out->weight2_data[ align_curr ] = 0.0;
+  }
+
+  /* is it a match? */
+  if( under_set && 
+      ( !over_set || ( diff_under < diff_over )) && /* better than over */
+      ( diff_under <= out->match_tol ))
+    out->sub1_data[ align_curr ] = 1 + in_curr - in_inc; /* matches under */
+  else if( over_set && ( diff_over <= out->match_tol ))
+    out->sub1_data[ align_curr ] = 1 + in_curr;  /* matches over */
+  else if(( out->how == 0 ) || 
+	  (( out->error_how == 0 ) &&
+	   (( !under_set && (( out->how == 3 ) || ( out->how == 5 ))) ||
+	    ( !over_set && (( out->how == 4 ) || ( out->how == 5 ))))))
+    out->na_data[ align_curr ] = 1;  /* make it an NA on no match */
+  else if(( out->how == 1 ) || 
+	  (( out->error_how == 1 ) &&
+	   (( !under_set && (( out->how == 3 ) || ( out->how == 5 ))) ||
+	    ( !over_set && (( out->how == 4 ) || ( out->how == 5 ))))))
+    out->drop_data[ align_curr ] = 1;  /* drop on no match */
+  else if(( out->how == 2 ) || 
+	  (( out->error_how == 2 ) &&
+	   (( !under_set && (( out->how == 3 ) || ( out->how == 5 ))) ||
+	    ( !over_set && (( out->how == 4 ) || ( out->how == 5 ))))))
+  {
+    /* take nearest on no match */
+    if( !under_set )  /* one end */
+      out->sub1_data[ align_curr ] = 1 + in_curr;
+    else if( !over_set ) /* other end */
+      out->sub1_data[ align_curr ] = 1 + in_curr - in_inc;
+    else if( diff_under <= diff_over ) 
+      out->sub1_data[ align_curr ] = 1 + in_curr - in_inc;
+    else
+      out->sub1_data[ align_curr ] = 1 + in_curr;
+  } else if( out->how == 3 ) /* before */
+    out->sub1_data[ align_curr ] = 1 + in_curr - in_inc;
+  else if( out->how == 4 ) /* after */
+    out->sub1_data[ align_curr ] = 1 + in_curr;
+  else /* interp */
+  {
+    out->sub1_data[ align_curr ] = 1 + in_curr;
+    out->sub2_data[ align_curr ] = 1 + in_curr - in_inc;
+    out->weight1_data[ align_curr ] = diff_under / ( diff_over + diff_under );
+    out->weight2_data[ align_curr ] = diff_over / ( diff_over + diff_under );
+  }
+}
+
+/* set up a sequence from the numeric vector c( from, to, by, length, 
+   form ); NA from, to, and by are only allowed where the form doesn't
+   use them.  The relative time forms get their step from the caller.
+   Exits with an error for invalid arguments. */
+
+static void seq_pos_init( SEQ_POS *sp, SEXP seq_pars, const char *fn )
+{
+  double *pars;
+
+  if( !IS_NUMERIC( seq_pars ) || ( length(seq_pars) < 5 ))
+    error( "Invalid sequence in c function %s", fn );
+  pars = REAL( seq_pars );
+
+  sp->from = pars[0];
+  sp->to = pars[1];
+  sp->by = pars[2];
+  if( ISNAN( pars[3] ) || ( pars[3] < 1 ) || ( pars[3] > INT_MAX ) ||
+      ISNAN( pars[4] ) || ( pars[4] < SEQ_FROM_BY ) || ( pars[4] > SEQ_REL_TO ))
+    error( "Invalid sequence in c function %s", fn );
+  sp->len = (Sint) pars[3];
+  sp->form = (int) pars[4];
+
+  if( sp->form < SEQ_REL )
+  {
+    if( !R_FINITE( sp->by ) || ( sp->by == 0 ) ||
+	(( sp->form != SEQ_TO_BY ) && !R_FINITE( sp->from )) ||
+	(( sp->form != SEQ_FROM_BY ) && !R_FINITE( sp->to )))
+      error( "Invalid sequence in c function %s", fn );
+    sp->inc = (( sp->by > 0 ) || ( sp->len < 2 )) ? 1 : -1;
+  }
+}
+
+/* element i of a numeric sequence, with the arithmetic of seq */
+
+static double seq_num( const SEQ_POS *sp, Sint i )
+{
+  double ret;
 
+  switch( sp->form )
+  {
+  case SEQ_TO_BY:
+    return( sp->to - ( sp->len - 1 - i ) * sp->by );
+
+  case SEQ_FROM_TO:
+    if(( i > 0 ) && ( i == sp->len - 1 ))
+      return( sp->to );
+    return( sp->from + i * sp->by );
+
+  case SEQ_UP_TO:
+    ret = sp->from + i * sp->by;
+    if(( sp->by > 0 ) ? ( ret > sp->to ) : ( ret < sp->to ))
+      ret = sp->to;
+    return( ret );
+
+  default:
+    return( sp->from + i * sp->by );
+  }
+}
+
+/* element i of a time sequence, as a key from time_key; returns 0 if 
+   it can't be found */
+
+static int seq_key( const SEQ_POS *sp, Sint i, long long *key )
+{
+  double num;
+  Sint day, ms;
+
+  if( sp->form == SEQ_REL || sp->form == SEQ_REL_TO )
+  {
+    if( !rtime_step_jms( &(sp->step), 
+			 ( sp->form == SEQ_REL ) ? i : sp->len - 1 - i,
+			 &day, &ms ))
+      return 0;
+  } else
+  {
+    /* as time_from_numeric converts it */
+    num = seq_num( sp, i );
+    if( !R_FINITE( num ) || ( fabs( num ) >= INT_MAX ))
+      return 0;
+    day = (Sint) floor( num );
+    if( !ms_from_fraction( num - day, &ms ) || !adjust_time( &day, &ms ))
+      return 0;
+  }
+
+  return( time_key( day, ms, key ));
+}
+
+/* the subscript that num_gallop would find for target in a numeric
+   sequence: the first, going in the direction the sequence increases,
+   whose element is not less than the target, or just past the end.
+   The estimate from the step is corrected by comparing elements. */
+
+#define SEQ_SUB(s) (( sp->inc > 0 ) ? (s) : sp->len - 1 - (s))
+
+static Sint seq_num_find( const SEQ_POS *sp, double target )
+{
+  double est;
+  Sint s;
+
+  if( sp->form == SEQ_TO_BY )
+    est = ( sp->len - 1 ) - ( sp->to - target ) / sp->by;
+  else
+    est = ( target - sp->from ) / sp->by;
+  if( sp->inc < 0 )
+    est = ( sp->len - 1 ) - est;
+
+  est = ceil( est );
+  if( ISNAN( est ) || ( est < 0 ))
+    s = 0;
+  else if( est > sp->len )
+    s = sp->len;
+  else
+    s = (Sint) est;
+
+  while(( s > 0 ) && !( seq_num( sp, SEQ_SUB( s - 1 )) < target ))
+    s--;
+  while(( s < sp->len ) && ( seq_num( sp, SEQ_SUB( s )) < target ))
+    s++;
+
+  return( SEQ_SUB( s ));
+}
+
+/* the same for a time sequence and a time_key target; returns 0 if an
+   element can't be found */
+
+static int seq_key_find( const SEQ_POS *sp, long long target, 
+			 Sint *in_curr )
+{
+  double est, step_ms;
+  long long key, start_key;
+  Sint s;
+
+  if( sp->form == SEQ_REL || sp->form == SEQ_REL_TO )
+  {
+    if( !time_key( sp->step.julian, sp->step.ms, &start_key ))
+      return 0;
+    step_ms = (double) sp->step.num;
+    if( sp->step.kind == RT_STEP_DAYS )
+      step_ms *= MS_PER_DAY;
+    else if( sp->step.kind == RT_STEP_MONTHS )
+      step_ms *= 30.436875 * MS_PER_DAY;
+    est = (double) ( target - start_key ) / step_ms;
+    if( sp->form == SEQ_REL_TO )
+      est = ( sp->len - 1 ) - est;
+  } else if( sp->form == SEQ_TO_BY )
+    est = ( sp->len - 1 ) - 
+      ( sp->to - (double) target / MS_PER_DAY ) / sp->by;
+  else
+    est = ( (double) target / MS_PER_DAY - sp->from ) / sp->by;
+  if( sp->inc < 0 )
+    est = ( sp->len - 1 ) - est;
+
+  est = ceil( est );
+  if( ISNAN( est ) || ( est < 0 ))
+    s = 0;
+  else if( est > sp->len )
+    s = sp->len;
+  else
+    s = (Sint) est;
+
+  for( ; s > 0; s-- )
+  {
+    if( !seq_key( sp, SEQ_SUB( s - 1 ), &key ))
+      return 0;
+    if( key < target )
+      break;
+  }
+  for( ; s < sp->len; s++ )
+  {
+    if( !seq_key( sp, SEQ_SUB( s ), &key ))
+      return 0;
+    if( !( key < target ))
+      break;
+  }
+
+  *in_curr = SEQ_SUB( s );
+  return 1;
+}
 
+#undef SEQ_SUB
@@ -12,10 +12,16 @@
 #include "timeObj.h"
 #include "zoneObj.h"
 #include "timeFuns.h"
+#include "relTime.h"
 #include <string.h>
 
 SEXP num_align( SEXP num_obj, SEXP align_pos, SEXP how_obj, SEXP match_tol );
 SEXP time_align( SEXP time_obj, SEXP align_pos, SEXP how_obj, SEXP match_tol );
+SEXP num_seq_align( SEXP seq_pars, SEXP align_pos, SEXP how_obj, 
+		    SEXP match_tol );
+SEXP time_seq_align( SEXP seq_pars, SEXP seq_start, SEXP rel_strs,
+		     SEXP align_pos, SEXP how_obj, SEXP match_tol,
+		     SEXP zone_list );
 
 
 #endif  // TIMELIB_ALIGN_H
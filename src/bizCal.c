@@ -0,0 +1,785 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ *
+ * It contains C code utility functions for business calendars: a bit
+ * per day over a range of dates, with a count of the business days
+ * before every block of days, so that business days can be tested,
+ * counted, and stepped over without searching a holiday list.  See
+ * bizCal.h for the layout.
+ *
+ * The exported functions here were written to be called with the
+ * .Call interface of R.  They include (see documentation below):
+  SEXP biz_calendar_make( SEXP hol_vec, SEXP weekend, SEXP range_vec,
+			  SEXP zone_list );
+  SEXP time_is_bizday( SEXP time_vec, SEXP cal, SEXP zone_list );
+  SEXP time_add_bizdays( SEXP time_vec, SEXP n_vec, SEXP cal,
+			 SEXP zone_list );
+  SEXP time_bizdays_between( SEXP from_vec, SEXP to_vec, SEXP cal,
+			     SEXP zone_list );
+  SEXP time_bizday_of_month( SEXP time_vec, SEXP cal, SEXP zone_list );
+*************************************************************************/
+
+#include "bizCal.h"
+
+static Sint mask_count( const BIZ_CALENDAR *bc, Sint from, Sint to );
+static Sint mask_step( const BIZ_CALENDAR *bc, Sint start, Sint num,
+		       int sgn );
+static int bit_count( unsigned int byte );
+static int local_julian( Sint julian, Sint ms, TZONE_STRUCT *tzone,
+			 TIME_DATE_STRUCT *td, Sint *local );
+static void biz_get_arg( SEXP cal, BIZ_CALENDAR *bc, const char *fn );
+
+/****************************
+  Exported functions
+ ****************************/
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME biz_calendar_get
+
+   DESCRIPTION  Read a business calendar from an R bizCalendar object.
+
+   ARGUMENTS
+      IARG  cal  The R bizCalendar object
+      OARG  bc   The calendar structure
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if the
+   object is not a bizCalendar or its slots are inconsistent.
+
+   ALGORITHM The structure points into the slots of the object, so it
+   is only valid while the object is.
+
+   EXCEPTIONS
+
+   NOTE See also: biz_calendar_make
+
+**********************************************************************/
+int biz_calendar_get( SEXP cal, BIZ_CALENDAR *bc )
+{
+  SEXP range, bits, rank, weekend, dates;
+  Sint ndays, i;
+  static const char *classes[] = {
+    BIZ_CALENDAR_CLASS_NAME
+  };
+
+  if( !cal || !bc || !checkClass( cal, classes, 1L ))
+    return 0;
+
+  range = GET_SLOT( cal, install( "range" ));
+  bits = GET_SLOT( cal, install( "bits" ));
+  rank = GET_SLOT( cal, install( "rank" ));
+  weekend = GET_SLOT( cal, install( "weekend" ));
+  dates = GET_SLOT( cal, install( "dates" ));
+
+  if( !IS_INTEGER(range) || length(range) != 2 || TYPEOF(bits) != RAWSXP ||
+      !IS_INTEGER(rank) || !IS_INTEGER(weekend) || !IS_INTEGER(dates))
+    return 0;
+
+  bc->first = INTEGER(range)[0];
+  bc->last = INTEGER(range)[1];
+  ndays = bc->last - bc->first + 1;
+  if( bc->first == NA_INTEGER || bc->last == NA_INTEGER || ndays < 0 )
+    return 0;
+  bc->nblock = ( ndays + BIZ_BLOCK - 1 ) / BIZ_BLOCK;
+  if( length(bits) != ( ndays + 7 ) / 8 || length(rank) != bc->nblock + 1 )
+    return 0;
+  bc->bits = RAW(bits);
+  bc->rank = INTEGER_READ(rank);
+
+  memset( bc->weekend, 0, sizeof(bc->weekend) );
+  for( i = 0; i < length(weekend); i++ )
+    if( INTEGER(weekend)[i] >= 0 && INTEGER(weekend)[i] <= 6 )
+      bc->weekend[ INTEGER(weekend)[i] ] = 1;
+  bc->week_biz = 0;
+  for( i = 0; i < 7; i++ )
+    bc->week_biz += !bc->weekend[i];
+  if( !bc->week_biz )
+    return 0;
+
+  bc->dates = INTEGER(dates);
+  bc->num_dates = length(dates);
+
+  return 1;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME biz_is_bizday
+
+   DESCRIPTION  Decide whether a julian day is a business day.
+
+   ARGUMENTS
+      IARG  bc      The calendar
+      IARG  julian  The julian day
+
+   RETURN Returns 1/0 for True/False.
+
+   ALGORITHM Within the range of the calendar the bit is tested;
+   outside it, the weekday is compared to the weekend mask.
+
+   EXCEPTIONS
+
+   NOTE See also: biz_rank
+
+**********************************************************************/
+int biz_is_bizday( const BIZ_CALENDAR *bc, Sint julian )
+{
+  Sint off;
+
+  if( julian < bc->first || julian > bc->last )
+    return( !bc->weekend[ julian_to_weekday( julian ) ] );
+
+  off = julian - bc->first;
+  return(( bc->bits[ off / 8 ] >> ( off % 8 )) & 1 );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME biz_rank
+
+   DESCRIPTION  Count the business days before a julian day.
+
+   ARGUMENTS
+      IARG  bc      The calendar
+      IARG  julian  The julian day
+
+   RETURN Returns the number of business days from the first day of
+   the calendar up to but not including julian, or minus the number
+   from julian up to but not including the first day, if julian is
+   before it.
+
+   ALGORITHM Within the range, the count before the block is read from
+   the rank table, and the bits of at most BIZ_BLOCK days are counted.
+   Outside the range, whole weeks are counted with the weekend mask,
+   and the remaining days one at a time.
+
+   EXCEPTIONS
+
+   NOTE See also: biz_select
+
+**********************************************************************/
+Sint biz_rank( const BIZ_CALENDAR *bc, Sint julian )
+{
+  Sint off, pos, count;
+
+  if( julian <= bc->first )
+    return( -mask_count( bc, julian, bc->first ));
+  if( julian > bc->last + 1 )
+    return( bc->rank[ bc->nblock ] + mask_count( bc, bc->last + 1, julian ));
+
+  off = julian - bc->first;
+  pos = ( off / BIZ_BLOCK ) * BIZ_BLOCK;
+  count = bc->rank[ off / BIZ_BLOCK ];
+
+  for( ; pos + 8 <= off; pos += 8 )
+    count += bit_count( bc->bits[ pos / 8 ] );
+  if( pos < off )
+    count += bit_count( bc->bits[ pos / 8 ] & (( 1u << ( off - pos )) - 1 ));
+
+  return( count );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME biz_select
+
+   DESCRIPTION  Find the business day with a given rank.
+
+   ARGUMENTS
+      IARG  bc    The calendar
+      IARG  rank  The rank, as returned by biz_rank
+
+   RETURN Returns the julian day of the business day whose biz_rank
+   is rank.
+
+   ALGORITHM Within the range, the block is found by binary search of
+   the rank table, and then the bits of the block are scanned.  Before
+   or after the range, whole weeks are skipped with the weekend mask.
+
+   EXCEPTIONS
+
+   NOTE See also: biz_rank
+
+**********************************************************************/
+Sint biz_select( const BIZ_CALENDAR *bc, Sint rank )
+{
+  Sint low, hi, mid, pos, left;
+  unsigned int byte;
+
+  if( rank < 0 )
+    return( mask_step( bc, bc->first, -rank, -1 ));
+  if( rank >= bc->rank[ bc->nblock ] )
+    return( mask_step( bc, bc->last + 1, rank - bc->rank[ bc->nblock ] + 1,
+		       1 ));
+
+  /* last block that starts with no more than rank business days */
+  low = 0;
+  hi = bc->nblock - 1;
+  while( low < hi )
+  {
+    mid = ( low + hi + 1 ) / 2;
+    if( bc->rank[ mid ] <= rank )
+      low = mid;
+    else
+      hi = mid - 1;
+  }
+
+  left = rank - bc->rank[ low ];
+  for( pos = low * BIZ_BLOCK; ; pos += 8 )
+  {
+    byte = bc->bits[ pos / 8 ];
+    if( bit_count( byte ) > left )
+      break;
+    left -= bit_count( byte );
+  }
+  for( ; ; pos++, byte >>= 1 )
+    if(( byte & 1 ) && !left-- )
+      break;
+
+  return( bc->first + pos );
+}
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME biz_calendar_make
+
+   DESCRIPTION  Make the bitset and indexes of a business calendar.
+   To be called from R as
+   \\
+   {\tt
+   .Call("biz_calendar_make", holidays, weekend, range, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  hol_vec    The R time object of holidays
+      IARG  weekend    Integer vector of weekend weekdays, 0 for Sunday
+      IARG  range_vec  R time object with the first and last dates
+      IARG  zone_list  The list of R time zone objects
+
+   RETURN Returns a list of the julian range, the bits, the rank
+   table, and the non-business weekdays, which are the slots of a
+   bizCalendar object (see bizCal.h).
+   This function exits with the standard R error syntax if
+   there is an error, such as the wrong type of input.
+
+   ALGORITHM The holidays and the range are converted to dates in
+   their time zones.  Every day of the range that is not in the
+   weekend gets its bit set, and then the bits of the holidays are
+   cleared.  NA holidays and holidays outside the range are ignored.
+
+   EXCEPTIONS
+
+   NOTE See also: biz_calendar_get
+
+**********************************************************************/
+SEXP biz_calendar_make( SEXP hol_vec, SEXP weekend, SEXP range_vec,
+			SEXP zone_list )
+{
+  SEXP ret, range, bits, rank, dates, names;
+  Sint *hol_days, *hol_ms, *range_days, *range_ms, *out_rank, *out_dates;
+  Sint lng_hol, lng_range, first, last, ndays, nblock, i, j, off, ndates;
+  unsigned char *out_bits;
+  int is_weekend[7], wday, count;
+  TIME_DATE_STRUCT td_hol, td_range;
+  TZONE_STRUCT *tzone_hol, *tzone_range;
+
+  if( !time_get_pieces( hol_vec, NULL, &hol_days, &hol_ms, &lng_hol, NULL,
+			&td_hol.zone, NULL ) ||
+      ( lng_hol && ( !hol_days || !hol_ms )) || !td_hol.zone )
+    error( "Invalid holiday argument in C function biz_calendar_make" );
+  if( !time_get_pieces( range_vec, NULL, &range_days, &range_ms, &lng_range,
+			NULL, &td_range.zone, NULL ) ||
+      lng_range != 2 || !td_range.zone )
+    error( "Invalid range argument in C function biz_calendar_make" );
+
+  tzone_hol = find_zone( td_hol.zone, zone_list );
+  tzone_range = find_zone( td_range.zone, zone_list );
+  if( !tzone_hol || !tzone_range )
+    error( "Unknown or unreadable time zone in C function biz_calendar_make" );
+
+  if( !IS_INTEGER(weekend) )
+    error( "Invalid weekend argument in C function biz_calendar_make" );
+  memset( is_weekend, 0, sizeof(is_weekend) );
+  for( i = 0; i < length(weekend); i++ )
+  {
+    if( INTEGER(weekend)[i] < 0 || INTEGER(weekend)[i] > 6 )
+      error( "Weekend days must be from 0 (Sunday) to 6 (Saturday)" );
+    is_weekend[ INTEGER(weekend)[i] ] = 1;
+  }
+  for( i = 0, count = 0; i < 7; i++ )
+    count += !is_weekend[i];
+  if( !count )
+    error( "A business calendar needs at least one business weekday" );
+
+  if( range_days[0] == NA_INTEGER || range_days[1] == NA_INTEGER ||
+      !local_julian( range_days[0], range_ms[0], tzone_range, &td_range,
+		     &first ) ||
+      !local_julian( range_days[1], range_ms[1], tzone_range, &td_range,
+		     &last ))
+    error( "The range of a business calendar cannot be NA" );
+  if( last < first - 1 || last - first >= BIZ_MAX_DAYS )
+    error( "The range of a business calendar must be increasing and cover at most %d days", BIZ_MAX_DAYS );
+
+  ndays = last - first + 1;
+  nblock = ( ndays + BIZ_BLOCK - 1 ) / BIZ_BLOCK;
+
+  PROTECT( range = NEW_INTEGER( 2 ));
+  PROTECT( bits = allocVector( RAWSXP, ( ndays + 7 ) / 8 ));
+  PROTECT( rank = NEW_INTEGER( nblock + 1 ));
+  INTEGER(range)[0] = first;
+  INTEGER(range)[1] = last;
+  out_bits = RAW(bits);
+  out_rank = INTEGER(rank);
+  memset( out_bits, 0, length(bits) );
+
+  /* weekdays first, then take out the holidays */
+  wday = ndays ? julian_to_weekday( first ) : 0;
+  for( off = 0; off < ndays; off++, wday = ( wday + 1 ) % 7 )
+    if( !is_weekend[ wday ] )
+      out_bits[ off / 8 ] |= (unsigned char) ( 1u << ( off % 8 ));
+
+  for( i = 0; i < lng_hol; i++ )
+  {
+    if( hol_days[i] == NA_INTEGER || hol_ms[i] == NA_INTEGER ||
+	!local_julian( hol_days[i], hol_ms[i], tzone_hol, &td_hol, &j ) ||
+	j < first || j > last )
+      continue;
+    off = j - first;
+    out_bits[ off / 8 ] &= (unsigned char) ~( 1u << ( off % 8 ));
+  }
+
+  /* rank table and the non-business weekdays */
+  out_rank[0] = 0;
+  for( i = 0; i < nblock; i++ )
+  {
+    count = 0;
+    for( off = i * BIZ_BLOCK; off < ( i + 1 ) * BIZ_BLOCK && off < ndays;
+	 off += 8 )
+      count += bit_count( out_bits[ off / 8 ] );
+    out_rank[ i + 1 ] = out_rank[i] + count;
+  }
+
+  ndates = 0;
+  wday = ndays ? julian_to_weekday( first ) : 0;
+  for( off = 0; off < ndays; off++, wday = ( wday + 1 ) % 7 )
+    if( wday != 0 && wday != 6 && !(( out_bits[ off / 8 ] >> ( off % 8 )) & 1 ))
+      ndates++;
+  PROTECT( dates = NEW_INTEGER( ndates ));
+  out_dates = INTEGER(dates);
+  ndates = 0;
+  wday = ndays ? julian_to_weekday( first ) : 0;
+  for( off = 0; off < ndays; off++, wday = ( wday + 1 ) % 7 )
+    if( wday != 0 && wday != 6 && !(( out_bits[ off / 8 ] >> ( off % 8 )) & 1 ))
+      out_dates[ ndates++ ] = first + off;
+
+  PROTECT( ret = NEW_LIST( 4 ));
+  SET_VECTOR_ELT( ret, 0, range );
+  SET_VECTOR_ELT( ret, 1, bits );
+  SET_VECTOR_ELT( ret, 2, rank );
+  SET_VECTOR_ELT( ret, 3, dates );
+  PROTECT( names = NEW_CHARACTER( 4 ));
+  SET_STRING_ELT( names, 0, mkChar( "range" ));
+  SET_STRING_ELT( names, 1, mkChar( "bits" ));
+  SET_STRING_ELT( names, 2, mkChar( "rank" ));
+  SET_STRING_ELT( names, 3, mkChar( "dates" ));
+  setAttrib( ret, R_NamesSymbol, names );
+
+  UNPROTECT(10); //6+4 from time_get_pieces
+  return( ret );
+}
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_is_bizday
+
+   DESCRIPTION  Decide whether the dates of a time object are business
+   days.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_is_bizday", time.vec, cal, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  time_vec   The R time object
+      IARG  cal        The R bizCalendar object
+      IARG  zone_list  The list of R time zone objects
+
+   RETURN Returns a logical vector, NA for NA times.
+   This function exits with the standard R error syntax if
+   there is an error, such as the wrong type of input.
+
+   ALGORITHM Each time is converted to its date in the time zone of
+   the time object, which is tested with biz_is_bizday.
+
+   EXCEPTIONS
+
+   NOTE See also: time_add_bizdays
+
+**********************************************************************/
+SEXP time_is_bizday( SEXP time_vec, SEXP cal, SEXP zone_list )
+{
+  SEXP ret;
+  Sint *in_days, *in_ms, lng, i, jul;
+  int *out;
+  TIME_DATE_STRUCT td;
+  TZONE_STRUCT *tzone;
+  BIZ_CALENDAR bc;
+
+  biz_get_arg( cal, &bc, "time_is_bizday" );
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL,
+			&td.zone, NULL ) ||
+      ( lng && ( !in_days || !in_ms )) || !td.zone )
+    error( "Invalid time argument in C function time_is_bizday" );
+  tzone = find_zone( td.zone, zone_list );
+  if( !tzone )
+    error( "Unknown or unreadable time zone in C function time_is_bizday" );
+
+  PROTECT( ret = NEW_LOGICAL( lng ));
+  out = LOGICAL(ret);
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( in_days[i] == NA_INTEGER || in_ms[i] == NA_INTEGER ||
+	!local_julian( in_days[i], in_ms[i], tzone, &td, &jul ))
+      out[i] = NA_LOGICAL;
+    else
+      out[i] = biz_is_bizday( &bc, jul );
+  }
+
+  UNPROTECT(3); //1+2 from time_get_pieces
+  return( ret );
+}
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_add_bizdays
+
+   DESCRIPTION  Add business days to the dates of a time object.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_add_bizdays", time.vec, n, cal, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  time_vec   The R time object
+      IARG  n_vec      Integer vector of business days to add
+      IARG  cal        The R bizCalendar object
+      IARG  zone_list  The list of R time zone objects
+
+   RETURN Returns a time object whose dates are the n'th business days
+   after (before, for negative n) the input dates, at the same local
+   time of day; n of 0 leaves the time as it is.  The shorter of
+   time_vec and n_vec is recycled.
+   This function exits with the standard R error syntax if
+   there is an error, such as the wrong type of input.
+
+   ALGORITHM The date is ranked with biz_rank, n is added, and the
+   date with the new rank found with biz_select.  The local time of
+   day is kept, and the result converted back to GMT with
+   jms_from_zone.
+
+   EXCEPTIONS
+
+   NOTE See also: time_bizdays_between
+
+**********************************************************************/
+SEXP time_add_bizdays( SEXP time_vec, SEXP n_vec, SEXP cal,
+		       SEXP zone_list )
+{
+  SEXP ret;
+  Sint *in_days, *in_ms, *out_days, *out_ms, *in_n;
+  Sint lng1, lng2, lng, i, jul, num;
+  TIME_DATE_STRUCT td;
+  TZONE_STRUCT *tzone;
+  BIZ_CALENDAR bc;
+
+  biz_get_arg( cal, &bc, "time_add_bizdays" );
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng1, NULL,
+			&td.zone, NULL ) ||
+      ( lng1 && ( !in_days || !in_ms )) || !td.zone )
+    error( "Invalid time argument in C function time_add_bizdays" );
+  tzone = find_zone( td.zone, zone_list );
+  if( !tzone )
+    error( "Unknown or unreadable time zone in C function time_add_bizdays" );
+
+  if( !IS_INTEGER(n_vec) )
+    error( "Invalid number of business days in C function time_add_bizdays" );
+  in_n = INTEGER(n_vec);
+  lng2 = length(n_vec);
+  if( lng1 && lng2 && ( lng1 % lng2 ) && ( lng2 % lng1 ))
+    error( "Length of longer operand is not a multiple of length of shorter in C function time_add_bizdays" );
+  lng = ( !lng1 || !lng2 ) ? 0 : (( lng1 > lng2 ) ? lng1 : lng2 );
+
+  PROTECT( ret = time_create_new( lng, &out_days, &out_ms ));
+  if( !ret || ( lng && ( !out_days || !out_ms )))
+    error( "Could not create return object in C function time_add_bizdays" );
+
+  for( i = 0; i < lng; i++ )
+  {
+    num = in_n[ i % lng2 ];
+    if( in_days[ i % lng1 ] == NA_INTEGER || in_ms[ i % lng1 ] == NA_INTEGER ||
+	num == NA_INTEGER ||
+	!local_julian( in_days[ i % lng1 ], in_ms[ i % lng1 ], tzone, &td,
+		       &jul ))
+    {
+      out_days[i] = NA_INTEGER;
+      out_ms[i] = NA_INTEGER;
+      continue;
+    }
+
+    if( num > 0 )
+      jul = biz_select( &bc, biz_rank( &bc, jul + 1 ) + num - 1 );
+    else if( num < 0 )
+      jul = biz_select( &bc, biz_rank( &bc, jul ) + num );
+
+    if( !julian_to_mdy( jul, &td ) ||
+	!jms_from_zone( &td, tzone, &(out_days[i]), &(out_ms[i]) ))
+    {
+      out_days[i] = NA_INTEGER;
+      out_ms[i] = NA_INTEGER;
+    }
+  }
+
+  UNPROTECT(3); //1+2 from time_get_pieces
+  return( ret );
+}
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_bizdays_between
+
+   DESCRIPTION  Count the business days between the dates of two time
+   objects.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_bizdays_between", from, to, cal, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  from_vec   The R time object of starting times
+      IARG  to_vec     The R time object of ending times
+      IARG  cal        The R bizCalendar object
+      IARG  zone_list  The list of R time zone objects
+
+   RETURN Returns an integer vector of the number of business days
+   after the from date up to and including the to date, negative if
+   the to date is earlier.  The shorter argument is recycled.
+   This function exits with the standard R error syntax if
+   there is an error, such as the wrong type of input.
+
+   ALGORITHM The difference of the biz_rank values of the days after
+   the two dates, each taken in its own time zone.
+
+   EXCEPTIONS
+
+   NOTE See also: time_add_bizdays
+
+**********************************************************************/
+SEXP time_bizdays_between( SEXP from_vec, SEXP to_vec, SEXP cal,
+			   SEXP zone_list )
+{
+  SEXP ret;
+  Sint *from_days, *from_ms, *to_days, *to_ms, *out;
+  Sint lng1, lng2, lng, i, i1, i2, jul1, jul2;
+  TIME_DATE_STRUCT td1, td2;
+  TZONE_STRUCT *tzone1, *tzone2;
+  BIZ_CALENDAR bc;
+
+  biz_get_arg( cal, &bc, "time_bizdays_between" );
+
+  if( !time_get_pieces( from_vec, NULL, &from_days, &from_ms, &lng1, NULL,
+			&td1.zone, NULL ) ||
+      ( lng1 && ( !from_days || !from_ms )) || !td1.zone ||
+      !time_get_pieces( to_vec, NULL, &to_days, &to_ms, &lng2, NULL,
+			&td2.zone, NULL ) ||
+      ( lng2 && ( !to_days || !to_ms )) || !td2.zone )
+    error( "Invalid time argument in C function time_bizdays_between" );
+  tzone1 = find_zone( td1.zone, zone_list );
+  tzone2 = find_zone( td2.zone, zone_list );
+  if( !tzone1 || !tzone2 )
+    error( "Unknown or unreadable time zone in C function time_bizdays_between" );
+
+  if( lng1 && lng2 && ( lng1 % lng2 ) && ( lng2 % lng1 ))
+    error( "Length of longer operand is not a multiple of length of shorter in C function time_bizdays_between" );
+  lng = ( !lng1 || !lng2 ) ? 0 : (( lng1 > lng2 ) ? lng1 : lng2 );
+
+  PROTECT( ret = NEW_INTEGER( lng ));
+  out = INTEGER(ret);
+
+  for( i = 0; i < lng; i++ )
+  {
+    i1 = i % lng1;
+    i2 = i % lng2;
+    if( from_days[i1] == NA_INTEGER || from_ms[i1] == NA_INTEGER ||
+	to_days[i2] == NA_INTEGER || to_ms[i2] == NA_INTEGER ||
+	!local_julian( from_days[i1], from_ms[i1], tzone1, &td1, &jul1 ) ||
+	!local_julian( to_days[i2], to_ms[i2], tzone2, &td2, &jul2 ))
+      out[i] = NA_INTEGER;
+    else
+      out[i] = biz_rank( &bc, jul2 + 1 ) - biz_rank( &bc, jul1 + 1 );
+  }
+
+  UNPROTECT(5); //1+4 from time_get_pieces
+  return( ret );
+}
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_bizday_of_month
+
+   DESCRIPTION  Find the number of each date among the business days
+   of its month.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_bizday_of_month", time.vec, cal, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  time_vec   The R time object
+      IARG  cal        The R bizCalendar object
+      IARG  zone_list  The list of R time zone objects
+
+   RETURN Returns an integer vector of the number of business days in
+   the month up to and including each date, so the first business day
+   of a month is 1, and days before it are 0.
+   This function exits with the standard R error syntax if
+   there is an error, such as the wrong type of input.
+
+   ALGORITHM The difference of the biz_rank values of the day after
+   the date and the first of its month.
+
+   EXCEPTIONS
+
+   NOTE See also: time_is_bizday
+
+**********************************************************************/
+SEXP time_bizday_of_month( SEXP time_vec, SEXP cal, SEXP zone_list )
+{
+  SEXP ret;
+  Sint *in_days, *in_ms, *out, lng, i, jul, jul1;
+  TIME_DATE_STRUCT td;
+  TZONE_STRUCT *tzone;
+  BIZ_CALENDAR bc;
+
+  biz_get_arg( cal, &bc, "time_bizday_of_month" );
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL,
+			&td.zone, NULL ) ||
+      ( lng && ( !in_days || !in_ms )) || !td.zone )
+    error( "Invalid time argument in C function time_bizday_of_month" );
+  tzone = find_zone( td.zone, zone_list );
+  if( !tzone )
+    error( "Unknown or unreadable time zone in C function time_bizday_of_month" );
+
+  PROTECT( ret = NEW_INTEGER( lng ));
+  out = INTEGER(ret);
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( in_days[i] == NA_INTEGER || in_ms[i] == NA_INTEGER ||
+	!local_julian( in_days[i], in_ms[i], tzone, &td, &jul ))
+    {
+      out[i] = NA_INTEGER;
+      continue;
+    }
+    jul1 = jul - td.day + 1;
+    out[i] = biz_rank( &bc, jul + 1 ) - biz_rank( &bc, jul1 );
+  }
+
+  UNPROTECT(3); //1+2 from time_get_pieces
+  return( ret );
+}
+
+/****************************
+  Internal functions
+ ****************************/
+
+/* number of days from to to - 1 that aren't in the weekend, for
+   from <= to */
+
+static Sint mask_count( const BIZ_CALENDAR *bc, Sint from, Sint to )
+{
+  Sint count;
+  int wday;
+
+  count = (( to - from ) / 7 ) * bc->week_biz;
+  from += (( to - from ) / 7 ) * 7;
+  for( wday = julian_to_weekday( from ); from < to;
+       from++, wday = ( wday + 1 ) % 7 )
+    count += !bc->weekend[ wday ];
+
+  return( count );
+}
+
+/* the num'th day (num >= 1) not in the weekend, counting forward from
+   start (sgn > 0) or backward from start - 1 (sgn < 0) */
+
+static Sint mask_step( const BIZ_CALENDAR *bc, Sint start, Sint num,
+		       int sgn )
+{
+  Sint weeks, day;
+
+  weeks = ( num - 1 ) / bc->week_biz;
+  num -= weeks * bc->week_biz;
+
+  if( sgn > 0 )
+  {
+    for( day = start + 7 * weeks - 1; num; )
+      if( !bc->weekend[ julian_to_weekday( ++day ) ] )
+	num--;
+  } else
+  {
+    for( day = start - 7 * weeks; num; )
+      if( !bc->weekend[ julian_to_weekday( --day ) ] )
+	num--;
+  }
+
+  return( day );
+}
+
+/* number of bits set in a byte */
+
+static int bit_count( unsigned int byte )
+{
+  byte = ( byte & 0x55 ) + (( byte >> 1 ) & 0x55 );
+  byte = ( byte & 0x33 ) + (( byte >> 2 ) & 0x33 );
+  return(( byte & 0x0f ) + ( byte >> 4 ));
+}
+
+/* date of a time in the given zone, with the local time in td */
+
+static int local_julian( Sint julian, Sint ms, TZONE_STRUCT *tzone,
+			 TIME_DATE_STRUCT *td, Sint *local )
+{
+  return( jms_to_zone( julian, ms, tzone, td ) &&
+	  julian_from_mdy( *td, local ));
+}
+
+/* read the calendar argument of an entry point, or exit with an error */
+
+static void biz_get_arg( SEXP cal, BIZ_CALENDAR *bc, const char *fn )
+{
+  if( !biz_calendar_get( cal, bc ))
+    error( "Invalid business calendar in C function %s", fn );
+}
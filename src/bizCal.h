@@ -0,0 +1,59 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+*************************************************************************/
+
+#ifndef TIMELIB_BIZCAL_H
+#define TIMELIB_BIZCAL_H
+
+#include "timeUtils.h"
+#include "timeObj.h"
+#include "zoneObj.h"
+#include "zoneFuns.h"
+#include "mdy.h"
+#include <string.h>
+
+/* A business calendar covers the local dates first to last with one
+   bit per day, set for business days, eight days to a byte starting
+   from the low bit.  rank[b] is the number of business days before
+   block b of BIZ_BLOCK days, for b from 0 to the number of blocks, so
+   the last entry is the total.  Outside the range, the weekend mask
+   alone decides.  dates holds the weekdays (Monday to Friday) in the
+   range that are not business days, sorted, which is the form of
+   holiday list that relative time addition uses. */
+
+#define BIZ_BLOCK 64
+#define BIZ_MAX_DAYS 3660000
+
+typedef struct biz_calendar_struct
+{
+  Sint first;
+  Sint last;
+  const unsigned char *bits;
+  const Sint *rank;
+  Sint nblock;
+  int weekend[7];
+  int week_biz;
+  Sint *dates;
+  Sint num_dates;
+} BIZ_CALENDAR;
+
+/* read the calendar from an R bizCalendar object */
+int biz_calendar_get( SEXP cal, BIZ_CALENDAR *bc );
+
+int biz_is_bizday( const BIZ_CALENDAR *bc, Sint julian );
+Sint biz_rank( const BIZ_CALENDAR *bc, Sint julian );
+Sint biz_select( const BIZ_CALENDAR *bc, Sint rank );
+
+SEXP biz_calendar_make( SEXP hol_vec, SEXP weekend, SEXP range_vec,
+			SEXP zone_list );
+SEXP time_is_bizday( SEXP time_vec, SEXP cal, SEXP zone_list );
+SEXP time_add_bizdays( SEXP time_vec, SEXP n_vec, SEXP cal,
+		       SEXP zone_list );
+SEXP time_bizdays_between( SEXP from_vec, SEXP to_vec, SEXP cal,
+			   SEXP zone_list );
+SEXP time_bizday_of_month( SEXP time_vec, SEXP cal, SEXP zone_list );
+
+#endif  // TIMELIB_BIZCAL_H
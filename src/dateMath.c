@@ -6,7 +6,9 @@
 *************************************************************************/
 
 #include "dateMath.h"
+#include <limits.h>
 #include <math.h>
+#include <string.h>
 
 /**********************************************************************
  * C Code Documentation ************************************************
@@ -30,12 +32,9 @@
    except that it operates on dates with times by truncating the times
    to midnight in the local time zone.  The calculation is performed by 
    converting from julian day and milliseconds to date, time of day, yearday,
-   and weekday using the julian_to_mdy, ms_to_hms, mdy_to_yday, and 
-   julian_to_weekday functions; then converting to the local time zone 
-   using GMT_to_zone;
+   and weekday in the local time zone using jms_to_zone;
    then dropping the time of day back to midnight and converting back to
-   GMT, julian days, and milliseconds using the GMT_from_zone,
-   julian_from_mdy, and ms_from_hms functions.
+   GMT, julian days, and milliseconds using the jms_from_zone function.
    \\
    \\
    The day number corresponds to the number of
@@ -69,21 +68,14 @@ int date_floor( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
   if( !zone || !out_jul || !out_ms )
     return 0;
 
-  td.weekday = julian_to_weekday( in_jul );
+  /* calculate month/day/year in the local zone */
 
-  /* calculate month/day/year and convert to local zone */
-
-  if( !julian_to_mdy( in_jul, &td ) ||
-      !ms_to_hms( in_ms, &td ) ||
-      !mdy_to_yday( &td ) ||
-      !GMT_to_zone( &td, zone ))
+  if( !jms_to_zone( in_jul, in_ms, zone, &td ))
     return 0;
 
   /* truncate the time to midnight and convert back */
   td.hour = td.minute = td.second = td.ms = 0;
-  if( !GMT_from_zone( &td, zone ) ||
-      !julian_from_mdy( td, out_jul ) ||
-      !ms_from_hms( td, out_ms ))
+  if( !jms_from_zone( &td, zone, out_jul, out_ms ))
     return 0;
 
   return 1;
@@ -112,12 +104,9 @@ int date_floor( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
    to midnight on the next day (unless the input was exactly midnight) 
    in the local time zone.  The calculation is performed by 
    converting from julian day and milliseconds to date, time of day, and
-   yearday, and weekday using the julian_to_mdy, ms_to_hms, mdy_to_yday, 
-   and julian_to_weekday functions; then converting to the local time zone 
-   using GMT_to_zone; 
+   yearday, and weekday in the local time zone using jms_to_zone; 
    then promoting the time of day to midnight and converting back to
-   GMT, julian days, and milliseconds using the GMT_from_zone,
-   julian_from_mdy, and ms_from_hms functions.
+   GMT, julian days, and milliseconds using the jms_from_zone function.
    \\
    \\
    The day number corresponds to the number of
@@ -151,14 +140,9 @@ int date_ceil( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
   if( !zone || !out_jul || !out_ms )
     return 0;
 
-  td.weekday = julian_to_weekday( in_jul );
-
-  /* calculate month/day/year and convert to local zone */
+  /* calculate month/day/year in the local zone */
 
-  if( !julian_to_mdy( in_jul, &td ) ||
-      !ms_to_hms( in_ms, &td ) ||
-      !mdy_to_yday( &td ) ||
-      !GMT_to_zone( &td, zone ))
+  if( !jms_to_zone( in_jul, in_ms, zone, &td ))
     return 0;
 
   /* advance the time to midnight and convert back */
@@ -168,9 +152,7 @@ int date_ceil( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
 
   td.hour = td.minute = td.second = td.ms = 0;
 
-  if( !GMT_from_zone( &td, zone ) ||
-      !julian_from_mdy( td, out_jul ) ||
-      !ms_from_hms( td, out_ms ))
+  if( !jms_from_zone( &td, zone, out_jul, out_ms ))
     return 0;
 
   return 1;
@@ -255,3 +237,712 @@ int add_offset( TIME_DATE_STRUCT *tstruc, Sint secs_to_add )
 
   return 1;
 }
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_unit_from_str
+
+   DESCRIPTION  Find the calendar unit code corresponding to a string.
+
+   ARGUMENTS
+      IARG  str      the unit abbreviation string
+
+   RETURN Returns the unit code, or UNIT_ERROR if the string is not
+   a known unit.
+
+   ALGORITHM The string is compared to the abbreviations
+   "ms", "sec", "min", "hr", "day", "wk", "mth", "qtr", and "yr".
+
+   EXCEPTIONS 
+
+   NOTE See also: date_bin_index, date_bin_start
+
+**********************************************************************/
+TIME_UNIT_CODE time_unit_from_str( const char *str )
+{
+  if( !str )
+    return UNIT_ERROR;
+
+  if( !strcmp( str, "ms" ))
+    return UNIT_MS;
+  if( !strcmp( str, "sec" ))
+    return UNIT_SEC;
+  if( !strcmp( str, "min" ))
+    return UNIT_MIN;
+  if( !strcmp( str, "hr" ))
+    return UNIT_HR;
+  if( !strcmp( str, "day" ))
+    return UNIT_DAY;
+  if( !strcmp( str, "wk" ))
+    return UNIT_WK;
+  if( !strcmp( str, "mth" ))
+    return UNIT_MTH;
+  if( !strcmp( str, "qtr" ))
+    return UNIT_QTR;
+  if( !strcmp( str, "yr" ))
+    return UNIT_YR;
+
+  return UNIT_ERROR;
+}
+
+static int bin_local_start( double index, TIME_UNIT_CODE unit, Sint k, 
+			    int week_start, Sint *ljul, Sint *lms );
+static int local_to_gmt( Sint ljul, Sint lms, TZONE_STRUCT *zone, 
+			 int daylight, Sint *gjul, Sint *gms );
+static int jms_before( Sint jul1, Sint ms1, Sint jul2, Sint ms2 );
+static int wall_round( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
+		       TIME_UNIT_CODE unit, Sint k, int week_start, 
+		       int is_ceil, Sint *out_jul, Sint *out_ms );
+static int wall_bin_start( int64_t local, int next, TIME_UNIT_CODE unit,
+			   Sint k, int week_start, int64_t *start );
+static int local_reached( Sint gjul, Sint gms, Sint ljul, Sint lms,
+			  TZONE_STRUCT *zone, int *reached );
+
+/* number of milliseconds in one of the sub-day units, or 0 */
+static double unit_ms( TIME_UNIT_CODE unit )
+{
+  switch( unit )
+  {
+  case UNIT_MS:
+    return 1.0;
+  case UNIT_SEC:
+    return 1000.0;
+  case UNIT_MIN:
+    return 60000.0;
+  case UNIT_HR:
+    return 3600000.0;
+  default:
+    return 0.0;
+  }
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME date_bin_index
+
+   DESCRIPTION  Find the ordinal number of the calendar bin containing
+   a local date and time.
+
+   ARGUMENTS
+      IARG  td_local    the date/time structure, in local time
+      IARG  unit        the calendar unit of the bins
+      IARG  k           the number of units in each bin
+      IARG  week_start  the weekday bins start on for weeks (0 = Sunday)
+      OARG  index       the bin number
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if the input 
+   structure does not correspond to a real date, if k is not positive,
+   or if the unit is unknown.
+
+   ALGORITHM Bins are numbered so that consecutive bins have consecutive
+   numbers, and bin 0 starts at the epoch of its unit:  midnight
+   January 1, 1960 for days and sub-day units, the first week_start
+   weekday on or before that day for weeks, and January of year 0 for 
+   months, quarters, and years.  Sub-day bins restart at each local 
+   midnight, so that the last bin of a day may be short if k units do 
+   not divide the day evenly.  Floor division is used throughout, so 
+   dates before the epoch are binned correctly.
+   \\
+   \\
+   Numbers are returned as doubles, because sub-day bins over a 
+   wide range of dates can exceed the integer range.
+
+   EXCEPTIONS 
+
+   NOTE See also: date_bin_start, time_unit_from_str
+
+**********************************************************************/
+int date_bin_index( TIME_DATE_STRUCT *td_local, TIME_UNIT_CODE unit,
+		    Sint k, int week_start, double *index )
+{
+  Sint ljul, lms;
+  double size, per_day, pos;
+
+  if( !td_local || !index || k < 1 )
+    return 0;
+
+  switch( unit )
+  {
+  case UNIT_MS:
+  case UNIT_SEC:
+  case UNIT_MIN:
+  case UNIT_HR:
+    if( !julian_from_mdy( *td_local, &ljul ) ||
+	!ms_from_hms( *td_local, &lms ))
+      return 0;
+    size = k * unit_ms( unit );
+    per_day = ceil( MS_PER_DAY / size );
+    pos = floor( lms / size );
+    if( pos > per_day - 1 )
+      pos = per_day - 1;
+    *index = ljul * per_day + pos;
+    return 1;
+
+  case UNIT_DAY:
+    if( !julian_from_mdy( *td_local, &ljul ))
+      return 0;
+    *index = floor( (double) ljul / k );
+    return 1;
+
+  case UNIT_WK:
+    if( !julian_from_mdy( *td_local, &ljul ))
+      return 0;
+    /* shift so that bin boundaries fall on week_start days */
+    *index = floor( (double) ( ljul - ( week_start - WEEKDAY_START )) / 
+		    ( 7.0 * k ));
+    return 1;
+
+  case UNIT_MTH:
+    *index = floor(( 12.0 * td_local->year + td_local->month - 1 ) / k );
+    return 1;
+
+  case UNIT_QTR:
+    *index = floor(( 12.0 * td_local->year + td_local->month - 1 ) / 
+		   ( 3.0 * k ));
+    return 1;
+
+  case UNIT_YR:
+    *index = floor( (double) td_local->year / k );
+    return 1;
+
+  default:
+    return 0;
+  }
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME date_bin_index_gmt
+
+   DESCRIPTION  Find the ordinal number of the calendar bin containing
+   a GMT time, where the bins are in a given time zone.
+
+   ARGUMENTS
+      IARG  in_jul      the input julian day number
+      IARG  in_ms       the input number of milliseconds since midnight
+      IARG  zone        the time zone
+      IARG  unit        the calendar unit of the bins
+      IARG  k           the number of units in each bin
+      IARG  week_start  the weekday bins start on for weeks (0 = Sunday)
+      OARG  index       the bin number
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if the input 
+   arguments do not correspond to a real date or time zone, or if 
+   date_bin_index fails.
+
+   ALGORITHM The time is converted to a local time structure using the
+   jms_to_zone function, and passed to date_bin_index.
+
+   EXCEPTIONS 
+
+   NOTE See also: date_bin_index, date_bin_start
+
+**********************************************************************/
+int date_bin_index_gmt( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
+			TIME_UNIT_CODE unit, Sint k, int week_start, 
+			double *index )
+{
+  TIME_DATE_STRUCT td;
+
+  if( !zone )
+    return 0;
+
+  if( !jms_to_zone( in_jul, in_ms, zone, &td ))
+    return 0;
+
+  return( date_bin_index( &td, unit, k, week_start, index ));
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME date_bin_start
+
+   DESCRIPTION  Find the starting time of a calendar bin.
+
+   ARGUMENTS
+      IARG  index       the bin number, from date_bin_index
+      IARG  zone        the time zone
+      IARG  unit        the calendar unit of the bins
+      IARG  k           the number of units in each bin
+      IARG  week_start  the weekday bins start on for weeks (0 = Sunday)
+      OARG  out_jul     the julian day of the bin start, in GMT
+      OARG  out_ms      the milliseconds of the bin start, in GMT
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if the input 
+   arguments do not correspond to a real date or time zone, if k is
+   not positive, or if the unit is unknown.
+
+   ALGORITHM This function inverts the numbering of date_bin_index to 
+   find the local date and time the bin starts at, and converts it
+   to GMT using the GMT_from_zone function.  If the local start time 
+   is ambiguous because of a daylight savings change, the earlier 
+   of the two times is used.  If the local start time falls in the
+   gap of a daylight savings change, the first time after the gap is
+   returned instead.
+   \\
+   \\
+   A bin lying entirely in a daylight savings gap has no times in it;
+   the returned time is then in a later bin, which callers can detect
+   by re-computing the bin number of the result.
+
+   EXCEPTIONS 
+
+   NOTE See also: date_bin_index, time_unit_from_str
+
+**********************************************************************/
+int date_bin_start( double index, TZONE_STRUCT *zone, TIME_UNIT_CODE unit,
+		    Sint k, int week_start, Sint *out_jul, Sint *out_ms )
+{
+  Sint ljul, lms;
+
+  if( !zone || !out_jul || !out_ms ||
+      !bin_local_start( index, unit, k, week_start, &ljul, &lms ))
+    return 0;
+
+  /* earlier of ambiguous times */
+  return( local_to_gmt( ljul, lms, zone, 1, out_jul, out_ms ));
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME date_floor_unit
+
+   DESCRIPTION  Like date_floor, but truncating to the start of a 
+   calendar bin of any unit rather than to midnight.
+
+   ARGUMENTS
+      IARG  in_jul      the input julian day number
+      IARG  in_ms       the input number of milliseconds since midnight
+      IARG  zone        the time zone
+      IARG  unit        the calendar unit of the bins
+      IARG  k           the number of units in each bin
+      IARG  week_start  the weekday bins start on for weeks (0 = Sunday)
+      OARG  out_jul     the calculated julian day number 
+      OARG  out_ms      the calculated millisecond number 
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if the input 
+   arguments do not correspond to a real date or time zone, if k is
+   not positive, or if the unit is unknown.
+
+   ALGORITHM The bin of the input's local time is found, with the same
+   numbering as date_bin_index.  The result is the latest time, no 
+   later than the input, at which the local clock shows the bin's 
+   starting time:  when it is ambiguous because of a daylight savings 
+   change, the later of the two times is used if it is not after the 
+   input, so 1:30 standard time after a fall-back change floors to 1:00
+   standard time for hours.  When the starting time falls in a daylight
+   savings gap, the first time after the gap is used.  The work is done
+   by wall_round.
+
+   EXCEPTIONS 
+
+   NOTE See also: date_ceil_unit, date_bin_index, date_bin_start
+
+**********************************************************************/
+int date_floor_unit( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
+		     TIME_UNIT_CODE unit, Sint k, int week_start,
+		     Sint *out_jul, Sint *out_ms )
+{
+  if( !zone || !out_jul || !out_ms || k < 1 )
+    return 0;
+
+  return( wall_round( in_jul, in_ms, zone, unit, k, week_start, 0,
+		      out_jul, out_ms ));
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME date_ceil_unit
+
+   DESCRIPTION  Like date_ceil, but rounding up to the start of a 
+   calendar bin of any unit rather than to midnight.
+
+   ARGUMENTS
+      IARG  in_jul      the input julian day number
+      IARG  in_ms       the input number of milliseconds since midnight
+      IARG  zone        the time zone
+      IARG  unit        the calendar unit of the bins
+      IARG  k           the number of units in each bin
+      IARG  week_start  the weekday bins start on for weeks (0 = Sunday)
+      OARG  out_jul     the calculated julian day number 
+      OARG  out_ms      the calculated millisecond number 
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if the input 
+   arguments do not correspond to a real date or time zone, if k is
+   not positive, or if the unit is unknown.
+
+   ALGORITHM If date_floor_unit returns the input, it is also the 
+   ceiling.  Otherwise the result is the earliest time after the input 
+   at which the local clock shows a bin starting time, which may be the
+   later of two ambiguous times for the input's own bin start.  A bin
+   start skipped over by a daylight savings gap counts as the first 
+   time after the gap, so bins lying entirely in a gap are skipped.
+   The work is done by wall_round.
+
+   EXCEPTIONS 
+
+   NOTE See also: date_floor_unit, date_bin_start
+
+**********************************************************************/
+int date_ceil_unit( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
+		    TIME_UNIT_CODE unit, Sint k, int week_start,
+		    Sint *out_jul, Sint *out_ms )
+{
+  if( !zone || !out_jul || !out_ms || k < 1 )
+    return 0;
+
+  return( wall_round( in_jul, in_ms, zone, unit, k, week_start, 1,
+		      out_jul, out_ms ));
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME bin_local_start
+
+   DESCRIPTION  Find the local date and time a calendar bin starts at.
+
+   ARGUMENTS
+      IARG  index       the bin number, from date_bin_index
+      IARG  unit        the calendar unit of the bins
+      IARG  k           the number of units in each bin
+      IARG  week_start  the weekday bins start on for weeks (0 = Sunday)
+      OARG  ljul        the local julian day of the bin start
+      OARG  lms         the local milliseconds of the bin start
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if k is
+   not positive, or if the unit is unknown.
+
+   ALGORITHM This function inverts the numbering of date_bin_index.
+
+   EXCEPTIONS 
+
+   NOTE See also: date_bin_index, date_bin_start
+
+**********************************************************************/
+static int bin_local_start( double index, TIME_UNIT_CODE unit, Sint k, 
+			    int week_start, Sint *ljul, Sint *lms )
+{
+  TIME_DATE_STRUCT td;
+  double size, per_day, day, mth;
+
+  if( k < 1 )
+    return 0;
+
+  switch( unit )
+  {
+  case UNIT_MS:
+  case UNIT_SEC:
+  case UNIT_MIN:
+  case UNIT_HR:
+    size = k * unit_ms( unit );
+    per_day = ceil( MS_PER_DAY / size );
+    day = floor( index / per_day );
+    *ljul = (Sint) day;
+    *lms = (Sint) (( index - day * per_day ) * size );
+    return 1;
+
+  case UNIT_DAY:
+    *ljul = (Sint) ( index * k );
+    *lms = 0;
+    return 1;
+
+  case UNIT_WK:
+    *ljul = (Sint) ( index * 7 * k ) + ( week_start - WEEKDAY_START );
+    *lms = 0;
+    return 1;
+
+  case UNIT_MTH:
+  case UNIT_QTR:
+  case UNIT_YR:
+    if( unit == UNIT_MTH )
+      mth = index * k;
+    else if( unit == UNIT_QTR )
+      mth = index * 3 * k;
+    else
+      mth = index * 12 * k;
+    td.year = (Sint) floor( mth / 12.0 );
+    td.month = (Sint) ( mth - 12.0 * td.year ) + 1;
+    td.day = 1;
+    *lms = 0;
+    return( julian_from_mdy( td, ljul ));
+
+  default:
+    return 0;
+  }
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME local_to_gmt
+
+   DESCRIPTION  Convert a local julian day and milliseconds to GMT.
+
+   ARGUMENTS
+      IARG  ljul        the local julian day
+      IARG  lms         the local milliseconds
+      IARG  zone        the time zone
+      IARG  daylight    1 for the earlier of two ambiguous times, 0 for
+                        the later
+      OARG  gjul        the GMT julian day
+      OARG  gms         the GMT milliseconds
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if the input 
+   arguments do not correspond to a real date or time zone.
+
+   ALGORITHM The time is converted with jms_from_zone, and then back 
+   with jms_to_zone.  If the local time was skipped over by a daylight
+   savings gap, the result is moved forward to the first time after 
+   the gap:  the gap ends no later than the length of the jump after
+   the converted time, and the end is found by bisection with 
+   local_reached.  A fixed-offset zone just has its offset subtracted.
+
+   EXCEPTIONS 
+
+   NOTE See also: date_bin_start
+
+**********************************************************************/
+static int local_to_gmt( Sint ljul, Sint lms, TZONE_STRUCT *zone, 
+			 int daylight, Sint *gjul, Sint *gms )
+{
+  TIME_DATE_STRUCT td;
+  Sint chk_jul, chk_ms, diff, lo_jul, lo_ms, mid_jul, mid_ms;
+  int reached;
+
+  /* a fixed-offset zone has no gaps or overlaps */
+  if( zone_is_fixed( zone ))
+  {
+    *gjul = ljul;
+    *gms = lms - 1000 * zone->offset;
+    return( adjust_time( gjul, gms ));
+  }
+
+  if( !jms_to_struct( ljul, lms, &td ))
+    return 0;
+
+  td.daylight = daylight;
+
+  if( !jms_from_zone( &td, zone, gjul, gms ))
+    return 0;
+
+  /* convert back, to see if the local start time was skipped over */
+  if( !jms_to_zone( *gjul, *gms, zone, &td ) ||
+      !julian_from_mdy( td, &chk_jul ) ||
+      !ms_from_hms( td, &chk_ms ))
+    return 0;
+
+  diff = ( ljul - chk_jul ) * MS_PER_DAY + ( lms - chk_ms );
+  if( diff <= 0 )
+    return 1;
+
+  /* move forward to the end of the gap, the first time whose local 
+     time is not before the one asked for; it is in (lo, lo + diff] */
+  lo_jul = *gjul;
+  lo_ms = *gms;
+  *gms += diff;
+  if( !adjust_time( gjul, gms ))
+    return 0;
+  while( diff > 1 )
+  {
+    mid_jul = lo_jul;
+    mid_ms = lo_ms + diff / 2;
+    if( !adjust_time( &mid_jul, &mid_ms ) ||
+	!local_reached( mid_jul, mid_ms, ljul, lms, zone, &reached ))
+      return 0;
+    if( reached )
+    {
+      *gjul = mid_jul;
+      *gms = mid_ms;
+      diff = diff / 2;
+    }
+    else
+    {
+      lo_jul = mid_jul;
+      lo_ms = mid_ms;
+      diff = diff - diff / 2;
+    }
+  }
+
+  return 1;
+}
+
+/* true if the first time is strictly before the second */
+static int jms_before( Sint jul1, Sint ms1, Sint jul2, Sint ms2 )
+{
+  return(( jul1 < jul2 ) || (( jul1 == jul2 ) && ( ms1 < ms2 )));
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME wall_round
+
+   DESCRIPTION  Do the work of date_floor_unit and date_ceil_unit.
+
+   ARGUMENTS
+      IARG  in_jul      the input julian day number
+      IARG  in_ms       the input number of milliseconds since midnight
+      IARG  zone        the time zone
+      IARG  unit        the calendar unit of the bins
+      IARG  k           the number of units in each bin
+      IARG  week_start  the weekday bins start on for weeks (0 = Sunday)
+      IARG  is_ceil     1 for the ceiling, 0 for the floor
+      OARG  out_jul     the calculated julian day number 
+      OARG  out_ms      the calculated millisecond number 
+
+   RETURN Returns 1/0 for success/failure.
+
+   ALGORITHM Times are handled as 64-bit milliseconds since 1960.  
+   zone_segment gives the interval of GMT times around the input in 
+   which the zone's offset does not change -- from the transition 
+   table of a zoneinfo zone, or from the daylight savings rules -- and
+   in it the wall clock is the GMT time plus the offset.  So the floor
+   walks back from the input and the ceiling forward, one interval at a
+   time, without converting times to dates in the zone:
+   \\
+   \\
+   For the floor, the start S of the input's local bin is found with 
+   wall_bin_start.  In the input's interval, S minus the offset is no 
+   later than the input; if it is not before the interval's start, it 
+   is the floor.  Otherwise, if S minus the previous interval's offset 
+   is not before that start, S was skipped over and the start of the
+   interval is the floor; if not, the walk goes on to the previous 
+   interval.  So the later of two ambiguous times is found first.
+   \\
+   \\
+   For the ceiling, the next bin start B after the input's local time 
+   is found, and B minus the offset is the ceiling if it is before the
+   end of the interval.  Otherwise the walk goes on to the next 
+   interval:  if B is not after the wall time the clock jumps to there,
+   B was skipped and the interval's start is the ceiling; otherwise B 
+   is found again from the bin starts not before that wall time, which
+   finds the later of two ambiguous times after a fall-back change.
+   \\
+   \\
+   Intervals may also end where the offset stays the same, and the 
+   walks just go on through them.  The walks stop at the first interval
+   holding a bin start, so they take a step or two for bins of a day or
+   less, and about two steps for each year of longer bins.
+
+   EXCEPTIONS 
+
+   NOTE See also: date_floor_unit, date_ceil_unit, zone_segment
+
+**********************************************************************/
+static int wall_round( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
+		       TIME_UNIT_CODE unit, Sint k, int week_start, 
+		       int is_ceil, Sint *out_jul, Sint *out_ms )
+{
+  int64_t in, out, bin, next_start, wall, start, end, prev_start, 
+    prev_end;
+  Sint offset, prev_offset;
+
+  in = (int64_t) in_jul * MS_PER_DAY + in_ms;
+  if( !zone_segment( zone, in, &start, &end, &offset ) ||
+      !wall_bin_start( in + 1000 * (int64_t) offset, 0, unit, k, 
+		       week_start, &bin ))
+    return 0;
+
+  /* the floor: walk back to the interval the bin start is in */
+  for( ;; )
+  {
+    out = bin - 1000 * (int64_t) offset;
+    if( out >= start )
+      break;
+    if( !zone_segment( zone, start - 1, &prev_start, &prev_end, 
+		       &prev_offset ))
+      return 0;
+    if( bin - 1000 * (int64_t) prev_offset >= start )
+    {
+      /* skipped over */
+      out = start;
+      break;
+    }
+    start = prev_start;
+    offset = prev_offset;
+  }
+
+  if( is_ceil && out != in )
+  {
+    /* the ceiling: walk forward from the input */
+    if( !zone_segment( zone, in, &start, &end, &offset ))
+      return 0;
+    wall = in + 1000 * (int64_t) offset;
+    for( ;; )
+    {
+      if( !wall_bin_start( wall, 1, unit, k, week_start, &next_start ))
+	return 0;
+      out = next_start - 1000 * (int64_t) offset;
+      if( out < end )
+	break;
+      if( !zone_segment( zone, end, &start, &end, &offset ))
+	return 0;
+      wall = start + 1000 * (int64_t) offset;
+      if( next_start <= wall )
+      {
+	/* skipped over */
+	out = start;
+	break;
+      }
+      /* bin starts not before the new wall time */
+      wall--;
+    }
+  }
+
+  /* back to julian days and milliseconds */
+  bin = ( out >= 0 ) ? out / MS_PER_DAY : -(( MS_PER_DAY - 1 - out ) / 
+					    MS_PER_DAY );
+  if( bin >= INT_MAX || bin <= INT_MIN )
+    return 0;
+  *out_jul = (Sint) bin;
+  *out_ms = (Sint) ( out - bin * MS_PER_DAY );
+  return 1;
+}
+
+/* the local start of the calendar bin containing local milliseconds
+   since 1960, or of the bin after it if next is 1; returns 1/0 for 
+   success/failure */
+static int wall_bin_start( int64_t local, int next, TIME_UNIT_CODE unit,
+			   Sint k, int week_start, int64_t *start )
+{
+  TIME_DATE_STRUCT td;
+  int64_t day;
+  Sint ljul, lms;
+  double index;
+
+  day = ( local >= 0 ) ? local / MS_PER_DAY : 
+    -(( MS_PER_DAY - 1 - local ) / MS_PER_DAY );
+  if( day >= INT_MAX || day <= INT_MIN ||
+      !jms_to_struct( (Sint) day, (Sint) ( local - day * MS_PER_DAY ), 
+		      &td ) ||
+      !date_bin_index( &td, unit, k, week_start, &index ) ||
+      !bin_local_start( index + next, unit, k, week_start, &ljul, &lms ))
+    return 0;
+
+  *start = (int64_t) ljul * MS_PER_DAY + lms;
+  return 1;
+}
+
+/* whether the local time of a GMT time is not before a local julian
+   day and milliseconds; returns 1/0 for success/failure */
+static int local_reached( Sint gjul, Sint gms, Sint ljul, Sint lms,
+			  TZONE_STRUCT *zone, int *reached )
+{
+  TIME_DATE_STRUCT td;
+  Sint chk_jul, chk_ms;
+
+  if( !jms_to_zone( gjul, gms, zone, &td ) ||
+      !julian_from_mdy( td, &chk_jul ) ||
+      !ms_from_hms( td, &chk_ms ))
+    return 0;
+
+  *reached = !jms_before( chk_jul, chk_ms, ljul, lms );
+  return 1;
+}
@@ -25,4 +25,43 @@ int date_ceil( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
 
 int add_offset( TIME_DATE_STRUCT *tstruc, Sint secs_to_add );
 
+/* calendar units for binning dates in local time */
+
+typedef enum time_unit_code
+{
+  UNIT_ERROR,
+  UNIT_MS,
+  UNIT_SEC,
+  UNIT_MIN,
+  UNIT_HR,
+  UNIT_DAY,
+  UNIT_WK,
+  UNIT_MTH,
+  UNIT_QTR,
+  UNIT_YR
+} TIME_UNIT_CODE;
+
+TIME_UNIT_CODE time_unit_from_str( const char *str );
+
+/* functions to find the calendar bin of a local time/date, and the
+   GMT starting time of a bin. return true/false for success/failure */
+
+int date_bin_index( TIME_DATE_STRUCT *td_local, TIME_UNIT_CODE unit,
+		    Sint k, int week_start, double *index );
+int date_bin_index_gmt( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
+			TIME_UNIT_CODE unit, Sint k, int week_start, 
+			double *index );
+int date_bin_start( double index, TZONE_STRUCT *zone, TIME_UNIT_CODE unit,
+		    Sint k, int week_start, Sint *out_jul, Sint *out_ms );
+
+/* functions to find the floor/ceiling for dates in calendar bins of 
+   any unit. return true/false for success/failure */
+
+int date_floor_unit( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
+		     TIME_UNIT_CODE unit, Sint k, int week_start,
+		     Sint *out_jul, Sint *out_ms );
+int date_ceil_unit( Sint in_jul, Sint in_ms, TZONE_STRUCT *zone,
+		    TIME_UNIT_CODE unit, Sint k, int week_start,
+		    Sint *out_jul, Sint *out_ms );
+
 #endif /* TIMELIB_DATEMATH_H */
@@ -0,0 +1,310 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ *
+ * It contains C code utility functions for the columns of R groupVec
+ * objects, such as time/date objects and time events.
+ *
+ * The exported functions here were written to be called with the
+ * .Call interface of R.  They include (see documentation below):
+  SEXP group_vec_subset( SEXP columns, SEXP index );
+*************************************************************************/
+
+#include "groupVec.h"
+
+#include <math.h>
+#include <limits.h>
+
+static const char *IS_GROUP_CLASS[] = {
+  TIME_CLASS_NAME,
+  TSPAN_CLASS_NAME
+};
+
+static int gather_leaf( SEXP col );
+static Sint *gather_index( SEXP index, Sint len, Sint *out_len );
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME group_vec_subset
+
+   DESCRIPTION  Subscript all the columns of a groupVec object at once.
+   To be called from R as
+   \\
+   {\tt
+   .Call("group_vec_subset", x@columns, i)
+   }
+
+   ARGUMENTS
+      IARG  columns  The list of columns of the groupVec object
+      IARG  index    A logical or numeric subscript, without attributes
+
+   RETURN Returns the list of subscripted columns, as lapply of ``[''
+   would give it, or NULL if a column or the subscript has to be left
+   to R.
+
+   ALGORITHM The columns can be plain integer, logical, double, or
+   character vectors, or time/date or time span objects whose own
+   columns are such vectors (so the start and end columns of a time
+   event are included).  The subscript is turned into a list of
+   positions once, in the way R does for vectors: logical subscripts
+   are recycled, zeros are dropped, negative numbers exclude positions,
+   and NA or positions past the end give NA.  Subscripts mixing
+   positive and negative numbers, which R reports as errors, are left
+   to R.  Then one pass over the positions fills in all the numeric
+   vectors.
+
+   EXCEPTIONS
+
+   NOTE
+
+**********************************************************************/
+SEXP group_vec_subset( SEXP columns, SEXP index )
+{
+  SEXP ret, col, in_cols, out_cols, leaf, out_leaf;
+  SEXP *in_str, *out_str;
+  Sint ncol, nleaf, nint, nreal, nstr, len, out_len, i, j, k, pos;
+  Sint **int_in, **int_out, *idx;
+  double **real_in, **real_out;
+  int nested;
+
+  if( !isNewList( columns ))
+    error( "Invalid columns argument in C function group_vec_subset" );
+  if( !isLogical( index ) && !isInteger( index ) && !isReal( index ))
+    return( R_NilValue );
+
+  /* check the columns, and count their vectors of each kind */
+  ncol = length( columns );
+  nint = nreal = nstr = 0;
+  len = -1;
+  for( i = 0; i < ncol; i++ )
+  {
+    col = VECTOR_ELT( columns, i );
+    nested = !gather_leaf( col );
+    if( nested )
+    {
+      if( !OBJECT( col ) || !checkClass( col, IS_GROUP_CLASS, 2L ))
+	return( R_NilValue );
+      in_cols = GET_SLOT( col, install( "columns" ));
+      if( !isNewList( in_cols ))
+	return( R_NilValue );
+      nleaf = length( in_cols );
+    }
+    else
+      nleaf = 1;
+
+    for( j = 0; j < nleaf; j++ )
+    {
+      leaf = nested ? VECTOR_ELT( in_cols, j ) : col;
+      if( !gather_leaf( leaf ))
+	return( R_NilValue );
+      if( len < 0 )
+	len = length( leaf );
+      else if( length( leaf ) != len )
+	return( R_NilValue );
+
+      if( TYPEOF( leaf ) == REALSXP )
+	nreal++;
+      else if( TYPEOF( leaf ) == STRSXP )
+	nstr++;
+      else
+	nint++;
+    }
+  }
+  if( len < 0 )
+    len = 0;
+
+  idx = gather_index( index, len, &out_len );
+  if( !idx )
+    return( R_NilValue );
+
+  /* make the output columns, keeping their objects and classes */
+  int_in = (Sint **) R_alloc( nint + 1, sizeof(Sint *) );
+  int_out = (Sint **) R_alloc( nint + 1, sizeof(Sint *) );
+  real_in = (double **) R_alloc( nreal + 1, sizeof(double *) );
+  real_out = (double **) R_alloc( nreal + 1, sizeof(double *) );
+  in_str = (SEXP *) R_alloc( nstr + 1, sizeof(SEXP) );
+  out_str = (SEXP *) R_alloc( nstr + 1, sizeof(SEXP) );
+  nint = nreal = nstr = 0;
+
+  PROTECT( ret = allocVector( VECSXP, ncol ));
+  setAttrib( ret, R_NamesSymbol, getAttrib( columns, R_NamesSymbol ));
+  for( i = 0; i < ncol; i++ )
+  {
+    col = VECTOR_ELT( columns, i );
+    nested = !gather_leaf( col );
+    if( nested )
+    {
+      in_cols = GET_SLOT( col, install( "columns" ));
+      nleaf = length( in_cols );
+      col = SET_VECTOR_ELT( ret, i, shallow_duplicate( col ));
+      PROTECT( out_cols = allocVector( VECSXP, nleaf ));
+      setAttrib( out_cols, R_NamesSymbol,
+		 getAttrib( in_cols, R_NamesSymbol ));
+      SET_SLOT( col, install( "columns" ), out_cols );
+      UNPROTECT(1);
+    }
+    else
+    {
+      in_cols = columns;
+      out_cols = ret;
+      nleaf = 1;
+    }
+
+    for( j = 0; j < nleaf; j++ )
+    {
+      k = nested ? j : i;
+      leaf = VECTOR_ELT( in_cols, k );
+      out_leaf = SET_VECTOR_ELT( out_cols, k,
+				 allocVector( TYPEOF( leaf ), out_len ));
+
+      if( TYPEOF( leaf ) == REALSXP )
+      {
+	real_in[ nreal ] = REAL( leaf );
+	real_out[ nreal++ ] = REAL( out_leaf );
+      } else if( TYPEOF( leaf ) == STRSXP )
+      {
+	in_str[ nstr ] = leaf;
+	out_str[ nstr++ ] = out_leaf;
+      } else
+      {
+	int_in[ nint ] = ( TYPEOF( leaf ) == LGLSXP ) ?
+	  LOGICAL( leaf ) : INTEGER( leaf );
+	int_out[ nint++ ] = ( TYPEOF( leaf ) == LGLSXP ) ?
+	  LOGICAL( out_leaf ) : INTEGER( out_leaf );
+      }
+    }
+  }
+
+  /* one pass for the numeric vectors; NA_LOGICAL is NA_INTEGER */
+  for( k = 0; k < out_len; k++ )
+  {
+    pos = idx[k];
+    for( j = 0; j < nint; j++ )
+      int_out[j][k] = ( pos < 0 ) ? NA_INTEGER : int_in[j][ pos ];
+    for( j = 0; j < nreal; j++ )
+      real_out[j][k] = ( pos < 0 ) ? NA_REAL : real_in[j][ pos ];
+  }
+
+  for( j = 0; j < nstr; j++ )
+    for( k = 0; k < out_len; k++ )
+      SET_STRING_ELT( out_str[j], k, ( idx[k] < 0 ) ? NA_STRING :
+		      STRING_ELT( in_str[j], idx[k] ));
+
+  UNPROTECT(1);
+  return( ret );
+}
+
+/* whether a column is a vector that can be gathered directly:
+   integer, logical, double, or character, without a class, names,
+   or dimensions, which R would have to subscript itself */
+
+static int gather_leaf( SEXP col )
+{
+  switch( TYPEOF( col ))
+  {
+  case INTSXP:
+  case LGLSXP:
+  case REALSXP:
+  case STRSXP:
+    return( !OBJECT( col ) &&
+	    ( getAttrib( col, R_NamesSymbol ) == R_NilValue ) &&
+	    ( getAttrib( col, R_DimSymbol ) == R_NilValue ));
+  default:
+    return 0;
+  }
+}
+
+/* the positions (from 0, or -1 for NA) that subscripting a vector of
+   length len with index takes, or NULL if it has to be left to R */
+
+static Sint *gather_index( SEXP index, Sint len, Sint *out_len )
+{
+  Sint ilen, i, n, *ret, *in_int = NULL;
+  double *in_real = NULL, val;
+  int has_pos = 0, has_neg = 0, has_na = 0;
+  char *drop;
+
+  if(( xlength( index ) > INT_MAX ) || ( len < 0 ))
+    return NULL;
+  ilen = length( index );
+
+  if( isLogical( index ))
+  {
+    /* recycled to the length, with positions past it NA */
+    in_int = LOGICAL( index );
+    n = ( ilen && ( ilen < len )) ? len : ilen;
+    *out_len = 0;
+    for( i = 0; i < n; i++ )
+      if( in_int[ i % ilen ] )
+	(*out_len)++;
+    ret = (Sint *) R_alloc( *out_len + 1, sizeof(Sint) );
+    *out_len = 0;
+    for( i = 0; i < n; i++ )
+    {
+      if( in_int[ i % ilen ] == NA_LOGICAL )
+	ret[ (*out_len)++ ] = -1;
+      else if( in_int[ i % ilen ] )
+	ret[ (*out_len)++ ] = ( i < len ) ? i : -1;
+    }
+    return( ret );
+  }
+
+  if( isInteger( index ))
+    in_int = INTEGER( index );
+  else
+    in_real = REAL( index );
+
+  /* numbers are truncated towards 0, as R does */
+  for( i = 0; i < ilen; i++ )
+  {
+    val = in_int ? (( in_int[i] == NA_INTEGER ) ? NA_REAL : in_int[i] ) :
+      in_real[i];
+    if( ISNAN( val ))
+      has_na = 1;
+    else if( val >= 1 )
+      has_pos = 1;
+    else if( val <= -1 )
+      has_neg = 1;
+  }
+
+  if( has_neg )
+  {
+    if( has_pos || has_na )
+      return NULL;
+
+    drop = (char *) R_alloc( len + 1, sizeof(char) );
+    memset( drop, 0, len + 1 );
+    for( i = 0; i < ilen; i++ )
+    {
+      val = in_int ? in_int[i] : in_real[i];
+      if(( val <= -1 ) && ( -val < (double) len + 1 ))
+	drop[ (Sint) ( -val ) - 1 ] = 1;
+    }
+    ret = (Sint *) R_alloc( len + 1, sizeof(Sint) );
+    *out_len = 0;
+    for( i = 0; i < len; i++ )
+      if( !drop[i] )
+	ret[ (*out_len)++ ] = i;
+    return( ret );
+  }
+
+  ret = (Sint *) R_alloc( ilen + 1, sizeof(Sint) );
+  *out_len = 0;
+  for( i = 0; i < ilen; i++ )
+  {
+    val = in_int ? (( in_int[i] == NA_INTEGER ) ? NA_REAL : in_int[i] ) :
+      in_real[i];
+    if( ISNAN( val ))
+      ret[ (*out_len)++ ] = -1;
+    else if( val >= 1 )
+      ret[ (*out_len)++ ] = ( val < (double) len + 1 ) ?
+	(Sint) val - 1 : -1;
+  }
+  return( ret );
+}
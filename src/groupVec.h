@@ -0,0 +1,16 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+*************************************************************************/
+
+#ifndef TIMELIB_GROUPVEC_H
+#define TIMELIB_GROUPVEC_H
+
+#include "timeUtils.h"
+#include <string.h>
+
+SEXP group_vec_subset( SEXP columns, SEXP index );
+
+#endif  // TIMELIB_GROUPVEC_H
@@ -0,0 +1,231 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ *
+ * It contains C code utility functions for evaluating holiday rule
+ * tables into sorted lists of dates.  See holidays.h for the layout of
+ * the tables.
+ *
+ * The exported functions here were written to be called with the
+ * .Call interface of R.  They include (see documentation below):
+  SEXP time_holidays( SEXP rules, SEXP years, SEXP observe );
+*************************************************************************/
+
+#include "holidays.h"
+
+static int rule_julian( const Sint *rules, Sint nrule, Sint row, Sint year,
+			Sint *julian );
+static int observe_nyse( Sint *julian, Sint nyse_start );
+static int compare_julian( const void *a, const void *b );
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_holidays
+
+   DESCRIPTION  Evaluate a holiday rule table for the given years.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_holidays", rules, years, observe)
+   }
+
+   ARGUMENTS
+      IARG  rules    The integer rule matrix (see holidays.h)
+      IARG  years    An integer vector of years
+      IARG  observe  The observance code for the whole calendar
+
+   RETURN Returns a sorted integer vector of the distinct julian days
+   of the holidays, without NA.
+   This function exits with the standard R error syntax if
+   there is an error, such as the wrong type of input.
+
+   ALGORITHM Each rule whose year limits include the year is evaluated
+   with julian_from_mdy, julian_from_index, or julian_easter_memo, offset,
+   and moved off the weekend if asked.  The observance is applied,
+   and the dates are then sorted and duplicates dropped.  The dates
+   are calendar days, so no time zones are involved.
+
+   EXCEPTIONS
+
+   NOTE See also: time_easter, time_from_month_day_index
+
+**********************************************************************/
+SEXP time_holidays( SEXP rules, SEXP years, SEXP observe )
+{
+  SEXP ret;
+  Sint *in_rules, *in_years, *buf, *out;
+  Sint nrule, nyear, i, j, n, nout, jul, nyse_start = 0;
+  int obs, wday;
+  TIME_DATE_STRUCT td;
+
+  if( !IS_INTEGER(rules) || !isMatrix(rules) ||
+      ncols(rules) != HOL_NCOL )
+    error( "Holiday rules must be an integer matrix with %d columns in c function time_holidays", HOL_NCOL );
+  if( !IS_INTEGER(years) || !IS_INTEGER(observe) || length(observe) < 1 )
+    error( "Invalid years or observe argument in c function time_holidays" );
+
+  in_rules = INTEGER(rules);
+  nrule = nrows(rules);
+  in_years = INTEGER(years);
+  nyear = length(years);
+  obs = INTEGER(observe)[0];
+
+  if( obs == HOL_OBSERVE_NYSE )
+  {
+    memset( &td, 0, sizeof(td) );
+    td.year = 1959;
+    td.month = 7;
+    td.day = 3;
+    julian_from_mdy( td, &nyse_start );
+  } else if( obs != HOL_OBSERVE_NONE )
+    error( "Unknown observance code in c function time_holidays" );
+
+  /* at most one date per rule and year */
+  buf = (Sint *) R_alloc( nrule * nyear + 1, sizeof(Sint) );
+  n = 0;
+
+  for( i = 0; i < nyear; i++ )
+  {
+    if( in_years[i] == NA_INTEGER )
+      continue;
+
+    for( j = 0; j < nrule; j++ )
+    {
+      if( !rule_julian( in_rules, nrule, j, in_years[i], &jul ))
+	continue;
+
+      if( in_rules[ j + HOL_COL_MOVE * nrule ] != 0 &&
+	  in_rules[ j + HOL_COL_MOVE * nrule ] != NA_INTEGER )
+      {
+	wday = julian_to_weekday( jul );
+	if( wday == 6 )
+	  jul--;
+	else if( wday == 0 )
+	  jul++;
+      }
+
+      if( obs == HOL_OBSERVE_NYSE && !observe_nyse( &jul, nyse_start ))
+	continue;
+
+      buf[n++] = jul;
+    }
+  }
+
+  /* sort and drop duplicates */
+  if( n > 1 )
+    qsort( buf, n, sizeof(Sint), compare_julian );
+  nout = 0;
+  for( i = 0; i < n; i++ )
+    if( !nout || buf[i] != buf[nout - 1] )
+      buf[nout++] = buf[i];
+
+  PROTECT( ret = allocVector( INTSXP, nout ));
+  out = INTEGER(ret);
+  for( i = 0; i < nout; i++ )
+    out[i] = buf[i];
+
+  UNPROTECT(1);
+  return( ret );
+}
+
+/* Julian day of rule row in the given year; returns 0 if the rule
+   doesn't apply that year or the date doesn't exist */
+
+static int rule_julian( const Sint *rules, Sint nrule, Sint row, Sint year,
+			Sint *julian )
+{
+  Sint from, to, offset;
+  TIME_DATE_STRUCT td;
+
+#define RULE(col) ( rules[ row + (col) * nrule ] )
+
+  from = RULE( HOL_COL_FROM );
+  to = RULE( HOL_COL_TO );
+  if(( from != NA_INTEGER && year < from ) ||
+     ( to != NA_INTEGER && year > to ))
+    return 0;
+
+  switch( RULE( HOL_COL_KIND ))
+  {
+  case HOL_FIXED:
+    if( RULE( HOL_COL_MONTH ) == NA_INTEGER ||
+	RULE( HOL_COL_DAY ) == NA_INTEGER )
+      return 0;
+    memset( &td, 0, sizeof(td) );
+    td.year = year;
+    td.month = RULE( HOL_COL_MONTH );
+    td.day = RULE( HOL_COL_DAY );
+    if( !julian_from_mdy( td, julian ))
+      return 0;
+    break;
+
+  case HOL_WEEKDAY:
+    if( RULE( HOL_COL_MONTH ) == NA_INTEGER ||
+	RULE( HOL_COL_WEEKDAY ) == NA_INTEGER ||
+	RULE( HOL_COL_INDEX ) == NA_INTEGER ||
+	!julian_from_index( RULE( HOL_COL_MONTH ), RULE( HOL_COL_WEEKDAY ),
+			    RULE( HOL_COL_INDEX ), year, julian ))
+      return 0;
+    break;
+
+  case HOL_EASTER:
+    if( !julian_easter_memo( year, julian ))
+      return 0;
+    break;
+
+  default:
+    return 0;
+  }
+
+  offset = RULE( HOL_COL_OFFSET );
+  if( offset != NA_INTEGER )
+    *julian += offset;
+
+#undef RULE
+
+  return 1;
+}
+
+/* NYSE observance of one holiday; returns 0 if it isn't observed.
+   A Saturday holiday stays put (and is dropped) when the Friday
+   before is the last weekday of its month, i.e. when the following
+   Monday is in a different month. */
+
+static int observe_nyse( Sint *julian, Sint nyse_start )
+{
+  TIME_DATE_STRUCT fri, mon;
+
+  switch( julian_to_weekday( *julian ))
+  {
+  case 0:
+    (*julian)++;
+    return 1;
+
+  case 6:
+    if( *julian < nyse_start ||
+	!julian_to_mdy( *julian - 1, &fri ) ||
+	!julian_to_mdy( *julian + 2, &mon ) ||
+	fri.month != mon.month )
+      return 0;
+    (*julian)--;
+    return 1;
+
+  default:
+    return 1;
+  }
+}
+
+/* qsort comparison for julian days */
+
+static int compare_julian( const void *a, const void *b )
+{
+  Sint ja = *(const Sint *) a, jb = *(const Sint *) b;
+
+  return(( ja > jb ) - ( ja < jb ));
+}
@@ -0,0 +1,54 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+*************************************************************************/
+
+#ifndef TIMELIB_HOLIDAYS_H
+#define TIMELIB_HOLIDAYS_H
+
+#include "timeUtils.h"
+#include "mdy.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* A holiday rule table is an integer matrix with one row per rule and
+   the columns below.  A rule gives one date per year, from the first
+   year to the last year (NA for no limit):
+
+     HOL_FIXED    month and day
+     HOL_WEEKDAY  index'th weekday (0-6, Sunday-Saturday) of the month,
+                  with index -1 for the last one
+     HOL_EASTER   Easter Sunday
+
+   The offset in days is then added, and if move is nonzero, dates on
+   Saturday move to Friday and dates on Sunday to Monday.  Dates that
+   don't exist (e.g. a 5th Monday) are left out. */
+
+#define HOL_COL_KIND 0
+#define HOL_COL_MONTH 1
+#define HOL_COL_DAY 2
+#define HOL_COL_WEEKDAY 3
+#define HOL_COL_INDEX 4
+#define HOL_COL_OFFSET 5
+#define HOL_COL_FROM 6
+#define HOL_COL_TO 7
+#define HOL_COL_MOVE 8
+#define HOL_NCOL 9
+
+#define HOL_FIXED 1
+#define HOL_WEEKDAY 2
+#define HOL_EASTER 3
+
+/* Observance applied to the whole calendar once the rules are
+   evaluated.  HOL_OBSERVE_NYSE moves Sunday holidays to Monday and,
+   from July 3, 1959, Saturday holidays to Friday unless the Friday is
+   the last weekday of its month; other weekend dates are dropped. */
+
+#define HOL_OBSERVE_NONE 0
+#define HOL_OBSERVE_NYSE 1
+
+SEXP time_holidays( SEXP rules, SEXP years, SEXP observe );
+
+#endif  // TIMELIB_HOLIDAYS_H
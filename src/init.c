@@ -12,6 +12,14 @@
 #include "zoneFuns.h"
 #include "stMath.h"
 #include "align.h"
+#include "timeAgg.h"
+#include "timeArrow.h"
+#include "timeCodec.h"
+#include "timeMap.h"
+#include "zoneTZif.h"
+#include "holidays.h"
+#include "bizCal.h"
+#include "groupVec.h"
 #include "Syms.h"
 
 #include <R_ext/Rdynload.h>
@@ -35,6 +43,10 @@ static R_CallMethodDef CallEntries[] = {
   CALLDEF(time_from_numeric, 2),
   CALLDEF(time_to_weekday, 2),
   CALLDEF(time_to_zone, 3),
+  CALLDEF(time_from_unix, 2),
+  CALLDEF(time_to_unix, 4),
+  CALLDEF(time_pack, 1),
+  CALLDEF(time_unpack, 1),
   CALLDEF(time_floor, 2),
   CALLDEF(time_ceiling, 2),
   CALLDEF(time_time_add, 4),
@@ -43,8 +55,34 @@ static R_CallMethodDef CallEntries[] = {
   CALLDEF(time_sum, 3),
   CALLDEF(time_rel_add, 4),
   CALLDEF(time_rel_seq, 7),
+  CALLDEF(time_rel_seq_index, 4),
+  CALLDEF(time_rel_seq_length, 4),
+  CALLDEF(time_seq_detect, 3),
   CALLDEF(num_align, 4),
   CALLDEF(time_align, 4),
+  CALLDEF(num_seq_align, 4),
+  CALLDEF(time_seq_align, 7),
+  CALLDEF(time_bin, 6),
+  CALLDEF(time_floor_unit, 6),
+  CALLDEF(time_ceiling_unit, 6),
+  CALLDEF(time_aggregate, 9),
+  CALLDEF(time_rolling, 5),
+  CALLDEF(time_arrow_allocate, 0),
+  CALLDEF(time_to_arrow, 3),
+  CALLDEF(time_from_arrow, 2),
+  CALLDEF(time_encode, 2),
+  CALLDEF(time_decode, 2),
+  CALLDEF(time_codec_info, 1),
+  CALLDEF(time_map_write, 3),
+  CALLDEF(time_map, 1),
+  CALLDEF(tzif_zone_info, 2),
+  CALLDEF(time_holidays, 3),
+  CALLDEF(biz_calendar_make, 4),
+  CALLDEF(time_is_bizday, 3),
+  CALLDEF(time_add_bizdays, 4),
+  CALLDEF(time_bizdays_between, 4),
+  CALLDEF(time_bizday_of_month, 3),
+  CALLDEF(group_vec_subset, 2),
   {NULL, NULL, 0}
 };
 
@@ -57,6 +95,9 @@ R_init_splusTimeDate(DllInfo *dll)
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
 
+    /* the ALTREP class for file-backed time columns */
+    time_map_init(dll);
+
 /* These are callable from other packages' C code: */
 
 #define RREGDEF(name)  R_RegisterCCallable("splusTimeDate", #name, (DL_FUNC) name)
@@ -35,6 +35,8 @@
 /* internal functions used below and defined at bottom of file
 */
 static Sint days_in_year( Sint year );
+static Sint days_before_year( Sint year );
+static Sint floor_div( Sint num, Sint den );
 static int  is_leap_year( Sint year );
 static Sint LRound( double num );
 
@@ -67,8 +69,9 @@ static Sint month_days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
    changed from Julian to Gregorian calendars in September of 1752.
    Prior to 8AD, results may be incorrect.
    The calculation is by simple tabulation of the number of days in
-   each month and year between the given date and 1/1/1960, through
-   calls to the days_in_month and days_in_year functions.
+   each month before the given date, through calls to the days_in_month
+   function, plus the number of days between 1/1/1960 and the start of
+   the year, which days_before_year finds in closed form.
 
    EXCEPTIONS 
 
@@ -112,10 +115,7 @@ int julian_from_mdy( TIME_DATE_STRUCT td_input, Sint *julian )
 
   for( i = 1; i <  td_input.month; i++ )
     *julian += days_in_month( i,  td_input.year );
-  for( i = JULIAN_YEAR; i <  td_input.year; i++ )
-    *julian += days_in_year( i );
-  for( i = JULIAN_YEAR - 1; i >=  td_input.year; i-- )
-    *julian -= days_in_year( i );
+  *julian += days_before_year( td_input.year );
 
   return( 1 );
 
@@ -521,6 +521,94 @@ int julian_easter( Sint year, Sint *julian )
   return 1;
 }
 
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME julian_easter_memo
+
+   DESCRIPTION  Calculate the julian day of Easter in the given year,
+   using a table of the years EASTER_TABLE_FIRST to EASTER_TABLE_LAST.
+
+   ARGUMENTS
+      IARG  year    the year to calculate it (e.g. 1978)
+      OARG  julian  the calculated day number
+
+   RETURN Returns 1/0 for success/failure.  The algorithm fails if
+   the pointer for the return value is NULL.
+
+   ALGORITHM The table is filled in with julian_easter the first time
+   a year in its window is asked for, and then read from.  Years
+   outside the window are calculated directly with julian_easter.
+   The window can be changed by defining EASTER_TABLE_FIRST and
+   EASTER_TABLE_LAST when compiling (see mdy.h).
+
+   EXCEPTIONS
+
+   NOTE See also: julian_easter, julian_easter_vec
+
+**********************************************************************/
+int julian_easter_memo( Sint year, Sint *julian )
+{
+  static Sint table[ EASTER_TABLE_LAST - EASTER_TABLE_FIRST + 1 ];
+  static int table_built = 0;
+  Sint i;
+
+  if( !julian )
+    return 0;
+
+  if(( year < EASTER_TABLE_FIRST ) || ( year > EASTER_TABLE_LAST ))
+    return( julian_easter( year, julian ));
+
+  if( !table_built )
+  {
+    for( i = EASTER_TABLE_FIRST; i <= EASTER_TABLE_LAST; i++ )
+      if( !julian_easter( i, &table[ i - EASTER_TABLE_FIRST ] ))
+	return 0;
+    table_built = 1;
+  }
+
+  *julian = table[ year - EASTER_TABLE_FIRST ];
+  return( 1 );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME julian_easter_vec
+
+   DESCRIPTION  Calculate the julian days of Easter in a vector of
+   years.
+
+   ARGUMENTS
+      IARG  years   the years
+      IARG  n       the number of years
+      OARG  julian  the calculated day numbers, NA for NA years
+
+   RETURN Returns 1/0 for success/failure.  The algorithm fails if
+   a pointer is NULL.
+
+   ALGORITHM Each year is looked up with julian_easter_memo.
+
+   EXCEPTIONS
+
+   NOTE See also: julian_easter_memo
+
+**********************************************************************/
+int julian_easter_vec( const Sint *years, Sint n, Sint *julian )
+{
+  Sint i;
+
+  if( !years || !julian )
+    return 0;
+
+  for( i = 0; i < n; i++ )
+    if(( years[i] == NA_INTEGER ) ||
+       !julian_easter_memo( years[i], &julian[i] ))
+      julian[i] = NA_INTEGER;
+
+  return( 1 );
+}
+
 /**********************************************************************
  * C Code Documentation ************************************************
  **********************************************************************
@@ -957,6 +1045,38 @@ static Sint days_in_year( Sint year )
   return 365L;
 }
 
+/* Number of days from 1/1/1960 to 1/1 of the given year, negative
+   before 1960.  Leap days are counted in closed form: Gregorian ones
+   after 1752, and then Julian ones, with 1752 itself 355 days long. */
+
+static Sint days_before_year( Sint year )
+{
+  Sint greg_days;
+
+  if( year > 1752 )
+    return( 365 * ( year - JULIAN_YEAR ) +
+	    floor_div( year - 1, 4 ) - floor_div( year - 1, 100 ) +
+	    floor_div( year - 1, 400 ) -
+	    ( floor_div( JULIAN_YEAR - 1, 4 ) - floor_div( JULIAN_YEAR - 1, 100 ) +
+	      floor_div( JULIAN_YEAR - 1, 400 )));
+
+  greg_days = days_before_year( 1753 ) - 355;
+  return( greg_days - 365 * ( 1752 - year ) -
+	  ( floor_div( 1751, 4 ) - floor_div( year - 1, 4 )));
+}
+
+/* integer division rounding down, for negative years */
+
+static Sint floor_div( Sint num, Sint den )
+{
+  Sint quot = num / den;
+
+  if(( num % den ) && (( num < 0 ) != ( den < 0 )))
+    quot--;
+  return( quot );
+}
+
+
 
 /**********************************************************************
  * C Code Documentation ************************************************
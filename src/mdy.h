@@ -10,6 +10,14 @@
 
 #include "timeUtils.h"
 
+/* window of years tabulated by julian_easter_memo */
+#ifndef EASTER_TABLE_FIRST
+#define EASTER_TABLE_FIRST 1753
+#endif
+#ifndef EASTER_TABLE_LAST
+#define EASTER_TABLE_LAST 2299
+#endif
+
 int julian_from_mdy( TIME_DATE_STRUCT td_input, Sint *julian );
 int julian_from_index( Sint month, Sint wkday, Sint index, Sint year, 
 		       Sint *julian );
@@ -17,6 +25,8 @@ int julian_to_mdy( Sint julian,  TIME_DATE_STRUCT *td_output );
 int julian_to_weekday( Sint julian );
 int mdy_to_yday( TIME_DATE_STRUCT *td_input );
 int julian_easter( Sint year, Sint *julian );
+int julian_easter_memo( Sint year, Sint *julian );
+int julian_easter_vec( const Sint *years, Sint n, Sint *julian );
 int ms_from_hms( TIME_DATE_STRUCT td_input, Sint *ms_ret );
 int ms_to_hms( Sint ms, TIME_DATE_STRUCT *td_output );
 int ms_from_fraction( double frac, Sint *ms );
@@ -47,10 +47,17 @@ typedef enum rt_code
 /* local function headers -- see doc in function headers below */
 
 static int rtcode_from_str( char *abb );
+static int rt_parse_fields( char *rt_str, RT_FIELD *buf, RT_FIELD **fields );
+static int rt_add_fields( TIME_DATE_STRUCT *td, const RT_FIELD *fields,
+			  int num_fields, Sint *hol_dates, Sint num_hols,
+			  TZONE_STRUCT *tzone );
 static int rt_add_one( TIME_DATE_STRUCT *td, int sgn, int align, int num,
 		       RT_CODE code, Sint *hol_dates, Sint num_hols );
-static int day_matches( Sint julian, RT_CODE code, Sint *hol_dates, 
-			Sint num_hols );
+static void rt_add_months( TIME_DATE_STRUCT *td, Sint months );
+static Sint rt_step_weekday( Sint julian, int sgn, int wkd );
+static Sint rt_step_weekdays( Sint julian, int sgn, Sint num );
+static Sint rt_count_holidays( Sint from, Sint to, const Sint *hol_dates, 
+			       Sint num_hols );
 
 
 /****************************
@@ -68,7 +75,7 @@ static int day_matches( Sint julian, RT_CODE code, Sint *hol_dates,
    ARGUMENTS
       IOARG  td        struct containing the month, day, year, hour, etc.
       IARG   rt_str    the relative time string
-      IARG   hol_dates dates of holidays
+      IARG   hol_dates sorted dates of holidays, without duplicates
       IARG   num_hols  number of holidays in hol_dates
 
    RETURN Returns 1/0 for success/failure.  The routine fails if the input 
@@ -94,87 +101,21 @@ static int day_matches( Sint julian, RT_CODE code, Sint *hol_dates,
 int rtime_add( TIME_DATE_STRUCT *td, char *rt_str, Sint *hol_dates, 
 	       Sint num_hols )
 {
-  int pos, num_ch, i, ret;
-  int sgn, align, num;
-  char *abb, tmpchr;
-  RT_CODE code;
+  RT_FIELD buf[ RT_FIELD_BUF ], *fields;
+  int num_fields, i;
   Sint jul;
 
   if( (num_hols && !hol_dates) ||
       !td || !rt_str )
     return 0;
 
-  num_ch = strlen( rt_str );
-  pos = 0;
-
-  while( pos < num_ch )
-  {
-    /* get past white space */
-    while(( pos < num_ch ) && isspace( rt_str[pos] ))
-      pos++;
-
-    if( pos >= num_ch )
-      break;
-
-    /* next character (sign) must be + or - */
-    if( rt_str[pos] == '+' )
-      sgn = 1;
-    else if( rt_str[pos] == '-' )
-      sgn = -1;
-    else
-      return 0;
-
-    if( ++pos >= num_ch )
-      return 0;
-    
-    /* next character is optional a for align */
-    align = 0;
-    if( rt_str[pos] == 'a' )
-    {
-      align = 1;
-      if( ++pos >= num_ch )
-	return 0;
-    }
+  if(( num_fields = rt_parse_fields( rt_str, buf, &fields )) < 0 )
+    return 0;
 
-    /* next characters are number to add
-       find out how many digits there are */
-    for( i = 0; pos + i < num_ch; i++ )
-      if( !isdigit(rt_str[pos + i]))
-	break;
-    if(( i < 1 ) || ( pos + i >= num_ch ))
+  for( i = 0; i < num_fields; i++ )
+    if( !rt_add_one( td, fields[i].sgn, fields[i].align, fields[i].num, 
+		     (RT_CODE) fields[i].code, hol_dates, num_hols ))
       return 0;
-    
-    /* read the digits */
-    tmpchr = rt_str[ pos + i ];
-    rt_str[ pos + i ] = '\0';
-	/* S7 CHANGE Changing sscanf back to sscanf for win64 to retain correct return value */
-    ret = sscanf( &(rt_str[pos]), "%d", &num );
-    rt_str[ pos + i ] = tmpchr;
-    if( ret != 1 )
-      return 0;
-    pos += i;
-
-    /* next characters to white space are the abbreviation code */
-    abb = &(rt_str[pos]);
-    while(( pos < num_ch ) && !isspace( rt_str[pos] ))
-      pos++;
-    if( pos > num_ch )
-      return 0;
-    if( pos < num_ch )
-    {
-      tmpchr = rt_str[pos];
-      rt_str[pos] = '\0';
-      code = rtcode_from_str( abb );
-      rt_str[pos] = tmpchr;
-    } else /* this is end of string */
-      code = rtcode_from_str( abb );
-
-    if( !rt_add_one( td, sgn, align, num, code, hol_dates, num_hols ))
-      return 0;
-
-    /* that's it, go ahead and continue */
-    pos++;
-  }
 
   /* put the weekday and yearday back */
   
@@ -199,7 +140,7 @@ int rtime_add( TIME_DATE_STRUCT *td, char *rt_str, Sint *hol_dates,
    ARGUMENTS
       IOARG  td        struct with month, day, year, hour, etc. (GMT)
       IARG   rt_str    the relative time string
-      IARG   hol_dates dates of holidays
+      IARG   hol_dates sorted dates of holidays, without duplicates
       IARG   num_hols  number of holidays in hol_dates
       IARG   tzone     time zone to use for conversions
 
@@ -228,22 +169,66 @@ int rtime_add( TIME_DATE_STRUCT *td, char *rt_str, Sint *hol_dates,
 int rtime_add_with_zones( TIME_DATE_STRUCT *td, char *rt_str, Sint *hol_dates, 
 	       Sint num_hols, TZONE_STRUCT *tzone )
 {
-  int pos, num_ch, i, ret;
-  int sgn, align, num;
-  char *abb, tmpchr;
-  RT_CODE code;
-  Sint jul;
-  int in_GMT;
-  int need_local;
-
-  in_GMT = 1;
+  RT_FIELD buf[ RT_FIELD_BUF ], *fields;
+  int num_fields;
 
   if( (num_hols && !hol_dates) ||
       !td || !rt_str || !tzone )
     return 0;
 
+  if(( num_fields = rt_parse_fields( rt_str, buf, &fields )) < 0 )
+    return 0;
+
+  return( rt_add_fields( td, fields, num_fields, hol_dates, num_hols, 
+			 tzone ));
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME rtime_parse
+
+   DESCRIPTION  Parse a relative time string into its fields, so that it
+   can be added to many times without parsing it again.
+
+   ARGUMENTS
+      IARG   rt_str      the relative time string
+      OARG   fields      array for the parsed fields
+      IARG   max_fields  size of the fields array
+
+   RETURN Returns the number of fields in the string, or -1 if it is
+   not a valid relative time string.  Only the first max_fields fields
+   are stored, so if the return value is larger than max_fields, the
+   string needs to be parsed again with a larger array.
+
+   ALGORITHM Each field is a sign, an optional a for alignment, a 
+   number, and an abbreviation, and fields are separated by white space.
+   The abbreviation is looked up with local function rtcode_from_str.
+   The string is not modified.
+
+   EXCEPTIONS 
+
+   NOTE  See documentation for relative time class in R for notes
+   on the format of relative time strings.
+   \\
+   \\
+   See also: rtime_add_jms
+
+**********************************************************************/
+int rtime_parse( const char *rt_str, RT_FIELD *fields, int max_fields )
+{
+  int pos, num_ch, i, count;
+  int sgn, align;
+  long num;
+  char abb[ RT_ABB_MAX + 1 ];
+  RT_CODE code;
+
+  if( !rt_str || ( max_fields > 0 && !fields ))
+    return -1;
+
   num_ch = strlen( rt_str );
   pos = 0;
+  count = 0;
 
   while( pos < num_ch )
   {
@@ -260,10 +245,10 @@ int rtime_add_with_zones( TIME_DATE_STRUCT *td, char *rt_str, Sint *hol_dates,
     else if( rt_str[pos] == '-' )
       sgn = -1;
     else
-      return 0;
+      return -1;
 
     if( ++pos >= num_ch )
-      return 0;
+      return -1;
     
     /* next character is optional a for align */
     align = 0;
@@ -271,72 +256,334 @@ int rtime_add_with_zones( TIME_DATE_STRUCT *td, char *rt_str, Sint *hol_dates,
     {
       align = 1;
       if( ++pos >= num_ch )
-	return 0;
+	return -1;
     }
 
-    /* next characters are number to add
-       find out how many digits there are */
-    for( i = 0; pos + i < num_ch; i++ )
-      if( !isdigit(rt_str[pos + i]))
-	break;
-    if(( i < 1 ) || ( pos + i >= num_ch )) {
-      return 0;
+    /* next characters are number to add */
+    num = 0;
+    for( i = 0; pos + i < num_ch && isdigit( rt_str[pos + i] ); i++ )
+    {
+      num = 10 * num + ( rt_str[pos + i] - '0' );
+      if( num > INT_MAX )
+	return -1;
     }
-    
-    /* read the digits */
-    tmpchr = rt_str[ pos + i ];
-    rt_str[ pos + i ] = '\0';
-	/* S7 CHANGE Changing sscanf back to sscanf for win64 to retain correct return value */
-    ret = sscanf( &(rt_str[pos]), "%d", &num );
-    rt_str[ pos + i ] = tmpchr;
-    if( ret != 1 )
-      return 0;
+    if(( i < 1 ) || ( pos + i >= num_ch ))
+      return -1;
     pos += i;
 
     /* next characters to white space are the abbreviation code */
-    abb = &(rt_str[pos]);
-    while(( pos < num_ch ) && !isspace( rt_str[pos] ))
-      pos++;
-    if( pos > num_ch )
-      return 0;
-    if( pos < num_ch )
-    {
-      tmpchr = rt_str[pos];
-      rt_str[pos] = '\0';
-      code = rtcode_from_str( abb );
-      rt_str[pos] = tmpchr;
-    } else /* this is end of string */
-      code = rtcode_from_str( abb );
+    for( i = 0; pos < num_ch && !isspace( rt_str[pos] ); i++, pos++ )
+      if( i < RT_ABB_MAX )
+	abb[i] = rt_str[pos];
+    if( i > RT_ABB_MAX )
+      return -1;
+    abb[i] = '\0';
+    code = rtcode_from_str( abb );
+    if( code == RT_ERROR )
+      return -1;
 
-    /* Convert to/from GMT if we're not in right zone */
-    need_local = align || (code >= RT_DAY);
-    if( in_GMT && need_local ) {
-      /* convert to local */
-      if( !GMT_to_zone( td, tzone ))
-	return 0;
-      in_GMT = 0;
-    } else if( !in_GMT && !need_local ) {
-      /* convert to GMT for hours/min/sec */
-      if( !GMT_from_zone( td, tzone ))
-	return 0;
-      in_GMT = 1;
+    if( count < max_fields )
+    {
+      fields[count].sgn = sgn;
+      fields[count].align = align;
+      fields[count].num = (int) num;
+      fields[count].code = (int) code;
     }
-
-    if( !rt_add_one( td, sgn, align, num, code, hol_dates, num_hols ))
-      return 0;
+    count++;
 
     /* that's it, go ahead and continue */
     pos++;
   }
 
-  /* Convert back to GMT */
-  if( !in_GMT  ) {
-    return GMT_from_zone( td, tzone );
+  return( count );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME rtime_add_jms
+
+   DESCRIPTION  Add parsed relative time fields to a GMT julian day and
+   milliseconds, doing day, month, etc. in the local zone, and hour, 
+   minute, and second in GMT.
+
+   ARGUMENTS
+      IOARG  julian      the GMT julian day
+      IOARG  ms          the GMT milliseconds
+      IARG   fields      the fields, from rtime_parse
+      IARG   num_fields  the number of fields
+      IARG   hol_dates   sorted dates of holidays, without duplicates
+      IARG   num_hols    number of holidays in hol_dates
+      IARG   tzone       time zone to use for conversions
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if a 
+   field can't be added, or if pointers are NULL.
+
+   ALGORITHM When every field is done in the local zone (days and
+   longer, or aligned), which is the usual case, the time is converted
+   to the local zone once with jms_to_zone, the fields added with local
+   function rt_add_one, and the result converted back once with
+   jms_from_zone, so that fixed-offset and transition-table zones take
+   their fast paths.  Month, quarter, and year fields are added in
+   closed form on the year, month, and day, with the day moved back to
+   the end of a shorter month.  Otherwise, this is the same as 
+   rtime_add_with_zones.
+
+   EXCEPTIONS 
+
+   NOTE  See also: rtime_parse, rtime_add_with_zones
+
+**********************************************************************/
+int rtime_add_jms( Sint *julian, Sint *ms, const RT_FIELD *fields, 
+		   int num_fields, Sint *hol_dates, Sint num_hols, 
+		   TZONE_STRUCT *tzone )
+{
+  TIME_DATE_STRUCT td;
+  int i, all_local;
+
+  if( !julian || !ms || ( num_fields && !fields ) || !tzone ||
+      ( num_hols && !hol_dates ))
+    return 0;
+
+  all_local = 1;
+  for( i = 0; i < num_fields; i++ )
+    if( !fields[i].align && fields[i].code < RT_DAY )
+      all_local = 0;
+
+  if( all_local )
+  {
+    if( !jms_to_zone( *julian, *ms, tzone, &td ))
+      return 0;
+    for( i = 0; i < num_fields; i++ )
+      if( !rt_add_one( &td, fields[i].sgn, fields[i].align, fields[i].num,
+		       (RT_CODE) fields[i].code, hol_dates, num_hols ))
+	return 0;
+    return( jms_from_zone( &td, tzone, julian, ms ));
   }
 
-  return 1;
+  return( jms_to_struct( *julian, *ms, &td ) &&
+	  rt_add_fields( &td, fields, num_fields, hol_dates, num_hols, 
+			 tzone ) &&
+	  julian_from_mdy( td, julian ) &&
+	  ms_from_hms( td, ms ));
+}
+
+
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME rtime_step_init
+
+   DESCRIPTION  Find out whether repeatedly adding a relative time to a
+   start time steps by a fixed amount, and if so set up a step 
+   structure for rtime_step_jms.
+
+   ARGUMENTS
+      OARG   step        the step structure
+      IARG   fields      the fields, from rtime_parse
+      IARG   num_fields  the number of fields
+      IARG   julian      the GMT julian day of the start
+      IARG   ms          the GMT milliseconds of the start
+      IARG   tzone       time zone to use for conversions
+
+   RETURN Returns 1 if the relative time is regular from this start,
+   and 0 if it isn't or the arguments are invalid.
+
+   ALGORITHM A single unaligned field of milliseconds, seconds, 
+   minutes, or hours is a fixed number of milliseconds in GMT, and 
+   one of days or weeks a fixed number of days in the local zone.
+   Months, quarters, and years are a fixed number of months in the
+   local zone, as long as the start is no later than the 28th day of
+   its month, so that the day is never moved back to the end of a
+   shorter month.  Days and months are only regular if the local time
+   of day of the start is never skipped by a daylight savings change
+   (see zone_skips_time), since adding the relative time to a skipped
+   time moves the time of day of all the later elements.  Everything
+   else (weekdays, business days, named weekdays, ten-day periods,
+   alignment, and several fields) depends on where the previous step
+   ended, and is not regular.
+
+   EXCEPTIONS 
+
+   NOTE  See also: rtime_step_jms, rtime_add_jms
+
+**********************************************************************/
+int rtime_step_init( RT_STEP *step, const RT_FIELD *fields, int num_fields,
+		     Sint julian, Sint ms, TZONE_STRUCT *tzone )
+{
+  long long num;
+  Sint local_ms;
+
+  if( !step || !fields || ( num_fields != 1 ) || fields[0].align || 
+      ( fields[0].num < 1 ) || !tzone || 
+      ( julian == NA_INTEGER ) || ( ms == NA_INTEGER ))
+    return 0;
+
+  num = fields[0].num;
+  switch( fields[0].code )
+  {
+  case RT_HR:
+    num *= 60;
+  /*LINTED: Meant to fall through here */
+  case RT_MIN:
+    num *= 60;
+  /*LINTED: Meant to fall through here */
+  case RT_SEC:
+    num *= 1000;
+  /*LINTED: Meant to fall through here */
+  case RT_MS:
+    step->kind = RT_STEP_MS;
+    break;
+
+  case RT_WK:
+    num *= 7;
+  /*LINTED: Meant to fall through here */
+  case RT_DAY:
+    step->kind = RT_STEP_DAYS;
+    break;
+
+  case RT_YR:
+    num *= 4;
+  /*LINTED: Meant to fall through here */
+  case RT_QTR:
+    num *= 3;
+  /*LINTED: Meant to fall through here */
+  case RT_MTH:
+    step->kind = RT_STEP_MONTHS;
+    break;
+
+  default:
+    return 0;
+  }
+
+  step->num = fields[0].sgn * num;
+  step->julian = julian;
+  step->ms = ms;
+  step->tzone = tzone;
+
+  if( step->kind == RT_STEP_MS )
+    return 1;
+
+  if( !jms_to_zone( julian, ms, tzone, &(step->local) ) ||
+      !julian_from_mdy( step->local, &(step->local_julian) ))
+    return 0;
+
+  if( !zone_is_fixed( tzone ) &&
+      ( !ms_from_hms( step->local, &local_ms ) ||
+	zone_skips_time( tzone, local_ms )))
+    return 0;
+
+  return(( step->kind != RT_STEP_MONTHS ) || ( step->local.day <= 28 ));
 }
 
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME rtime_step_jms
+
+   DESCRIPTION  Find the element of a regular relative time sequence
+   that is a given number of steps from its start.
+
+   ARGUMENTS
+      IARG   step    the step structure, from rtime_step_init
+      IARG   count   the number of steps, 0 for the start
+      OARG   julian  the GMT julian day of the element
+      OARG   ms      the GMT milliseconds of the element
+
+   RETURN Returns 1/0 for success/failure.  The routine fails if count
+   is negative, or the element is out of range.
+
+   ALGORITHM Milliseconds are added to the GMT start and carried into
+   the day.  Days are added to the local julian day of the start, and
+   months to its local year and month, keeping the local time of day,
+   and the result is converted back with jms_from_zone.  A local time
+   that is ambiguous in a daylight savings change is resolved as 
+   adding the relative time to the element before would resolve it,
+   from that element's daylight status; this is found again in closed
+   form when needed.  Skipped local times don't occur, since 
+   rtime_step_init does not accept a start whose time of day can be
+   skipped.
+
+   EXCEPTIONS 
+
+   NOTE  See also: rtime_step_init, rtime_add_jms
+
+**********************************************************************/
+int rtime_step_jms( const RT_STEP *step, Sint count, Sint *julian, 
+		    Sint *ms )
+{
+  TIME_DATE_STRUCT td, td_dst;
+  long long total, days;
+  Sint jul_dst, ms_dst, prev_jul, prev_ms;
+
+  if( !step || !julian || !ms || ( count < 0 ))
+    return 0;
+
+  if( !count )
+  {
+    *julian = step->julian;
+    *ms = step->ms;
+    return 1;
+  }
+
+  if( step->kind == RT_STEP_MS )
+  {
+    total = step->ms + count * step->num;
+    days = total / MS_PER_DAY;
+    if( total % MS_PER_DAY < 0 )
+      days--;
+    total -= days * MS_PER_DAY;
+    days += step->julian;
+    if(( days >= INT_MAX ) || ( days <= -INT_MAX ))
+      return 0;
+    *julian = (Sint) days;
+    *ms = (Sint) total;
+    return 1;
+  }
+
+  td = step->local;
+  total = count * step->num;
+  if( step->kind == RT_STEP_DAYS )
+  {
+    days = step->local_julian + total;
+    if(( days >= INT_MAX ) || ( days <= -INT_MAX ) ||
+       !julian_to_mdy( (Sint) days, &td ))
+      return 0;
+  } else
+  {
+    if(( total >= INT_MAX / 2 ) || ( total <= -INT_MAX / 2 ))
+      return 0;
+    rt_add_months( &td, (Sint) total );
+  }
+
+  if( zone_is_fixed( step->tzone ))
+    return( jms_from_zone( &td, step->tzone, julian, ms ));
+
+  td.daylight = 0;
+  td_dst = td;
+  td_dst.daylight = 1;
+  if( !jms_from_zone( &td, step->tzone, julian, ms ) ||
+      !jms_from_zone( &td_dst, step->tzone, &jul_dst, &ms_dst ))
+    return 0;
+  if(( *julian == jul_dst ) && ( *ms == ms_dst ))
+    return 1;
+
+  /* the time is ambiguous, so use the daylight status of the element
+     before */
+  if( count == 1 )
+    td.daylight = step->local.daylight;
+  else if( !rtime_step_jms( step, count - 1, &prev_jul, &prev_ms ) ||
+	   !jms_to_zone( prev_jul, prev_ms, step->tzone, &td ))
+    return 0;
+
+  if( td.daylight )
+  {
+    *julian = jul_dst;
+    *ms = ms_dst;
+  }
+  return 1;
+}
 
 
 /****************************
@@ -414,6 +661,70 @@ static int rtcode_from_str( char *abb )
 
 }
 
+/* parse a relative time string into buf, or into an R_alloc array if it
+   has more than RT_FIELD_BUF fields; returns the number of fields, or
+   -1 if the string isn't valid */
+
+static int rt_parse_fields( char *rt_str, RT_FIELD *buf, RT_FIELD **fields )
+{
+  int num_fields;
+
+  *fields = buf;
+  num_fields = rtime_parse( rt_str, buf, RT_FIELD_BUF );
+  if( num_fields > RT_FIELD_BUF )
+  {
+    *fields = (RT_FIELD *) R_alloc( num_fields, sizeof(RT_FIELD) );
+    num_fields = rtime_parse( rt_str, *fields, num_fields );
+  }
+  return( num_fields );
+}
+
+/* add parsed fields to a GMT time structure, converting to/from the 
+   local zone as needed, so that days, weekdays, bizdays, weeks, months,
+   tendays, and years are done in the local zone, and hours, minutes,
+   seconds, and milliseconds in GMT.  The reason for this is that the
+   days and larger relative times want to preserve the time of day in
+   the local zone, whereas the hours, minutes, seconds, and milliseconds
+   relative times really mean that you want that amount of real time to
+   have passed. */
+
+static int rt_add_fields( TIME_DATE_STRUCT *td, const RT_FIELD *fields,
+			  int num_fields, Sint *hol_dates, Sint num_hols,
+			  TZONE_STRUCT *tzone )
+{
+  int i, in_GMT, need_local;
+
+  in_GMT = 1;
+
+  for( i = 0; i < num_fields; i++ )
+  {
+    /* Convert to/from GMT if we're not in right zone */
+    need_local = fields[i].align || ( fields[i].code >= RT_DAY );
+    if( in_GMT && need_local ) {
+      /* convert to local */
+      if( !GMT_to_zone( td, tzone ))
+	return 0;
+      in_GMT = 0;
+    } else if( !in_GMT && !need_local ) {
+      /* convert to GMT for hours/min/sec */
+      if( !GMT_from_zone( td, tzone ))
+	return 0;
+      in_GMT = 1;
+    }
+
+    if( !rt_add_one( td, fields[i].sgn, fields[i].align, fields[i].num, 
+		     (RT_CODE) fields[i].code, hol_dates, num_hols ))
+      return 0;
+  }
+
+  /* Convert back to GMT */
+  if( !in_GMT  ) {
+    return GMT_from_zone( td, tzone );
+  }
+
+  return 1;
+}
+
 /**********************************************************************
  * C Code Documentation ************************************************
  **********************************************************************
@@ -427,7 +738,7 @@ static int rtcode_from_str( char *abb )
       IARG   align     if non-zero, allow less than num to suffice to align
       IARG   num       how many to add/subtract
       IARG   code      the time unit code of what to add/subtract
-      IARG   hol_dates dates of holidays
+      IARG   hol_dates sorted dates of holidays, without duplicates
       IARG   num_hols  number of holidays in hol_dates
 
    RETURN Returns 1/0 for success/failure.  The routine fails if the input 
@@ -435,7 +746,11 @@ static int rtcode_from_str( char *abb )
    or if pointers are NULL.
 
    ALGORITHM This function adds or subtracts time based on
-   the meanings of the codes and alignment.  Note that the weekdays and 
+   the meanings of the codes and alignment.  Named weekdays are
+   found directly from the weekday, and weekdays and business days
+   are stepped as whole weeks plus the days left over, stepping again
+   over the holidays passed, rather than one day at a time.
+   Note that the weekdays and 
    yeardays members of the time date structure are NOT maintained.
 
    EXCEPTIONS 
@@ -447,8 +762,8 @@ static int rt_add_one( TIME_DATE_STRUCT *td, int sgn, int align, int num,
 		       RT_CODE code, Sint *hol_dates, Sint num_hols )
 {
 
-  Sint ms, jul, offset; 
-  int tmp, i, by_week = 0;
+  Sint ms, jul, offset, tmp_jul; 
+  int by_week = 0;
 
   if( !td || ( num_hols && !hol_dates ))
     return 0;
@@ -691,20 +1006,7 @@ static int rt_add_one( TIME_DATE_STRUCT *td, int sgn, int align, int num,
     } else
       offset = - sgn * num;
 
-    td->month -= offset;
-    if(( td->month > 11 ) || (td->month < 1 ))
-    {
-      offset = td->month % 12;
-      if( offset < 1 )
-	offset += 12;
-      td->year += (td->month - offset) / 12;
-      td->month = offset;
-    }
-    /* check for falling off end of month */
-    jul = days_in_month( td->month, td->year );
-    if( td->day > jul )
-      td->day = jul;
-
+    rt_add_months( td, - offset );
     return 1;
 
   case RT_YR:
@@ -746,14 +1048,8 @@ static int rt_add_one( TIME_DATE_STRUCT *td, int sgn, int align, int num,
     } else
       offset = - sgn * num;
 
-    td->year -= offset;
-    
-    /* check for falling off end of month (for feb29 + year) */
-
-    jul = days_in_month( td->month, td->year );
-    if( td->day > jul )
-      td->day = jul;
-
+    /* keeps feb29 + year within the month */
+    rt_add_months( td, - 12 * offset );
     return 1;
 
   case RT_SUN:
@@ -793,32 +1089,25 @@ static int rt_add_one( TIME_DATE_STRUCT *td, int sgn, int align, int num,
       td->ms = 0;
     }
 
-    /* for first addition/subtraction, get to first matching day */
     /* always add/subtract at least 1 */
-    tmp = 0;
-    while( !tmp )
-    {
-      jul += sgn;
-      tmp = day_matches( jul, code, hol_dates, num_hols );
-      if( tmp < 0 )
-	return 0;
-    }
+    if( !num )
+      num = 1;
 
-    /* now add the rest of the days */
-    if( by_week && num )
-      jul += sgn * ( num - 1 ) * 7;
+    if( by_week )
+      jul = rt_step_weekday( jul, sgn, code - RT_SUN ) + sgn * ( num - 1 ) * 7;
     else
-      for( i = 1; i < num; i++ )
+    {
+      /* step over weekdays, then again over the holidays passed */
+      while( num > 0 )
       {
-	tmp = 0;
-	while( !tmp )
-	{
-	  jul += sgn;
-	  tmp = day_matches( jul, code, hol_dates, num_hols );
-	  if( tmp < 0 )
-	    return 0;
-	}
+	tmp_jul = rt_step_weekdays( jul, sgn, num );
+	num = ( code == RT_BIZ ) ? 
+	  rt_count_holidays( sgn > 0 ? jul + 1 : tmp_jul,
+			     sgn > 0 ? tmp_jul : jul - 1, 
+			     hol_dates, num_hols ) : 0;
+	jul = tmp_jul;
       }
+    }
 
     /* convert back to td structure */
     if( !julian_to_mdy( jul, td ))
@@ -922,101 +1211,105 @@ static int rt_add_one( TIME_DATE_STRUCT *td, int sgn, int align, int num,
 }
 
 
-/**********************************************************************
- * C Code Documentation ************************************************
- **********************************************************************
-   NAME day_matches
-
-   DESCRIPTION  Decide whether a given julian day matches the day code.
-
-   ARGUMENTS
-      IARG   julian    the julian day
-      IARG   code      the time unit code
-      IARG   hol_dates dates of holidays
-      IARG   num_hols  number of holidays in hol_dates
+/* add months to a time structure in closed form, moving the day back
+   to the end of the month if the month is shorter */
 
-   RETURN Returns 1/0 for True/False, or -1 on error.
+static void rt_add_months( TIME_DATE_STRUCT *td, Sint months )
+{
+  Sint total, year, dim;
+
+  total = 12 * td->year + ( td->month - 1 ) + months;
+  year = total / 12;
+  if( total % 12 < 0 )
+    year--;
+  td->year = year;
+  td->month = total - 12 * year + 1;
+
+  dim = days_in_month( td->month, td->year );
+  if( td->day > dim )
+    td->day = dim;
+}
 
-   ALGORITHM This function finds the weekday by calling julian_to_weekday,
-   and compares it for the weekday codes.  For business day code, it
-   also checks to see whether the date is a holiday.  For other codes,
-   it simply returns True, to avoid endless loops.
+/* the first day after (sgn > 0) or before (sgn < 0) julian with the
+   given weekday, 0 for Sunday */
 
-   EXCEPTIONS 
+static Sint rt_step_weekday( Sint julian, int sgn, int wkd )
+{
+  int diff;
+
+  diff = julian_to_weekday( julian ) - wkd;
+  if( sgn > 0 )
+    diff = -diff;
+  diff = (( diff % 7 ) + 7 ) % 7;
+  if( !diff )
+    diff = 7;
+  return( julian + sgn * diff );
+}
 
-   NOTE See documentation for relative time class in R.
+/* the num'th weekday (Monday to Friday, num >= 1) after (sgn > 0) or 
+   before (sgn < 0) julian, as whole weeks plus the days left over.  
+   A weekend day is first moved to the Friday before (going forward) or
+   the Monday after (going back), which has the same weekdays beyond 
+   it. */
 
-**********************************************************************/
-static int day_matches( Sint julian, RT_CODE code, Sint *hol_dates, 
-			Sint num_hols )
+static Sint rt_step_weekdays( Sint julian, int sgn, Sint num )
 {
-
-  int wkd;
-  Sint low, hi, mid; 
+  int wkd, pos;
+  Sint total;
 
   wkd = julian_to_weekday( julian );
-
-  switch( code )
+  if( sgn > 0 )
   {
-  case RT_SUN:
-    return( wkd == 0 );
-  case RT_MON:
-    return( wkd == 1 );
-  case RT_TUE:
-    return( wkd == 2 );
-  case RT_WED:
-    return( wkd == 3 );
-  case RT_THU:
-    return( wkd == 4 );
-  case RT_FRI:
-    return( wkd == 5 );
-  case RT_SAT:
-    return( wkd == 6 );
-  case RT_WKD:
-    return(( wkd != 6 ) && ( wkd != 0 ));
+    if( wkd == 6 || wkd == 0 )
+    {
+      julian -= ( wkd == 6 ) ? 1 : 2;
+      wkd = 5;
+    }
+    pos = wkd - 1;
+  } else
+  {
+    if( wkd == 6 || wkd == 0 )
+    {
+      julian += ( wkd == 6 ) ? 2 : 1;
+      wkd = 1;
+    }
+    pos = 5 - wkd;
+  }
 
-  case RT_BIZ:
-    if(( wkd == 6 ) || ( wkd == 0 ))
-      return 0;
-    /* check for holidays */
-    if( !num_hols )
-      return 1;
-    if( !hol_dates )
-      return -1;
-    /* do a binary search to see if this date is there */
-    low = 0;
-    hi = num_hols - 1;
+  total = pos + num;
+  return( julian + sgn * ( 7 * ( total / 5 ) + total % 5 - pos ));
+}
 
-    while( low <= hi )
-    {
-      if(( julian < hol_dates[low] ) || ( julian > hol_dates[hi] ))
-	return 1;
-      if(( julian == hol_dates[low] ) || ( julian == hol_dates[hi] ))
-	return 0;
-      if( hol_dates[low] > hol_dates[hi] )
-	return -1;
+/* the number of holidays from from to to that fall on weekdays; the 
+   holidays must be sorted, without duplicates */
 
-      mid = (hi + low) / 2;
-      if(( mid == low) || ( mid == hi ))
-	break;
+static Sint rt_count_holidays( Sint from, Sint to, const Sint *hol_dates, 
+			       Sint num_hols )
+{
+  Sint low, hi, mid, count;
+  int wkd;
 
-      if( julian == hol_dates[mid] )
-	return 0;
-      if( julian < hol_dates[mid] )
-      {
-	hi = mid - 1;
-	low++;
-      }
-      else
-      {
-	low = mid + 1;
-	hi--;
-      }
-    }
+  if( !num_hols || !hol_dates || from > to )
+    return 0;
 
-    return 1;
+  /* first holiday on or after from */
+  low = 0;
+  hi = num_hols;
+  while( low < hi )
+  {
+    mid = low + ( hi - low ) / 2;
+    if( hol_dates[mid] < from )
+      low = mid + 1;
+    else
+      hi = mid;
+  }
 
-  default: 
-    return -1;
+  for( count = 0; low < num_hols && hol_dates[low] <= to; low++ )
+  {
+    wkd = julian_to_weekday( hol_dates[low] );
+    if( wkd != 0 && wkd != 6 )
+      count++;
   }
+
+  return( count );
 }
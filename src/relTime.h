@@ -19,10 +19,54 @@
 
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+
+/* one field of a relative time string, such as "+a2mth"; code is one
+   of the relative time codes in relTime.c */
+
+typedef struct rt_field_struct
+{
+  int sgn;
+  int align;
+  int num;
+  int code;
+} RT_FIELD;
+
+/* fields parsed without allocating, and the longest abbreviation */
+#define RT_FIELD_BUF 16
+#define RT_ABB_MAX 3
+
+/* a relative time that steps a fixed number of milliseconds, local
+   days, or local months (kind is one of RT_STEP_MS etc.), set up from
+   a start time by rtime_step_init so that any multiple of it can be 
+   added to the start directly with rtime_step_jms */
+
+typedef struct rt_step_struct
+{
+  int kind;
+  long long num;
+  Sint julian;
+  Sint ms;
+  Sint local_julian;
+  TIME_DATE_STRUCT local;
+  TZONE_STRUCT *tzone;
+} RT_STEP;
+
+#define RT_STEP_MS 1
+#define RT_STEP_DAYS 2
+#define RT_STEP_MONTHS 3
 
 int rtime_add( TIME_DATE_STRUCT *td, char *rt_str, Sint *hol_dates, 
 	       Sint num_hols );
 int rtime_add_with_zones( TIME_DATE_STRUCT *td, char *rt_str, Sint *hol_dates, 
 			  Sint num_hols, TZONE_STRUCT *tzone );
+int rtime_parse( const char *rt_str, RT_FIELD *fields, int max_fields );
+int rtime_add_jms( Sint *julian, Sint *ms, const RT_FIELD *fields, 
+		   int num_fields, Sint *hol_dates, Sint num_hols, 
+		   TZONE_STRUCT *tzone );
+int rtime_step_init( RT_STEP *step, const RT_FIELD *fields, int num_fields,
+		     Sint julian, Sint ms, TZONE_STRUCT *tzone );
+int rtime_step_jms( const RT_STEP *step, Sint count, Sint *julian, 
+		    Sint *ms );
 
 #endif  // TIMELIB_RELTIME_H
@@ -26,6 +26,62 @@ static const char *IS_TSPAN_CLASS[] = {
     TSPAN_CLASS_NAME
   };
 
+static int add_vec_vec( const Sint *days1, const Sint *ms1, 
+			const Sint *days2, const Sint *ms2, Sint sgn, 
+			Sint lng, int is_span, Sint * restrict out_days,
+			Sint * restrict out_ms );
+static int add_vec_scalar( const Sint *days, const Sint *ms, Sint sgn, 
+			   Sint add_day, Sint add_ms, Sint lng, int is_span, 
+			   Sint * restrict out_days, Sint * restrict out_ms );
+static void add_fixup( Sint lng, int is_span, Sint *out_days, 
+		       Sint *out_ms );
+static SEXP add_packed( const double *in1, Sint lng1, const double *in2, 
+			Sint lng2, int sgn, int is_span );
+static SEXP time_unit_round( SEXP time_vec, SEXP unit, SEXP k, 
+			     SEXP week_start, SEXP zone, SEXP zone_list,
+			     int is_ceil );
+static int rel_holiday_dates( SEXP hol_vec, SEXP zone_list, 
+			      Sint **hol_dates, Sint *num_hols,
+			      const char *fn );
+static Sint *hol_cache_find( const Sint *days, const Sint *ms, Sint num,
+			     const char *zone, const TZONE_STRUCT *tzone,
+			     Sint *num_dates );
+static Sint *hol_cache_add( const Sint *days, const Sint *ms, Sint num,
+			    const char *zone, const TZONE_STRUCT *tzone,
+			    const Sint *dates, Sint num_dates );
+static int hol_cache_zone( const TZONE_STRUCT *tzone, 
+			   const TZONE_STRUCT **key );
+static int compare_julian( const void *a, const void *b );
+static int rel_seq_step( SEXP start_time, SEXP rel_strs, SEXP zone_list,
+			 RT_STEP *step, const char *fn );
+static int seq_detect_step( const Sint *days, const Sint *ms, Sint lng, 
+			    double tol );
+static int seq_detect_months( const Sint *days, const Sint *ms, Sint lng,
+			      TZONE_STRUCT *tzone, Sint *months );
+static int rel_seq_beyond( const RT_STEP *step, Sint count, int direction,
+			   Sint end_day, Sint end_ms, int *beyond );
+
+/* local dates of holiday lists for relative time addition, kept for
+   the session and matched by the holidays' days, ms and time zone.
+   The zone is matched by its offset, and by its address if it has
+   rules or transitions (NULL if not). */
+
+typedef struct hol_cache_struct
+{
+  Sint num;
+  Sint num_dates;
+  Sint offset;
+  const TZONE_STRUCT *tzone;
+  char *zone;
+  Sint *key;
+  Sint *dates;
+} HOL_CACHE;
+
+#define HOL_CACHE_MAX 16
+
+static HOL_CACHE hol_cache[ HOL_CACHE_MAX ];
+static int hol_cache_next = 0;
+
 
 
 /**********************************************************************
@@ -51,8 +107,11 @@ static const char *IS_TSPAN_CLASS[] = {
    vector, containing the above described output times.
 
    ALGORITHM  For each input time, this function calculates the desired
-   floor time using the date_floor function, in conjunction with the 
-   time zone information found from the find_zone function.
+   floor time using the date_floor_unit function with bins of one day,
+   in conjunction with the time zone information found from the 
+   find_zone function.  So zones with a transition table are done from
+   the table, and a midnight skipped by a daylight savings change 
+   floors to the first time after the change.
 
    EXCEPTIONS 
 
@@ -91,8 +150,8 @@ SEXP time_floor( SEXP time_vec, SEXP zone_list )
   {
     if(  in_days[i] ==NA_INTEGER ||
 	 in_ms[i] ==NA_INTEGER ||
-	!date_floor( in_days[i], in_ms[i], tzone, &(jul_data[i]), 
-		     &(ms_data[i] )))
+	!date_floor_unit( in_days[i], in_ms[i], tzone, UNIT_DAY, 1, 0,
+			  &(jul_data[i]), &(ms_data[i] )))
     {
       /* error occurred -- put NA into return value */
       jul_data[i] = NA_INTEGER;
@@ -127,8 +186,9 @@ SEXP time_floor( SEXP time_vec, SEXP zone_list )
    vector, containing the above described output times.
 
    ALGORITHM  For each input time, this function calculates the desired
-   ceiling time using the date_ceil function, in conjunction with the 
-   time zone information found from find_zone.
+   ceiling time using the date_ceil_unit function with bins of one day,
+   in conjunction with the time zone information found from find_zone,
+   as in time_floor.
 
    EXCEPTIONS 
 
@@ -168,8 +228,8 @@ SEXP time_ceiling( SEXP time_vec, SEXP zone_list )
   {
     if(  in_days[i] ==NA_INTEGER ||
 	 in_ms[i] ==NA_INTEGER ||
-	!date_ceil( in_days[i], in_ms[i], tzone, &(jul_data[i]), 
-		     &(ms_data[i] )))
+	!date_ceil_unit( in_days[i], in_ms[i], tzone, UNIT_DAY, 1, 0,
+			 &(jul_data[i]), &(ms_data[i] )))
     {
       /* error occurred -- put NA into return value */
       jul_data[i] = NA_INTEGER;
@@ -211,7 +271,12 @@ SEXP time_ceiling( SEXP time_vec, SEXP zone_list )
    as necessary using the adjust_time or adjust_span functions.  
    No special time zones or formats are put on the returned object.
    If one of the two vectors has a length that is a multiple of the other,
-   the shorter one is repeated.
+   the shorter one is repeated.  The usual shapes -- equal lengths, or
+   either operand of length 1 -- are done by the add_vec_vec and 
+   add_vec_scalar loops, which avoid the recycling arithmetic and 
+   per-element calls; other lengths use the general loop.  When both
+   objects are packed and the sign is +1 or -1, their milliseconds are
+   added by add_packed without being split, and the result is packed.
 
    EXCEPTIONS 
 
@@ -225,8 +290,31 @@ SEXP time_time_add( SEXP time1, SEXP time2,
   SEXP ret;
   double *in_sign;
   Sint *in_days1, *in_ms1, *in_days2, *in_ms2, *out_days, *out_ms;
-  Sint i, lng1, lng2, lng, ind1, ind2, sign_na, is_span, tmp;
+  Sint i, lng1, lng2, lng, ind1, ind2, sign_na, is_span, tmp, int_sign;
   const char *in_class;
+  SEXP packed1, packed2;
+
+  /* packed operands are added as milliseconds, and stay packed */
+
+  if( time_is_packed( time1 ) && time_is_packed( time2 ) &&
+      isReal( sign ) && length( sign ) >= 1L &&
+      ( REAL( sign )[0] == 1 || REAL( sign )[0] == -1 ) &&
+      isString( ret_class ) && length( ret_class ) >= 1L )
+  {
+    in_class = CHAR( STRING_ELT( ret_class, 0 ));
+    is_span = !strcmp( in_class, TSPAN_CLASS_NAME );
+    if( is_span || !strcmp( in_class, TIME_CLASS_NAME ))
+    {
+      packed1 = time_julian_pointer( time1 );
+      packed2 = time_julian_pointer( time2 );
+      lng1 = length( packed1 );
+      lng2 = length( packed2 );
+      if( lng1 && lng2 && ( lng1 % lng2 ) && ( lng2 % lng1 ))
+	error( "Length of longer operand is not a multiple of length of shorter in C function time_time_add" );
+      return( add_packed( REAL( packed1 ), lng1, REAL( packed2 ), lng2, 
+			  ( REAL( sign )[0] < 0 ) ? -1 : 1, is_span ));
+    }
+  }
 
   /* get the desired parts of the time objects */
 
@@ -280,6 +368,36 @@ SEXP time_time_add( SEXP time1, SEXP time2,
   if( !ret || !out_days || !out_ms )
     error( "Could not create return object in C function time_time_add" );
 
+  /* fast paths for a sign of +1 or -1 and lengths that don't recycle,
+     or recycle only a single value */
+  int_sign = ( *in_sign == 1 ) ? 1 : (( *in_sign == -1 ) ? -1 : 0 );
+  if( lng && !sign_na && int_sign &&
+      (( lng1 == lng2 ) || ( lng1 == 1 ) || ( lng2 == 1 )))
+  {
+    if( lng1 == lng2 )
+      tmp = add_vec_vec( in_days1, in_ms1, in_days2, in_ms2, int_sign,
+			 lng, is_span, out_days, out_ms );
+    else if( lng2 == 1 )
+    {
+      if( in_days2[0] == NA_INTEGER || in_ms2[0] == NA_INTEGER )
+	tmp = add_vec_scalar( in_days1, in_ms1, 1, NA_INTEGER, NA_INTEGER,
+			      lng, is_span, out_days, out_ms );
+      else
+	tmp = add_vec_scalar( in_days1, in_ms1, 1, int_sign * in_days2[0], 
+			      int_sign * in_ms2[0], lng, is_span, 
+			      out_days, out_ms );
+    }
+    else
+      tmp = add_vec_scalar( in_days2, in_ms2, int_sign, 
+			    in_days1[0], in_ms1[0],
+			    lng, is_span, out_days, out_ms );
+    if( tmp )
+      add_fixup( lng, is_span, out_days, out_ms );
+
+    UNPROTECT(6); //2+4 from time_get_pieces
+    return ret;
+  }
+
   /* go through input and add */
   for( i = 0; i < lng; i++ )
   {
@@ -352,7 +470,13 @@ SEXP time_time_add( SEXP time1, SEXP time2,
    and then converting back. 
    No special time zones or formats are put on the returned object.
    If one of the two vectors has a length that is a multiple of the other,
-   the shorter one is repeated.
+   the shorter one is repeated.  For addition and subtraction with equal
+   lengths or an operand of length 1, the numbers are first split into 
+   days and milliseconds (once, for a single number), and then added by 
+   the same loops as in time_time_add.  For a packed time or time span,
+   addition and subtraction convert the numbers to milliseconds in the
+   same way and add them by add_packed, so the result stays packed;
+   multiplication and division split it.
 
    EXCEPTIONS 
 
@@ -366,7 +490,54 @@ SEXP time_num_op( SEXP time_vec, SEXP num_vec, SEXP op )
   double *in_nums, tmpdbl;
   Sint *in_days, *in_ms, *out_days, *out_ms, add_sign;
   Sint i, lng1, lng2, lng, ind1, ind2, is_span, is_ok, tmp;
+  Sint *num_days, *num_ms;
   const char *in_op;
+  SEXP packed;
+  double *packed_nums;
+
+  /* a packed time plus or minus numbers is done on the milliseconds, 
+     and stays packed */
+
+  if( time_is_packed( time_vec ) && isString( op ) && 
+      length( op ) == 1L && 
+      ( !strcmp( CHAR( STRING_ELT( op, 0 )), "+" ) ||
+	!strcmp( CHAR( STRING_ELT( op, 0 )), "-" )) &&
+      ( checkClass( time_vec, IS_TIME_CLASS, 1L ) ||
+	checkClass( time_vec, IS_TSPAN_CLASS, 1L )))
+  {
+    is_span = checkClass( time_vec, IS_TSPAN_CLASS, 1L );
+    packed = time_julian_pointer( time_vec );
+    lng1 = length( packed );
+    PROTECT( num_vec = (SEXP) AS_NUMERIC(num_vec) );
+    if( (lng2 = length(num_vec)) < 1L){
+      UNPROTECT(1);
+      error( "Problem extracting numeric argument in C function time_num_op" );
+    }
+    in_nums = REAL(num_vec);
+    if(lng1 && lng2 && ( lng1 % lng2 ) && ( lng2 % lng1 )){
+      UNPROTECT(1);
+      error( "Length of longer operand is not a multiple of length of shorter in C function time_num_op" );
+    }
+
+    /* convert the numbers of days to milliseconds, as in the split 
+       fast path below */
+    packed_nums = (double *) R_alloc( lng2, sizeof(double) );
+    for( i = 0; i < lng2; i++ )
+    {
+      tmpdbl = floor( in_nums[i] );
+      if( !R_FINITE( tmpdbl ) || ( fabs( tmpdbl ) >= INT_MAX ) ||
+	  !ms_from_fraction( in_nums[i] - tmpdbl, &tmp ))
+	packed_nums[i] = NA_REAL;
+      else
+	packed_nums[i] = tmpdbl * MS_PER_DAY + tmp;
+    }
+
+    PROTECT( ret = add_packed( REAL( packed ), lng1, packed_nums, lng2, 
+			       ( *CHAR( STRING_ELT( op, 0 )) == '-' ) ? -1 : 1,
+			       is_span ));
+    UNPROTECT(2);
+    return ret;
+  }
 
   /* get the desired parts of the time object */
 
@@ -427,6 +598,52 @@ SEXP time_num_op( SEXP time_vec, SEXP num_vec, SEXP op )
     error( "Could not create return object in C function time_num_op" );
   }
 
+  /* fast paths for addition and subtraction without general recycling */
+  if( lng && (( *in_op == '+' ) || ( *in_op == '-' )) &&
+      (( lng1 == lng2 ) || ( lng1 == 1 ) || ( lng2 == 1 )))
+  {
+    add_sign = ( *in_op == '-' ) ? -1 : 1;
+
+    /* split the numbers into whole days and milliseconds */
+    num_days = (Sint *) R_alloc( lng2, sizeof(Sint) );
+    num_ms = (Sint *) R_alloc( lng2, sizeof(Sint) );
+    for( i = 0; i < lng2; i++ )
+    {
+      tmpdbl = floor( in_nums[i] );
+      if( !R_FINITE( tmpdbl ) || ( fabs( tmpdbl ) >= INT_MAX ) ||
+	  !ms_from_fraction( in_nums[i] - tmpdbl, &(num_ms[i]) ))
+      {
+	num_days[i] = NA_INTEGER;
+	num_ms[i] = NA_INTEGER;
+	continue;
+      }
+      num_days[i] = (Sint) tmpdbl;
+    }
+
+    if( lng1 == lng2 )
+      tmp = add_vec_vec( in_days, in_ms, num_days, num_ms, add_sign,
+			 lng, is_span, out_days, out_ms );
+    else if( lng2 == 1 )
+    {
+      if( num_days[0] == NA_INTEGER )
+	tmp = add_vec_scalar( in_days, in_ms, 1, NA_INTEGER, NA_INTEGER,
+			      lng, is_span, out_days, out_ms );
+      else
+	tmp = add_vec_scalar( in_days, in_ms, 1, add_sign * num_days[0],
+			      add_sign * num_ms[0], lng, is_span, 
+			      out_days, out_ms );
+    }
+    else
+      tmp = add_vec_scalar( num_days, num_ms, add_sign, 
+			    in_days[0], in_ms[0],
+			    lng, is_span, out_days, out_ms );
+    if( tmp )
+      add_fixup( lng, is_span, out_days, out_ms );
+
+    UNPROTECT(4); //2+2 from time_get_pieces
+    return ret;
+  }
+
   /* go through input and perform operation */
   for( i = 0; i < lng; i++ )
   {
@@ -544,7 +761,8 @@ SEXP time_num_op( SEXP time_vec, SEXP num_vec, SEXP op )
    ALGORITHM  If na_rm is False and there are NAs, this function will
    return NA for the min and max.  Otherwise, it will find the minimum
    and maximum time or time span in the passed in vector, and return
-   them in a newly created time object.
+   them in a newly created time object.  A packed object is scanned as
+   a single vector of milliseconds, and only the two results are split.
    No special time zones or formats are put on the returned object.
 
 
@@ -559,6 +777,55 @@ SEXP time_range( SEXP time_vec, SEXP na_rm )
   SEXP ret;
   Sint *in_days, *in_ms, *out_days, *out_ms, *rm_na;
   Sint i, lng, initialized, tmplng;
+  double *in_packed, packed_range[2];
+
+  if( time_is_packed( time_vec ))
+  {
+    /* one pass over the packed milliseconds */
+
+    in_packed = REAL( time_julian_pointer( time_vec ));
+    lng = length( time_julian_pointer( time_vec ));
+    if( !IS_LOGICAL(na_rm) || length(na_rm) < 1L )
+      error( "Problem extracting data from second argument in C function time_range" );
+
+    if( checkClass( time_vec, IS_TIME_CLASS, 1L ))
+      PROTECT(ret = time_create_new( 2, &out_days, &out_ms ));
+    else
+      PROTECT(ret = tspan_create_new( 2, &out_days, &out_ms ));
+    if( !out_days || !out_ms || !ret )
+      error( "Could not create return object in C function time_range" );
+
+    packed_range[0] = packed_range[1] = NA_REAL;
+    initialized = 0;
+    for( i = 0; i < lng; i++ )
+    {
+      if( ISNAN( in_packed[i] ))
+      {
+	if( LOGICAL(na_rm)[0] )
+	  continue;
+	initialized = 0;
+	break;
+      }
+      if( !initialized )
+      {
+	packed_range[0] = packed_range[1] = in_packed[i];
+	initialized = 1;
+	continue;
+      }
+      if( in_packed[i] < packed_range[0] )
+	packed_range[0] = in_packed[i];
+      else if( in_packed[i] > packed_range[1] )
+	packed_range[1] = in_packed[i];
+    }
+    if( !initialized )
+      packed_range[0] = packed_range[1] = NA_REAL;
+
+    time_packed_split( packed_range, 2, 
+		       !checkClass( time_vec, IS_TIME_CLASS, 1L ),
+		       out_days, out_ms );
+    UNPROTECT(1);
+    return ret;
+  }
 
   /* get the desired parts of the time object */
 
@@ -809,7 +1076,7 @@ SEXP time_sum( SEXP time_vec, SEXP na_rm, SEXP cum )
    To be called from R as 
    \\
    {\tt 
-   .Call("time_rel_add", time.vec, rel.obj@.Data, sort( rel.obj@holidays),
+   .Call("time_rel_add", time.vec, rel.obj@.Data, rel.obj@holidays,
           zone.list)
    }
    where TIMECLASS is replaced by the name of the time class.
@@ -817,7 +1084,7 @@ SEXP time_sum( SEXP time_vec, SEXP na_rm, SEXP cum )
    ARGUMENTS
       IARG  time_vec    The R time vector object
       IARG  rel_strs    The character strings from the relative time object
-      IARG  hol_vec     SORTED vector of holiday dates
+      IARG  hol_vec     Vector of holiday dates, or a bizCalendar
       IARG  zone_list   The list of R time zone objects
 
 
@@ -827,14 +1094,15 @@ SEXP time_sum( SEXP time_vec, SEXP na_rm, SEXP cum )
    object's local time zone.
 
    ALGORITHM  First, a list of the holidays' julian dates is 
-   created, taking into account the holidays' time zone.
+   created, taking into account the holidays' time zone (see
+   rel_holiday_dates).
    (Time values are converted to local zones by first converting
-   to a TIME_DATE_STRUCT using the jms_to_struct function, and then
-   to their local time zones by calling GMT_to_zone function
-   in conjunction with find_zone.  If needed, they can then be
+   to a TIME_DATE_STRUCT in their local time zones using the
+   jms_to_zone function in conjunction with find_zone.  If needed, they can then be
    converted back to julian dates by calling julian_from_mdy.)
-   Then the times are combined with the
-   relative times using the rtime_add_with_zones function.
+   The relative time strings are parsed once with rtime_parse,
+   and then the times are combined with the parsed
+   relative times using the rtime_add_jms function.
    No special time zones or formats are put on the returned object.
    If time_vec or rel_strs has a length that is a multiple of the other,
    the shorter one is repeated. If the sequence becomes monotonic
@@ -851,10 +1119,12 @@ SEXP time_rel_add( SEXP time_vec, SEXP rel_strs,
 
   SEXP ret;
   Sint *in_days, *in_ms, *out_days, *out_ms;
-  Sint *hol_days, *hol_ms;
-  Sint i, lng1, lng2, lng_hol, lng, ind1, ind2, all_na;
-  TIME_DATE_STRUCT td, td_hol;
-  TZONE_STRUCT *tzone, *tzone_hol;
+  Sint i, lng1, lng2, lng_hol, lng, ind1, ind2, all_na, tot_fields;
+  Sint *first_field;
+  int *num_fields;
+  RT_FIELD *fields;
+  TIME_DATE_STRUCT td;
+  TZONE_STRUCT *tzone;
   Sint *hol_dates;
 
   /* get the desired parts of the time objects */
@@ -868,15 +1138,6 @@ SEXP time_rel_add( SEXP time_vec, SEXP rel_strs,
   if( !tzone )
     error( "Unknown or unreadable time zone in C function time_rel_add" );
 
-  if( !time_get_pieces( hol_vec, NULL, &hol_days, &hol_ms, &lng_hol, NULL, 
-			&td_hol.zone, NULL ) ||
-      (( lng_hol && (!hol_days || !hol_ms )) || !td_hol.zone ))
-    error( "Invalid holiday argument in C function time_rel_add" );
-
-  tzone_hol = find_zone( td_hol.zone, zone_list );
-  if( !tzone_hol )
-    error( "Unknown or unreadable time zone for holidays in C function time_rel_add" );
-
   /* extract the rel time strings */
   if(!isString(rel_strs) || (lng2 = length(rel_strs)) < 1L)
     error( "Problem extracting relative time strings in C function time_rel_add" );
@@ -899,48 +1160,49 @@ SEXP time_rel_add( SEXP time_vec, SEXP rel_strs,
     error( "Could not create return object in C function time_rel_add" );
 
   /* get list of holiday dates */
-  hol_dates = NULL;
-  all_na = 0;
-  if( lng_hol>0 )
+  all_na = !rel_holiday_dates( hol_vec, zone_list, &hol_dates, &lng_hol,
+			       "time_rel_add" );
+
+  /* parse each relative time string once */
+  num_fields = (int *) R_alloc( lng2, sizeof(int) );
+  first_field = (Sint *) R_alloc( lng2, sizeof(Sint) );
+  tot_fields = 0;
+  for( i = 0; i < lng2; i++ )
   {
-    hol_dates = (Sint *) R_alloc( lng_hol, sizeof(Sint) );
-
-    for( i = 0; i < lng_hol; i++ )
-    {
-      if(  hol_days[i] == NA_INTEGER || 
-	   hol_ms[i] == NA_INTEGER ||
-	  !jms_to_struct( hol_days[i], hol_ms[i], &td_hol ) ||
-	  !GMT_to_zone( &td_hol, tzone_hol ) ||
-	  !julian_from_mdy( td_hol, &(hol_dates[i])))
-	{
-	  all_na = 1;
-	  break;
-	}
-    }
+    num_fields[i] = ( STRING_ELT(rel_strs, i) == NA_STRING ) ? -1 :
+      rtime_parse( CHAR(STRING_ELT(rel_strs, i)), NULL, 0 );
+    first_field[i] = tot_fields;
+    if( num_fields[i] > 0 )
+      tot_fields += num_fields[i];
   }
+  fields = (RT_FIELD *) R_alloc( tot_fields + 1, sizeof(RT_FIELD) );
+  for( i = 0; i < lng2; i++ )
+    if( num_fields[i] > 0 )
+      rtime_parse( CHAR(STRING_ELT(rel_strs, i)), fields + first_field[i],
+		   num_fields[i] );
 
   /* go through input and perform operation */
   for( i = 0; i < lng; i++ )
   {
     ind1 = i % lng1;
     ind2 = i % lng2;
+    out_days[i] = in_days[ind1];
+    out_ms[i] = in_ms[ind1];
 
     /* check for NA, convert to local zone, add, and convert back */
-    if(	all_na ||
+    if(	all_na || num_fields[ind2] < 0 ||
 	 in_days[ind1] == NA_INTEGER || 
 	 in_ms[ind1] == NA_INTEGER ||
-	!jms_to_struct( in_days[ind1], in_ms[ind1], &td ) ||
-	!rtime_add_with_zones( &td, (char *) CHAR(STRING_ELT(rel_strs, ind2)), 
-			       hol_dates, lng_hol, tzone ) ||
-	!julian_from_mdy( td, &(out_days[i] )) ||
-	!ms_from_hms( td, &(out_ms[i] )))
+	!rtime_add_jms( &(out_days[i]), &(out_ms[i]), 
+			fields + first_field[ind2], num_fields[ind2], 
+			hol_dates, lng_hol, tzone ))
     {
       out_days[i] = NA_INTEGER;
       out_ms[i] = NA_INTEGER;
     }
   }
 
-  UNPROTECT(5); //4+1 from time_get_pieces
+  UNPROTECT(3); //1+2 from time_get_pieces
   return ret;
 
 }
@@ -956,7 +1218,7 @@ SEXP time_rel_add( SEXP time_vec, SEXP rel_strs,
    \\
    {\tt 
    .Call("time_rel_seq", start.time, end.time, length, use.length,
-         rel.obj@.Data, sort( rel.obj@holidays),
+         rel.obj@.Data, rel.obj@holidays,
           zone.list)
    }
    where TIMECLASS is replaced by the name of the time class.
@@ -967,7 +1229,7 @@ SEXP time_rel_add( SEXP time_vec, SEXP rel_strs,
       IARG  len_vec     The length of the sequence
       IARG  has_len     True if length is used; False if end_time is used
       IARG  rel_strs    The character string from the relative time object
-      IARG  hol_vec     SORTED vector of holiday dates
+      IARG  hol_vec     Vector of holiday dates, or a bizCalendar
       IARG  zone_list   The list of R time zone objects
 
 
@@ -978,14 +1240,15 @@ SEXP time_rel_add( SEXP time_vec, SEXP rel_strs,
    reached (if has_len is True).
 
    ALGORITHM  First, a list of the holidays' julian dates is 
-   created, taking into account the holidays' time zone.
+   created, taking into account the holidays' time zone (see
+   rel_holiday_dates).
    (Time values are converted to local zones by first converting
-   to a TIME_DATE_STRUCT using the jms_to_struct function, and then
-   to their local time zones by calling GMT_to_zone function
-   in conjunction with find_zone.  If needed, they can then be
+   to a TIME_DATE_STRUCT in their local time zones using the
+   jms_to_zone function in conjunction with find_zone.  If needed, they can then be
    converted back to julian dates by calling julian_from_mdy.)
-   Then the starting time is repeatedly combined 
-   with the relative time using the rtime_add_with_zones function.
+   The relative time is parsed once with rtime_parse, and
+   then the starting time is repeatedly combined 
+   with it using the rtime_add_jms function.
    No special time zones or formats are put on the returned object.
    If start, end, length, or relative time has a length > 1, the 
    extra values are ignored and a warning is generated.
@@ -1012,11 +1275,13 @@ SEXP time_rel_seq( SEXP start_time, SEXP end_time,
   SEXP ret, tmp_days, tmp_ms;
   Sint *start_days, *start_ms, *end_days, *end_ms,
     *out_days, *out_ms, *use_len, *seq_len;
-  Sint *hol_days, *hol_ms, num_alloc;
+  Sint num_alloc;
   Sint i, lng_hol, lng, direction=0;
-  TIME_DATE_STRUCT td, td_hol;
-  TZONE_STRUCT *tzone, *tzone_hol;
+  TIME_DATE_STRUCT td;
+  TZONE_STRUCT *tzone;
   char *in_strs;
+  RT_FIELD *fields;
+  int num_fields;
   Sint *hol_dates;
   Sint pre_start_day, pre_start_ms, used_old_alg ;
   Sint num_protect=0;
@@ -1060,20 +1325,6 @@ SEXP time_rel_seq( SEXP start_time, SEXP end_time,
       warning( "End time has multiple elements; only the first will be used" );
   }
 
-  if( !time_get_pieces( hol_vec, NULL, &hol_days, &hol_ms, &lng_hol, NULL, 
-			&td_hol.zone, NULL ) ||
-      (( lng_hol && (!hol_days || !hol_ms )) || !td_hol.zone )){
-    UNPROTECT(num_protect);
-    error( "Invalid holiday argument in C function time_rel_seq" );
-  }
-  num_protect +=2;
-
-  tzone_hol = find_zone( td_hol.zone, zone_list );
-  if( !tzone_hol ){
-    UNPROTECT(num_protect);
-    error( "Unknown or unreadable time zone for holidays in C function time_rel_seq" );
-  }
-
   /* extract the rel time string */
   if(!isString(rel_strs) || (lng = length(rel_strs)) < 1L){
     UNPROTECT(num_protect);
@@ -1082,6 +1333,12 @@ SEXP time_rel_seq( SEXP start_time, SEXP end_time,
   if( lng > 1 )
     warning( "Relative time has multiple elements; only the first will be used" );
   in_strs = (char *) CHAR(STRING_ELT(rel_strs, 0));
+  if(( num_fields = rtime_parse( in_strs, NULL, 0 )) < 0 ){
+    UNPROTECT(num_protect);
+    error( "Could not add relative time in C function time_rel_seq" );
+  }
+  fields = (RT_FIELD *) R_alloc( num_fields + 1, sizeof(RT_FIELD) );
+  rtime_parse( in_strs, fields, num_fields );
   /* extract the length */
 
   if( *use_len )
@@ -1100,21 +1357,9 @@ SEXP time_rel_seq( SEXP start_time, SEXP end_time,
   }
 
   /* get list of holiday dates */
-  hol_dates = NULL;
-  if( lng_hol )
-  {
-    hol_dates = (Sint *) R_alloc( lng_hol, sizeof(Sint) );
-
-    for( i = 0; i < lng_hol; i++ )
-    {
-      if(  hol_days[i] ==NA_INTEGER || 
-	   hol_ms[i] ==NA_INTEGER ||
-	  !jms_to_struct( hol_days[i], hol_ms[i], &td_hol ) ||
-	  !GMT_to_zone( &td_hol, tzone_hol ) ||
-	  !julian_from_mdy( td_hol, &(hol_dates[i])))
-	  error( "Bad holiday data in C function time_rel_seq" );
-    }
-  }
+  if( !rel_holiday_dates( hol_vec, zone_list, &hol_dates, &lng_hol,
+			  "time_rel_seq" ))
+    error( "Bad holiday data in C function time_rel_seq" );
 
   /* create output time object or temporary storage */
 
@@ -1180,13 +1425,13 @@ SEXP time_rel_seq( SEXP start_time, SEXP end_time,
   /* fprintf(stderr, " time_rel_seq: start=%ld,%ld, in_strs[0]=%s\n", *start_days, *start_ms, in_strs[0]); */
   if (avoid_bad_start_day) {
      /* the following is gross.  -wwd */
-     char tmp_strs[100] ;
-     strncpy(tmp_strs, in_strs, 99);
-     if (tmp_strs[0] == '-')
-       tmp_strs[0] = '+';
-     else if (tmp_strs[0] == '+')
-       tmp_strs[0] = '-';
-     if (tmp_strs[1] == 'a') {
+     /* step back by the first field with its sign flipped */
+     RT_FIELD *tmp_fields = (RT_FIELD *) R_alloc( num_fields + 1, 
+						  sizeof(RT_FIELD) );
+     memcpy( tmp_fields, fields, num_fields * sizeof(RT_FIELD) );
+     if( num_fields )
+       tmp_fields[0].sgn = - tmp_fields[0].sgn;
+     if( num_fields && tmp_fields[0].align ) {
        /* fprintf(stderr, " time_rel_seq: alignment might have caused problems -- using old algorithm\n");  */
        out_days[0] = *start_days;
        out_ms[0] = *start_ms;
@@ -1194,10 +1439,10 @@ SEXP time_rel_seq( SEXP start_time, SEXP end_time,
        i = 1 ;
      } else {
        /* convert to local zone, add, and convert back */
-       if( !jms_to_struct( *start_days, *start_ms, &td ) ||
-	   !rtime_add_with_zones( &td, tmp_strs, hol_dates, lng_hol, tzone ) ||
-	   !julian_from_mdy( td, &pre_start_day) ||
-	   !ms_from_hms( td, &pre_start_ms)){
+       pre_start_day = *start_days;
+       pre_start_ms = *start_ms;
+       if( !rtime_add_jms( &pre_start_day, &pre_start_ms, tmp_fields, 
+			   num_fields, hol_dates, lng_hol, tzone )){
 	 UNPROTECT(num_protect);
          error( "Could not subtract relative time in C function time_rel_seq" );
        }
@@ -1253,10 +1498,10 @@ SEXP time_rel_seq( SEXP start_time, SEXP end_time,
     }
 
     /* convert to local zone, add, and convert back */
-    if(	!jms_to_struct( PREV_DAY, PREV_MS, &td ) ||
-	!rtime_add_with_zones( &td, in_strs, hol_dates, lng_hol, tzone ) ||
-	!julian_from_mdy( td, &(out_days[i] )) ||
-	!ms_from_hms( td, &(out_ms[i] ))){
+    out_days[i] = PREV_DAY;
+    out_ms[i] = PREV_MS;
+    if(	!rtime_add_jms( &(out_days[i]), &(out_ms[i]), fields, num_fields, 
+			hol_dates, lng_hol, tzone )){
       UNPROTECT(num_protect);
       error( "Could not add relative time in C function time_rel_seq" );
     }
@@ -1311,3 +1556,1242 @@ SEXP time_rel_seq( SEXP start_time, SEXP end_time,
   UNPROTECT(num_protect);
   return ret;
 }
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_rel_seq_index
+
+   DESCRIPTION  Find elements of a relative time sequence from their
+   positions, without making the sequence. To be called from R as 
+   \\
+   {\tt 
+   .Call("time_rel_seq_index", start.time, rel.obj@.Data, counts,
+          zone.list)
+   }
+
+   ARGUMENTS
+      IARG  start_time  The starting R time object
+      IARG  rel_strs    The character string from the relative time object
+      IARG  counts      Integer vector of the number of times the 
+                        relative time is added to the start for each
+                        element (0 for the start itself)
+      IARG  zone_list   The list of R time zone objects
+
+   RETURN Returns a time vector with one element for each count, NA 
+   where the count is NA, or NULL if the sequence is not regular, so
+   that it has to be made with time_rel_seq.
+
+   ALGORITHM The relative time is parsed, and rtime_step_init decides
+   whether it steps by a fixed amount from the start.  If it does, 
+   each element is found directly with rtime_step_jms.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_rel_seq, time_rel_seq_length
+
+**********************************************************************/
+SEXP time_rel_seq_index( SEXP start_time, SEXP rel_strs, SEXP counts,
+			 SEXP zone_list )
+{
+  SEXP ret;
+  Sint *in_counts, *out_days, *out_ms, lng, i;
+  RT_STEP step;
+
+  if( !IS_INTEGER(counts) )
+    error( "Invalid counts argument in C function time_rel_seq_index" );
+
+  if( !rel_seq_step( start_time, rel_strs, zone_list, &step, 
+		     "time_rel_seq_index" ))
+    return( R_NilValue );
+
+  lng = length(counts);
+  in_counts = INTEGER(counts);
+
+  PROTECT(ret = time_create_new( lng, &out_days, &out_ms ));
+  if( !ret || ( lng && ( !out_days || !out_ms ))){
+    UNPROTECT(1);
+    error( "Could not create return object in C function time_rel_seq_index" );
+  }
+
+  for( i = 0; i < lng; i++ )
+  {
+    if(( in_counts[i] == NA_INTEGER ) ||
+       !rtime_step_jms( &step, in_counts[i], &(out_days[i]), &(out_ms[i]) ))
+    {
+      out_days[i] = NA_INTEGER;
+      out_ms[i] = NA_INTEGER;
+    }
+  }
+
+  UNPROTECT(1);
+  return( ret );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_rel_seq_length
+
+   DESCRIPTION  Find the length of a relative time sequence from a start
+   to an end time, without making the sequence. To be called from R as 
+   \\
+   {\tt 
+   .Call("time_rel_seq_length", start.time, end.time, rel.obj@.Data,
+          zone.list)
+   }
+
+   ARGUMENTS
+      IARG  start_time  The starting R time object
+      IARG  end_time    The ending R time object
+      IARG  rel_strs    The character string from the relative time object
+      IARG  zone_list   The list of R time zone objects
+
+   RETURN Returns the length that time_rel_seq would give the sequence,
+   or NULL if the sequence is not regular or does not go towards the
+   end time, so that it has to be made with time_rel_seq.
+
+   ALGORITHM If rtime_step_init finds that the relative time steps by a
+   fixed amount, the number of steps to the end is estimated from the
+   difference in milliseconds, local days, or local months, and then
+   moved until the element found with rtime_step_jms for it is not 
+   beyond the end time, but the next element is.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_rel_seq, time_rel_seq_index
+
+**********************************************************************/
+SEXP time_rel_seq_length( SEXP start_time, SEXP end_time, SEXP rel_strs,
+			  SEXP zone_list )
+{
+  SEXP ret;
+  Sint *end_days, *end_ms, lng, end_day, end_ms1, end_local;
+  TIME_DATE_STRUCT td;
+  RT_STEP step;
+  long long est;
+  int direction, beyond;
+
+  if( !time_get_pieces( end_time, NULL, &end_days, &end_ms, &lng, NULL,
+			NULL, NULL ) ||
+      !lng || !end_days || !end_ms )
+    error( "Invalid time argument in C function time_rel_seq_length" );
+  end_day = *end_days;
+  end_ms1 = *end_ms;
+  UNPROTECT(2); //from time_get_pieces
+
+  if(( end_day == NA_INTEGER ) || ( end_ms1 == NA_INTEGER ))
+    error( "NA not allowed in sequence" );
+
+  if( !rel_seq_step( start_time, rel_strs, zone_list, &step, 
+		     "time_rel_seq_length" ))
+    return( R_NilValue );
+
+  /* the direction to the end, which has to be the direction of the
+     steps unless the sequence is just the start */
+  if(( end_day > step.julian ) || 
+     (( end_day == step.julian ) && ( end_ms1 > step.ms )))
+    direction = 1;
+  else if(( end_day < step.julian ) || 
+	  (( end_day == step.julian ) && ( end_ms1 < step.ms )))
+    direction = -1;
+  else
+    direction = 0;
+
+  if( direction && ( direction * step.num < 0 ))
+    return( R_NilValue );
+
+  est = 0;
+  if( direction )
+  {
+    if( step.kind == RT_STEP_MS )
+      est = (((long long) end_day - step.julian ) * MS_PER_DAY + 
+	     end_ms1 - step.ms ) / step.num;
+    else
+    {
+      if( !jms_to_zone( end_day, end_ms1, step.tzone, &td ) ||
+	  !julian_from_mdy( td, &end_local ))
+	return( R_NilValue );
+      if( step.kind == RT_STEP_DAYS )
+	est = ((long long) end_local - step.local_julian ) / step.num;
+      else
+	est = ( 12LL * ( td.year - step.local.year ) + 
+		td.month - step.local.month ) / step.num;
+    }
+    if( est >= INT_MAX - 1 )
+      return( R_NilValue );
+    if( est < 0 )
+      est = 0;
+
+    /* move to the last element that isn't beyond the end */
+    if( !rel_seq_beyond( &step, (Sint) est, direction, end_day, end_ms1,
+			 &beyond ))
+      return( R_NilValue );
+    while( beyond && est > 0 )
+    {
+      est--;
+      if( !rel_seq_beyond( &step, (Sint) est, direction, end_day, end_ms1,
+			   &beyond ))
+	return( R_NilValue );
+    }
+    while( est < INT_MAX - 1 )
+    {
+      if( !rel_seq_beyond( &step, (Sint) est + 1, direction, end_day, 
+			   end_ms1, &beyond ))
+	return( R_NilValue );
+      if( beyond )
+	break;
+      est++;
+    }
+  }
+
+  PROTECT(ret = NEW_INTEGER(1));
+  INTEGER(ret)[0] = (Sint) est + 1;
+  UNPROTECT(1);
+  return( ret );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_seq_detect
+
+   DESCRIPTION  Find whether a time vector is a regular sequence, and 
+   of what kind. To be called from R as 
+   \\
+   {\tt 
+   .Call("time_seq_detect", time.vec, tol, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  time_vec    The R time vector object
+      IARG  tol         The tolerance in days for equal differences
+      IARG  zone_list   The list of R time zone objects
+
+   RETURN Returns an integer vector of two elements.  The first is 
+   SEQ_DETECT_STEP if the differences between the times are all equal
+   to the first one within the tolerance, SEQ_DETECT_MONTHS if the 
+   times all have the same local time of day and day of the month, and
+   the same number of months between them, SEQ_DETECT_MONTHEND if they
+   are the same but with all the dates at the ends of their months 
+   instead of on the same day, and SEQ_DETECT_NONE otherwise, including
+   when there are NA values.  The second is the number of months
+   between the times for the monthly kinds, and NA otherwise.
+
+   ALGORITHM  One pass over the times compares the differences in
+   milliseconds.  Only if that fails is a second pass made, which
+   converts each time to the local zone with jms_to_zone and compares
+   it to the one before.  Each pass stops at the first time that
+   doesn't fit.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_rel_seq
+
+**********************************************************************/
+SEXP time_seq_detect( SEXP time_vec, SEXP tol, SEXP zone_list )
+{
+  SEXP ret;
+  Sint *in_days, *in_ms, lng, months = NA_INTEGER;
+  char *zone;
+  TZONE_STRUCT *tzone;
+  int kind;
+
+  if( !IS_NUMERIC(tol) || length(tol) < 1L || ISNAN(REAL(tol)[0]) )
+    error( "Invalid tolerance argument in C function time_seq_detect" );
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL,
+			&zone, NULL ) ||
+      !zone || ( lng && ( !in_days || !in_ms )))
+    error( "Invalid time argument in C function time_seq_detect" );
+
+  if( seq_detect_step( in_days, in_ms, lng, REAL(tol)[0] ))
+    kind = SEQ_DETECT_STEP;
+  else
+  {
+    tzone = find_zone( zone, zone_list );
+    if( !tzone ){
+      UNPROTECT(2); //from time_get_pieces
+      error( "Unknown or unreadable time zone in C function time_seq_detect" );
+    }
+    kind = seq_detect_months( in_days, in_ms, lng, tzone, &months );
+    if( kind == SEQ_DETECT_NONE )
+      months = NA_INTEGER;
+  }
+  UNPROTECT(2); //from time_get_pieces
+
+  PROTECT(ret = NEW_INTEGER(2));
+  INTEGER(ret)[0] = kind;
+  INTEGER(ret)[1] = months;
+  UNPROTECT(1);
+  return( ret );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_bin
+
+   DESCRIPTION  Group times into calendar bins, such as k-minute, daily,
+   weekly, monthly, quarterly, or yearly bins, in a given time zone.
+   To be called from R as 
+   \\
+   {\tt 
+   .Call("time_bin", time.vec, unit, k, week.start, zone, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  time_vec   The R time vector object
+      IARG  unit       Unit abbreviation ("ms", "sec", "min", "hr", "day", 
+                       "wk", "mth", "qtr", or "yr")
+      IARG  k          Number of units in each bin
+      IARG  week_start Weekday weekly bins start on (0 = Sunday)
+      IARG  zone       Name of the time zone to bin in
+      IARG  zone_list  The list of R time zone objects
+
+   RETURN Returns a list of two elements.  The first is an integer vector
+   of the same length as the input time vector, giving the bin number
+   of each input time, starting at 1 for the bin containing the earliest
+   time.  The second is a time vector containing the starting time of each
+   bin, followed by the starting time of the bin after the last one.
+
+   ALGORITHM  Each input time is converted to the local zone with 
+   jms_to_zone, and its bin ordinal is found using date_bin_index. 
+   Then, for each ordinal from the smallest to the largest, the bin start
+   time is found using date_bin_start.  Bins that lie entirely in 
+   daylight savings gaps are dropped, so that the bin numbers refer to
+   bins that actually exist.  This takes one pass over the input,
+   and one pass over the range of bins, without sorting.
+
+   EXCEPTIONS 
+
+   NOTE See also: date_bin_index, date_bin_start, time_floor
+
+**********************************************************************/
+SEXP time_bin( SEXP time_vec, SEXP unit, SEXP k, SEXP week_start,
+	       SEXP zone, SEXP zone_list )
+{
+  SEXP ret, codes, breaks;
+  Sint *in_days, *in_ms, *jul_data, *ms_data, *code_data, *bin_map;
+  Sint *start_days, *start_ms;
+  Sint i, lng, nbins, nlev, in_k, tmp_jul, tmp_ms, end_jul, end_ms;
+  int in_wk, has_data;
+  double *bin_idx, min_idx, max_idx, this_idx, chk_idx;
+  const char *zonestr;
+  TIME_UNIT_CODE in_unit;
+  TZONE_STRUCT *tzone;
+
+  /* extract the bin definition */
+
+  if( !isString(unit) || length(unit) < 1L ||
+      ( in_unit = time_unit_from_str( CHAR(STRING_ELT(unit, 0)))) 
+      == UNIT_ERROR )
+    error( "Invalid unit in C function time_bin" );
+
+  if( !IS_INTEGER(k) || length(k) < 1L || 
+      ( in_k = INTEGER(k)[0] ) == NA_INTEGER || in_k < 1 )
+    error( "Invalid number of units in C function time_bin" );
+
+  if( !IS_INTEGER(week_start) || length(week_start) < 1L || 
+      ( in_wk = INTEGER(week_start)[0] ) == NA_INTEGER || 
+      in_wk < 0 || in_wk > 6 )
+    error( "Invalid week start in C function time_bin" );
+
+  if( !isString(zone) || length(zone) < 1L ||
+      !( zonestr = CHAR(STRING_ELT(zone, 0))))
+    error( "Invalid time zone in C function time_bin" );
+
+  tzone = find_zone( zonestr, zone_list );
+  if( !tzone )
+    error( "Unknown or unreadable time zone in C function time_bin" );
+
+  /* get the desired parts of the time object */
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL, 
+			NULL, NULL ))
+    error("Invalid argument in C function time_bin");
+
+  PROTECT(codes = NEW_INTEGER( lng ));
+  code_data = INTEGER( codes );
+
+  /* first pass: find the bin ordinal of each time, and the range */
+
+  bin_idx = (double *) R_alloc( lng, sizeof(double) );
+  has_data = 0;
+  min_idx = max_idx = 0;
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( in_days[i] == NA_INTEGER || 
+	in_ms[i] == NA_INTEGER ||
+	!date_bin_index_gmt( in_days[i], in_ms[i], tzone, in_unit, in_k, 
+			     in_wk, &(bin_idx[i]) ))
+    {
+      bin_idx[i] = NA_REAL;
+      continue;
+    }
+
+    if( !has_data || bin_idx[i] < min_idx )
+      min_idx = bin_idx[i];
+    if( !has_data || bin_idx[i] > max_idx )
+      max_idx = bin_idx[i];
+    has_data = 1;
+  }
+
+  /* second pass: find the start of each bin in the range */
+
+  if( !has_data )
+    nbins = 0;
+  else if( max_idx - min_idx + 1 >= INT_MAX ){
+    UNPROTECT(3);
+    error( "Too many bins in C function time_bin" );
+  }
+  else
+    nbins = (Sint) ( max_idx - min_idx + 1 );
+
+  bin_map = (Sint *) R_alloc( nbins + 1, sizeof(Sint) );
+  start_days = (Sint *) R_alloc( nbins + 1, sizeof(Sint) );
+  start_ms = (Sint *) R_alloc( nbins + 1, sizeof(Sint) );
+  nlev = 0;
+
+  for( i = 0; i < nbins; i++ )
+  {
+    this_idx = min_idx + i;
+    bin_map[i] = NA_INTEGER;
+
+    if( !date_bin_start( this_idx, tzone, in_unit, in_k, in_wk, 
+			 &tmp_jul, &tmp_ms ) ||
+	!date_bin_index_gmt( tmp_jul, tmp_ms, tzone, in_unit, in_k, in_wk, 
+			     &chk_idx ) ||
+	chk_idx != this_idx )
+      continue;
+
+    bin_map[i] = nlev;
+    start_days[nlev] = tmp_jul;
+    start_ms[nlev] = tmp_ms;
+    nlev++;
+  }
+
+  /* closing break: the start of the next bin that exists, or else of
+     the first bin after the last one */
+
+  if( nbins )
+  {
+    end_jul = end_ms = NA_INTEGER;
+    for( this_idx = max_idx + 1; this_idx < max_idx + 1000; this_idx++ )
+    {
+      if( !date_bin_start( this_idx, tzone, in_unit, in_k, in_wk, 
+			   &tmp_jul, &tmp_ms ))
+	continue;
+      if( end_jul == NA_INTEGER )
+      {
+	end_jul = tmp_jul;
+	end_ms = tmp_ms;
+      }
+      if( date_bin_index_gmt( tmp_jul, tmp_ms, tzone, in_unit, in_k, in_wk, 
+			      &chk_idx ) &&
+	  chk_idx == this_idx )
+      {
+	end_jul = tmp_jul;
+	end_ms = tmp_ms;
+	break;
+      }
+    }
+    start_days[nlev] = end_jul;
+    start_ms[nlev] = end_ms;
+  }
+
+  /* fill in the codes and break times */
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( ISNA( bin_idx[i] ) ||
+	bin_map[ (Sint) ( bin_idx[i] - min_idx ) ] == NA_INTEGER )
+      code_data[i] = NA_INTEGER;
+    else
+      code_data[i] = bin_map[ (Sint) ( bin_idx[i] - min_idx ) ] + 1;
+  }
+
+  PROTECT(breaks = time_create_new( nbins ? nlev + 1 : 0, 
+				    &jul_data, &ms_data ));
+  if( !breaks || ( nbins && ( !jul_data || !ms_data ))){
+    UNPROTECT(4);
+    error( "Could not create new time object in C function time_bin" );
+  }
+
+  for( i = 0; nbins && i <= nlev; i++ )
+  {
+    jul_data[i] = start_days[i];
+    ms_data[i] = start_ms[i];
+  }
+
+  PROTECT(ret = allocVector( VECSXP, 2 ));
+  SET_VECTOR_ELT( ret, 0, codes );
+  SET_VECTOR_ELT( ret, 1, breaks );
+
+  UNPROTECT(5); //3 + 2 from time_get_pieces
+  return( ret );
+}
+
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_floor_unit
+
+   DESCRIPTION  Find new times corresponding to the input times, such that
+   in a given time zone, each is the start of a calendar bin, such as a
+   k-minute, daily, weekly, monthly, quarterly, or yearly bin, and is no 
+   later than the input time.
+   To be called from R as 
+   \\
+   {\tt 
+   .Call("time_floor_unit", time.vec, unit, k, week.start, zone, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  time_vec   The R time vector object
+      IARG  unit       Unit abbreviation ("ms", "sec", "min", "hr", "day", 
+                       "wk", "mth", "qtr", or "yr")
+      IARG  k          Number of units in each bin
+      IARG  week_start Weekday weekly bins start on (0 = Sunday)
+      IARG  zone       Name of the time zone
+      IARG  zone_list  The list of R time zone objects
+
+   RETURN Returns a time vector object of the same length as the input time
+   vector, containing the above described output times.
+
+   ALGORITHM  For each input time, this function calculates the floor
+   time with the date_floor_unit function, which uses the same bins as
+   time_bin and is correct across daylight savings gaps and overlaps.
+   No special time zones or formats are put on the returned object.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_ceiling_unit, time_floor, time_bin
+
+**********************************************************************/
+SEXP time_floor_unit( SEXP time_vec, SEXP unit, SEXP k, SEXP week_start,
+		      SEXP zone, SEXP zone_list )
+{
+  return( time_unit_round( time_vec, unit, k, week_start, zone, 
+			   zone_list, 0 ));
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_ceiling_unit
+
+   DESCRIPTION  Find new times corresponding to the input times, such that
+   in a given time zone, each is the start of a calendar bin and is no 
+   earlier than the input time.
+   To be called from R as 
+   \\
+   {\tt 
+   .Call("time_ceiling_unit", time.vec, unit, k, week.start, zone, 
+         zone.list)
+   }
+
+   ARGUMENTS
+      IARG  time_vec   The R time vector object
+      IARG  unit       Unit abbreviation, as for time_floor_unit
+      IARG  k          Number of units in each bin
+      IARG  week_start Weekday weekly bins start on (0 = Sunday)
+      IARG  zone       Name of the time zone
+      IARG  zone_list  The list of R time zone objects
+
+   RETURN Returns a time vector object of the same length as the input time
+   vector, containing the above described output times.
+
+   ALGORITHM  For each input time, this function calculates the ceiling
+   time with the date_ceil_unit function.
+   No special time zones or formats are put on the returned object.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_floor_unit, time_ceiling, time_bin
+
+**********************************************************************/
+SEXP time_ceiling_unit( SEXP time_vec, SEXP unit, SEXP k, SEXP week_start,
+			SEXP zone, SEXP zone_list )
+{
+  return( time_unit_round( time_vec, unit, k, week_start, zone, 
+			   zone_list, 1 ));
+}
+
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME add_vec_vec
+
+   DESCRIPTION  Add or subtract two equal-length vectors of julian days
+   and milliseconds.
+
+   ARGUMENTS
+      IARG  days1     Julian days of the first operand
+      IARG  ms1       Milliseconds of the first operand
+      IARG  days2     Julian days of the second operand
+      IARG  ms2       Milliseconds of the second operand
+      IARG  sgn       1 to add the second operand, -1 to subtract it
+      IARG  lng       Length of all the vectors
+      IARG  is_span   1 if the output is a time span, 0 for a time
+      OARG  out_days  Julian days of the output
+      OARG  out_ms    Milliseconds of the output
+
+   RETURN Returns 1 if some output milliseconds are still out of range
+   and need add_fixup, and 0 otherwise.
+
+   ALGORITHM  The days and milliseconds are combined, and then carried
+   by at most one day, which is all that is needed when the inputs are
+   in the form adjust_time and adjust_span make; the result is then the
+   same as theirs.  NA inputs give NA outputs by selection rather than
+   by branching, and the is_span test is outside the loops, so that the
+   compiler can vectorize them.  Inputs out of the usual form are left
+   for add_fixup.
+
+   EXCEPTIONS 
+
+   NOTE See also: add_vec_scalar, add_fixup, time_time_add, time_num_op
+
+**********************************************************************/
+static int add_vec_vec( const Sint *days1, const Sint *ms1, 
+			const Sint *days2, const Sint *ms2, Sint sgn, 
+			Sint lng, int is_span, Sint * restrict out_days,
+			Sint * restrict out_ms )
+{
+  Sint i, day, ms, carry, is_na;
+  int bad = 0;
+
+  if( is_span )
+  {
+    for( i = 0; i < lng; i++ )
+    {
+      is_na = ( days1[i] == NA_INTEGER ) | ( ms1[i] == NA_INTEGER ) |
+	( days2[i] == NA_INTEGER ) | ( ms2[i] == NA_INTEGER );
+      /* zero the NA values, so the arithmetic cannot overflow */
+      day = ( is_na ? 0 : days1[i] ) + sgn * ( is_na ? 0 : days2[i] );
+      ms = ( is_na ? 0 : ms1[i] ) + sgn * ( is_na ? 0 : ms2[i] );
+      carry = ( ms >= MS_PER_DAY ) - ( ms <= -MS_PER_DAY );
+      day += carry;
+      ms -= carry * MS_PER_DAY;
+      carry = (( day > 0 ) & ( ms < 0 )) - (( day < 0 ) & ( ms > 0 ));
+      day -= carry;
+      ms += carry * MS_PER_DAY;
+      bad |= !is_na & (( ms >= MS_PER_DAY ) | ( ms <= -MS_PER_DAY ));
+      out_days[i] = is_na ? NA_INTEGER : day;
+      out_ms[i] = is_na ? NA_INTEGER : ms;
+    }
+  }
+  else
+  {
+    for( i = 0; i < lng; i++ )
+    {
+      is_na = ( days1[i] == NA_INTEGER ) | ( ms1[i] == NA_INTEGER ) |
+	( days2[i] == NA_INTEGER ) | ( ms2[i] == NA_INTEGER );
+      day = ( is_na ? 0 : days1[i] ) + sgn * ( is_na ? 0 : days2[i] );
+      ms = ( is_na ? 0 : ms1[i] ) + sgn * ( is_na ? 0 : ms2[i] );
+      carry = ( ms >= MS_PER_DAY ) - ( ms < 0 );
+      day += carry;
+      ms -= carry * MS_PER_DAY;
+      bad |= !is_na & (( ms >= MS_PER_DAY ) | ( ms < 0 ));
+      out_days[i] = is_na ? NA_INTEGER : day;
+      out_ms[i] = is_na ? NA_INTEGER : ms;
+    }
+  }
+
+  return bad;
+}
+
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME add_vec_scalar
+
+   DESCRIPTION  Add a single julian day and millisecond value to a 
+   vector of julian days and milliseconds.
+
+   ARGUMENTS
+      IARG  days      Julian days of the vector operand
+      IARG  ms        Milliseconds of the vector operand
+      IARG  sgn       1 or -1, to multiply the vector operand by
+      IARG  add_day   Julian days to add, or NA_INTEGER
+      IARG  add_ms    Milliseconds to add, or NA_INTEGER
+      IARG  lng       Length of the vectors
+      IARG  is_span   1 if the output is a time span, 0 for a time
+      OARG  out_days  Julian days of the output
+      OARG  out_ms    Milliseconds of the output
+
+   RETURN Returns 1 if some output milliseconds are still out of range
+   and need add_fixup, and 0 otherwise.
+
+   ALGORITHM  The output is sgn times the vector plus the single value,
+   carried as in add_vec_vec.  An NA single value makes the whole 
+   output NA.
+
+   EXCEPTIONS 
+
+   NOTE See also: add_vec_vec, add_fixup
+
+**********************************************************************/
+static int add_vec_scalar( const Sint *days, const Sint *ms, Sint sgn, 
+			   Sint add_day, Sint add_ms, Sint lng, int is_span, 
+			   Sint * restrict out_days, Sint * restrict out_ms )
+{
+  Sint i, day, tmp_ms, carry, is_na;
+  int bad = 0;
+
+  if( add_day == NA_INTEGER || add_ms == NA_INTEGER )
+  {
+    for( i = 0; i < lng; i++ )
+      out_days[i] = out_ms[i] = NA_INTEGER;
+    return 0;
+  }
+
+  if( is_span )
+  {
+    for( i = 0; i < lng; i++ )
+    {
+      is_na = ( days[i] == NA_INTEGER ) | ( ms[i] == NA_INTEGER );
+      /* zero the NA values, so the arithmetic cannot overflow */
+      day = sgn * ( is_na ? 0 : days[i] ) + add_day;
+      tmp_ms = sgn * ( is_na ? 0 : ms[i] ) + add_ms;
+      carry = ( tmp_ms >= MS_PER_DAY ) - ( tmp_ms <= -MS_PER_DAY );
+      day += carry;
+      tmp_ms -= carry * MS_PER_DAY;
+      carry = (( day > 0 ) & ( tmp_ms < 0 )) - (( day < 0 ) & ( tmp_ms > 0 ));
+      day -= carry;
+      tmp_ms += carry * MS_PER_DAY;
+      bad |= !is_na & (( tmp_ms >= MS_PER_DAY ) | ( tmp_ms <= -MS_PER_DAY ));
+      out_days[i] = is_na ? NA_INTEGER : day;
+      out_ms[i] = is_na ? NA_INTEGER : tmp_ms;
+    }
+  }
+  else
+  {
+    for( i = 0; i < lng; i++ )
+    {
+      is_na = ( days[i] == NA_INTEGER ) | ( ms[i] == NA_INTEGER );
+      day = sgn * ( is_na ? 0 : days[i] ) + add_day;
+      tmp_ms = sgn * ( is_na ? 0 : ms[i] ) + add_ms;
+      carry = ( tmp_ms >= MS_PER_DAY ) - ( tmp_ms < 0 );
+      day += carry;
+      tmp_ms -= carry * MS_PER_DAY;
+      bad |= !is_na & (( tmp_ms >= MS_PER_DAY ) | ( tmp_ms < 0 ));
+      out_days[i] = is_na ? NA_INTEGER : day;
+      out_ms[i] = is_na ? NA_INTEGER : tmp_ms;
+    }
+  }
+
+  return bad;
+}
+
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME add_fixup
+
+   DESCRIPTION  Finish the adjustment of sums made by add_vec_vec and 
+   add_vec_scalar whose milliseconds are still out of range.
+
+   ARGUMENTS
+      IARG  lng       Length of the vectors
+      IARG  is_span   1 if the output is a time span, 0 for a time
+      IOARG out_days  Julian days of the output
+      IOARG out_ms    Milliseconds of the output
+
+   RETURN None
+
+   ALGORITHM  The partial carries keep the total of days and 
+   milliseconds, so adjust_time or adjust_span gives the same result as
+   it would have on the plain sum.  Outputs they fail to adjust are set
+   to NA, as in the element by element loop.
+
+   EXCEPTIONS 
+
+   NOTE See also: add_vec_vec, add_vec_scalar
+
+**********************************************************************/
+static void add_fixup( Sint lng, int is_span, Sint *out_days, 
+		       Sint *out_ms )
+{
+  Sint i;
+  int tmp;
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( out_days[i] == NA_INTEGER || out_ms[i] == NA_INTEGER )
+      continue;
+    if( is_span )
+      tmp = adjust_span( &(out_days[i]), &(out_ms[i] ));
+    else
+      tmp = adjust_time( &(out_days[i]), &(out_ms[i] ));
+
+    if( !tmp )
+      out_days[i] = out_ms[i] = NA_INTEGER;
+  }
+}
+
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME add_packed
+
+   DESCRIPTION  Add two vectors of packed milliseconds, making a packed
+   object.
+
+   ARGUMENTS
+      IARG  in1      First vector of milliseconds since 1960
+      IARG  lng1     Length of in1
+      IARG  in2      Second vector of milliseconds, NA_REAL for NA
+      IARG  lng2     Length of in2; one length is a multiple of the other
+      IARG  sgn      1 to add or -1 to subtract in2
+      IARG  is_span  1 to make a time span object, 0 for a time object
+
+   RETURN Returns the new packed time or time span object.
+
+   ALGORITHM  The sums of whole milliseconds are exact in a double, so
+   no carrying is needed and the loop vectorizes.  NA inputs, and sums
+   not less than TIME_PACKED_MAX_MS in absolute value, give NA.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_time_add, time_num_op, time_create_packed
+
+**********************************************************************/
+static SEXP add_packed( const double *in1, Sint lng1, const double *in2, 
+			Sint lng2, int sgn, int is_span )
+{
+  SEXP ret;
+  double *out;
+  Sint i, lng;
+
+  if( !lng1 || !lng2 )
+    lng = 0;
+  else if( lng2 > lng1 )
+    lng = lng2;
+  else
+    lng = lng1;
+
+  PROTECT( ret = time_create_packed( lng, is_span, &out ));
+  if( !ret || !out )
+    error( "Could not create return object in C function add_packed" );
+
+  if( lng1 == lng2 )
+    for( i = 0; i < lng; i++ )
+      out[i] = in1[i] + sgn * in2[i];
+  else
+    for( i = 0; i < lng; i++ )
+      out[i] = in1[ i % lng1 ] + sgn * in2[ i % lng2 ];
+
+  for( i = 0; i < lng; i++ )
+    if( ISNAN( out[i] ) || fabs( out[i] ) >= TIME_PACKED_MAX_MS )
+      out[i] = NA_REAL;
+
+  UNPROTECT(1);
+  return ret;
+}
+
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_unit_round
+
+   DESCRIPTION  Do the work of time_floor_unit and time_ceiling_unit.
+
+   ARGUMENTS
+      IARG  time_vec   The R time vector object
+      IARG  unit       Unit abbreviation
+      IARG  k          Number of units in each bin
+      IARG  week_start Weekday weekly bins start on (0 = Sunday)
+      IARG  zone       Name of the time zone
+      IARG  zone_list  The list of R time zone objects
+      IARG  is_ceil    1 for the ceiling, 0 for the floor
+
+   RETURN Returns the new time vector object.
+
+   ALGORITHM  The arguments are checked as in time_bin, the zone is
+   found once, and date_floor_unit or date_ceil_unit is called for each
+   time.  Times they fail for become NA.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_floor_unit, time_ceiling_unit
+
+**********************************************************************/
+static SEXP time_unit_round( SEXP time_vec, SEXP unit, SEXP k, 
+			     SEXP week_start, SEXP zone, SEXP zone_list,
+			     int is_ceil )
+{
+  SEXP ret;
+  Sint *in_days, *in_ms, *jul_data, *ms_data;
+  Sint i, lng, in_k;
+  int in_wk, is_ok;
+  const char *zonestr;
+  const char *fname = is_ceil ? "time_ceiling_unit" : "time_floor_unit";
+  TIME_UNIT_CODE in_unit;
+  TZONE_STRUCT *tzone;
+
+  /* extract the bin definition */
+
+  if( !isString(unit) || length(unit) < 1L ||
+      ( in_unit = time_unit_from_str( CHAR(STRING_ELT(unit, 0)))) 
+      == UNIT_ERROR )
+    error( "Invalid unit in C function %s", fname );
+
+  if( !IS_INTEGER(k) || length(k) < 1L || 
+      ( in_k = INTEGER(k)[0] ) == NA_INTEGER || in_k < 1 )
+    error( "Invalid number of units in C function %s", fname );
+
+  if( !IS_INTEGER(week_start) || length(week_start) < 1L || 
+      ( in_wk = INTEGER(week_start)[0] ) == NA_INTEGER || 
+      in_wk < 0 || in_wk > 6 )
+    error( "Invalid week start in C function %s", fname );
+
+  if( !isString(zone) || length(zone) < 1L ||
+      !( zonestr = CHAR(STRING_ELT(zone, 0))))
+    error( "Invalid time zone in C function %s", fname );
+
+  tzone = find_zone( zonestr, zone_list );
+  if( !tzone )
+    error( "Unknown or unreadable time zone in C function %s", fname );
+
+  /* get the desired parts of the time object */
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL, 
+			NULL, NULL ))
+    error( "Invalid argument in C function %s", fname );
+
+  PROTECT(ret = time_create_new( lng, &jul_data, &ms_data ));
+  if( !ret || ( lng && ( !jul_data || !ms_data ))){
+    UNPROTECT(3);
+    error( "Could not create new time object in C function %s", fname );
+  }
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( in_days[i] == NA_INTEGER || in_ms[i] == NA_INTEGER )
+      is_ok = 0;
+    else if( is_ceil )
+      is_ok = date_ceil_unit( in_days[i], in_ms[i], tzone, in_unit, in_k, 
+			      in_wk, &(jul_data[i]), &(ms_data[i]) );
+    else
+      is_ok = date_floor_unit( in_days[i], in_ms[i], tzone, in_unit, in_k, 
+			       in_wk, &(jul_data[i]), &(ms_data[i]) );
+    if( !is_ok )
+    {
+      jul_data[i] = NA_INTEGER;
+      ms_data[i] = NA_INTEGER;
+    }
+  }
+
+  UNPROTECT(3); //1+2 from time_get_pieces
+  return( ret );
+}
+
+/* Julian dates of the holidays for relative time addition, sorted
+   and without duplicates.  For a bizCalendar, these are its
+   non-business weekdays, which are already dates; other holidays are
+   converted to dates in their own time zone, and the result is cached
+   so that the same holidays aren't converted again.  Returns 0 if a
+   holiday is NA, and exits with an error for an invalid argument. */
+
+static int rel_holiday_dates( SEXP hol_vec, SEXP zone_list, 
+			      Sint **hol_dates, Sint *num_hols,
+			      const char *fn )
+{
+  Sint *hol_days, *hol_ms, *dates, lng_hol, i, n;
+  TIME_DATE_STRUCT td_hol;
+  TZONE_STRUCT *tzone_hol;
+  BIZ_CALENDAR bc;
+  static const char *biz_classes[] = {
+    BIZ_CALENDAR_CLASS_NAME
+  };
+
+  *hol_dates = NULL;
+  *num_hols = 0;
+
+  if( checkClass( hol_vec, biz_classes, 1L ))
+  {
+    if( !biz_calendar_get( hol_vec, &bc ))
+      error( "Invalid business calendar in C function %s", fn );
+    *hol_dates = bc.dates;
+    *num_hols = bc.num_dates;
+    return 1;
+  }
+
+  if( !time_get_pieces( hol_vec, NULL, &hol_days, &hol_ms, &lng_hol, NULL, 
+			&td_hol.zone, NULL ) ||
+      (( lng_hol && (!hol_days || !hol_ms )) || !td_hol.zone ))
+    error( "Invalid holiday argument in C function %s", fn );
+
+  tzone_hol = find_zone( td_hol.zone, zone_list );
+  if( !tzone_hol )
+    error( "Unknown or unreadable time zone for holidays in C function %s", fn );
+
+  if( !lng_hol ||
+      ( *hol_dates = hol_cache_find( hol_days, hol_ms, lng_hol, td_hol.zone,
+				     tzone_hol, num_hols )))
+  {
+    UNPROTECT(2); //from time_get_pieces
+    return 1;
+  }
+
+  dates = (Sint *) R_alloc( lng_hol, sizeof(Sint) );
+  for( i = 0; i < lng_hol; i++ )
+  {
+    if(  hol_days[i] == NA_INTEGER || 
+	 hol_ms[i] == NA_INTEGER ||
+	!jms_to_zone( hol_days[i], hol_ms[i], tzone_hol, &td_hol ) ||
+	!julian_from_mdy( td_hol, &(dates[i])))
+    {
+      UNPROTECT(2); //from time_get_pieces
+      return 0;
+    }
+  }
+
+  /* sort and drop duplicates */
+  qsort( dates, lng_hol, sizeof(Sint), compare_julian );
+  for( i = n = 0; i < lng_hol; i++ )
+    if( !n || dates[i] != dates[n - 1] )
+      dates[n++] = dates[i];
+
+  *hol_dates = hol_cache_add( hol_days, hol_ms, lng_hol, td_hol.zone,
+			      tzone_hol, dates, n );
+  if( !*hol_dates )
+    *hol_dates = dates;
+  *num_hols = n;
+
+  UNPROTECT(2); //from time_get_pieces
+  return 1;
+}
+
+/* cached dates of a holiday list, or NULL if it isn't cached.  The
+   zone is compared as well as the name, in case the zone list
+   defines the name differently. */
+
+static Sint *hol_cache_find( const Sint *days, const Sint *ms, Sint num,
+			     const char *zone, const TZONE_STRUCT *tzone,
+			     Sint *num_dates )
+{
+  int i;
+  HOL_CACHE *entry;
+  const TZONE_STRUCT *zone_key;
+
+  if( !hol_cache_zone( tzone, &zone_key ))
+    return NULL;
+
+  for( i = 0; i < HOL_CACHE_MAX; i++ )
+  {
+    entry = &(hol_cache[i]);
+    if( !entry->key || entry->num != num || entry->tzone != zone_key ||
+	entry->offset != tzone->offset || strcmp( entry->zone, zone ) ||
+	memcmp( entry->key, days, num * sizeof(Sint) ) ||
+	memcmp( entry->key + num, ms, num * sizeof(Sint) ))
+      continue;
+    *num_dates = entry->num_dates;
+    return( entry->dates );
+  }
+  return NULL;
+}
+
+/* add a holiday list and its dates to the cache, replacing the oldest
+   entry if it is full; returns the cached dates, or NULL if there
+   isn't memory for them or the zone can't be matched later */
+
+static Sint *hol_cache_add( const Sint *days, const Sint *ms, Sint num,
+			    const char *zone, const TZONE_STRUCT *tzone,
+			    const Sint *dates, Sint num_dates )
+{
+  HOL_CACHE *entry;
+  char *block;
+  size_t size;
+  const TZONE_STRUCT *zone_key;
+
+  if( !hol_cache_zone( tzone, &zone_key ))
+    return NULL;
+
+  size = ( 2 * (size_t) num + num_dates ) * sizeof(Sint) + strlen( zone ) + 1;
+  if( !( block = (char *) malloc( size )))
+    return NULL;
+
+  entry = &(hol_cache[ hol_cache_next ]);
+  hol_cache_next = ( hol_cache_next + 1 ) % HOL_CACHE_MAX;
+  free( entry->key );
+
+  entry->key = (Sint *) block;
+  entry->dates = entry->key + 2 * num;
+  entry->zone = (char *) ( entry->dates + num_dates );
+  memcpy( entry->key, days, num * sizeof(Sint) );
+  memcpy( entry->key + num, ms, num * sizeof(Sint) );
+  memcpy( entry->dates, dates, num_dates * sizeof(Sint) );
+  strcpy( entry->zone, zone );
+  entry->num = num;
+  entry->num_dates = num_dates;
+  entry->offset = tzone->offset;
+  entry->tzone = zone_key;
+
+  return( entry->dates );
+}
+
+/* the address to match a holiday list's zone by: NULL for a zone that
+   is only an offset, or the zone itself if it is kept for the session.
+   Returns 0 for other zones, which were allocated for this call only,
+   so their address could be reused by a different zone later. */
+
+static int hol_cache_zone( const TZONE_STRUCT *tzone, 
+			   const TZONE_STRUCT **key )
+{
+  if( zone_is_fixed( tzone ))
+    *key = NULL;
+  else if( zone_is_kept( tzone ))
+    *key = tzone;
+  else
+    return 0;
+  return 1;
+}
+
+/* qsort comparison for julian days */
+
+static int compare_julian( const void *a, const void *b )
+{
+  Sint ja = *(const Sint *) a, jb = *(const Sint *) b;
+
+  return(( ja > jb ) - ( ja < jb ));
+}
+
+/* set up the step of a relative time sequence from its start time, 
+   with the first relative time string; returns 0 if the relative time
+   isn't regular from there (see rtime_step_init), and exits with an 
+   error for invalid arguments */
+
+static int rel_seq_step( SEXP start_time, SEXP rel_strs, SEXP zone_list,
+			 RT_STEP *step, const char *fn )
+{
+  Sint *start_days, *start_ms, lng;
+  char *zone;
+  TZONE_STRUCT *tzone;
+  RT_FIELD fields[ RT_FIELD_BUF ];
+  int num_fields, is_regular;
+
+  if( !isString(rel_strs) || length(rel_strs) < 1L )
+    error( "Problem extracting relative time strings in C function %s", fn );
+  num_fields = rtime_parse( CHAR(STRING_ELT(rel_strs, 0)), fields, 
+			    RT_FIELD_BUF );
+  if( num_fields < 0 )
+    error( "Could not add relative time in C function %s", fn );
+
+  if( !time_get_pieces( start_time, NULL, &start_days, &start_ms, &lng, 
+			NULL, &zone, NULL ) ||
+      !zone || !lng || !start_days || !start_ms )
+    error( "Invalid time argument in C function %s", fn );
+
+  tzone = find_zone( zone, zone_list );
+  if( !tzone ){
+    UNPROTECT(2); //from time_get_pieces
+    error( "Unknown or unreadable time zone in C function %s", fn );
+  }
+  if(( *start_days == NA_INTEGER ) || ( *start_ms == NA_INTEGER )){
+    UNPROTECT(2); //from time_get_pieces
+    error( "NA not allowed in sequence" );
+  }
+
+  is_regular = ( num_fields == 1 ) &&
+    rtime_step_init( step, fields, num_fields, *start_days, *start_ms, 
+		     tzone );
+
+  UNPROTECT(2); //from time_get_pieces
+  return( is_regular );
+}
+
+/* whether the element count steps from the start of a regular 
+   sequence is beyond the end time in the given direction; returns 0
+   if the element can't be found */
+
+static int rel_seq_beyond( const RT_STEP *step, Sint count, int direction,
+			   Sint end_day, Sint end_ms, int *beyond )
+{
+  Sint day, ms;
+
+  if( !rtime_step_jms( step, count, &day, &ms ))
+    return 0;
+
+  *beyond = ( direction * ( day - end_day ) > 0 ) ||
+    (( day == end_day ) && ( direction * ( ms - end_ms ) > 0 ));
+  return 1;
+}
+
+/* whether the times, with no NA, all differ from the one before by 
+   the first difference, within tol days */
+
+static int seq_detect_step( const Sint *days, const Sint *ms, Sint lng, 
+			    double tol )
+{
+  long long first, diff;
+  Sint i;
+
+  for( i = 0; i < lng; i++ )
+  {
+    if(( days[i] == NA_INTEGER ) || ( ms[i] == NA_INTEGER ))
+      return 0;
+    if( i < 1 )
+      continue;
+
+    diff = ((long long) days[i] - days[i - 1] ) * MS_PER_DAY + 
+      ms[i] - ms[i - 1];
+    if( i == 1 )
+      first = diff;
+    else if( fabs( (double) ( diff - first ) / MS_PER_DAY ) > tol )
+      return 0;
+  }
+  return 1;
+}
+
+/* the kind of monthly sequence the times are, with the number of 
+   months between them, or SEQ_DETECT_NONE */
+
+static int seq_detect_months( const Sint *days, const Sint *ms, Sint lng,
+			      TZONE_STRUCT *tzone, Sint *months )
+{
+  TIME_DATE_STRUCT td, td_prev;
+  Sint i, diff;
+  int same_day = 1, month_end = 1;
+
+  memset( &td_prev, 0, sizeof(td_prev) );
+
+  for( i = 0; i < lng; i++ )
+  {
+    if(( days[i] == NA_INTEGER ) || ( ms[i] == NA_INTEGER ) ||
+       !jms_to_zone( days[i], ms[i], tzone, &td ))
+      return( SEQ_DETECT_NONE );
+
+    month_end = month_end && 
+      ( td.day == days_in_month( td.month, td.year ));
+    if( i < 1 )
+    {
+      td_prev = td;
+      continue;
+    }
+
+    if(( td.hour != td_prev.hour ) || ( td.minute != td_prev.minute ) ||
+       ( td.second != td_prev.second ) || ( td.ms != td_prev.ms ))
+      return( SEQ_DETECT_NONE );
+    same_day = same_day && ( td.day == td_prev.day );
+    if( !same_day && !month_end )
+      return( SEQ_DETECT_NONE );
+
+    diff = 12 * ( td.year - td_prev.year ) + td.month - td_prev.month;
+    if( i == 1 )
+      *months = diff;
+    else if( diff != *months )
+      return( SEQ_DETECT_NONE );
+    td_prev = td;
+  }
+
+  return( month_end ? SEQ_DETECT_MONTHEND : SEQ_DETECT_MONTHS );
+}
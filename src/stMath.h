@@ -14,8 +14,15 @@
 #include "zoneObj.h"
 #include "zoneFuns.h"
 #include "relTime.h"
+#include "bizCal.h"
 #include <string.h>
 
+/* kinds of sequence found by time_seq_detect */
+#define SEQ_DETECT_NONE 0
+#define SEQ_DETECT_STEP 1
+#define SEQ_DETECT_MONTHS 2
+#define SEQ_DETECT_MONTHEND 3
+
 SEXP time_floor( SEXP time_vec, SEXP zone_list );
 SEXP time_ceiling( SEXP time_vec, SEXP zone_list );
 SEXP time_time_add( SEXP time1, SEXP time2, 
@@ -30,6 +37,17 @@ SEXP time_rel_seq( SEXP start_time, SEXP end_time,
 		    SEXP len_vec, SEXP has_len,
 		    SEXP rel_strs, SEXP hol_vec,
 		    SEXP zone_list);
+SEXP time_rel_seq_index( SEXP start_time, SEXP rel_strs, SEXP counts,
+			 SEXP zone_list );
+SEXP time_rel_seq_length( SEXP start_time, SEXP end_time, SEXP rel_strs,
+			  SEXP zone_list );
+SEXP time_seq_detect( SEXP time_vec, SEXP tol, SEXP zone_list );
+SEXP time_bin( SEXP time_vec, SEXP unit, SEXP k, SEXP week_start,
+	       SEXP zone, SEXP zone_list );
+SEXP time_floor_unit( SEXP time_vec, SEXP unit, SEXP k, SEXP week_start,
+		      SEXP zone, SEXP zone_list );
+SEXP time_ceiling_unit( SEXP time_vec, SEXP unit, SEXP k, SEXP week_start,
+			SEXP zone, SEXP zone_list );
 
 
 #endif  // TIMELIB_STMATH_H
@@ -0,0 +1,728 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved. 
+ * Confidential & Proprietary 
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ *
+ * It contains C code utility functions for aggregating data by
+ * calendar bins of R time objects.
+ *
+ * The exported functions here were written to be called with the 
+ * .Call interface of R.  They include (see documentation below):
+  SEXP time_aggregate( SEXP time_vec, SEXP values, SEXP unit, SEXP k, 
+		       SEXP week_start, SEXP zone, SEXP funs, SEXP na_rm,
+		       SEXP zone_list );
+  SEXP time_rolling( SEXP time_vec, SEXP lower_vec, SEXP values, 
+                     SEXP funs, SEXP na_rm );
+*************************************************************************/
+
+#include "timeAgg.h"
+
+/* aggregation functions */
+
+typedef enum agg_code
+{
+  AGG_ERROR,
+  AGG_SUM,
+  AGG_MEAN,
+  AGG_MIN,
+  AGG_MAX,
+  AGG_FIRST,
+  AGG_LAST,
+  AGG_COUNT
+} AGG_CODE;
+
+static AGG_CODE agg_from_str( const char *str );
+static Sint group_sorted( double *bin_idx, Sint lng, Sint *group, 
+			  double *keys );
+static Sint group_hashed( double *bin_idx, Sint lng, Sint *group, 
+			  double *keys );
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_aggregate
+
+   DESCRIPTION  Aggregate numeric data over calendar bins of a time 
+   vector, such as 5-minute, daily, or monthly bins in a given zone.
+   To be called from R as 
+   \\
+   {\tt 
+   .Call("time_aggregate", time.vec, values, unit, k, week.start, zone,
+         funs, na.rm, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  time_vec   The R time vector object
+      IARG  values     Numeric matrix with one row per time
+      IARG  unit       Unit abbreviation, as for time_bin
+      IARG  k          Number of units in each bin
+      IARG  week_start Weekday weekly bins start on (0 = Sunday)
+      IARG  zone       Name of the time zone to bin in
+      IARG  funs       Names of the aggregation functions: "sum", "mean",
+                       "min", "max", "first", "last", or "count"
+      IARG  na_rm      Logical: whether to omit NA values
+      IARG  zone_list  The list of R time zone objects
+
+   RETURN Returns a list.  The first element is a time vector containing
+   the starting time of each bin that contains at least one time, in
+   increasing order.  The remaining elements correspond to the elements of
+   funs, and are numeric matrices with one row per bin and the same number
+   of columns as values, containing the aggregated data.
+
+   ALGORITHM  The bin ordinal of each time is found using 
+   date_bin_index_gmt.  If the ordinals are non-decreasing, as they are
+   for sorted times, the bins are found in one pass by comparing each
+   ordinal to the previous one; otherwise, they are found using a hash 
+   table keyed on the ordinal, and then sorted.  Then the data are 
+   aggregated in one pass per column, keeping running sums, counts, 
+   extremes, and the rows of the earliest and latest times in each bin.
+   Times that are NA are omitted.  Unless na_rm is true, an NA value
+   makes the sum, mean, minimum, and maximum of its bin NA; the first and
+   last values are those of the earliest and latest times in the bin,
+   and the count is the number of values used.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_bin, date_bin_start
+
+**********************************************************************/
+SEXP time_aggregate( SEXP time_vec, SEXP values, SEXP unit, SEXP k, 
+		     SEXP week_start, SEXP zone, SEXP funs, SEXP na_rm,
+		     SEXP zone_list )
+{
+  SEXP ret, starts, tmp;
+  Sint *in_days, *in_ms, *jul_data, *ms_data, *group;
+  Sint i, j, g, col, lng, nrow, ncol, ngroup, nfun, in_k;
+  Sint *first_row, *last_row, *counts;
+  int in_wk, in_narm, *has_na;
+  double *in_vals, *bin_idx, *keys, *sums, *mins, *maxs, *out, this_time;
+  double *first_time, *last_time, val;
+  const char *zonestr;
+  AGG_CODE *fun_codes;
+  TIME_UNIT_CODE in_unit;
+  TZONE_STRUCT *tzone;
+
+  /* extract the bin definition and functions */
+
+  if( !isString(unit) || length(unit) < 1L ||
+      ( in_unit = time_unit_from_str( CHAR(STRING_ELT(unit, 0)))) 
+      == UNIT_ERROR )
+    error( "Invalid unit in C function time_aggregate" );
+
+  if( !IS_INTEGER(k) || length(k) < 1L || 
+      ( in_k = INTEGER(k)[0] ) == NA_INTEGER || in_k < 1 )
+    error( "Invalid number of units in C function time_aggregate" );
+
+  if( !IS_INTEGER(week_start) || length(week_start) < 1L || 
+      ( in_wk = INTEGER(week_start)[0] ) == NA_INTEGER || 
+      in_wk < 0 || in_wk > 6 )
+    error( "Invalid week start in C function time_aggregate" );
+
+  if( !isString(zone) || length(zone) < 1L ||
+      !( zonestr = CHAR(STRING_ELT(zone, 0))))
+    error( "Invalid time zone in C function time_aggregate" );
+
+  if( !IS_LOGICAL(na_rm) || length(na_rm) < 1L )
+    error( "Invalid na.rm argument in C function time_aggregate" );
+  in_narm = ( LOGICAL(na_rm)[0] == 1 );
+
+  if( !isString(funs) || ( nfun = length(funs)) < 1L )
+    error( "Invalid functions in C function time_aggregate" );
+  fun_codes = (AGG_CODE *) R_alloc( nfun, sizeof(AGG_CODE) );
+  for( j = 0; j < nfun; j++ )
+    if(( fun_codes[j] = agg_from_str( CHAR(STRING_ELT(funs, j)))) 
+       == AGG_ERROR )
+      error( "Unknown function %s in C function time_aggregate",
+	     CHAR(STRING_ELT(funs, j)));
+
+  tzone = find_zone( zonestr, zone_list );
+  if( !tzone )
+    error( "Unknown or unreadable time zone in C function time_aggregate" );
+
+  /* get the desired parts of the time object */
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL, 
+			NULL, NULL ))
+    error("Invalid argument in C function time_aggregate");
+
+  if( !isReal(values) || !isMatrix(values) || 
+      ( nrow = nrows(values)) != lng ){
+    UNPROTECT(2);
+    error( "Values must be a numeric matrix with one row per time in C function time_aggregate" );
+  }
+  ncol = ncols(values);
+  in_vals = REAL(values);
+
+  /* find the bin ordinal of each time */
+
+  bin_idx = (double *) R_alloc( lng + 1, sizeof(double) );
+  for( i = 0; i < lng; i++ )
+  {
+    if( in_days[i] == NA_INTEGER || 
+	in_ms[i] == NA_INTEGER ||
+	!date_bin_index_gmt( in_days[i], in_ms[i], tzone, in_unit, in_k, 
+			     in_wk, &(bin_idx[i]) ))
+      bin_idx[i] = NA_REAL;
+  }
+
+  /* assign each time to a group, numbered in increasing bin order */
+
+  group = (Sint *) R_alloc( lng + 1, sizeof(Sint) );
+  keys = (double *) R_alloc( lng + 1, sizeof(double) );
+  ngroup = group_sorted( bin_idx, lng, group, keys );
+  if( ngroup < 0 )
+    ngroup = group_hashed( bin_idx, lng, group, keys );
+
+  /* find the bin starting times */
+
+  PROTECT(ret = NEW_LIST( nfun + 1 ));
+  PROTECT(starts = time_create_new( ngroup, &jul_data, &ms_data ));
+  if( !starts || ( ngroup && ( !jul_data || !ms_data ))){
+    UNPROTECT(4);
+    error( "Could not create new time object in C function time_aggregate" );
+  }
+  SET_VECTOR_ELT( ret, 0, starts );
+  UNPROTECT(1);
+
+  for( g = 0; g < ngroup; g++ )
+  {
+    if( !date_bin_start( keys[g], tzone, in_unit, in_k, in_wk, 
+			 &(jul_data[g]), &(ms_data[g]) ))
+    {
+      jul_data[g] = NA_INTEGER;
+      ms_data[g] = NA_INTEGER;
+    }
+  }
+
+  for( j = 0; j < nfun; j++ )
+  {
+    tmp = allocMatrix( REALSXP, ngroup, ncol );
+    SET_VECTOR_ELT( ret, j + 1, tmp );
+  }
+
+  /* aggregate each column */
+
+  sums = (double *) R_alloc( ngroup + 1, sizeof(double) );
+  mins = (double *) R_alloc( ngroup + 1, sizeof(double) );
+  maxs = (double *) R_alloc( ngroup + 1, sizeof(double) );
+  first_time = (double *) R_alloc( ngroup + 1, sizeof(double) );
+  last_time = (double *) R_alloc( ngroup + 1, sizeof(double) );
+  first_row = (Sint *) R_alloc( ngroup + 1, sizeof(Sint) );
+  last_row = (Sint *) R_alloc( ngroup + 1, sizeof(Sint) );
+  counts = (Sint *) R_alloc( ngroup + 1, sizeof(Sint) );
+  has_na = (int *) R_alloc( ngroup + 1, sizeof(int) );
+
+  for( col = 0; col < ncol; col++ )
+  {
+    for( g = 0; g < ngroup; g++ )
+    {
+      sums[g] = 0;
+      mins[g] = R_PosInf;
+      maxs[g] = R_NegInf;
+      first_row[g] = last_row[g] = -1;
+      counts[g] = 0;
+      has_na[g] = 0;
+    }
+
+    for( i = 0; i < lng; i++ )
+    {
+      if(( g = group[i] ) < 0 )
+	continue;
+      val = in_vals[ i + (R_xlen_t) col * nrow ];
+      if( ISNAN( val ))
+      {
+	if( in_narm )
+	  continue;
+	has_na[g] = 1;
+      }
+      else
+      {
+	sums[g] += val;
+	if( val < mins[g] ) mins[g] = val;
+	if( val > maxs[g] ) maxs[g] = val;
+      }
+      counts[g]++;
+
+      /* ties go to the earlier row for first, the later for last */
+      this_time = (double) in_days[i] * MS_PER_DAY + in_ms[i];
+      if( first_row[g] < 0 || this_time < first_time[g] )
+      {
+	first_row[g] = i;
+	first_time[g] = this_time;
+      }
+      if( last_row[g] < 0 || this_time >= last_time[g] )
+      {
+	last_row[g] = i;
+	last_time[g] = this_time;
+      }
+    }
+
+    for( j = 0; j < nfun; j++ )
+    {
+      out = REAL( VECTOR_ELT( ret, j + 1 )) + (R_xlen_t) col * ngroup;
+      for( g = 0; g < ngroup; g++ )
+      {
+	switch( fun_codes[j] )
+	{
+	case AGG_SUM:
+	  out[g] = has_na[g] ? NA_REAL : sums[g];
+	  break;
+	case AGG_MEAN:
+	  out[g] = ( has_na[g] || !counts[g] ) ? NA_REAL : 
+	    sums[g] / counts[g];
+	  break;
+	case AGG_MIN:
+	  out[g] = ( has_na[g] || !counts[g] ) ? NA_REAL : mins[g];
+	  break;
+	case AGG_MAX:
+	  out[g] = ( has_na[g] || !counts[g] ) ? NA_REAL : maxs[g];
+	  break;
+	case AGG_FIRST:
+	  out[g] = ( first_row[g] < 0 ) ? NA_REAL : 
+	    in_vals[ first_row[g] + (R_xlen_t) col * nrow ];
+	  break;
+	case AGG_LAST:
+	  out[g] = ( last_row[g] < 0 ) ? NA_REAL : 
+	    in_vals[ last_row[g] + (R_xlen_t) col * nrow ];
+	  break;
+	case AGG_COUNT:
+	  out[g] = counts[g];
+	  break;
+	default:
+	  out[g] = NA_REAL;
+	}
+      }
+    }
+  }
+
+  UNPROTECT(3); //1 + 2 from time_get_pieces
+  return( ret );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_rolling
+
+   DESCRIPTION  Compute rolling statistics of numeric data over time
+   windows ending at each time of a sorted time vector.
+   To be called from R as 
+   \\
+   {\tt 
+   .Call("time_rolling", time.vec, lower.vec, values, funs, na.rm)
+   }
+
+   ARGUMENTS
+      IARG  time_vec   The R time vector object, sorted with no NA values
+      IARG  lower_vec  R time vector of window lower bounds, one per time
+      IARG  values     Numeric matrix with one row per time
+      IARG  funs       Names of the statistics: "sum", "mean", "min", 
+                       "max", "first", "last", or "count"
+      IARG  na_rm      Logical: whether to omit NA values
+
+   RETURN Returns a list with one element per element of funs, each a 
+   numeric matrix of the same dimensions as values.  Row i contains the
+   statistic over the rows whose times are greater than lower bound i
+   and no greater than time i, so rows with equal times have equal
+   windows.  Rows whose lower bound is NA have NA results.
+
+   ALGORITHM  The window is kept with two pointers, which only move 
+   forward, so the lower bounds must be non-decreasing wherever they are
+   not NA.  Running sums and counts are updated as rows enter and leave 
+   the window, and the minimum and maximum are kept in monotonic deques
+   of row numbers, so that each column takes time proportional to the
+   number of rows.  Unless na_rm is true, an NA value makes the sum, mean,
+   minimum, and maximum of the windows containing it NA; the first and
+   last values are those of the first and last rows in the window, and
+   the count is the number of values used.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_aggregate
+
+**********************************************************************/
+SEXP time_rolling( SEXP time_vec, SEXP lower_vec, SEXP values, SEXP funs,
+		   SEXP na_rm )
+{
+  SEXP ret, tmp;
+  Sint *in_days, *in_ms, *low_days, *low_ms;
+  Sint i, j, col, lng, lng_low, nrow, ncol, nfun, left, right, count, nas;
+  Sint *min_dq, *max_dq, min_head, min_tail, max_head, max_tail;
+  Sint *next_valid, *prev_valid;
+  int in_narm, has_lower = 0;
+  double *in_times, *in_vals, *vals, *out, sum, val, lower, prev_lower = 0;
+  AGG_CODE *fun_codes;
+
+  /* extract the functions */
+
+  if( !IS_LOGICAL(na_rm) || length(na_rm) < 1L )
+    error( "Invalid na.rm argument in C function time_rolling" );
+  in_narm = ( LOGICAL(na_rm)[0] == 1 );
+
+  if( !isString(funs) || ( nfun = length(funs)) < 1L )
+    error( "Invalid functions in C function time_rolling" );
+  fun_codes = (AGG_CODE *) R_alloc( nfun, sizeof(AGG_CODE) );
+  for( j = 0; j < nfun; j++ )
+    if(( fun_codes[j] = agg_from_str( CHAR(STRING_ELT(funs, j)))) 
+       == AGG_ERROR )
+      error( "Unknown function %s in C function time_rolling",
+	     CHAR(STRING_ELT(funs, j)));
+
+  /* get the desired parts of the time objects */
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL, 
+			NULL, NULL ))
+    error("Invalid argument in C function time_rolling");
+
+  if( !time_get_pieces( lower_vec, NULL, &low_days, &low_ms, &lng_low, 
+			NULL, NULL, NULL ) ){
+    UNPROTECT(2);
+    error("Invalid lower bound argument in C function time_rolling");
+  }
+
+  if( lng_low != lng ){
+    UNPROTECT(4);
+    error( "Lower bounds must have one element per time in C function time_rolling" );
+  }
+
+  if( !isReal(values) || !isMatrix(values) || 
+      ( nrow = nrows(values)) != lng ){
+    UNPROTECT(4);
+    error( "Values must be a numeric matrix with one row per time in C function time_rolling" );
+  }
+  ncol = ncols(values);
+  in_vals = REAL(values);
+
+  /* convert times to milliseconds, which is exact in a double */
+
+  in_times = (double *) R_alloc( lng + 1, sizeof(double) );
+  for( i = 0; i < lng; i++ )
+  {
+    if( in_days[i] == NA_INTEGER || in_ms[i] == NA_INTEGER ||
+	( i && (double) in_days[i] * MS_PER_DAY + in_ms[i] < 
+	  in_times[i-1] )){
+      UNPROTECT(4);
+      error( "Times must be sorted and not NA in C function time_rolling" );
+    }
+    in_times[i] = (double) in_days[i] * MS_PER_DAY + in_ms[i];
+
+    if( low_days[i] == NA_INTEGER || low_ms[i] == NA_INTEGER )
+      continue;
+    lower = (double) low_days[i] * MS_PER_DAY + low_ms[i];
+    if( has_lower && lower < prev_lower ){
+      UNPROTECT(4);
+      error( "Window lower bounds must be non-decreasing in C function time_rolling" );
+    }
+    prev_lower = lower;
+    has_lower = 1;
+  }
+
+  PROTECT(ret = NEW_LIST( nfun ));
+  for( j = 0; j < nfun; j++ )
+  {
+    tmp = allocMatrix( REALSXP, nrow, ncol );
+    SET_VECTOR_ELT( ret, j, tmp );
+  }
+
+  min_dq = (Sint *) R_alloc( lng + 1, sizeof(Sint) );
+  max_dq = (Sint *) R_alloc( lng + 1, sizeof(Sint) );
+  next_valid = (Sint *) R_alloc( lng + 1, sizeof(Sint) );
+  prev_valid = (Sint *) R_alloc( lng + 1, sizeof(Sint) );
+
+  for( col = 0; col < ncol; col++ )
+  {
+    vals = in_vals + (R_xlen_t) col * nrow;
+
+    /* nearest non-NA rows, for first and last with na_rm */
+    for( i = 0, j = -1; i < lng; i++ )
+    {
+      if( !ISNAN( vals[i] ))
+	j = i;
+      prev_valid[i] = j;
+    }
+    for( i = lng - 1, j = lng; i >= 0; i-- )
+    {
+      if( !ISNAN( vals[i] ))
+	j = i;
+      next_valid[i] = j;
+    }
+
+    left = 0;
+    right = -1;
+    sum = 0;
+    count = nas = 0;
+    min_head = min_tail = max_head = max_tail = 0;
+
+    for( i = 0; i < lng; i++ )
+    {
+      /* add rows up to the last one with this time */
+      while( right + 1 < lng && in_times[ right + 1 ] <= in_times[i] )
+      {
+	right++;
+	val = vals[right];
+	if( ISNAN( val ))
+	{
+	  nas++;
+	  continue;
+	}
+	sum += val;
+	count++;
+	while( min_tail > min_head && vals[ min_dq[ min_tail - 1 ]] >= val )
+	  min_tail--;
+	min_dq[ min_tail++ ] = right;
+	while( max_tail > max_head && vals[ max_dq[ max_tail - 1 ]] <= val )
+	  max_tail--;
+	max_dq[ max_tail++ ] = right;
+      }
+
+      if( low_days[i] == NA_INTEGER || low_ms[i] == NA_INTEGER )
+      {
+	for( j = 0; j < nfun; j++ )
+	  REAL( VECTOR_ELT( ret, j ))[ i + (R_xlen_t) col * nrow ] = NA_REAL;
+	continue;
+      }
+
+      /* drop rows at or before the lower bound */
+      lower = (double) low_days[i] * MS_PER_DAY + low_ms[i];
+      while( left <= right && in_times[left] <= lower )
+      {
+	val = vals[left];
+	if( ISNAN( val ))
+	  nas--;
+	else
+	{
+	  sum -= val;
+	  count--;
+	  if( min_tail > min_head && min_dq[ min_head ] == left )
+	    min_head++;
+	  if( max_tail > max_head && max_dq[ max_head ] == left )
+	    max_head++;
+	}
+	left++;
+      }
+
+      for( j = 0; j < nfun; j++ )
+      {
+	out = REAL( VECTOR_ELT( ret, j )) + (R_xlen_t) col * nrow;
+	switch( fun_codes[j] )
+	{
+	case AGG_SUM:
+	  out[i] = ( nas && !in_narm ) ? NA_REAL : ( count ? sum : 0 );
+	  break;
+	case AGG_MEAN:
+	  out[i] = (( nas && !in_narm ) || !count ) ? NA_REAL : sum / count;
+	  break;
+	case AGG_MIN:
+	  out[i] = (( nas && !in_narm ) || !count ) ? NA_REAL : 
+	    vals[ min_dq[ min_head ]];
+	  break;
+	case AGG_MAX:
+	  out[i] = (( nas && !in_narm ) || !count ) ? NA_REAL : 
+	    vals[ max_dq[ max_head ]];
+	  break;
+	case AGG_FIRST:
+	  if( left > right )
+	    out[i] = NA_REAL;
+	  else if( !in_narm )
+	    out[i] = vals[left];
+	  else
+	    out[i] = ( next_valid[left] <= right ) ? 
+	      vals[ next_valid[left] ] : NA_REAL;
+	  break;
+	case AGG_LAST:
+	  if( left > right )
+	    out[i] = NA_REAL;
+	  else if( !in_narm )
+	    out[i] = vals[right];
+	  else
+	    out[i] = ( prev_valid[right] >= left ) ? 
+	      vals[ prev_valid[right] ] : NA_REAL;
+	  break;
+	case AGG_COUNT:
+	  out[i] = in_narm ? count : count + nas;
+	  break;
+	default:
+	  out[i] = NA_REAL;
+	}
+      }
+    }
+  }
+
+  UNPROTECT(5); //1 + 4 from time_get_pieces
+  return( ret );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME agg_from_str
+
+   DESCRIPTION  Find the aggregation function code for a string.
+
+   ARGUMENTS
+      IARG  str      the function name
+
+   RETURN Returns the code, or AGG_ERROR if the name is unknown.
+
+   ALGORITHM Compares the string to the known names.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_aggregate
+
+**********************************************************************/
+static AGG_CODE agg_from_str( const char *str )
+{
+  if( !str )
+    return AGG_ERROR;
+
+  if( !strcmp( str, "sum" ))
+    return AGG_SUM;
+  if( !strcmp( str, "mean" ))
+    return AGG_MEAN;
+  if( !strcmp( str, "min" ))
+    return AGG_MIN;
+  if( !strcmp( str, "max" ))
+    return AGG_MAX;
+  if( !strcmp( str, "first" ))
+    return AGG_FIRST;
+  if( !strcmp( str, "last" ))
+    return AGG_LAST;
+  if( !strcmp( str, "count" ))
+    return AGG_COUNT;
+
+  return AGG_ERROR;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME group_sorted
+
+   DESCRIPTION  Number the distinct bin ordinals of sorted data.
+
+   ARGUMENTS
+      IARG  bin_idx   Bin ordinals, possibly NA
+      IARG  lng       Length of bin_idx
+      OARG  group     Group number of each ordinal, or -1 for NA
+      OARG  keys      Bin ordinal of each group
+
+   RETURN Returns the number of groups, or -1 if the non-NA ordinals
+   are not in non-decreasing order.
+
+   ALGORITHM One pass, starting a new group whenever the ordinal changes.
+
+   EXCEPTIONS 
+
+   NOTE See also: group_hashed, time_aggregate
+
+**********************************************************************/
+static Sint group_sorted( double *bin_idx, Sint lng, Sint *group, 
+			  double *keys )
+{
+  Sint i, ngroup = 0;
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( ISNAN( bin_idx[i] ))
+    {
+      group[i] = -1;
+      continue;
+    }
+
+    if( ngroup && bin_idx[i] < keys[ngroup - 1] )
+      return -1;
+
+    if( !ngroup || bin_idx[i] > keys[ngroup - 1] )
+      keys[ngroup++] = bin_idx[i];
+
+    group[i] = ngroup - 1;
+  }
+
+  return ngroup;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME group_hashed
+
+   DESCRIPTION  Number the distinct bin ordinals of unsorted data.
+
+   ARGUMENTS
+      IARG  bin_idx   Bin ordinals, possibly NA
+      IARG  lng       Length of bin_idx
+      OARG  group     Group number of each ordinal, or -1 for NA
+      OARG  keys      Bin ordinal of each group
+
+   RETURN Returns the number of groups.
+
+   ALGORITHM The distinct ordinals are found with an open addressing
+   hash table of at least twice the input size, numbering the groups 
+   in order of appearance.  Then the distinct ordinals are sorted using
+   rsort_with_index, and the group numbers are mapped so that they are
+   in increasing order of ordinal.
+
+   EXCEPTIONS 
+
+   NOTE See also: group_sorted, time_aggregate
+
+**********************************************************************/
+static Sint group_hashed( double *bin_idx, Sint lng, Sint *group, 
+			  double *keys )
+{
+  Sint i, ngroup = 0, *table, *order, *rank;
+  size_t size = 2, mask, slot;
+  unsigned long long hash;
+
+  while( size < 2 * (size_t) lng )
+    size *= 2;
+  mask = size - 1;
+
+  table = (Sint *) R_alloc( size, sizeof(Sint) );
+  for( slot = 0; slot < size; slot++ )
+    table[slot] = -1;
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( ISNAN( bin_idx[i] ))
+    {
+      group[i] = -1;
+      continue;
+    }
+
+    /* ordinals are whole numbers, so hash their integer value */
+    hash = (unsigned long long) (long long) bin_idx[i] * 
+      0x9E3779B97F4A7C15ULL;
+    slot = (size_t) ( hash >> 32 ) & mask;
+    while( table[slot] >= 0 && keys[ table[slot] ] != bin_idx[i] )
+      slot = ( slot + 1 ) & mask;
+
+    if( table[slot] < 0 )
+    {
+      table[slot] = ngroup;
+      keys[ngroup++] = bin_idx[i];
+    }
+    group[i] = table[slot];
+  }
+
+  /* sort the keys, and renumber the groups to match */
+
+  order = (Sint *) R_alloc( ngroup + 1, sizeof(Sint) );
+  rank = (Sint *) R_alloc( ngroup + 1, sizeof(Sint) );
+  for( i = 0; i < ngroup; i++ )
+    order[i] = i;
+  rsort_with_index( keys, order, ngroup );
+  for( i = 0; i < ngroup; i++ )
+    rank[ order[i] ] = i;
+
+  for( i = 0; i < lng; i++ )
+    if( group[i] >= 0 )
+      group[i] = rank[ group[i] ];
+
+  return ngroup;
+}
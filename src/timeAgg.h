@@ -0,0 +1,25 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved. 
+ * Confidential & Proprietary 
+ *
+*************************************************************************/
+
+#ifndef TIMELIB_TIMEAGG_H
+#define TIMELIB_TIMEAGG_H
+
+#include "timeUtils.h"
+#include "timeObj.h"
+#include "zoneObj.h"
+#include "zoneFuns.h"
+#include "timeFuns.h"
+#include <string.h>
+
+SEXP time_aggregate( SEXP time_vec, SEXP values, SEXP unit, SEXP k, 
+		     SEXP week_start, SEXP zone, SEXP funs, SEXP na_rm,
+		     SEXP zone_list );
+SEXP time_rolling( SEXP time_vec, SEXP lower_vec, SEXP values, SEXP funs,
+		   SEXP na_rm );
+
+
+#endif  // TIMELIB_TIMEAGG_H
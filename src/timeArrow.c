@@ -0,0 +1,502 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ *
+ * It contains C code utility functions for exchanging R time and time
+ * span objects with other programs through the Arrow C Data Interface.
+ * A time object is a timestamp array in milliseconds with the time zone
+ * name, and a time span object is a duration array in milliseconds.
+ *
+ * The exported functions here were written to be called with the
+ * .Call interface of R.  They include (see documentation below):
+  SEXP time_arrow_allocate( void );
+  SEXP time_to_arrow( SEXP time_vec, SEXP array_ptr, SEXP schema_ptr );
+  SEXP time_from_arrow( SEXP array_ptr, SEXP schema_ptr );
+*************************************************************************/
+
+#include "timeArrow.h"
+
+/* the buffers an exported array owns */
+
+typedef struct arrow_private_struct
+{
+  const void *buffers[2];
+  uint8_t *validity;
+  int64_t *values;
+} ARROW_PRIVATE_STRUCT;
+
+static void arrow_release_array( struct ArrowArray *array );
+static void arrow_release_schema( struct ArrowSchema *schema );
+static void arrow_finalize_array( SEXP ptr );
+static void arrow_finalize_schema( SEXP ptr );
+static void *arrow_struct_address( SEXP ptr );
+static int64_t arrow_floor_div( int64_t num, int64_t den );
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_arrow_allocate
+
+   DESCRIPTION  Allocate an empty Arrow array and schema structure pair,
+   to export R time objects to or import them from.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_arrow_allocate")
+   }
+
+   ARGUMENTS
+
+   RETURN Returns a list with components "array" and "schema", each an
+   external pointer to a released (empty) structure.
+
+   ALGORITHM  The structures are allocated with calloc, so that their
+   release callbacks are NULL, which marks them as released in the
+   Arrow C Data Interface.  Finalizers are registered that call the
+   release callback, if it is not NULL, and then free the structures.
+
+   EXCEPTIONS
+
+   NOTE See also: time_to_arrow, time_from_arrow
+
+**********************************************************************/
+SEXP time_arrow_allocate( void )
+{
+  SEXP ret, names, array_xp, schema_xp;
+  struct ArrowArray *array;
+  struct ArrowSchema *schema;
+
+  array = (struct ArrowArray *) calloc( 1, sizeof(struct ArrowArray) );
+  schema = (struct ArrowSchema *) calloc( 1, sizeof(struct ArrowSchema) );
+  if( !array || !schema )
+  {
+    free( array );
+    free( schema );
+    error( "Could not allocate memory in C function time_arrow_allocate" );
+  }
+
+  PROTECT( array_xp = R_MakeExternalPtr( array, R_NilValue, R_NilValue ));
+  R_RegisterCFinalizerEx( array_xp, arrow_finalize_array, TRUE );
+  PROTECT( schema_xp = R_MakeExternalPtr( schema, R_NilValue, R_NilValue ));
+  R_RegisterCFinalizerEx( schema_xp, arrow_finalize_schema, TRUE );
+
+  PROTECT( ret = NEW_LIST(2) );
+  PROTECT( names = NEW_CHARACTER(2) );
+  SET_VECTOR_ELT( ret, 0, array_xp );
+  SET_VECTOR_ELT( ret, 1, schema_xp );
+  SET_STRING_ELT( names, 0, mkChar( "array" ));
+  SET_STRING_ELT( names, 1, mkChar( "schema" ));
+  setAttrib( ret, R_NamesSymbol, names );
+
+  UNPROTECT(4);
+  return ret;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_to_arrow
+
+   DESCRIPTION  Export an R time or time span object to Arrow C Data
+   Interface structures.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_to_arrow", time.vec, array.ptr, schema.ptr)
+   }
+
+   ARGUMENTS
+      IARG  time_vec    The R time or time span object
+      IARG  array_ptr   Address of a released ArrowArray structure
+      IARG  schema_ptr  Address of a released ArrowSchema structure
+
+   RETURN Returns NULL; the structures are filled in.
+
+   ALGORITHM  The addresses may be given as external pointers, or as
+   numbers or character strings holding the address.  Time objects are
+   exported with format "tsm:ZONE", a timestamp in milliseconds since
+   1970 in GMT with the time zone name of the object, and time spans
+   with format "tDm", a duration in milliseconds.  The values are
+   computed from the Julian days and milliseconds in one pass, and NA
+   values are cleared in a validity bitmap, which is left out if there
+   are no NA values.  The exported buffers are allocated with malloc and
+   are owned by the structures; the receiver frees them by calling the
+   release callbacks.
+
+   EXCEPTIONS
+
+   NOTE See also: time_from_arrow, time_arrow_allocate
+
+**********************************************************************/
+SEXP time_to_arrow( SEXP time_vec, SEXP array_ptr, SEXP schema_ptr )
+{
+  struct ArrowArray *array;
+  struct ArrowSchema *schema;
+  ARROW_PRIVATE_STRUCT *priv;
+  Sint *in_days, *in_ms;
+  Sint i, lng;
+  char *zone = NULL, *format;
+  int is_span, nprotect = 0;
+  int64_t null_count = 0, ms_off;
+  size_t zone_len;
+  static const char *span_classes[] = {
+    TSPAN_CLASS_NAME
+  };
+
+  if( !( array = (struct ArrowArray *) arrow_struct_address( array_ptr )) ||
+      !( schema = (struct ArrowSchema *) arrow_struct_address( schema_ptr )))
+    error( "Invalid Arrow structure address in C function time_to_arrow" );
+
+  /* extract input data */
+
+  is_span = checkClass( time_vec, span_classes, 1L );
+  if( is_span )
+  {
+    if( !tspan_get_pieces( time_vec, &in_days, &in_ms, &lng, NULL ))
+      error( "Invalid argument in C function time_to_arrow" );
+  }
+  else
+  {
+    if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL,
+			  &zone, NULL ))
+      error( "Invalid argument in C function time_to_arrow" );
+    nprotect = 2;
+  }
+
+  /* time spans count from 0, times from 1970 in GMT */
+  ms_off = is_span ? 0 : ( (int64_t) UNIX_EPOCH_JULIAN ) * MS_PER_DAY;
+
+  /* allocate the buffers; no R errors past here until they are owned */
+
+  zone_len = zone ? strlen( zone ) : 0;
+  priv = (ARROW_PRIVATE_STRUCT *) malloc( sizeof(ARROW_PRIVATE_STRUCT) );
+  format = (char *) malloc( zone_len + 5 );
+  if( priv )
+  {
+    priv->values = (int64_t *) malloc( ( lng ? lng : 1 ) * sizeof(int64_t) );
+    priv->validity = (uint8_t *) calloc( lng / 8 + 1, 1 );
+  }
+  if( !priv || !format || !priv->values || !priv->validity )
+  {
+    if( priv )
+    {
+      free( priv->values );
+      free( priv->validity );
+    }
+    free( priv );
+    free( format );
+    UNPROTECT( nprotect );
+    error( "Could not allocate memory in C function time_to_arrow" );
+  }
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( in_days[i] == NA_INTEGER || in_ms[i] == NA_INTEGER )
+    {
+      priv->values[i] = 0;
+      null_count++;
+      continue;
+    }
+    priv->values[i] = ( (int64_t) in_days[i] ) * MS_PER_DAY + in_ms[i]
+      - ms_off;
+    priv->validity[i >> 3] |= (uint8_t) ( 1 << ( i & 7 ));
+  }
+
+  /* the validity bitmap may be left out when nothing is missing */
+  if( !null_count )
+  {
+    free( priv->validity );
+    priv->validity = NULL;
+  }
+  priv->buffers[0] = priv->validity;
+  priv->buffers[1] = priv->values;
+
+  if( is_span )
+    strcpy( format, "tDm" );
+  else
+  {
+    strcpy( format, "tsm:" );
+    strcat( format, zone );
+  }
+
+  schema->format = format;
+  schema->name = "";
+  schema->metadata = NULL;
+  schema->flags = ARROW_FLAG_NULLABLE;
+  schema->n_children = 0;
+  schema->children = NULL;
+  schema->dictionary = NULL;
+  schema->release = arrow_release_schema;
+  schema->private_data = format;
+
+  array->length = lng;
+  array->null_count = null_count;
+  array->offset = 0;
+  array->n_buffers = 2;
+  array->n_children = 0;
+  array->buffers = priv->buffers;
+  array->children = NULL;
+  array->dictionary = NULL;
+  array->release = arrow_release_array;
+  array->private_data = priv;
+
+  UNPROTECT( nprotect ); //2 from time_get_pieces
+  return R_NilValue;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_from_arrow
+
+   DESCRIPTION  Import an R time or time span object from Arrow C Data
+   Interface structures.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_from_arrow", array.ptr, schema.ptr)
+   }
+
+   ARGUMENTS
+      IARG  array_ptr   Address of an ArrowArray structure
+      IARG  schema_ptr  Address of its ArrowSchema structure
+
+   RETURN Returns an R time object for timestamp and date arrays, with
+   the time zone slot set to the time zone of the schema (or "" if it
+   has none), and an R time span object for duration arrays.
+
+   ALGORITHM  The addresses may be given as external pointers, or as
+   numbers or character strings holding the address.  The accepted
+   formats are timestamps ("tss:", "tsm:", "tsu:", "tsn:"), dates
+   ("tdD", "tdm"), and durations ("tDs", "tDm", "tDu", "tDn").  The
+   values are scaled to milliseconds (taking the floor for timestamps
+   and truncating for durations when the unit is finer) and split into
+   Julian days and milliseconds in one pass.  Values that are cleared
+   in the validity bitmap, or are out of range, become NA.  After the
+   data are copied, the structures are released, as the Arrow C Data
+   Interface requires of a consumer.
+
+   EXCEPTIONS  An error occurs, and the structures are not released, if
+   the format is not one of the above or the array is malformed.
+
+   NOTE See also: time_to_arrow, time_arrow_allocate
+
+**********************************************************************/
+SEXP time_from_arrow( SEXP array_ptr, SEXP schema_ptr )
+{
+  SEXP ret;
+  struct ArrowArray *array;
+  struct ArrowSchema *schema;
+  const char *fmt, *zone = "";
+  const uint8_t *validity;
+  const int64_t *data64 = NULL;
+  const int32_t *data32 = NULL;
+  Sint *jul_data, *ms_data;
+  Sint i, lng;
+  int64_t mult = 1, div = 1, val, days, offset;
+  int is_span = 0, is_floor = 1;
+
+  if( !( array = (struct ArrowArray *) arrow_struct_address( array_ptr )) ||
+      !( schema = (struct ArrowSchema *) arrow_struct_address( schema_ptr )))
+    error( "Invalid Arrow structure address in C function time_from_arrow" );
+
+  if( !array->release || !schema->release || !( fmt = schema->format ))
+    error( "Arrow structure was already released in C function time_from_arrow" );
+
+  /* find the type and the scale to milliseconds */
+
+  if( !strncmp( fmt, "ts", 2 ) && fmt[2] && fmt[3] == ':' )
+  {
+    zone = fmt + 4;
+    switch( fmt[2] )
+    {
+    case 's': mult = 1000; break;
+    case 'm': break;
+    case 'u': div = 1000; break;
+    case 'n': div = 1000000; break;
+    default: fmt = NULL;
+    }
+  }
+  else if( !strcmp( fmt, "tdD" ))
+    mult = MS_PER_DAY;
+  else if( !strcmp( fmt, "tdm" ))
+    ;
+  else if( !strncmp( fmt, "tD", 2 ) && fmt[2] && !fmt[3] )
+  {
+    is_span = 1;
+    is_floor = 0;
+    switch( fmt[2] )
+    {
+    case 's': mult = 1000; break;
+    case 'm': break;
+    case 'u': div = 1000; break;
+    case 'n': div = 1000000; break;
+    default: fmt = NULL;
+    }
+  }
+  else
+    fmt = NULL;
+
+  if( !fmt )
+    error( "Unsupported Arrow format \"%s\" in C function time_from_arrow",
+	   schema->format );
+
+  if( array->n_buffers != 2 || !array->buffers || !array->buffers[1] ||
+      array->n_children != 0 || array->dictionary || array->length < 0 ||
+      array->offset < 0 || array->length > INT_MAX )
+    error( "Malformed Arrow array in C function time_from_arrow" );
+
+  lng = (Sint) array->length;
+  offset = array->offset;
+  /* a NULL bitmap means all valid; a null count of 0 lets us skip it,
+     but an unknown count (-1) does not */
+  validity = (const uint8_t *) array->buffers[0];
+  if( array->null_count == 0 )
+    validity = NULL;
+  if( !strcmp( fmt, "tdD" ))
+    data32 = (const int32_t *) array->buffers[1] + offset;
+  else
+    data64 = (const int64_t *) array->buffers[1] + offset;
+
+  /* create output object and copy the data */
+
+  if( is_span )
+    PROTECT( ret = tspan_create_new( lng, &jul_data, &ms_data ));
+  else
+    PROTECT( ret = time_create_new( lng, &jul_data, &ms_data ));
+  if( !ret || ( lng && ( !jul_data || !ms_data )))
+    error( "Could not create return object in C function time_from_arrow");
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( validity && !( validity[( offset + i ) >> 3] &
+		       ( 1 << (( offset + i ) & 7 ))))
+    {
+      jul_data[i] = ms_data[i] = NA_INTEGER;
+      continue;
+    }
+
+    val = data32 ? (int64_t) data32[i] : data64[i];
+    if( div > 1 )
+      val = is_floor ? arrow_floor_div( val, div ) : val / div;
+    else if( mult > 1 )
+    {
+      if( val > INT64_MAX / mult || val < -( INT64_MAX / mult ))
+      {
+	jul_data[i] = ms_data[i] = NA_INTEGER;
+	continue;
+      }
+      val *= mult;
+    }
+
+    /* times split with a positive ms part; spans with the same signs */
+    days = is_span ? val / MS_PER_DAY : arrow_floor_div( val, MS_PER_DAY );
+    if( !is_span )
+      days += UNIX_EPOCH_JULIAN;
+    if( days >= INT_MAX || days <= -INT_MAX )
+    {
+      jul_data[i] = ms_data[i] = NA_INTEGER;
+      continue;
+    }
+    jul_data[i] = (Sint) days;
+    ms_data[i] = (Sint) ( is_span ? val % MS_PER_DAY :
+			  val - ( days - UNIX_EPOCH_JULIAN ) * MS_PER_DAY );
+  }
+
+  if( !is_span )
+    SET_SLOT( ret, install( "time.zone" ), mkString( zone ));
+
+  /* the data are copied, so the structures can be released */
+  array->release( array );
+  schema->release( schema );
+
+  UNPROTECT(1);
+  return ret;
+}
+
+/* release callbacks for exported structures */
+
+static void arrow_release_array( struct ArrowArray *array )
+{
+  ARROW_PRIVATE_STRUCT *priv;
+
+  if( !array || !array->release )
+    return;
+  if(( priv = (ARROW_PRIVATE_STRUCT *) array->private_data ))
+  {
+    free( priv->validity );
+    free( priv->values );
+    free( priv );
+  }
+  array->private_data = NULL;
+  array->release = NULL;
+}
+
+static void arrow_release_schema( struct ArrowSchema *schema )
+{
+  if( !schema || !schema->release )
+    return;
+  free( schema->private_data );
+  schema->private_data = NULL;
+  schema->format = NULL;
+  schema->release = NULL;
+}
+
+/* finalizers for structures from time_arrow_allocate */
+
+static void arrow_finalize_array( SEXP ptr )
+{
+  struct ArrowArray *array;
+
+  if( !( array = (struct ArrowArray *) R_ExternalPtrAddr( ptr )))
+    return;
+  if( array->release )
+    array->release( array );
+  free( array );
+  R_ClearExternalPtr( ptr );
+}
+
+static void arrow_finalize_schema( SEXP ptr )
+{
+  struct ArrowSchema *schema;
+
+  if( !( schema = (struct ArrowSchema *) R_ExternalPtrAddr( ptr )))
+    return;
+  if( schema->release )
+    schema->release( schema );
+  free( schema );
+  R_ClearExternalPtr( ptr );
+}
+
+/* find a structure address from an external pointer, or a number or
+   string holding the address, as other Arrow packages pass them */
+
+static void *arrow_struct_address( SEXP ptr )
+{
+  const char *str;
+
+  if( TYPEOF( ptr ) == EXTPTRSXP )
+    return R_ExternalPtrAddr( ptr );
+  if( length( ptr ) != 1 )
+    return NULL;
+  if( isReal( ptr ) && R_FINITE( REAL(ptr)[0] ) && REAL(ptr)[0] > 0 )
+    return (void *) (uintptr_t) REAL(ptr)[0];
+  if( isString( ptr ) && STRING_ELT( ptr, 0 ) != NA_STRING &&
+      ( str = CHAR( STRING_ELT( ptr, 0 ))))
+    return (void *) (uintptr_t) strtoull( str, NULL, 10 );
+  return NULL;
+}
+
+static int64_t arrow_floor_div( int64_t num, int64_t den )
+{
+  int64_t quot = num / den;
+
+  if(( num % den ) && (( num < 0 ) != ( den < 0 )))
+    quot--;
+  return quot;
+}
@@ -0,0 +1,66 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+*************************************************************************/
+
+#ifndef TIMELIB_TIMEARROW_H
+#define TIMELIB_TIMEARROW_H
+
+#include "timeUtils.h"
+#include "timeObj.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The Arrow C Data Interface structures, exactly as given in the Arrow
+   specification.  The guard lets them coexist with other copies. */
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  /* Array type description */
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+
+  /* Release callback */
+  void (*release)(struct ArrowSchema*);
+  /* Opaque producer-specific data */
+  void* private_data;
+};
+
+struct ArrowArray {
+  /* Array data description */
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+
+  /* Release callback */
+  void (*release)(struct ArrowArray*);
+  /* Opaque producer-specific data */
+  void* private_data;
+};
+
+#endif  /* ARROW_C_DATA_INTERFACE */
+
+SEXP time_arrow_allocate( void );
+SEXP time_to_arrow( SEXP time_vec, SEXP array_ptr, SEXP schema_ptr );
+SEXP time_from_arrow( SEXP array_ptr, SEXP schema_ptr );
+
+#endif  // TIMELIB_TIMEARROW_H
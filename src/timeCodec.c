@@ -0,0 +1,666 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ *
+ * It contains C code utility functions for encoding R time and time
+ * span objects in a compact binary form, and decoding them again from
+ * raw vectors or memory-mapped files.  See timeCodec.h for the layout.
+ *
+ * The exported functions here were written to be called with the
+ * .Call interface of R.  They include (see documentation below):
+  SEXP time_encode( SEXP time_vec, SEXP block_size );
+  SEXP time_decode( SEXP src, SEXP blocks );
+  SEXP time_codec_info( SEXP src );
+*************************************************************************/
+
+#include "timeCodec.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <stdio.h>
+#endif
+
+/* parsed header of an encoded time column */
+
+typedef struct codec_header_struct
+{
+  int is_span;
+  uint64_t n;
+  uint32_t block_size;
+  uint32_t n_blocks;
+  const char *format;
+  uint32_t format_len;
+  const char *zone;
+  uint32_t zone_len;
+  const unsigned char *offsets;
+  const unsigned char *data;
+  uint64_t data_len;
+} CODEC_HEADER;
+
+/* the bytes of an encoded time column, from a raw vector or a file */
+
+typedef struct codec_buf_struct
+{
+  const unsigned char *bytes;
+  size_t len;
+  int is_mapped;
+} CODEC_BUF;
+
+static int codec_open( SEXP src, CODEC_BUF *buf );
+static void codec_close( CODEC_BUF *buf );
+static int codec_read_header( const CODEC_BUF *buf, CODEC_HEADER *hdr );
+static int codec_decode_block( const CODEC_HEADER *hdr, uint32_t block,
+			       Sint *jul, Sint *ms );
+static unsigned char *codec_put_varint( unsigned char *p, uint64_t val );
+static void codec_put_le( unsigned char *p, uint64_t val, int nbytes );
+static uint64_t codec_get_le( const unsigned char *p, int nbytes );
+
+#define ZIGZAG_ENCODE(v) ( ( (uint64_t) (v) << 1 ) ^ (uint64_t) ( (v) >> 63 ))
+#define ZIGZAG_DECODE(u) ( (int64_t) ( (u) >> 1 ) ^ -(int64_t) ( (u) & 1 ))
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_encode
+
+   DESCRIPTION  Encode an R time or time span object in a compact
+   binary form.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_encode", time.vec, block.size)
+   }
+
+   ARGUMENTS
+      IARG  time_vec    The R time or time span object
+      IARG  block_size  The number of values per block
+
+   RETURN Returns a raw vector holding the encoded object.
+
+   ALGORITHM  The header (see timeCodec.h) records the class, length,
+   block size, format, and time zone, and the byte offset of each
+   block.  Within each block, the millisecond keys of the present
+   values are written as the first key, the first difference, and then
+   differences of differences, each zig-zag coded as an unsigned
+   base-128 varint.  Evenly spaced times thus take one byte each, and
+   sorted times at irregular spacing only a few bytes.  The arithmetic
+   is done modulo 2^64, so any keys are encoded exactly.  The data are
+   first encoded into a buffer big enough for the worst case, and then
+   copied to a raw vector of the exact size.
+
+   EXCEPTIONS
+
+   NOTE See also: time_decode, time_codec_info
+
+**********************************************************************/
+SEXP time_encode( SEXP time_vec, SEXP block_size )
+{
+  SEXP ret, format_sexp, zone_sexp = NULL;
+  Sint *in_days, *in_ms;
+  Sint lng, i, start, count, k;
+  const char *format, *zone = "";
+  uint32_t bsize, n_blocks, b, format_len, zone_len;
+  size_t head_len, max_len, pos;
+  unsigned char *buf, *p;
+  uint64_t key, prev = 0, prev_delta = 0, delta;
+  int is_span, has_na, nseen, nprotect = 0;
+  static const char *span_classes[] = {
+    TSPAN_CLASS_NAME
+  };
+
+  if( !IS_INTEGER(block_size) || length(block_size) < 1 ||
+      INTEGER(block_size)[0] == NA_INTEGER || INTEGER(block_size)[0] < 1 )
+    error( "Problem extracting input in c function time_encode" );
+  bsize = (uint32_t) INTEGER(block_size)[0];
+
+  /* extract input data */
+
+  is_span = checkClass( time_vec, span_classes, 1L );
+  if( is_span )
+  {
+    if( !tspan_get_pieces( time_vec, &in_days, &in_ms, &lng, NULL ))
+      error( "Invalid argument in C function time_encode" );
+  }
+  else
+  {
+    if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL,
+			  NULL, NULL ))
+      error( "Invalid argument in C function time_encode" );
+    nprotect = 2; //2 from time_get_pieces
+    zone_sexp = time_zone_pointer( time_vec );
+  }
+  format_sexp = time_format_pointer( time_vec );
+  format = format_sexp ? CHAR( format_sexp ) : "";
+  if( zone_sexp )
+    zone = CHAR( zone_sexp );
+  format_len = (uint32_t) strlen( format );
+  zone_len = (uint32_t) strlen( zone );
+
+  n_blocks = (uint32_t) ( lng ? ( (uint64_t) lng + bsize - 1 ) / bsize : 0 );
+
+  /* worst case: every value takes 10 bytes, plus flag and bitmap */
+  head_len = CODEC_FIXED_HEADER + 8 + format_len + zone_len +
+    8 * ( (size_t) n_blocks + 1 );
+  max_len = head_len + 10 * (size_t) lng +
+    (size_t) n_blocks * ( bsize / 8 + 2 );
+  if( !( buf = (unsigned char *) R_alloc( max_len, 1 )))
+    error( "Could not allocate memory in C function time_encode" );
+
+  /* header */
+
+  memcpy( buf, CODEC_MAGIC, 4 );
+  buf[4] = CODEC_VERSION;
+  buf[5] = (unsigned char) is_span;
+  buf[6] = buf[7] = 0;
+  codec_put_le( buf + 8, (uint64_t) lng, 8 );
+  codec_put_le( buf + 16, bsize, 4 );
+  codec_put_le( buf + 20, n_blocks, 4 );
+  p = buf + CODEC_FIXED_HEADER;
+  codec_put_le( p, format_len, 4 );
+  memcpy( p + 4, format, format_len );
+  p += 4 + format_len;
+  codec_put_le( p, zone_len, 4 );
+  memcpy( p + 4, zone, zone_len );
+  p += 4 + zone_len;
+
+  /* blocks; the offsets are filled in as they are written */
+
+  pos = head_len;
+  for( b = 0; b < n_blocks; b++ )
+  {
+    codec_put_le( p + 8 * b, pos - head_len, 8 );
+    start = (Sint) ( (uint64_t) b * bsize );
+    count = ( lng - start < (Sint) bsize ) ? lng - start : (Sint) bsize;
+
+    has_na = 0;
+    for( i = start; i < start + count; i++ )
+      if( in_days[i] == NA_INTEGER || in_ms[i] == NA_INTEGER )
+      {
+	has_na = 1;
+	break;
+      }
+
+    buf[pos++] = (unsigned char) has_na;
+    if( has_na )
+    {
+      memset( buf + pos, 0, ( count + 7 ) / 8 );
+      for( k = 0; k < count; k++ )
+	if( in_days[start + k] != NA_INTEGER && in_ms[start + k] != NA_INTEGER )
+	  buf[pos + ( k >> 3 )] |= (unsigned char) ( 1 << ( k & 7 ));
+      pos += ( count + 7 ) / 8;
+    }
+
+    nseen = 0;
+    for( i = start; i < start + count; i++ )
+    {
+      if( in_days[i] == NA_INTEGER || in_ms[i] == NA_INTEGER )
+	continue;
+      key = (uint64_t) ( (int64_t) in_days[i] * MS_PER_DAY + in_ms[i] );
+      if( nseen == 0 )
+	delta = key;
+      else if( nseen == 1 )
+      {
+	prev_delta = key - prev;
+	delta = prev_delta;
+      }
+      else
+      {
+	delta = ( key - prev ) - prev_delta;
+	prev_delta = key - prev;
+      }
+      prev = key;
+      nseen++;
+      pos = codec_put_varint( buf + pos, 
+			      ZIGZAG_ENCODE( (int64_t) delta )) - buf;
+    }
+  }
+  codec_put_le( p + 8 * n_blocks, pos - head_len, 8 );
+
+  PROTECT( ret = NEW_RAW( pos ));
+  memcpy( RAW(ret), buf, pos );
+  UNPROTECT( 1 + nprotect );
+  return ret;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_decode
+
+   DESCRIPTION  Decode an R time or time span object encoded by
+   time_encode, from a raw vector or a file.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_decode", src, blocks)
+   }
+
+   ARGUMENTS
+      IARG  src     A raw vector, or the name of a file
+      IARG  blocks  NULL to decode all of the blocks, or an integer
+                    vector of 0-based block numbers to decode
+
+   RETURN Returns an R time or time span object holding the values of
+   the requested blocks, in the order requested, with the format and
+   time zone from the header.
+
+   ALGORITHM  A file is memory mapped, so that only the pages of the
+   header and of the requested blocks are read; this lets a large file
+   be decoded a few blocks at a time.  The lengths of the requested
+   blocks are found from the header, the return object is allocated,
+   and each block is decoded straight into it by reversing the steps
+   of time_encode.  Times are split into julian days and non-negative
+   milliseconds, and time spans into julian days and milliseconds of
+   the same sign, so a time with milliseconds past the end of its day
+   (a leap second) comes back on the following day.
+
+   EXCEPTIONS  An error occurs if the data are not a valid encoding,
+   or a block number is out of range.
+
+   NOTE See also: time_encode, time_codec_info
+
+**********************************************************************/
+SEXP time_decode( SEXP src, SEXP blocks )
+{
+  SEXP ret, str;
+  CODEC_BUF buf;
+  CODEC_HEADER hdr;
+  Sint *jul_data, *ms_data, *in_blocks = NULL;
+  Sint i, n_in, lng;
+  uint64_t count, total = 0;
+  int ok = 1;
+
+  if( !isNull(blocks) && !IS_INTEGER(blocks) )
+    error( "Problem extracting input in c function time_decode" );
+
+  if( !codec_open( src, &buf ))
+    error( "Could not read encoded data in C function time_decode" );
+  if( !codec_read_header( &buf, &hdr ))
+  {
+    codec_close( &buf );
+    error( "Invalid encoded time data in C function time_decode" );
+  }
+
+  /* find the output length */
+
+  n_in = isNull(blocks) ? (Sint) hdr.n_blocks : length(blocks);
+  if( !isNull(blocks) )
+    in_blocks = INTEGER(blocks);
+  for( i = 0; i < n_in; i++ )
+  {
+    uint32_t b = in_blocks ? (uint32_t) in_blocks[i] : (uint32_t) i;
+    if( in_blocks && ( in_blocks[i] == NA_INTEGER || in_blocks[i] < 0 ||
+		       b >= hdr.n_blocks ))
+    {
+      codec_close( &buf );
+      error( "Block number out of range in C function time_decode" );
+    }
+    count = hdr.n - (uint64_t) b * hdr.block_size;
+    total += ( count < hdr.block_size ) ? count : hdr.block_size;
+  }
+  if( total > INT_MAX )
+  {
+    codec_close( &buf );
+    error( "Too many values to decode in C function time_decode" );
+  }
+  lng = (Sint) total;
+
+  /* create the output object and decode into it */
+
+  if( hdr.is_span )
+    ret = tspan_create_new( lng, &jul_data, &ms_data );
+  else
+    ret = time_create_new( lng, &jul_data, &ms_data );
+  PROTECT( ret );
+
+  for( i = 0; ok && i < n_in; i++ )
+  {
+    uint32_t b = in_blocks ? (uint32_t) in_blocks[i] : (uint32_t) i;
+    count = hdr.n - (uint64_t) b * hdr.block_size;
+    if( count > hdr.block_size )
+      count = hdr.block_size;
+    ok = codec_decode_block( &hdr, b, jul_data, ms_data );
+    jul_data += count;
+    ms_data += count;
+  }
+
+  /* copy the header strings before the bytes go away */
+  if( ok )
+  {
+    PROTECT( str = NEW_CHARACTER(1) );
+    SET_STRING_ELT( str, 0, mkCharLen( hdr.format, hdr.format_len ));
+    SET_SLOT( ret, install( "format" ), str );
+    UNPROTECT(1);
+    if( !hdr.is_span )
+    {
+      PROTECT( str = NEW_CHARACTER(1) );
+      SET_STRING_ELT( str, 0, mkCharLen( hdr.zone, hdr.zone_len ));
+      SET_SLOT( ret, install( "time.zone" ), str );
+      UNPROTECT(1);
+    }
+  }
+
+  codec_close( &buf );
+  if( !ok )
+    error( "Invalid encoded time data in C function time_decode" );
+
+  UNPROTECT(1);
+  return ret;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_codec_info
+
+   DESCRIPTION  Read the header of an R time or time span object encoded
+   by time_encode, from a raw vector or a file.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_codec_info", src)
+   }
+
+   ARGUMENTS
+      IARG  src     A raw vector, or the name of a file
+
+   RETURN Returns a list with components "class", "length", "block.size",
+   "blocks", "format", "zone", and "bytes" (the size of the block data).
+
+   ALGORITHM  The header is parsed and checked as in time_decode, but no
+   blocks are decoded.
+
+   EXCEPTIONS
+
+   NOTE See also: time_encode, time_decode
+
+**********************************************************************/
+SEXP time_codec_info( SEXP src )
+{
+  SEXP ret, names;
+  CODEC_BUF buf;
+  CODEC_HEADER hdr;
+  static const char *nms[] = {
+    "class", "length", "block.size", "blocks", "format", "zone", "bytes"
+  };
+  int i;
+
+  if( !codec_open( src, &buf ))
+    error( "Could not read encoded data in C function time_codec_info" );
+  if( !codec_read_header( &buf, &hdr ))
+  {
+    codec_close( &buf );
+    error( "Invalid encoded time data in C function time_codec_info" );
+  }
+
+  PROTECT( ret = NEW_LIST(7) );
+  PROTECT( names = NEW_CHARACTER(7) );
+  for( i = 0; i < 7; i++ )
+    SET_STRING_ELT( names, i, mkChar( nms[i] ));
+  SET_VECTOR_ELT( ret, 0, mkString( hdr.is_span ? TSPAN_CLASS_NAME :
+				    TIME_CLASS_NAME ));
+  SET_VECTOR_ELT( ret, 1, ScalarReal( (double) hdr.n ));
+  SET_VECTOR_ELT( ret, 2, ScalarInteger( (int) hdr.block_size ));
+  SET_VECTOR_ELT( ret, 3, ScalarInteger( (int) hdr.n_blocks ));
+  SET_VECTOR_ELT( ret, 4, ScalarString( mkCharLen( hdr.format,
+						   hdr.format_len )));
+  SET_VECTOR_ELT( ret, 5, ScalarString( mkCharLen( hdr.zone,
+						   hdr.zone_len )));
+  SET_VECTOR_ELT( ret, 6, ScalarReal( (double) hdr.data_len ));
+  setAttrib( ret, R_NamesSymbol, names );
+
+  codec_close( &buf );
+  UNPROTECT(2);
+  return ret;
+}
+
+/* find the bytes of an encoding: a raw vector, or a memory-mapped file */
+
+static int codec_open( SEXP src, CODEC_BUF *buf )
+{
+  const char *path;
+
+  buf->bytes = NULL;
+  buf->len = 0;
+  buf->is_mapped = 0;
+
+  if( TYPEOF(src) == RAWSXP )
+  {
+    buf->bytes = RAW(src);
+    buf->len = (size_t) LENGTH(src);
+    return 1;
+  }
+
+  if( !isString(src) || length(src) != 1 || STRING_ELT(src, 0) == NA_STRING )
+    return 0;
+  path = CHAR( STRING_ELT( src, 0 ));
+
+#ifndef _WIN32
+  {
+    int fd;
+    struct stat st;
+    void *addr;
+
+    if(( fd = open( path, O_RDONLY )) < 0 )
+      return 0;
+    if( fstat( fd, &st ) < 0 || st.st_size <= 0 )
+    {
+      close( fd );
+      return 0;
+    }
+    addr = mmap( NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( addr == MAP_FAILED )
+      return 0;
+    buf->bytes = (const unsigned char *) addr;
+    buf->len = (size_t) st.st_size;
+    buf->is_mapped = 1;
+  }
+#else
+  {
+    /* no mmap here, so read the whole file */
+    FILE *fp;
+    long size;
+    unsigned char *data;
+
+    if( !( fp = fopen( path, "rb" )))
+      return 0;
+    if( fseek( fp, 0, SEEK_END ) || ( size = ftell( fp )) <= 0 ||
+	fseek( fp, 0, SEEK_SET ) ||
+	!( data = (unsigned char *) R_alloc( (size_t) size, 1 )) ||
+	fread( data, 1, (size_t) size, fp ) != (size_t) size )
+    {
+      fclose( fp );
+      return 0;
+    }
+    fclose( fp );
+    buf->bytes = data;
+    buf->len = (size_t) size;
+  }
+#endif
+  return 1;
+}
+
+static void codec_close( CODEC_BUF *buf )
+{
+#ifndef _WIN32
+  if( buf->is_mapped && buf->bytes )
+    munmap( (void *) buf->bytes, buf->len );
+#endif
+  buf->bytes = NULL;
+  buf->is_mapped = 0;
+}
+
+/* parse and check the header; return 1/0 for success/failure */
+
+static int codec_read_header( const CODEC_BUF *buf, CODEC_HEADER *hdr )
+{
+  const unsigned char *p = buf->bytes, *end = buf->bytes + buf->len;
+  uint64_t off_len;
+
+  if( !p || buf->len < CODEC_FIXED_HEADER + 8 ||
+      memcmp( p, CODEC_MAGIC, 4 ) || p[4] != CODEC_VERSION || p[5] > 1 )
+    return 0;
+
+  hdr->is_span = p[5];
+  hdr->n = codec_get_le( p + 8, 8 );
+  hdr->block_size = (uint32_t) codec_get_le( p + 16, 4 );
+  hdr->n_blocks = (uint32_t) codec_get_le( p + 20, 4 );
+  if( !hdr->block_size || hdr->n_blocks !=
+      ( hdr->n + hdr->block_size - 1 ) / hdr->block_size )
+    return 0;
+
+  p += CODEC_FIXED_HEADER;
+  hdr->format_len = (uint32_t) codec_get_le( p, 4 );
+  if( (uint64_t) ( end - p ) < 8 + (uint64_t) hdr->format_len )
+    return 0;
+  hdr->format = (const char *) p + 4;
+  p += 4 + hdr->format_len;
+  hdr->zone_len = (uint32_t) codec_get_le( p, 4 );
+  if( (uint64_t) ( end - p ) < 4 + (uint64_t) hdr->zone_len )
+    return 0;
+  hdr->zone = (const char *) p + 4;
+  p += 4 + hdr->zone_len;
+
+  off_len = 8 * ( (uint64_t) hdr->n_blocks + 1 );
+  if( (uint64_t) ( end - p ) < off_len )
+    return 0;
+  hdr->offsets = p;
+  hdr->data = p + off_len;
+  hdr->data_len = codec_get_le( p + 8 * (uint64_t) hdr->n_blocks, 8 );
+  if( hdr->data_len > (uint64_t) ( end - hdr->data ))
+    return 0;
+
+  return 1;
+}
+
+/* decode one block into jul/ms; return 1/0 for success/failure */
+
+static int codec_decode_block( const CODEC_HEADER *hdr, uint32_t block,
+			       Sint *jul, Sint *ms )
+{
+  const unsigned char *p, *end, *bitmap = NULL;
+  uint64_t start, stop, count, k, u, key = 0, delta = 0;
+  int64_t days = 0, rem = 0;
+  int shift;
+  uint64_t nseen = 0;
+
+  start = codec_get_le( hdr->offsets + 8 * (uint64_t) block, 8 );
+  stop = codec_get_le( hdr->offsets + 8 * ( (uint64_t) block + 1 ), 8 );
+  if( start >= stop || stop > hdr->data_len )
+    return 0;
+  p = hdr->data + start;
+  end = hdr->data + stop;
+
+  count = hdr->n - (uint64_t) block * hdr->block_size;
+  if( count > hdr->block_size )
+    count = hdr->block_size;
+
+  if( *p > 1 )
+    return 0;
+  if( *p++ )
+  {
+    if( (uint64_t) ( end - p ) < ( count + 7 ) / 8 )
+      return 0;
+    bitmap = p;
+    p += ( count + 7 ) / 8;
+  }
+
+  for( k = 0; k < count; k++ )
+  {
+    if( bitmap && !( bitmap[k >> 3] & ( 1 << ( k & 7 ))))
+    {
+      jul[k] = ms[k] = NA_INTEGER;
+      continue;
+    }
+
+    /* read a varint; most deltas of deltas fit in one byte */
+    if( p < end && !( *p & 0x80 ))
+      u = *p++;
+    else
+    {
+      u = 0;
+      shift = 0;
+      do
+      {
+	if( p >= end || shift > 63 )
+	  return 0;
+	u |= (uint64_t) ( *p & 0x7f ) << shift;
+	shift += 7;
+      } while( *p++ & 0x80 );
+    }
+
+    u = (uint64_t) ZIGZAG_DECODE( u );
+    if( nseen == 0 )
+      key = u;
+    else
+    {
+      delta = ( nseen == 1 ) ? u : delta + u;
+      key += delta;
+    }
+
+    /* split the key as the class expects; for times, a step that stays
+       within the day needs no division */
+    if( nseen && !hdr->is_span && (int64_t) delta > -MS_PER_DAY &&
+	(int64_t) delta < MS_PER_DAY && rem + (int64_t) delta >= 0 &&
+	rem + (int64_t) delta < MS_PER_DAY )
+      rem += (int64_t) delta;
+    else
+    {
+      days = (int64_t) key / MS_PER_DAY;
+      rem = (int64_t) key % MS_PER_DAY;
+      if( !hdr->is_span && rem < 0 )
+      {
+	rem += MS_PER_DAY;
+	days--;
+      }
+      if( days >= INT_MAX || days <= -INT_MAX )
+	return 0;
+    }
+    nseen++;
+    jul[k] = (Sint) days;
+    ms[k] = (Sint) rem;
+  }
+
+  return ( p == end );
+}
+
+/* write a base-128 varint, and return the next write position */
+
+static unsigned char *codec_put_varint( unsigned char *p, uint64_t val )
+{
+  while( val >= 0x80 )
+  {
+    *p++ = (unsigned char) ( val | 0x80 );
+    val >>= 7;
+  }
+  *p++ = (unsigned char) val;
+  return p;
+}
+
+static void codec_put_le( unsigned char *p, uint64_t val, int nbytes )
+{
+  int i;
+
+  for( i = 0; i < nbytes; i++, val >>= 8 )
+    p[i] = (unsigned char) ( val & 0xff );
+}
+
+static uint64_t codec_get_le( const unsigned char *p, int nbytes )
+{
+  uint64_t val = 0;
+  int i;
+
+  for( i = nbytes - 1; i >= 0; i-- )
+    val = ( val << 8 ) | p[i];
+  return val;
+}
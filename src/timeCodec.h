@@ -0,0 +1,48 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+*************************************************************************/
+
+#ifndef TIMELIB_TIMECODEC_H
+#define TIMELIB_TIMECODEC_H
+
+#include "timeUtils.h"
+#include "timeObj.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Layout of an encoded time column.  All integers are little-endian.
+
+     bytes 0-3    magic "sTDc"
+     byte  4      version (1)
+     byte  5      kind: 0 for timeDate, 1 for timeSpan
+     bytes 6-7    reserved (0)
+     bytes 8-15   uint64 number of values
+     bytes 16-19  uint32 values per block
+     bytes 20-23  uint32 number of blocks
+     then         uint32 format length, format bytes,
+                  uint32 zone length, zone bytes,
+                  uint64 block offsets (number of blocks + 1), relative
+                  to the start of the block data,
+                  block data
+
+   Each block holds up to the block size values (the last may be
+   shorter) and decodes on its own.  It starts with a flag byte: 0 if
+   the block has no NA values, or 1 followed by a bitmap with bit i
+   set if value i is present.  The present values are then stored as
+   64-bit millisecond keys (julian days * MS_PER_DAY + ms): the first
+   key, the first difference, and then the differences of differences,
+   each zig-zag coded and written as a base-128 varint. */
+
+#define CODEC_MAGIC "sTDc"
+#define CODEC_VERSION 1
+#define CODEC_FIXED_HEADER 24
+
+SEXP time_encode( SEXP time_vec, SEXP block_size );
+SEXP time_decode( SEXP src, SEXP blocks );
+SEXP time_codec_info( SEXP src );
+
+#endif  // TIMELIB_TIMECODEC_H
@@ -36,6 +36,11 @@
     SEXP time_to_weekday( SEXP time_vec, SEXP zone_list );
     SEXP time_to_zone( SEXP time_vec, SEXP zone, 
 			    SEXP zone_list );
+    SEXP time_from_unix( SEXP num_vec, SEXP scale );
+    SEXP time_to_unix( SEXP time_vec, SEXP scale, SEXP local,
+                       SEXP zone_list );
+    SEXP time_pack( SEXP time_vec );
+    SEXP time_unpack( SEXP time_vec );
 
 *************************************************************************/
 
@@ -70,7 +75,7 @@
    ALGORITHM The time object is converted to a TIME_DATE_STRUCT using the 
    jms_to_struct function.  The time object's time zone is passed to the
    find_zone function to find the zone information, which is then used to 
-   convert from GMT to local time using the GMT_to_zone function.  Then 
+   convert from GMT to local time using the jms_to_zone function.  Then 
    this information and the time object's format
    string are used to convert to character strings, using the
    mdyt_format function.  If needed (depends on the format), the following
@@ -133,8 +138,7 @@ SEXP time_to_string( SEXP time_vec, SEXP opt_list, SEXP zone_list )
 
     if(  in_days[i]== NA_INTEGER || 
 	 in_ms[i]==NA_INTEGER ||
-	!jms_to_struct( in_days[i], in_ms[i], &td ) ||
-	!GMT_to_zone( &td, tzone ) ||
+	!jms_to_zone( in_days[i], in_ms[i], tzone, &td ) ||
 	!mdyt_format( td, *new_format, topt, strbuf ))
       SET_STRING_ELT(ret, i, NA_STRING);
     else
@@ -174,7 +178,7 @@ SEXP time_to_string( SEXP time_vec, SEXP opt_list, SEXP zone_list )
    zones from the input character string vector, using the mdyt_input
    function.  The actual time zone information is found using the 
    find_zone function. Then the calendar dates and clock times are converted 
-   to GMT using the GMT_from_zone function, in conjunction with the
+   to GMT using the jms_from_zone function, in conjunction with the
    julian_to_weekday and mdy_to_yday functions, and then to julian days and 
    milliseconds since midnight, using the julian_from_mdy and ms_from_hms
    functions.  The julian days and milliseconds are put into the 
@@ -304,9 +308,7 @@ SEXP time_from_string( SEXP char_vec, SEXP format_string,
     /* convert to GMT from local time */
     /* and then to julian and ms from time of day and date */
     if( !mdy_to_yday( &td ) ||
-	!GMT_from_zone( &td, tzone ) ||
-	!julian_from_mdy( td, &(jul_data[i]) ) ||
-	!ms_from_hms( td, &(ms_data[i]) ))
+	!jms_from_zone( &td, tzone, &(jul_data[i]), &(ms_data[i]) ))
     { 
       /* error occurred -- put NA into return value */
 
@@ -496,8 +498,8 @@ SEXP tspan_from_string( SEXP char_vec,
 
    ALGORITHM The time object is converted to a TIME_DATE_STRUCT
    using the jms_to_struct function.  This structure is then 
-   converted to the local time zone using the GMT_to_zone 
-   functions, with the zone information found using the find_zone 
+   converted to the local time zone using the jms_to_zone 
+   function, with the zone information found using the find_zone 
    function, and the months, days, and years are put into the 
    returned list.
 
@@ -553,8 +555,7 @@ SEXP time_to_month_day_year( SEXP time_vec,
 
     if(  in_days[i] == NA_INTEGER || 
 	 in_ms[i] == NA_INTEGER || 
-	!jms_to_struct( in_days[i], in_ms[i], &td ) ||
-	!GMT_to_zone( &td, tzone ))
+	!jms_to_zone( in_days[i], in_ms[i], tzone, &td ))
     { 
       /* error occurred -- put NA into return value */
       month_data[i] = NA_INTEGER;
@@ -685,7 +686,7 @@ SEXP time_from_month_day_year( SEXP month_vec,
 
    ALGORITHM The time object is converted to a TIME_DATE_STRUCT using
    the jms_to_struct function. This is adjusted to the local time zone
-   using the GMT_to_zone function, with the zone information found 
+   using the jms_to_zone function, with the zone information found 
    using the find_zone function.  Then the day and yearday members 
    of the struct are put into the returned object.
 
@@ -735,8 +736,7 @@ SEXP time_to_year_day( SEXP time_vec, SEXP zone_list )
 
     if(  in_days[i] == NA_INTEGER || 
 	 in_ms[i] == NA_INTEGER || 
-	!jms_to_struct( in_days[i], in_ms[i], &td ) || 
-	!GMT_to_zone( &td, tzone ))
+	!jms_to_zone( in_days[i], in_ms[i], tzone, &td ))
     { 
       /* error occurred -- put NA into return value */
       day_data[i] = NA_INTEGER;
@@ -875,8 +875,9 @@ SEXP time_from_month_day_index( SEXP month, SEXP wkday,
    This function exits with the standard R error syntax if
    there is an error, such as the wrong type of input.
 
-   ALGORITHM Easter's date is calculated in the julian_easter
-   function, and this is put into the time object.  Since no times are 
+   ALGORITHM Easter's date is calculated in the julian_easter_vec
+   function, which uses a table of Easter dates built on first use,
+   and this is put into the time object.  Since no times are 
    given, time zones are not considered in making the calculation, and 
    the time object's times of day are always midnight GMT.
 
@@ -907,17 +908,9 @@ SEXP time_easter( SEXP year_vec )
 
   /* for each year, convert to julian day and put into return obj*/
 
+  julian_easter_vec( in_years, lng, day_data );
   for( i = 0; i < lng; i++ )
-  {
-    ms_data[i] = 0;
-
-    if(  in_years[i] == NA_INTEGER ||
-	!julian_easter( in_years[i],  &(day_data[i])))
-    {
-      day_data[i] = NA_INTEGER;
-      ms_data[i] = NA_INTEGER;
-    }
-  }
+    ms_data[i] = ( day_data[i] == NA_INTEGER ) ? NA_INTEGER : 0;
   
   UNPROTECT(1);
   return( ret );
@@ -949,7 +942,7 @@ SEXP time_easter( SEXP year_vec )
    ALGORITHM The time object is converted to a TIME_DATE_STRUCT 
    using the jms_to_struct function. Then the find_zone function 
    is used to find the actual time zone information, which is then used to 
-   convert from GMT to local time using the GMT_to_zone function.  The
+   convert from GMT to local time using the jms_to_zone function.  The
    hours, minutes, and seconds from the structure are then put into
    the returned list. 
 
@@ -1006,8 +999,7 @@ SEXP time_to_hour_min_sec( SEXP time_vec,
 
     if(  in_ms[i]== NA_INTEGER || 
 	 in_days[i]== NA_INTEGER || 
-	!jms_to_struct( in_days[i], in_ms[i], &td ) ||
-	!GMT_to_zone( &td, tzone ))
+	!jms_to_zone( in_days[i], in_ms[i], tzone, &td ))
     { 
       /* error occurred -- put NA into return value */
       hour_data[i] = NA_INTEGER;
@@ -1325,7 +1317,7 @@ SEXP time_from_numeric( SEXP num_vec, SEXP ret_class )
    ALGORITHM The time object is converted to a TIME_DATE_STRUCT 
    using the jms_to_struct function. Then the find_zone function 
    is used to find the actual time zone information, which is then used to 
-   convert from GMT to local time using the GMT_to_zone function.  The
+   convert from GMT to local time using the jms_to_zone function.  The
    weekday number from the struct is then put into the return value.
 
    EXCEPTIONS 
@@ -1365,8 +1357,7 @@ SEXP time_to_weekday( SEXP time_vec, SEXP zone_list )
   {
     if(  in_days[i] == NA_INTEGER || 
 	 in_ms[i] == NA_INTEGER ||
-	!jms_to_struct( in_days[i], in_ms[i], &td ) ||
-	!GMT_to_zone( &td, tzone ))
+	!jms_to_zone( in_days[i], in_ms[i], tzone, &td ))
       ret_data[i] = NA_INTEGER;
     else
       ret_data[i] = td.weekday;
@@ -1409,7 +1400,7 @@ SEXP time_to_weekday( SEXP time_vec, SEXP zone_list )
    converts the input times to TIME_DATE_STRUCT using the 
    jms_to_struct function, converts that 
    from local zone to GMT, using the find_zone function to get the
-   zone information and the GMT_from_zone function to do the conversion,
+   zone information and the jms_from_zone function to do the conversion,
    and then stores the result in a new time object, converting back to
    julian/ms using julian_from_mdy and ms_from_hms.
 
@@ -1470,9 +1461,7 @@ SEXP time_to_zone( SEXP time_vec, SEXP zone,
     if(  in_days[i] == NA_INTEGER || 
 	 in_ms[i] == NA_INTEGER || 
 	!jms_to_struct( in_days[i], in_ms[i], &td ) ||
-	!GMT_from_zone( &td, tzone ) ||
-	!julian_from_mdy( td, &(jul_data[i]) ) ||
-	!ms_from_hms( td, &(ms_data[i]) ))
+	!jms_from_zone( &td, tzone, &(jul_data[i]), &(ms_data[i]) ))
     { 
       /* error occurred -- put NA into return value */
       jul_data[i] = NA_INTEGER;
@@ -1485,3 +1474,309 @@ SEXP time_to_zone( SEXP time_vec, SEXP zone,
 
 }
 
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_from_unix
+
+   DESCRIPTION  Convert a numeric vector of times since January 1, 1970,
+   such as the data in an R POSIXct or Date object, to an R time object.
+   To be called from R as 
+   \\
+   {\tt 
+   .Call("time_from_unix", num.vec, scale)
+   }
+
+   ARGUMENTS
+      IARG  num_vec   The R numeric vector
+      IARG  scale     Milliseconds per unit of num_vec: 1000 for seconds
+                      (POSIXct), or 86400000 for days (Date)
+
+   RETURN Returns an R time object of the same length as the input
+   numeric vector, in GMT. 
+
+   ALGORITHM  Each number is converted to a whole number of milliseconds 
+   since 1970 by multiplying by scale and rounding, so that fractional
+   seconds are kept to the millisecond.  The Julian day is then the floor 
+   of that divided by the milliseconds per day, shifted by the 3653 days
+   from 1960 to 1970, and the remainder is the milliseconds.  NA, NaN, 
+   infinite, and out of range numbers become NA.  This is a single pass,
+   without converting to local time.  No special time zones or formats
+   are put on the returned object.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_to_unix, time_from_numeric
+
+**********************************************************************/
+SEXP time_from_unix( SEXP num_vec, SEXP scale )
+{
+  SEXP ret;
+  double *in_num, in_scale, tot_ms, days;
+  Sint i, lng;
+  Sint *jul_data, *ms_data;
+
+  /* extract input data */
+
+  if( !IS_NUMERIC(num_vec) || !IS_NUMERIC(scale) || length(scale) < 1 ||
+      !( in_num = REAL(num_vec)) || 
+      !( R_FINITE( in_scale = REAL(scale)[0] )) || in_scale <= 0 )
+    error( "Problem extracting input in c function time_from_unix");
+
+  lng = length(num_vec);
+
+  PROTECT(ret = time_create_new( lng, &jul_data, &ms_data ));
+  if( !ret || ( lng && ( !jul_data || !ms_data )))
+    error( "Could not create return object in C function time_from_unix");
+
+  for( i = 0; i < lng; i++ )
+  {
+    tot_ms = floor( in_num[i] * in_scale + 0.5 );
+    days = floor( tot_ms / MS_PER_DAY );
+    if( !R_FINITE( tot_ms ) || 
+	days + UNIX_EPOCH_JULIAN >= INT_MAX || 
+	days + UNIX_EPOCH_JULIAN <= -INT_MAX )
+    {
+      jul_data[i] = NA_INTEGER;
+      ms_data[i] = NA_INTEGER;
+      continue;
+    }
+    jul_data[i] = (Sint) days + UNIX_EPOCH_JULIAN;
+    ms_data[i] = (Sint) ( tot_ms - days * MS_PER_DAY );
+  }
+
+  UNPROTECT(1);
+  return ret;
+}
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_to_unix
+
+   DESCRIPTION  Convert an R time object to a numeric vector of times 
+   since January 1, 1970, as used in R POSIXct or Date objects.
+   To be called from R as 
+   \\
+   {\tt 
+   .Call("time_to_unix", time.vec, scale, local, zone.list)
+   }
+
+   ARGUMENTS
+      IARG  time_vec  The R time object
+      IARG  scale     Milliseconds per unit of the output: 1000 for 
+                      seconds (POSIXct), or 86400000 for days (Date)
+      IARG  local     Logical: if true, the times are converted to the 
+                      time object's zone first, so that the output gives 
+                      local dates and times
+      IARG  zone_list The list of R time zone objects
+
+   RETURN Returns a numeric vector of the same length as the input time
+   object.
+
+   ALGORITHM  Each time is converted to milliseconds since 1970 from the 
+   Julian day and milliseconds, and divided by scale.  If local is true,
+   the time is first converted to the local zone with jms_to_zone,
+   julian_from_mdy, and ms_from_hms, or for a fixed-offset zone by
+   adding the offset to the milliseconds.  NA times become NA.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_from_unix, time_to_numeric
+
+**********************************************************************/
+SEXP time_to_unix( SEXP time_vec, SEXP scale, SEXP local,
+		   SEXP zone_list )
+{
+  SEXP ret;
+  double *in_scale, *ret_data;
+  Sint i, lng, jul, ms;
+  Sint *in_days, *in_ms;
+  char *zone;
+  int is_local, is_fixed;
+  TIME_DATE_STRUCT td;
+  TZONE_STRUCT *tzone = NULL;
+
+  /* extract input data */
+
+  if( !IS_NUMERIC(scale) || length(scale) < 1 || 
+      !R_FINITE( *( in_scale = REAL(scale))) || *in_scale <= 0 ||
+      !IS_LOGICAL(local) || length(local) < 1 )
+    error( "Problem extracting input in c function time_to_unix");
+  is_local = ( LOGICAL(local)[0] == 1 );
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL, 
+			&zone, NULL ))
+    error( "Invalid argument in C function time_to_unix");
+
+  if( is_local && !( tzone = find_zone( zone, zone_list ))){
+    UNPROTECT(2);
+    error( "Unknown or unreadable time zone in C function time_to_unix" );
+  }
+
+  /* a fixed-offset zone is just added to the milliseconds */
+  is_fixed = is_local && zone_is_fixed( tzone );
+
+  PROTECT(ret = NEW_NUMERIC( lng ));
+  ret_data = REAL(ret);
+
+  for( i = 0; i < lng; i++ )
+  {
+    jul = in_days[i];
+    ms = in_ms[i];
+    if( jul == NA_INTEGER || ms == NA_INTEGER )
+    {
+      ret_data[i] = NA_REAL;
+      continue;
+    }
+
+    if( is_local && is_fixed )
+      ms += 1000 * tzone->offset;
+    else if( is_local )
+    {
+      if( !jms_to_zone( jul, ms, tzone, &td ) ||
+	  !julian_from_mdy( td, &jul ) ||
+	  !ms_from_hms( td, &ms ))
+      {
+	ret_data[i] = NA_REAL;
+	continue;
+      }
+    }
+
+    ret_data[i] = (( (double) jul - UNIX_EPOCH_JULIAN ) * MS_PER_DAY + ms ) 
+      / *in_scale;
+  }
+
+  UNPROTECT(3); //1+2 from time_get_pieces
+  return ret;
+}
+
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_pack
+
+   DESCRIPTION  Get the packed milliseconds of an R time or time span 
+   object.
+   To be called from R as 
+   \\
+   {\tt 
+   .Call("time_pack", time.vec)
+   }
+
+   ARGUMENTS
+      IARG  time_vec  The R time or time span object
+
+   RETURN Returns a numeric vector of the same length as the input, 
+   holding julian days * MS_PER_DAY + ms.  NA times become NA, and so
+   do times whose value is not less than TIME_PACKED_MAX_MS (2^53) in
+   absolute value, beyond which a double does not hold every
+   millisecond; that is about 104249991 days either side of 1960.
+
+   ALGORITHM  If the object is already packed, its data vector is
+   returned as is.  Otherwise the two columns are combined in a single
+   pass; the products and sums are exact up to the limit.  The R code
+   puts the result in the columns slot to make a packed object.
+
+   EXCEPTIONS  A warning is given if times out of range are set to NA.
+
+   NOTE See also: time_unpack, time_packed_split
+
+**********************************************************************/
+SEXP time_pack( SEXP time_vec )
+{
+  SEXP ret;
+  double *ret_data;
+  Sint i, lng;
+  Sint *in_days, *in_ms;
+  int out_of_range = 0;
+
+  if( time_is_packed( time_vec ))
+    return( time_julian_pointer( time_vec ));
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL, 
+			NULL, NULL ))
+    error( "Invalid argument in C function time_pack");
+
+  PROTECT(ret = NEW_NUMERIC( lng ));
+  ret_data = REAL(ret);
+
+  for( i = 0; i < lng; i++ )
+  {
+    if( in_days[i] == NA_INTEGER || in_ms[i] == NA_INTEGER )
+      ret_data[i] = NA_REAL;
+    else
+      ret_data[i] = (double) in_days[i] * MS_PER_DAY + in_ms[i];
+    if( fabs( ret_data[i] ) >= TIME_PACKED_MAX_MS )
+    {
+      ret_data[i] = NA_REAL;
+      out_of_range = 1;
+    }
+  }
+
+  if( out_of_range )
+    warning( "Times too far from 1960 to pack exactly were set to NA" );
+
+  UNPROTECT(3); //1+2 from time_get_pieces
+  return ret;
+}
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME time_unpack
+
+   DESCRIPTION  Get the julian day and millisecond columns of an R time 
+   or time span object, whichever layout it is stored in.
+   To be called from R as 
+   \\
+   {\tt 
+   .Call("time_unpack", time.vec)
+   }
+
+   ARGUMENTS
+      IARG  time_vec  The R time or time span object
+
+   RETURN Returns a list of two integer vectors, the julian days and 
+   the milliseconds.
+
+   ALGORITHM  A split object's columns are returned as they are; a 
+   packed object is split by time_packed_split, with floor division for
+   times and truncation for time spans.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_pack, time_packed_split
+
+**********************************************************************/
+SEXP time_unpack( SEXP time_vec )
+{
+  SEXP ret;
+  Sint *in_days, *in_ms, lng;
+
+  if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL, 
+			NULL, NULL ))
+    error( "Invalid argument in C function time_unpack");
+
+  PROTECT(ret = allocVector( VECSXP, 2 ));
+  if( time_is_packed( time_vec ))
+  {
+    /* time_get_pieces made new vectors */
+    SET_VECTOR_ELT( ret, 0, NEW_INTEGER( lng ));
+    SET_VECTOR_ELT( ret, 1, NEW_INTEGER( lng ));
+    if( lng ){
+      memcpy( INTEGER( VECTOR_ELT( ret, 0 )), in_days, lng * sizeof(Sint));
+      memcpy( INTEGER( VECTOR_ELT( ret, 1 )), in_ms, lng * sizeof(Sint));
+    }
+  }
+  else
+  {
+    SET_VECTOR_ELT( ret, 0, time_julian_pointer( time_vec ));
+    SET_VECTOR_ELT( ret, 1, time_ms_pointer( time_vec ));
+  }
+
+  UNPROTECT(3); //1+2 from time_get_pieces
+  return ret;
+}
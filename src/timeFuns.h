@@ -37,6 +37,11 @@ SEXP time_from_numeric( SEXP num_vec, SEXP ret_class );
 SEXP time_to_weekday( SEXP time_vec, SEXP zone_list );
 SEXP time_to_zone( SEXP time_vec, SEXP zone, 
 		   SEXP zone_list );
+SEXP time_from_unix( SEXP num_vec, SEXP scale );
+SEXP time_to_unix( SEXP time_vec, SEXP scale, SEXP local,
+		   SEXP zone_list );
+SEXP time_pack( SEXP time_vec );
+SEXP time_unpack( SEXP time_vec );
 
 int jms_to_struct( Sint julian, Sint ms, 
 		   TIME_DATE_STRUCT *td_output );
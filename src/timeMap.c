@@ -0,0 +1,695 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ *
+ * It contains C code utility functions for file-backed R time and time
+ * span objects, whose columns are ALTREP integer vectors served from a
+ * memory-mapped file.  See timeMap.h for the file layout.
+ *
+ * The exported functions here were written to be called with the
+ * .Call interface of R.  They include (see documentation below):
+  SEXP time_map_write( SEXP time_vec, SEXP file, SEXP packed );
+  SEXP time_map( SEXP file );
+ * time_map_init is called when the package is loaded, to register the
+ * ALTREP class.
+*************************************************************************/
+
+#include "timeMap.h"
+
+#include <stdio.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef TIME_MAP_ALTREP
+#include <R_ext/Altrep.h>
+#endif
+
+/* an open file-backed time column */
+
+typedef struct time_map_struct
+{
+  const unsigned char *base;
+  size_t len;
+  int is_mapped;
+  const unsigned char *data;
+  R_xlen_t n;
+  int packed;
+  int is_span;
+  const char *format;
+  uint32_t format_len;
+  const char *zone;
+  uint32_t zone_len;
+} TIME_MAP_STRUCT;
+
+static int map_open( const char *path, TIME_MAP_STRUCT *map );
+static void map_release( TIME_MAP_STRUCT *map );
+static void map_finalize( SEXP ptr );
+static int map_value( const TIME_MAP_STRUCT *map, R_xlen_t idx, int column );
+static void map_put_le( unsigned char *p, uint64_t val, int nbytes );
+static uint64_t map_get_le( const unsigned char *p, int nbytes );
+static int map_little_endian( void );
+
+#ifdef TIME_MAP_ALTREP
+static R_altrep_class_t map_int_class;
+static SEXP map_new_column( SEXP map_ptr, double start, double len,
+			    int column );
+#endif
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_map_write
+
+   DESCRIPTION  Write an R time or time span object to a file that
+   time_map can memory map.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_map_write", time.vec, file, packed)
+   }
+
+   ARGUMENTS
+      IARG  time_vec  The R time or time span object
+      IARG  file      The name of the file to write
+      IARG  packed    Logical: if true, write the packed layout
+
+   RETURN Returns NULL.
+
+   ALGORITHM  The header (see timeMap.h) is written, followed by the
+   data.  In the split layout, the julian day and millisecond columns
+   are written as they are; in the packed layout, each time is written
+   as one 64-bit millisecond count, a buffer at a time.  The file is
+   written under a temporary name in the same directory and then
+   renamed over the target, so objects already mapped from an earlier
+   file of that name keep reading the old contents.
+
+   EXCEPTIONS  An error occurs on big-endian platforms, where the file
+   could not be used in place, and if the file cannot be written.
+
+   NOTE See also: time_map
+
+**********************************************************************/
+SEXP time_map_write( SEXP time_vec, SEXP file, SEXP packed )
+{
+  SEXP format_sexp, zone_sexp = NULL;
+  Sint *in_days, *in_ms;
+  Sint lng, i, j, nbuf;
+  const char *format, *zone = "", *target;
+  char *tmp_name;
+  unsigned char head[TIME_MAP_FIXED_HEADER], pad[8];
+  uint32_t format_len, zone_len;
+  int64_t buf[1024];
+  int is_span, is_packed, ok, nprotect = 0;
+  FILE *fp;
+  static const char *span_classes[] = {
+    TSPAN_CLASS_NAME
+  };
+
+  if( !isString(file) || length(file) != 1 ||
+      STRING_ELT(file, 0) == NA_STRING ||
+      !IS_LOGICAL(packed) || length(packed) < 1 )
+    error( "Problem extracting input in c function time_map_write" );
+  is_packed = ( LOGICAL(packed)[0] == 1 );
+
+  if( !map_little_endian() )
+    error( "File-backed times are only supported on little-endian platforms" );
+
+  /* extract input data */
+
+  is_span = checkClass( time_vec, span_classes, 1L );
+  if( is_span )
+  {
+    if( !tspan_get_pieces( time_vec, &in_days, &in_ms, &lng, NULL ))
+      error( "Invalid argument in C function time_map_write" );
+  }
+  else
+  {
+    if( !time_get_pieces( time_vec, NULL, &in_days, &in_ms, &lng, NULL,
+			  NULL, NULL ))
+      error( "Invalid argument in C function time_map_write" );
+    nprotect = 2; //2 from time_get_pieces
+    zone_sexp = time_zone_pointer( time_vec );
+  }
+  format_sexp = time_format_pointer( time_vec );
+  format = format_sexp ? CHAR( format_sexp ) : "";
+  if( zone_sexp )
+    zone = CHAR( zone_sexp );
+  format_len = (uint32_t) strlen( format );
+  zone_len = (uint32_t) strlen( zone );
+
+  /* header */
+
+  memcpy( head, TIME_MAP_MAGIC, 4 );
+  head[4] = TIME_MAP_VERSION;
+  head[5] = (unsigned char) is_packed;
+  head[6] = (unsigned char) is_span;
+  head[7] = 0;
+  map_put_le( head + 8, (uint64_t) lng, 8 );
+  map_put_le( head + 16, format_len, 4 );
+  map_put_le( head + 20, zone_len, 4 );
+  memset( pad, 0, 8 );
+
+  /* write a temporary file next to the target, to rename over it */
+  target = CHAR( STRING_ELT( file, 0 ));
+  tmp_name = R_alloc( strlen( target ) + 5, sizeof(char) );
+  sprintf( tmp_name, "%s.tmp", target );
+
+  if( !( fp = fopen( tmp_name, "wb" )))
+    error( "Could not open file %s in C function time_map_write",
+	   tmp_name );
+
+  ok = ( fwrite( head, 1, TIME_MAP_FIXED_HEADER, fp ) ==
+	 TIME_MAP_FIXED_HEADER &&
+	 fwrite( format, 1, format_len, fp ) == format_len &&
+	 fwrite( zone, 1, zone_len, fp ) == zone_len &&
+	 fwrite( pad, 1, ( 8 - ( format_len + zone_len ) % 8 ) % 8, fp ) ==
+	 ( 8 - ( format_len + zone_len ) % 8 ) % 8 );
+
+  /* data */
+
+  if( ok && !is_packed )
+    ok = ( fwrite( in_days, sizeof(Sint), lng, fp ) == (size_t) lng &&
+	   fwrite( in_ms, sizeof(Sint), lng, fp ) == (size_t) lng );
+  else if( ok )
+  {
+    for( i = 0; ok && i < lng; i += nbuf )
+    {
+      nbuf = ( lng - i < 1024 ) ? lng - i : 1024;
+      for( j = 0; j < nbuf; j++ )
+      {
+	if( in_days[i + j] == NA_INTEGER || in_ms[i + j] == NA_INTEGER )
+	  buf[j] = INT64_MIN;
+	else
+	  buf[j] = (int64_t) in_days[i + j] * MS_PER_DAY + in_ms[i + j];
+      }
+      ok = ( fwrite( buf, sizeof(int64_t), nbuf, fp ) == (size_t) nbuf );
+    }
+  }
+
+  UNPROTECT( nprotect );
+  if( fclose( fp ) || !ok )
+  {
+    remove( tmp_name );
+    error( "Could not write file %s in C function time_map_write", target );
+  }
+
+#ifdef _WIN32
+  /* rename does not replace an existing file here */
+  remove( target );
+#endif
+  if( rename( tmp_name, target ))
+  {
+    remove( tmp_name );
+    error( "Could not write file %s in C function time_map_write", target );
+  }
+
+  return R_NilValue;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_map
+
+   DESCRIPTION  Create an R time or time span object backed by a file
+   written by time_map_write.
+   To be called from R as
+   \\
+   {\tt
+   .Call("time_map", file)
+   }
+
+   ARGUMENTS
+      IARG  file      The name of the file
+
+   RETURN Returns an R time or time span object, with the format and
+   time zone from the file.
+
+   ALGORITHM  The file is memory mapped, and its header is checked.
+   From R 3.6.0 on, the columns of the returned object are ALTREP
+   integer vectors that read the mapped file: elements and regions are
+   computed on request, a read-only data pointer into the file is given
+   out for the split layout, so the C functions of this library work on
+   the pages in place, and subsets that are contiguous ranges are
+   views into the same mapping.  A writable pointer, or a read-only
+   pointer to packed data, makes an ordinary copy of the column, which
+   is used from then on.  The mapping is released when no column refers
+   to it.  With older versions of R, or where memory mapping is not
+   available, the file is read into ordinary vectors.
+
+   EXCEPTIONS  An error occurs if the file is not a valid time file.
+
+   NOTE See also: time_map_write
+
+**********************************************************************/
+SEXP time_map( SEXP file )
+{
+  SEXP ret, cols, str;
+  TIME_MAP_STRUCT map, *map_copy;
+  Sint *jul_data, *ms_data;
+  int col, nprotect = 0;
+#ifdef TIME_MAP_ALTREP
+  SEXP map_ptr;
+#else
+  R_xlen_t i;
+#endif
+
+  if( !isString(file) || length(file) != 1 ||
+      STRING_ELT(file, 0) == NA_STRING )
+    error( "Problem extracting input in c function time_map" );
+
+  if( !map_little_endian() )
+    error( "File-backed times are only supported on little-endian platforms" );
+
+  if( !map_open( CHAR( STRING_ELT( file, 0 )), &map ))
+    error( "Could not read time file %s in C function time_map",
+	   CHAR( STRING_ELT( file, 0 )));
+
+  PROTECT( cols = NEW_LIST(2) );
+  nprotect++;
+
+#ifdef TIME_MAP_ALTREP
+  if( !( map_copy = (TIME_MAP_STRUCT *) malloc( sizeof(TIME_MAP_STRUCT) )))
+  {
+    map_release( &map );
+    error( "Could not allocate memory in C function time_map" );
+  }
+  *map_copy = map;
+  PROTECT( map_ptr = R_MakeExternalPtr( map_copy, R_NilValue, R_NilValue ));
+  nprotect++;
+  R_RegisterCFinalizerEx( map_ptr, map_finalize, TRUE );
+
+  for( col = 0; col < 2; col++ )
+    SET_VECTOR_ELT( cols, col,
+		    map_new_column( map_ptr, 0.0, (double) map.n, col ));
+#else
+  map_copy = &map;
+  for( col = 0; col < 2; col++ )
+  {
+    SET_VECTOR_ELT( cols, col, NEW_INTEGER( map.n ));
+    jul_data = INTEGER( VECTOR_ELT( cols, col ));
+    for( i = 0; i < map.n; i++ )
+      jul_data[i] = map_value( &map, i, col );
+  }
+#endif
+
+  /* create the object and put in the columns and header strings */
+
+  if( map_copy->is_span )
+    PROTECT( ret = tspan_create_new( 0, &jul_data, &ms_data ));
+  else
+    PROTECT( ret = time_create_new( 0, &jul_data, &ms_data ));
+  nprotect++;
+  SET_SLOT( ret, install( "columns" ), cols );
+
+  PROTECT( str = NEW_CHARACTER(1) );
+  SET_STRING_ELT( str, 0, mkCharLen( map_copy->format,
+				     map_copy->format_len ));
+  SET_SLOT( ret, install( "format" ), str );
+  UNPROTECT(1);
+  if( !map_copy->is_span )
+  {
+    PROTECT( str = NEW_CHARACTER(1) );
+    SET_STRING_ELT( str, 0, mkCharLen( map_copy->zone, map_copy->zone_len ));
+    SET_SLOT( ret, install( "time.zone" ), str );
+    UNPROTECT(1);
+  }
+
+#ifndef TIME_MAP_ALTREP
+  map_release( &map );
+#endif
+
+  UNPROTECT( nprotect );
+  return ret;
+}
+
+#ifdef TIME_MAP_ALTREP
+
+/* the view of a column: data1 is the mapping, data2 a list of the
+   start, length, and column number, and the ordinary copy, if any */
+
+#define MAP_STRUCT(x) \
+  ( (TIME_MAP_STRUCT *) R_ExternalPtrAddr( R_altrep_data1(x) ))
+#define MAP_INFO(x) REAL( VECTOR_ELT( R_altrep_data2(x), 0 ))
+#define MAP_COPY(x) VECTOR_ELT( R_altrep_data2(x), 1 )
+
+static SEXP map_new_column( SEXP map_ptr, double start, double len,
+			    int column )
+{
+  SEXP info, data2, ret;
+
+  PROTECT( info = NEW_NUMERIC(3) );
+  REAL(info)[0] = start;
+  REAL(info)[1] = len;
+  REAL(info)[2] = column;
+  PROTECT( data2 = NEW_LIST(2) );
+  SET_VECTOR_ELT( data2, 0, info );
+  ret = R_new_altrep( map_int_class, map_ptr, data2 );
+  UNPROTECT(2);
+  return ret;
+}
+
+static R_xlen_t map_length( SEXP x )
+{
+  return (R_xlen_t) MAP_INFO(x)[1];
+}
+
+static const Sint *map_split_pointer( SEXP x )
+{
+  TIME_MAP_STRUCT *map = MAP_STRUCT(x);
+  double *info = MAP_INFO(x);
+
+  if( !map || map->packed )
+    return NULL;
+  return (const Sint *) map->data + ( info[2] ? map->n : 0 ) +
+    (R_xlen_t) info[0];
+}
+
+static int map_elt( SEXP x, R_xlen_t i )
+{
+  SEXP copy = MAP_COPY(x);
+  double *info = MAP_INFO(x);
+
+  if( copy != R_NilValue )
+    return INTEGER(copy)[i];
+  return map_value( MAP_STRUCT(x), (R_xlen_t) info[0] + i, (int) info[2] );
+}
+
+static R_xlen_t map_get_region( SEXP x, R_xlen_t i, R_xlen_t n, int *buf )
+{
+  SEXP copy = MAP_COPY(x);
+  double *info = MAP_INFO(x);
+  const Sint *src;
+  R_xlen_t len = map_length(x), k;
+
+  if( i >= len )
+    return 0;
+  if( n > len - i )
+    n = len - i;
+
+  if( copy != R_NilValue )
+    memcpy( buf, INTEGER(copy) + i, n * sizeof(int) );
+  else if(( src = map_split_pointer(x) ))
+    memcpy( buf, src + i, n * sizeof(int) );
+  else
+    for( k = 0; k < n; k++ )
+      buf[k] = map_value( MAP_STRUCT(x), (R_xlen_t) info[0] + i + k,
+			  (int) info[2] );
+  return n;
+}
+
+static void *map_dataptr( SEXP x, Rboolean writeable )
+{
+  SEXP copy = MAP_COPY(x);
+  const Sint *src;
+
+  if( copy != R_NilValue )
+    return INTEGER(copy);
+  if( !writeable && ( src = map_split_pointer(x) ))
+    return (void *) src;
+
+  /* writable or packed data need an ordinary copy */
+  PROTECT( copy = NEW_INTEGER( map_length(x) ));
+  map_get_region( x, 0, map_length(x), INTEGER(copy) );
+  SET_VECTOR_ELT( R_altrep_data2(x), 1, copy );
+  UNPROTECT(1);
+  return INTEGER(copy);
+}
+
+static const void *map_dataptr_or_null( SEXP x )
+{
+  SEXP copy = MAP_COPY(x);
+
+  if( copy != R_NilValue )
+    return INTEGER(copy);
+  return map_split_pointer(x);
+}
+
+static SEXP map_duplicate( SEXP x, Rboolean deep )
+{
+  SEXP ret;
+
+  PROTECT( ret = NEW_INTEGER( map_length(x) ));
+  map_get_region( x, 0, map_length(x), INTEGER(ret) );
+  UNPROTECT(1);
+  return ret;
+}
+
+static SEXP map_extract_subset( SEXP x, SEXP indx, SEXP call )
+{
+  R_xlen_t m, k, len = map_length(x);
+  double first = 0, val;
+  double *info = MAP_INFO(x);
+
+  /* only contiguous ranges of a column that has not been copied */
+  if( MAP_COPY(x) != R_NilValue || ( !isInteger(indx) && !isReal(indx) ) ||
+      ( m = XLENGTH(indx) ) < 1 )
+    return NULL;
+
+  for( k = 0; k < m; k++ )
+  {
+    if( isInteger(indx) )
+    {
+      if( INTEGER(indx)[k] == NA_INTEGER )
+	return NULL;
+      val = INTEGER(indx)[k];
+    }
+    else
+      val = REAL(indx)[k];
+    if( k == 0 )
+      first = val;
+    if( !R_FINITE(val) || val != first + k || first < 1 ||
+	first + m - 1 > len )
+      return NULL;
+  }
+
+  return map_new_column( R_altrep_data1(x), info[0] + first - 1,
+			 (double) m, (int) info[2] );
+}
+
+static Rboolean map_inspect( SEXP x, int pre, int deep, int pvec,
+			     void (*inspect_subtree)(SEXP, int, int, int) )
+{
+  TIME_MAP_STRUCT *map = MAP_STRUCT(x);
+  double *info = MAP_INFO(x);
+
+  Rprintf( " splusTimeDate file-backed %s column (%s, start %.0f, length %.0f%s)\n",
+	   info[2] ? "ms" : "julian", ( map && map->packed ) ? "packed" :
+	   "split", info[0], info[1],
+	   ( MAP_COPY(x) != R_NilValue ) ? ", copied" : "" );
+  return TRUE;
+}
+
+#endif  /* TIME_MAP_ALTREP */
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_map_init
+
+   DESCRIPTION  Register the ALTREP class for file-backed time columns.
+
+   ARGUMENTS
+      IARG  dll       The DLL information of the package
+
+   RETURN
+
+   ALGORITHM  This is called from R_init_splusTimeDate.  It creates the
+   integer ALTREP class and sets its methods; with versions of R before
+   3.6.0 it does nothing.
+
+   EXCEPTIONS
+
+   NOTE See also: time_map
+
+**********************************************************************/
+#ifdef TIME_MAP_ALTREP
+
+void time_map_init( DllInfo *dll )
+{
+  map_int_class = R_make_altinteger_class( "time_map_int", "splusTimeDate",
+					   dll );
+  R_set_altrep_Length_method( map_int_class, map_length );
+  R_set_altrep_Inspect_method( map_int_class, map_inspect );
+  R_set_altrep_Duplicate_method( map_int_class, map_duplicate );
+  R_set_altvec_Dataptr_method( map_int_class, map_dataptr );
+  R_set_altvec_Dataptr_or_null_method( map_int_class, map_dataptr_or_null );
+  R_set_altvec_Extract_subset_method( map_int_class, map_extract_subset );
+  R_set_altinteger_Elt_method( map_int_class, map_elt );
+  R_set_altinteger_Get_region_method( map_int_class, map_get_region );
+}
+
+#else
+
+void time_map_init( DllInfo *dll )
+{
+}
+
+#endif  /* TIME_MAP_ALTREP */
+
+/* map or read the file and check its header; return 1/0 for
+   success/failure */
+
+static int map_open( const char *path, TIME_MAP_STRUCT *map )
+{
+  const unsigned char *p;
+  uint64_t n, head_len, data_len;
+
+  map->base = NULL;
+  map->len = 0;
+  map->is_mapped = 0;
+
+#ifndef _WIN32
+  {
+    int fd;
+    struct stat st;
+    void *addr;
+
+    if(( fd = open( path, O_RDONLY )) < 0 )
+      return 0;
+    if( fstat( fd, &st ) < 0 || st.st_size < TIME_MAP_FIXED_HEADER )
+    {
+      close( fd );
+      return 0;
+    }
+    addr = mmap( NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( addr == MAP_FAILED )
+      return 0;
+    map->base = (const unsigned char *) addr;
+    map->len = (size_t) st.st_size;
+    map->is_mapped = 1;
+  }
+#else
+  {
+    /* no mmap here, so read the whole file */
+    FILE *fp;
+    long size;
+    unsigned char *data = NULL;
+
+    if( !( fp = fopen( path, "rb" )))
+      return 0;
+    if( fseek( fp, 0, SEEK_END ) ||
+	( size = ftell( fp )) < TIME_MAP_FIXED_HEADER ||
+	fseek( fp, 0, SEEK_SET ) ||
+	!( data = (unsigned char *) malloc( (size_t) size )) ||
+	fread( data, 1, (size_t) size, fp ) != (size_t) size )
+    {
+      free( data );
+      fclose( fp );
+      return 0;
+    }
+    fclose( fp );
+    map->base = data;
+    map->len = (size_t) size;
+  }
+#endif
+
+  p = map->base;
+  n = map_get_le( p + 8, 8 );
+  map->format_len = (uint32_t) map_get_le( p + 16, 4 );
+  map->zone_len = (uint32_t) map_get_le( p + 20, 4 );
+  head_len = TIME_MAP_FIXED_HEADER + (uint64_t) map->format_len +
+    map->zone_len;
+  head_len += ( 8 - head_len % 8 ) % 8;
+  data_len = 8 * n;
+
+  if( memcmp( p, TIME_MAP_MAGIC, 4 ) || p[4] != TIME_MAP_VERSION ||
+      p[5] > 1 || p[6] > 1 || n > R_XLEN_T_MAX ||
+      head_len > map->len || data_len > map->len - head_len )
+  {
+    map_release( map );
+    return 0;
+  }
+
+  map->packed = p[5];
+  map->is_span = p[6];
+  map->n = (R_xlen_t) n;
+  map->format = (const char *) p + TIME_MAP_FIXED_HEADER;
+  map->zone = map->format + map->format_len;
+  map->data = p + head_len;
+  return 1;
+}
+
+static void map_release( TIME_MAP_STRUCT *map )
+{
+#ifndef _WIN32
+  if( map->is_mapped && map->base )
+    munmap( (void *) map->base, map->len );
+#else
+  free( (void *) map->base );
+#endif
+  map->base = NULL;
+  map->data = NULL;
+}
+
+static void map_finalize( SEXP ptr )
+{
+  TIME_MAP_STRUCT *map;
+
+  if( !( map = (TIME_MAP_STRUCT *) R_ExternalPtrAddr( ptr )))
+    return;
+  map_release( map );
+  free( map );
+  R_ClearExternalPtr( ptr );
+}
+
+/* one julian day (column 0) or millisecond (column 1) value */
+
+static int map_value( const TIME_MAP_STRUCT *map, R_xlen_t idx, int column )
+{
+  int64_t key, days, rem;
+
+  if( !map->packed )
+    return ((const Sint *) map->data)[( column ? map->n : 0 ) + idx];
+
+  memcpy( &key, map->data + 8 * idx, 8 );
+  if( key == INT64_MIN )
+    return NA_INTEGER;
+
+  /* times have non-negative ms, spans ms of the same sign as days */
+  days = key / MS_PER_DAY;
+  rem = key % MS_PER_DAY;
+  if( !map->is_span && rem < 0 )
+  {
+    rem += MS_PER_DAY;
+    days--;
+  }
+  if( days >= INT_MAX || days <= -INT_MAX )
+    return NA_INTEGER;
+  return column ? (int) rem : (int) days;
+}
+
+static void map_put_le( unsigned char *p, uint64_t val, int nbytes )
+{
+  int i;
+
+  for( i = 0; i < nbytes; i++, val >>= 8 )
+    p[i] = (unsigned char) ( val & 0xff );
+}
+
+static uint64_t map_get_le( const unsigned char *p, int nbytes )
+{
+  uint64_t val = 0;
+  int i;
+
+  for( i = nbytes - 1; i >= 0; i-- )
+    val = ( val << 8 ) | p[i];
+  return val;
+}
+
+static int map_little_endian( void )
+{
+  uint16_t one = 1;
+
+  return *(unsigned char *) &one;
+}
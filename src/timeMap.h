@@ -0,0 +1,55 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+*************************************************************************/
+
+#ifndef TIMELIB_TIMEMAP_H
+#define TIMELIB_TIMEMAP_H
+
+#include "timeUtils.h"
+#include "timeObj.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <R_ext/Rdynload.h>
+
+/* Layout of a file-backed time column.  All integers are little-endian,
+   and the data start on an 8-byte boundary so they can be used in place
+   once the file is memory mapped.
+
+     bytes 0-3    magic "sTDm"
+     byte  4      version (1)
+     byte  5      layout: 0 for split, 1 for packed
+     byte  6      kind: 0 for timeDate, 1 for timeSpan
+     byte  7      reserved (0)
+     bytes 8-15   uint64 number of values n
+     bytes 16-19  uint32 format length
+     bytes 20-23  uint32 zone length
+     then         format bytes, zone bytes, zero padding to a multiple
+                  of 8 bytes,
+                  data
+
+   In the split layout, the data are n int32 julian days followed by n
+   int32 milliseconds, exactly the two columns of the object.  In the
+   packed layout, the data are n int64 milliseconds (julian days *
+   MS_PER_DAY + ms), with INT64_MIN for NA. */
+
+#define TIME_MAP_MAGIC "sTDm"
+#define TIME_MAP_VERSION 1
+#define TIME_MAP_FIXED_HEADER 24
+
+/* ALTREP is used from R 3.6.0 on; before that the file is read into
+   ordinary vectors */
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 6, 0)
+#define TIME_MAP_ALTREP 1
+#endif
+
+SEXP time_map_write( SEXP time_vec, SEXP file, SEXP packed );
+SEXP time_map( SEXP file );
+
+void time_map_init( DllInfo *dll );
+
+#endif  // TIMELIB_TIMEMAP_H
@@ -19,6 +19,8 @@
 #include "timeObj.h"
 
 #include "sptd_utils.h"
+#include <limits.h>
+#include <math.h>
 
 /* definitions needed for time class */
 
@@ -243,7 +245,8 @@ SEXP time_julian_pointer( SEXP time_obj )
   SEXP data_pointer = time_data_pointer( time_obj );
   if( !data_pointer )
     return NULL;
-  /* the julian days currently live in the first element of the data list */
+  /* the julian days currently live in the first element of the data list;
+     a packed object has only the one element, of the same length */
   return( VECTOR_ELT(data_pointer, 0));
 }
 
@@ -277,12 +280,101 @@ SEXP time_ms_pointer( SEXP time_obj )
   SEXP data_pointer = time_data_pointer( time_obj );
   if( !data_pointer )
     return NULL;
-  /* the milliseconds  currently live in the 2nd element of the data list */
+  /* the milliseconds  currently live in the 2nd element of the data list;
+     a packed object has only one element, of the same length */
+  if( length( data_pointer ) < 2 )
+    return( VECTOR_ELT(data_pointer, 0));
   return( VECTOR_ELT(data_pointer, 1));
 
 }
 
 
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_is_packed
+
+   DESCRIPTION  Find out whether an R time or time span object is stored
+   in the packed layout.
+
+   ARGUMENTS
+      IARG  time_obj  The R time or time span object
+
+   RETURN Returns 1 if the object holds a single double vector of 
+   milliseconds since 1960 in place of the julian day and millisecond
+   vectors, and 0 otherwise.
+
+   ALGORITHM Looks at the number and type of the elements of the data
+   list.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_packed_split, time_data_pointer
+
+**********************************************************************/
+int time_is_packed( SEXP time_obj )
+{
+  SEXP data_pointer = time_data_pointer( time_obj );
+  if( !data_pointer || length( data_pointer ) != 1 )
+    return 0;
+  return( TYPEOF( VECTOR_ELT( data_pointer, 0 )) == REALSXP );
+}
+
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_packed_split
+
+   DESCRIPTION  Split packed milliseconds into julian days and 
+   milliseconds.
+
+   ARGUMENTS
+      IARG  packed    Milliseconds since 1960, NA_REAL for NA
+      IARG  length    Length of the packed vector
+      IARG  is_span   1 for time spans, 0 for times
+      OARG  day_vec   Julian days (length long)
+      OARG  ms_vec    Milliseconds (length long)
+
+   RETURN None
+
+   ALGORITHM Times are split with floor division, so the milliseconds
+   are in [0, MS_PER_DAY); spans are split with truncation, so the days
+   and milliseconds have the same sign, as adjust_span makes them.
+   Non-finite values and days outside the integer range give NA.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_is_packed, adjust_span
+
+**********************************************************************/
+void time_packed_split( const double *packed, Sint length, int is_span,
+			Sint *day_vec, Sint *ms_vec )
+{
+  Sint i;
+  double days;
+
+  for( i = 0; i < length; i++ )
+  {
+    if( !R_FINITE( packed[i] ))
+    {
+      day_vec[i] = ms_vec[i] = NA_INTEGER;
+      continue;
+    }
+    days = packed[i] / MS_PER_DAY;
+    days = ( is_span ? ( days < 0 ? ceil( days ) : floor( days )) :
+	     floor( days ));
+    if( days >= INT_MAX || days <= INT_MIN )
+    {
+      day_vec[i] = ms_vec[i] = NA_INTEGER;
+      continue;
+    }
+    day_vec[i] = (Sint) days;
+    ms_vec[i] = (Sint) ( packed[i] - days * MS_PER_DAY );
+  }
+}
+
+
 /**********************************************************************
  * C Code Documentation ************************************************
  **********************************************************************
@@ -343,7 +435,10 @@ int time_get_pieces( SEXP time_obj, SEXP opt_obj,
   SEXP tmp, tmp1, tmp2;
   const char *old_format, *tmpzone;
   Sint tmplen;
-  int zone_size, abb_size, full_size;
+  int zone_size, abb_size, full_size, is_packed = 0;
+  static const char *span_classes[] = {
+    TSPAN_CLASS_NAME
+  };
 
   if( !time_initialized )
     time_init();
@@ -352,6 +447,25 @@ int time_get_pieces( SEXP time_obj, SEXP opt_obj,
       ( opt_struct && !opt_obj ))
     return 0;
 
+  if(( day_vec || ms_vec ) && time_is_packed( time_obj ))
+  {
+    /* split the packed milliseconds into new julian day and ms vectors,
+       which take the places of the two protected objects below */
+
+    tmp = time_julian_pointer( time_obj );
+    tmplen = length(tmp);
+    PROTECT(tmp1 = NEW_INTEGER(tmplen));
+    PROTECT(tmp2 = NEW_INTEGER(tmplen));
+    time_packed_split( REAL(tmp), tmplen, 
+		       checkClass( time_obj, span_classes, 1L ),
+		       INTEGER(tmp1), INTEGER(tmp2) );
+    if( day_vec ) *day_vec = INTEGER(tmp1);
+    if( ms_vec ) *ms_vec = INTEGER(tmp2);
+    if( vec_length ) *vec_length = tmplen;
+    day_vec = ms_vec = NULL;
+    is_packed = 1;
+  }
+
   if( day_vec )
   {
     /* get the julian days data from the object and the length */
@@ -360,7 +474,7 @@ int time_get_pieces( SEXP time_obj, SEXP opt_obj,
 
     if(  (tmplen = length(tmp)) > 0 ){
       PROTECT(tmp1 = AS_INTEGER(tmp));
-      *day_vec = INTEGER(tmp1);
+      *day_vec = INTEGER_READ(tmp1);
     } else PROTECT(tmp1 = NEW_INTEGER(1));
 
     if( vec_length ) *vec_length = tmplen;
@@ -374,14 +488,14 @@ int time_get_pieces( SEXP time_obj, SEXP opt_obj,
 
     if(  (tmplen = length(tmp)) > 0 ){
       PROTECT(tmp2 = AS_INTEGER(tmp));
-      *ms_vec = INTEGER(tmp2);
+      *ms_vec = INTEGER_READ(tmp2);
     } else PROTECT(tmp1 = NEW_INTEGER(1));
 
     if( vec_length ) *vec_length = tmplen;
 
   }
 
-  if( vec_length && !ms_vec && !day_vec )
+  if( vec_length && !ms_vec && !day_vec && !is_packed )
   {
     /* get the length because we didn't get it above */
 
@@ -580,7 +694,7 @@ int tspan_get_pieces( SEXP time_obj, Sint **day_vec, Sint **ms_vec,
   int cl;
   SEXP tmp;
   const char *tmp_str;
-  Sint tmplen;
+  Sint tmplen, *jul_split, *ms_split;
   static const char *classes[] = {
     TSPAN_CLASS_NAME
   };
@@ -595,12 +709,28 @@ int tspan_get_pieces( SEXP time_obj, Sint **day_vec, Sint **ms_vec,
   if(cl < 0)
     return(0);
 
+  if(( day_vec || ms_vec ) && time_is_packed( time_obj ))
+  {
+    /* split the packed milliseconds into transient arrays */
+
+    tmp = time_julian_pointer( time_obj );
+    tmplen = length(tmp);
+    jul_split = (Sint *) R_alloc( tmplen + 1, sizeof(Sint) );
+    ms_split = (Sint *) R_alloc( tmplen + 1, sizeof(Sint) );
+    time_packed_split( REAL(tmp), tmplen, 1, jul_split, ms_split );
+    if( day_vec ) *day_vec = jul_split;
+    if( ms_vec ) *ms_vec = ms_split;
+    if( vec_length ) *vec_length = tmplen;
+    day_vec = ms_vec = NULL;
+    vec_length = NULL;
+  }
+
   if( day_vec )
   {
     /* get the julian days data from the object and the length */
 
     tmp = time_julian_pointer( time_obj );
-    *day_vec = INTEGER(tmp);
+    *day_vec = INTEGER_READ(tmp);
 
     if( !day_vec || ( (tmplen = length(tmp)) && !(*day_vec )))
       return 0;
@@ -613,7 +743,7 @@ int tspan_get_pieces( SEXP time_obj, Sint **day_vec, Sint **ms_vec,
     /* get the millisecond data from the object and the length */
 
     tmp = time_ms_pointer( time_obj );
-    *ms_vec = INTEGER(tmp);
+    *ms_vec = INTEGER_READ(tmp);
 
     if( !ms_vec || ( (tmplen = length(tmp)) && !(*ms_vec )))
       return 0;
@@ -710,3 +840,56 @@ SEXP tspan_create_new( Sint new_length, Sint **day_data, Sint **ms_data )
   UNPROTECT(3);
   return ret;
 }
+
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME time_create_packed
+
+   DESCRIPTION  Create a new packed R time or time span vector object, 
+   and return a pointer to its milliseconds.
+
+   ARGUMENTS
+      IARG  length       The desired length for the object
+      IARG  is_span      1 for a time span object, 0 for a time object
+      OARG  packed_data  Milliseconds since 1960, or NULL if not desired
+
+   RETURN Returns the new packed object, or NULL if an error occurs. 
+
+   ALGORITHM As for time_create_new and tspan_create_new, except that 
+   the columns slot holds a single double vector and the names and 
+   classes slots describe it, as timePack does in R.
+
+   EXCEPTIONS 
+
+   NOTE See also: time_is_packed, time_create_new, tspan_create_new
+
+**********************************************************************/
+SEXP time_create_packed( Sint new_length, int is_span, double **packed_data )
+{
+  SEXP ret, tmp;
+
+  if( !time_initialized )
+    time_init();
+
+  /* create a new time or time span object */
+  if( is_span )
+    PROTECT( tspan_class = MAKE_CLASS( TSPAN_CLASS_NAME ));
+  else
+    PROTECT( time_class = MAKE_CLASS( TIME_CLASS_NAME ));
+  PROTECT( ret = NEW_OBJECT( is_span ? tspan_class : time_class ));
+  PROTECT( tmp = NEW_LIST(1) );
+
+  /* one column of milliseconds */
+  SET_VECTOR_ELT(tmp, 0, NEW_NUMERIC(new_length));
+  SET_SLOT(ret, install("columns"), tmp);
+  SET_SLOT(ret, install("names"), mkString( "packed.ms" ));
+  SET_SLOT(ret, install("classes"), mkString( "numeric" ));
+
+  /* get the pointer for return */
+  if(packed_data) *packed_data = REAL( VECTOR_ELT(tmp, 0) );
+
+  UNPROTECT(3);
+  return ret;
+}
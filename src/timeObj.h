@@ -33,6 +33,19 @@ SEXP time_julian_pointer( SEXP time_obj );
 SEXP time_ms_pointer( SEXP time_obj );
 SEXP time_data_pointer( SEXP time_obj );
 
+/*
+ * A packed object stores one double vector of milliseconds since 1960
+ * (julian days * MS_PER_DAY + ms) in place of the two integer vectors;
+ * time_get_pieces and tspan_get_pieces split it transparently.  A
+ * double holds whole milliseconds exactly only below 2^53 in absolute
+ * value (about 104249991 days, or 285000 years), so packed values must
+ * be strictly inside TIME_PACKED_MAX_MS.
+ */
+#define TIME_PACKED_MAX_MS 9007199254740992.0
+int time_is_packed( SEXP time_obj );
+void time_packed_split( const double *packed, Sint length, int is_span,
+			Sint *day_vec, Sint *ms_vec );
+
 /*
  * Functions to extract all the parts of the object as c-readable data,
  * and to create a new time object and extract the time/date vectors.
@@ -51,6 +64,8 @@ SEXP time_create_new( Sint new_length, Sint **day_data,
 				      Sint **ms_data );
 SEXP tspan_create_new( Sint new_length, Sint **day_data,
 				      Sint **ms_data );
+SEXP time_create_packed( Sint new_length, int is_span,
+			 double **packed_data );
 SEXP time_to_string( SEXP time_vec, SEXP opt_list, 
 		      SEXP zone_list );
 SEXP time_from_string( SEXP char_vec, SEXP format_string,
@@ -22,10 +22,24 @@ extern "C" {
 #define WEEKDAY_START 5
 #define MS_PER_DAY 86400000
 
+/* julian day of January 1, 1970, the POSIX and R Date origin */
+#define UNIX_EPOCH_JULIAN 3653
+
+/* read-only pointer to the data of an R integer vector; for ALTREP
+   vectors, such as file-backed time columns, this avoids making a
+   writable copy */
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+#define INTEGER_READ(x) ((Sint *) INTEGER_RO(x))
+#else
+#define INTEGER_READ(x) INTEGER(x)
+#endif
+
 #define TIME_CLASS_NAME "timeDate"
 #define TSPAN_CLASS_NAME "timeSpan"
 #define C_ZONE_CLASS_NAME "timeZoneC"
 #define R_ZONE_CLASS_NAME "timeZoneR"
+#define TZIF_ZONE_CLASS_NAME "timeZoneTZif"
+#define BIZ_CALENDAR_CLASS_NAME "bizCalendar"
 
 /* Sfloat, Sint added for splusTimeDate_2.5.4 as they will be dropped
  * from R soon.
@@ -32,6 +32,8 @@
 *************************************************************************/
 
 #include "zoneFuns.h"
+#include "zoneTZif.h"
+#include <limits.h>
 #include <string.h>
 
 /* internal functions -- defined and documented at bottom of file */
@@ -40,6 +42,8 @@ static int get_offset( TIME_DATE_STRUCT tstruc, int in_local_time,
 		       TZONE_STRUCT *tzone, Sint *offset, int *is_daylight );
 static int julian_from_tzcode( TZONE_CODE code, Sint month, Sint day,
 			Sint xday, Sint year, Sint *julian );
+static int time_in_window( Sint ms, Sint start, Sint width );
+static Sint rule_new_year_extra( const TZONE_RULE_STRUCT *rule );
 
 /* there is also a huge amount of tabular information about time zones
    stored in static variables just before the internal functions */
@@ -278,6 +282,335 @@ int GMT_from_zone( TIME_DATE_STRUCT *tstruc, TZONE_STRUCT *tzone )
 }
 
 
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME zone_is_fixed
+
+   DESCRIPTION  Find out whether a time zone is a constant offset from
+   GMT.
+
+   ARGUMENTS
+      IARG   tzone   Time zone object
+
+   RETURN Returns 1 if the zone has no daylight savings rules or
+   transition table, so that its offset is always the offset member, 
+   and 0 otherwise.
+
+   ALGORITHM Checks the rule and transition table pointers.
+
+   EXCEPTIONS 
+
+   NOTE  See also: jms_to_zone, jms_from_zone
+
+**********************************************************************/
+int zone_is_fixed( const TZONE_STRUCT *tzone )
+{
+  return( tzone && !tzone->rule && !tzone->trans );
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME zone_skips_time
+
+   DESCRIPTION  Find out whether a local time of day is skipped on some
+   day in a time zone, because the clocks are put forward over it.
+
+   ARGUMENTS
+      IARG   tzone   Time zone object
+      IARG   ms      Local milliseconds after midnight
+
+   RETURN Returns 1 if the time of day is in a skipped interval of any
+   daylight savings rule or transition of the zone, and 0 otherwise.
+
+   ALGORITHM For a zone with rules, each rule with daylight savings 
+   skips the standard times from timestart to timestart + dsextra on 
+   the start day (or from timeend + dsextra to timeend on the end day
+   if dsextra is negative), and a rule whose daylight time runs over 
+   the new year skips the times from midnight on January 1 of its 
+   first year by the increase over the rule before.  For a zone with a
+   transition table, each transition that increases the offset skips
+   the local times from the old to the new offset.  The intervals are
+   taken modulo a day.
+
+   EXCEPTIONS 
+
+   NOTE  Adding a relative time of days or months to a skipped time 
+   gives a time whose local time of day is moved, which then carries
+   on to later additions.
+   \\
+   \\
+   See also: zone_is_fixed, get_offset
+
+**********************************************************************/
+int zone_skips_time( TZONE_STRUCT *tzone, Sint ms )
+{
+  TZONE_RULE_STRUCT *rule;
+  TZONE_TRANS_STRUCT *trans;
+  Sint i, old_off, new_off, jan_extra, prev_extra;
+
+  if( !tzone || ( ms == NA_INTEGER ))
+    return 0;
+
+  if(( trans = tzone->trans ))
+  {
+    old_off = trans->offset0;
+    for( i = 0; i < trans->count; i++ )
+    {
+      new_off = trans->offsets[i];
+      if(( new_off > old_off ) &&
+	 time_in_window( ms, 
+			 (Sint) ((( trans->times[i] + old_off ) % 86400 +
+				  86400 ) % 86400 ), new_off - old_off ))
+	return 1;
+      old_off = new_off;
+    }
+    return 0;
+  }
+
+  for( rule = tzone->rule; rule; rule = rule->prev_rule )
+  {
+    if( rule->hasdaylight && ( rule->dsextra > 0 ) &&
+	time_in_window( ms, rule->timestart, rule->dsextra ))
+      return 1;
+    if( rule->hasdaylight && ( rule->dsextra < 0 ) &&
+	time_in_window( ms, rule->timeend + rule->dsextra, -rule->dsextra ))
+      return 1;
+
+    jan_extra = rule_new_year_extra( rule );
+    prev_extra = rule_new_year_extra( rule->prev_rule );
+    if(( jan_extra > prev_extra ) &&
+       time_in_window( ms, 0, jan_extra - prev_extra ))
+      return 1;
+  }
+  return 0;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME zone_segment
+
+   DESCRIPTION  Find the interval of GMT times around a time in which a
+   time zone's offset from GMT does not change.
+
+   ARGUMENTS
+      IARG   tzone   Time zone object
+      IARG   gmt     GMT milliseconds since 1960
+      OARG   start   GMT milliseconds the interval starts at, or 
+                     ZONE_SEGMENT_MIN
+      OARG   end     GMT milliseconds just after the interval ends, or
+                     ZONE_SEGMENT_MAX
+      OARG   offset  seconds offset from GMT in the interval
+
+   RETURN Returns 1/0 for success/failure.
+
+   ALGORITHM For a zone with a transition table, the interval is between
+   the transition in effect, found with tzif_find, and the next one.  A
+   fixed-offset zone has one unbounded interval.  For a zone with 
+   rules, the offset is found with get_offset, and the interval is 
+   bounded by the nearest of the daylight savings starts and ends of 
+   the rules for the year before, the year of, and the year after the
+   time, and the GMT new years, where get_offset changes rules.
+
+   EXCEPTIONS 
+
+   NOTE  The interval of a zone with rules may end where the offset does
+   not change, at a new year or at the edge of the three years; the 
+   callers just go on to the next interval.
+   \\
+   \\
+   See also: get_offset, tzif_find, date_floor_unit
+
+**********************************************************************/
+int zone_segment( TZONE_STRUCT *tzone, int64_t gmt, int64_t *start,
+		  int64_t *end, Sint *offset )
+{
+  TZONE_TRANS_STRUCT *trans;
+  TZONE_RULE_STRUCT *rule;
+  TIME_DATE_STRUCT td, new_year;
+  int64_t day, secs, cand[12];
+  Sint jul, year, year0, j;
+  int daylight, ncand, i;
+
+  if( !tzone || !start || !end || !offset )
+    return 0;
+
+  *start = ZONE_SEGMENT_MIN;
+  *end = ZONE_SEGMENT_MAX;
+
+  if(( trans = tzone->trans ))
+  {
+    secs = gmt - (int64_t) UNIX_EPOCH_JULIAN * MS_PER_DAY;
+    secs = ( secs >= 0 ) ? secs / 1000 : -(( 999 - secs ) / 1000 );
+    j = tzif_find( trans, secs );
+    *offset = ( j < 0 ) ? trans->offset0 : trans->offsets[j];
+    if( j >= 0 )
+      *start = 1000 * ( trans->times[j] + 
+			(int64_t) UNIX_EPOCH_JULIAN * ( MS_PER_DAY / 1000 ));
+    if( j + 1 < trans->count )
+      *end = 1000 * ( trans->times[j + 1] + 
+		      (int64_t) UNIX_EPOCH_JULIAN * ( MS_PER_DAY / 1000 ));
+    return 1;
+  }
+
+  if( zone_is_fixed( tzone ))
+  {
+    *offset = tzone->offset;
+    return 1;
+  }
+
+  /* the offset at the time */
+  day = ( gmt >= 0 ) ? gmt / MS_PER_DAY : 
+    -(( MS_PER_DAY - 1 - gmt ) / MS_PER_DAY );
+  if( day >= INT_MAX || day <= INT_MIN ||
+      !jms_to_struct( (Sint) day, (Sint) ( gmt - day * MS_PER_DAY ), 
+		      &td ) ||
+      !get_offset( td, 0, tzone, offset, &daylight ))
+    return 0;
+
+  /* the times it can change at:  the new years, and the rule times,
+     which are in local standard time */
+  ncand = 0;
+  year0 = td.year;
+  for( year = year0 - 1; year <= year0 + 2; year++ )
+  {
+    new_year.year = year;
+    new_year.month = new_year.day = 1;
+    if( !julian_from_mdy( new_year, &jul ))
+      return 0;
+    cand[ ncand++ ] = (int64_t) jul * MS_PER_DAY;
+
+    if(( year > year0 + 1 ) || 
+       !( rule = zone_rule_for_year( tzone, year )) ||
+       !rule->hasdaylight || !rule->dsextra )
+      continue;
+    if( !julian_from_tzcode( rule->codestart, rule->monthstart,
+			     rule->daystart, rule->xdaystart, year, &jul ))
+      return 0;
+    cand[ ncand++ ] = (int64_t) jul * MS_PER_DAY + 
+      1000 * (int64_t) ( rule->timestart - tzone->offset );
+    if( !julian_from_tzcode( rule->codeend, rule->monthend,
+			     rule->dayend, rule->xdayend, year, &jul ))
+      return 0;
+    cand[ ncand++ ] = (int64_t) jul * MS_PER_DAY + 
+      1000 * (int64_t) ( rule->timeend - tzone->offset );
+  }
+
+  for( i = 0; i < ncand; i++ )
+  {
+    if(( cand[i] <= gmt ) && ( cand[i] > *start ))
+      *start = cand[i];
+    if(( cand[i] > gmt ) && ( cand[i] < *end ))
+      *end = cand[i];
+  }
+  return 1;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME jms_to_zone
+
+   DESCRIPTION  Convert a GMT julian day and milliseconds to a local zone
+   time/date structure.
+
+   ARGUMENTS
+      IARG   julian  GMT julian day
+      IARG   ms      GMT milliseconds
+      IARG   tzone   Time zone object
+      OARG   tstruc  Time/date structure, in local time
+
+   RETURN Returns 1/0 for success/failure
+
+   ALGORITHM For a fixed-offset zone, the offset is added to the 
+   milliseconds, the day is carried with adjust_time, and the result is
+   converted with jms_to_struct, so the date is only computed once.
+   Otherwise this is jms_to_struct followed by GMT_to_zone.
+
+   EXCEPTIONS 
+
+   NOTE  Leap seconds are not taken into account.
+   \\
+   \\
+   See also: jms_from_zone, GMT_to_zone, zone_is_fixed
+
+**********************************************************************/
+int jms_to_zone( Sint julian, Sint ms, TZONE_STRUCT *tzone,
+		 TIME_DATE_STRUCT *tstruc )
+{
+  if( !tstruc || !tzone )
+    return 0;
+
+  if( zone_is_fixed( tzone ))
+  {
+    ms += 1000 * tzone->offset;
+    if( !adjust_time( &julian, &ms ) ||
+	!jms_to_struct( julian, ms, tstruc ))
+      return 0;
+    tstruc->daylight = 0;
+    return 1;
+  }
+
+  tstruc->daylight = 0;
+  return( jms_to_struct( julian, ms, tstruc ) &&
+	  GMT_to_zone( tstruc, tzone ));
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME jms_from_zone
+
+   DESCRIPTION  Convert a local zone time/date structure to a GMT julian
+   day and milliseconds.
+
+   ARGUMENTS
+      IOARG  tstruc  Time/date structure, in local time
+      IARG   tzone   Time zone object
+      OARG   julian  GMT julian day
+      OARG   ms      GMT milliseconds
+
+   RETURN Returns 1/0 for success/failure
+
+   ALGORITHM For a fixed-offset zone, the local julian day and 
+   milliseconds are found with julian_from_mdy and ms_from_hms, and the
+   offset is subtracted from the milliseconds, carrying with 
+   adjust_time.  Otherwise GMT_from_zone is called first, and the 
+   structure is left in GMT.
+
+   EXCEPTIONS 
+
+   NOTE  The daylight member of the structure resolves ambiguous times,
+   as in GMT_from_zone.
+   \\
+   \\
+   See also: jms_to_zone, GMT_from_zone, zone_is_fixed
+
+**********************************************************************/
+int jms_from_zone( TIME_DATE_STRUCT *tstruc, TZONE_STRUCT *tzone,
+		   Sint *julian, Sint *ms )
+{
+  if( !tstruc || !tzone || !julian || !ms )
+    return 0;
+
+  if( !zone_is_fixed( tzone ) && !GMT_from_zone( tstruc, tzone ))
+    return 0;
+
+  if( !julian_from_mdy( *tstruc, julian ) ||
+      !ms_from_hms( *tstruc, ms ))
+    return 0;
+
+  if( zone_is_fixed( tzone ))
+  {
+    *ms -= 1000 * tzone->offset;
+    return( adjust_time( julian, ms ));
+  }
+  return 1;
+}
+
+
 /*****************************
   Time zone definitions.
  ****************************/
@@ -1150,12 +1483,15 @@ static TZONE_STRUCT *built_in_from_name(const char *mixed_name)
    RETURN Returns 1/0 for success/failure.
 
    ALGORITHM The function first finds the time zone rule corresponding 
-   to the input year by following the prev_rule pointers through the 
-   time zone rules.  Then by comparing the dates and times of the
+   to the input year with zone_rule_for_year, which uses the zone's 
+   rule index if it has one, or else follows the prev_rule pointers 
+   through the time zone rules.  Then by comparing the dates and times of the
    time changes for that year, if any, with the input time (in 
    conjunction with the julian_from_mdy, julian_from_tzcode,
    and ms_from_hms functions), it determines whether it is daylight 
-   or standard time, and returns the appropriate offset.
+   or standard time, and returns the appropriate offset.  Zones read
+   from zoneinfo files have a transition table instead, and are passed
+   to tzif_offset.
 
    EXCEPTIONS 
 
@@ -1179,21 +1515,17 @@ static int get_offset( TIME_DATE_STRUCT tstruc, int in_local_time,
   if( !tzone || !offset || !is_daylight )
     return 0;
 
+  /* zones read from zoneinfo files have a table of transitions */
+  if( tzone->trans )
+    return( tzif_offset( tzone->trans, &tstruc, in_local_time, 
+			 offset, is_daylight ));
+
   /* set the offset to non-daylight value */
   *offset = tzone->offset;
   *is_daylight = 0;
 
-  /* march through the time zone rules until we find the right year */
-  cur_rule = tzone->rule;
-  while( cur_rule )
-  {
-    if((( cur_rule->yearto == -1 ) || 
-	( cur_rule->yearto >= tstruc.year )) &&
-       (( cur_rule->yearfrom == -1 ) || 
-	( cur_rule->yearfrom <= tstruc.year )))
-      break;
-    cur_rule = cur_rule->prev_rule;
-  }
+  /* find the time zone rule for the year */
+  cur_rule = zone_rule_for_year( tzone, tstruc.year );
 
   if( !cur_rule ) /* didn't find one, so just return regular offset */
     return 1;
@@ -1439,3 +1771,28 @@ static int julian_from_tzcode( TZONE_CODE code, Sint month, Sint day,
   }
 }
 
+/* whether local milliseconds after midnight ms are within width 
+   seconds after start seconds after midnight, modulo a day */
+
+static int time_in_window( Sint ms, Sint start, Sint width )
+{
+  long long diff;
+
+  if( width <= 0 )
+    return 0;
+  diff = ((long long) ms - 1000LL * start ) % MS_PER_DAY;
+  if( diff < 0 )
+    diff += MS_PER_DAY;
+  return( diff < 1000LL * width );
+}
+
+/* the daylight savings seconds a rule is in on January 1, which it has
+   if its daylight time runs over the new year */
+
+static Sint rule_new_year_extra( const TZONE_RULE_STRUCT *rule )
+{
+  if( !rule || !rule->hasdaylight || 
+      ( rule->monthstart <= rule->monthend ))
+    return 0;
+  return( rule->dsextra );
+}
@@ -46,6 +46,24 @@ int find_zone_info( const char *name, SEXP zone_list,
 int GMT_to_zone( TIME_DATE_STRUCT *tstruc, TZONE_STRUCT *tzone );
 int GMT_from_zone( TIME_DATE_STRUCT *tstruc, TZONE_STRUCT *tzone );
 
+/* the same conversions between GMT julian days and milliseconds and a
+   local time structure, without a second date conversion for zones 
+   that are a constant offset from GMT */
+int zone_is_fixed( const TZONE_STRUCT *tzone );
+int zone_skips_time( TZONE_STRUCT *tzone, Sint ms );
+int jms_to_zone( Sint julian, Sint ms, TZONE_STRUCT *tzone,
+		 TIME_DATE_STRUCT *tstruc );
+int jms_from_zone( TIME_DATE_STRUCT *tstruc, TZONE_STRUCT *tzone,
+		   Sint *julian, Sint *ms );
+
+/* the interval of GMT milliseconds since 1960 around a time in which a
+   zone's offset does not change, for wall clock arithmetic; unbounded
+   ends are ZONE_SEGMENT_MIN and ZONE_SEGMENT_MAX */
+#define ZONE_SEGMENT_MAX ((int64_t) 1 << 62)
+#define ZONE_SEGMENT_MIN ( - ZONE_SEGMENT_MAX )
+int zone_segment( TZONE_STRUCT *tzone, int64_t gmt, int64_t *start,
+		  int64_t *end, Sint *offset );
+
 /* function to find the time zone from the time zone list */
 TZONE_STRUCT *find_zone( const char *name, SEXP zone_list );
 
@@ -18,17 +18,43 @@
 
 #include "timeUtils.h"
 #include "zoneObj.h"
+#include "zoneTZif.h"
 
 #include "sptd_utils.h"
+#include <stdlib.h>
+#include <string.h>
 
 /* definitions needed for time zone classes */
 
 static SEXP name_slot;
 static SEXP offset_slot;
 static SEXP rules_slot;
+static SEXP dir_slot;
 
 static int zone_initialized = 0;
 static int r_zone_to_struct( SEXP obj, void **ret_struct );
+static int zone_no_rules( Sint offset, void **ret_struct );
+static TZONE_STRUCT *zone_cache_find( Sint offset, Sint nrules, 
+				      Sint **cols );
+static TZONE_STRUCT *zone_compile( Sint offset, Sint nrules, Sint **cols );
+static TZONE_RULE_STRUCT *rule_walk( TZONE_RULE_STRUCT *rule, Sint year );
+static int zone_code( Sint code, TZONE_CODE *ret );
+static int compare_sint( const void *a, const void *b );
+
+/* compiled R time zones, kept for the session and matched by their
+   offset and rule columns */
+
+typedef struct zone_cache_struct
+{
+  Sint *key;
+  TZONE_STRUCT zone;
+  struct zone_cache_struct *next;
+} ZONE_CACHE;
+
+#define ZONE_CACHE_MAX 256
+
+static ZONE_CACHE *zone_cache = NULL;
+static int zone_cache_count = 0;
 
 /**********************************************************************
  * R-DOCUMENTATION ************************************************
@@ -63,6 +89,7 @@ static void zone_init(void)
   name_slot = install("name");
   offset_slot = install("offset");
   rules_slot = install("rules");
+  dir_slot = install("dir");
 }
 
 /**********************************************************************
@@ -89,6 +116,8 @@ static void zone_init(void)
    object (as determined by checkClass), it sets is_R to 1 and 
    converts the offset and rules information into a time zone
    struct by calling r_zone_to_struct, and returns a pointer to it.
+   If it is a zoneinfo file time zone object, it sets is_R to 1 and
+   returns the zone struct read by tzif_zone.
    If zone_init has not been called, it is called.
 
    EXCEPTIONS 
@@ -107,6 +136,10 @@ int find_zone_info( const char *name, SEXP zone_list, void **zone_info,
   static const char *classes[] = {
     C_ZONE_CLASS_NAME
   };
+  static const char *tzif_classes[] = {
+    TZIF_ZONE_CLASS_NAME
+  };
+  SEXP tmp_dir;
 
   if( !zone_initialized )
     zone_init();
@@ -125,6 +158,20 @@ int find_zone_info( const char *name, SEXP zone_list, void **zone_info,
 
   ctype = checkClass( tmp_data, classes, 1L );
 
+  /* zoneinfo file zones are returned as zone structs, like R ones */
+  if( !ctype && checkClass( tmp_data, tzif_classes, 1L ))
+  {
+    *is_R = 1;
+    tmp_dir = GET_SLOT( tmp_data, dir_slot );
+    tmp_data = GET_SLOT( tmp_data, name_slot );
+    if( !isString(tmp_data) || length(tmp_data) < 1 ||
+	!isString(tmp_dir) || length(tmp_dir) < 1 )
+      return 0;
+    *zone_info = (void *) tzif_zone( CHAR(STRING_ELT(tmp_dir, 0)),
+				     CHAR(STRING_ELT(tmp_data, 0)));
+    return( *zone_info != NULL );
+  }
+
   /* see if it's an R or C time zone */
   if( !ctype )
   {
@@ -150,6 +197,99 @@ int find_zone_info( const char *name, SEXP zone_list, void **zone_info,
 }
 
 
+/**********************************************************************
+ * R-DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME zone_rule_for_year
+
+   DESCRIPTION  Find the daylight savings rule of a time zone in effect
+   in a given year.
+
+   ARGUMENTS
+      IARG  tzone   The time zone struct
+      IARG  year    The year
+
+   RETURN Returns the rule, or NULL if no rule covers the year.
+
+   ALGORITHM If the zone has a rule index, the year is looked up in its
+   direct table, or else by binary search of its year segments.
+   Otherwise the rules are walked from the most recent one back, through
+   the prev_rule pointers, until one covers the year.
+
+   EXCEPTIONS 
+
+   NOTE See also: get_offset, r_zone_to_struct
+
+**********************************************************************/
+TZONE_RULE_STRUCT *zone_rule_for_year( const TZONE_STRUCT *tzone, 
+				       Sint year )
+{
+  const TZONE_RULE_INDEX *idx;
+  Sint lo, hi, mid;
+
+  if( !tzone )
+    return NULL;
+  if( !( idx = tzone->index ))
+    return( rule_walk( tzone->rule, year ));
+
+  if( year >= idx->year0 && year - idx->year0 < idx->nyears )
+    return( idx->by_year[ year - idx->year0 ] );
+
+  /* last segment starting on or before the year */
+  lo = 0;
+  hi = idx->nseg - 1;
+  while( lo < hi )
+  {
+    mid = lo + ( hi - lo + 1 ) / 2;
+    if( idx->seg_start[mid] <= year )
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return( idx->seg_rule[lo] );
+}
+
+/**********************************************************************
+ * R-DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME zone_is_kept
+
+   DESCRIPTION  Find whether a time zone struct is kept for the session,
+   so that its address identifies the zone in later calls.
+
+   ARGUMENTS
+      IARG  tzone   The time zone struct
+
+   RETURN Returns 1 if the struct is kept, 0 if it was allocated for
+   this call only.
+
+   ALGORITHM Built-in zones and zones read from files have no rule
+   index, and are kept.  R zones with rules are compiled with an
+   index, and are kept only if they are in the cache of compiled
+   zones.  Zones with neither rules nor transitions are reported as
+   not kept, since R zones without rules are allocated for each call;
+   they are only their offset, so callers can compare that instead.
+
+   EXCEPTIONS 
+
+   NOTE See also: r_zone_to_struct
+
+**********************************************************************/
+int zone_is_kept( const TZONE_STRUCT *tzone )
+{
+  ZONE_CACHE *entry;
+
+  if( !tzone )
+    return 0;
+  if( !tzone->index )
+    return( tzone->rule || tzone->trans );
+
+  for( entry = zone_cache; entry; entry = entry->next )
+    if( &(entry->zone) == tzone )
+      return 1;
+  return 0;
+}
+
 /**********************************************************************
  * R-DOCUMENTATION ************************************************
  **********************************************************************
@@ -165,9 +305,11 @@ int find_zone_info( const char *name, SEXP zone_list, void **zone_info,
    RETURN Returns 1/0 for success/failure.
 
    ALGORITHM This function extracts the offset and daylight savings
-   rules from an R time zone object and puts it into a new C
-   time zone struct, and returns in in ret_struct.  
-   The structure is allocated with Salloc.
+   rules from an R time zone object.  If a zone with the same offset
+   and rules has been compiled before, the cached struct is returned
+   in ret_struct.  Otherwise zone_compile puts the rules into a new C
+   time zone struct, with a rule index, and adds it to the cache.
+   A zone without rules is allocated with R_alloc.
    If zone_init has not been called, it is called.
 
    EXCEPTIONS 
@@ -178,13 +320,9 @@ int find_zone_info( const char *name, SEXP zone_list, void **zone_info,
 static int r_zone_to_struct( SEXP obj, void **ret_struct )
 {
   TZONE_STRUCT *tz;
-  TZONE_RULE_STRUCT *prev_rule, *this_rule;
-
   SEXP sptr, sptr2;
-  Sint *dataptr, *yearfroms, *yeartos, *hasdaylights, *dsextras,
-    *monthstarts, *codestarts, *daystarts, *xdaystarts, *timestarts,
-    *monthends, *codeends, *dayends, *xdayends, *timeends;
-  Sint len, tmplen, i;
+  Sint *dataptr, *cols[14];
+  Sint len, i;
   static const char *classes[] = {
     R_ZONE_CLASS_NAME    
   };
@@ -196,13 +334,6 @@ static int r_zone_to_struct( SEXP obj, void **ret_struct )
       !checkClass( obj, classes, 1L ))
     return 0;
 
-  /* allocate a time zone struct */
-
-  tz = (TZONE_STRUCT *) R_alloc( 1L, sizeof(TZONE_STRUCT) );
-  if( !tz )
-    return 0;
-  *ret_struct = (void *) tz;
-
   /* extract the offset */
   /* don't need to protect since its constrained in class def */
   sptr = GET_SLOT( obj, offset_slot);
@@ -210,8 +341,6 @@ static int r_zone_to_struct( SEXP obj, void **ret_struct )
       !(dataptr = INTEGER(sptr)))
     return 0;
 
-  tz->offset = dataptr[0];
-
   /* extract the rules */
 
   sptr2 = GET_SLOT( obj, rules_slot);
@@ -221,10 +350,8 @@ static int r_zone_to_struct( SEXP obj, void **ret_struct )
   len = length(sptr2);
   /* see if it's empty -- i.e. no daylight time */
   if( len == 0 )
-  {
-    tz->rule = NULL;
-    return 1;
-  } 
+    return( zone_no_rules( dataptr[0], ret_struct ));
+
   /* sptr2 should be a data.frame */
   #if defined(R_VERSION) && R_VERSION >= R_Version(4, 5, 0)
   if(!Rf_isDataFrame( sptr2 ))
@@ -234,105 +361,275 @@ static int r_zone_to_struct( SEXP obj, void **ret_struct )
     return 0;
   #endif
   
-  /* extract the data */
+  /* extract the data, in the order of the columns: yearfrom, yearto,
+     hasdaylight, dsextra, monthstart, codestart, daystart, xdaystart,
+     timestart, monthend, codeend, dayend, xdayend, timeend */
   if( len != 14 )
     return 0;
 
-  yearfroms = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 0) ) ));
-  yeartos = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 1) ) ));
-  hasdaylights = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 2) ) ));
-  dsextras = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 3) ) ));
-  monthstarts = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 4) ) ));
-  codestarts = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 5) ) ));
-  daystarts = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 6) ) ));
-  xdaystarts = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 7) ) ));
-  timestarts = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 8) ) ));
-  monthends = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 9) ) ));
-  codeends = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 10) ) ));
-  dayends = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 11) ) ));
-  xdayends = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 12) ) ));
-  timeends = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, 13) ) ));
-
-  if( !yearfroms || !yeartos || !hasdaylights || !dsextras || !monthstarts ||
-      !codestarts || !daystarts|| !xdaystarts || !timestarts || !monthends ||
-      !codeends || !dayends || !xdayends || !timeends){
-    UNPROTECT(14);
-    return 0;
-  }
+  for( i = 0; i < 14; i++ )
+    cols[i] = INTEGER( PROTECT( (SEXP) AS_INTEGER( VECTOR_ELT( sptr2, i ))));
+
+  for( i = 0; i < 14; i++ )
+    if( !cols[i] ){
+      UNPROTECT(14);
+      return 0;
+    }
 
   len = length(VECTOR_ELT(sptr2, 0));
 
   if( len == 0 )
   {
-    tz->rule = NULL;
     UNPROTECT(14);
-    return 1;
+    return( zone_no_rules( dataptr[0], ret_struct ));
   }
 
-  /* read the rules into rules structs */
+  /* use the compiled zone from the cache, or compile it */
+
+  if( !( tz = zone_cache_find( dataptr[0], len, cols )))
+    tz = zone_compile( dataptr[0], len, cols );
 
-  prev_rule = NULL;
+  UNPROTECT(14);
+  if( !tz )
+    return 0;
+
+  *ret_struct = (void *) tz;
+  return 1;
+}
 
-  for( i = 0; i < len; i++ )
+/* a zone with no daylight savings rules */
+
+static int zone_no_rules( Sint offset, void **ret_struct )
+{
+  TZONE_STRUCT *tz;
+
+  tz = (TZONE_STRUCT *) R_alloc( 1L, sizeof(TZONE_STRUCT) );
+  if( !tz )
+    return 0;
+
+  tz->offset = offset;
+  tz->rule = NULL;
+  tz->trans = NULL;
+  tz->index = NULL;
+  *ret_struct = (void *) tz;
+  return 1;
+}
+
+/* find a compiled zone with the same offset and rule columns */
+
+static TZONE_STRUCT *zone_cache_find( Sint offset, Sint nrules, 
+				      Sint **cols )
+{
+  ZONE_CACHE *entry;
+  int i;
+
+  for( entry = zone_cache; entry; entry = entry->next )
+  {
+    if( entry->key[0] != offset || entry->key[1] != nrules )
+      continue;
+    for( i = 0; i < 14; i++ )
+      if( memcmp( entry->key + 2 + i * nrules, cols[i], 
+		  nrules * sizeof(Sint) ))
+	break;
+    if( i == 14 )
+      return &(entry->zone);
+  }
+  return NULL;
+}
+
+/**********************************************************************
+ * R-DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME zone_compile
+
+   DESCRIPTION  Compile the rule columns of an R time zone into a time
+   zone struct with a rule index.
+
+   ARGUMENTS
+      IARG  offset   Offset from GMT in seconds
+      IARG  nrules   Number of rules
+      IARG  cols     The 14 rule columns
+
+   RETURN Returns the time zone struct, or NULL if the rules are 
+   invalid.
+
+   ALGORITHM The rules are put into one contiguous array, in their
+   order, each with prev_rule pointing to the one before.  The years
+   where the rule in effect can change (each yearfrom, and the year
+   after each yearto) are sorted, and the rule for each segment between
+   them is found with rule_walk.  If the segments span no more than
+   TZONE_INDEX_MAX_YEARS years, a direct table by year is filled in as
+   well.  Everything is in one block, allocated with malloc and kept in
+   the cache, along with a copy of the columns to match against, or
+   with R_alloc if the cache is full.
+
+   EXCEPTIONS 
+
+   NOTE See also: r_zone_to_struct, zone_rule_for_year
+
+**********************************************************************/
+static TZONE_STRUCT *zone_compile( Sint offset, Sint nrules, Sint **cols )
+{
+  ZONE_CACHE *entry;
+  TZONE_STRUCT *tz;
+  TZONE_RULE_STRUCT *rules;
+  TZONE_RULE_INDEX *idx;
+  Sint *bounds, nb, nyears, i, k, y;
+  size_t size, off_rules, off_idx, off_start, off_segrule, off_year, 
+    off_key;
+  char *block;
+  int heap;
+
+  /* the years the rule can change in */
+  bounds = (Sint *) R_alloc( 2 * nrules, sizeof(Sint) );
+  nb = 0;
+  for( i = 0; i < nrules; i++ )
+  {
+    if( cols[0][i] != -1 )
+      bounds[nb++] = cols[0][i];
+    if( cols[1][i] != -1 )
+      bounds[nb++] = cols[1][i] + 1;
+  }
+  qsort( bounds, nb, sizeof(Sint), compare_sint );
+  for( i = k = 0; i < nb; i++ )
+    if( !k || bounds[i] != bounds[k-1] )
+      bounds[k++] = bounds[i];
+  nb = k;
+
+  nyears = 0;
+  if( nb > 1 && bounds[nb-1] - bounds[0] <= TZONE_INDEX_MAX_YEARS )
+    nyears = bounds[nb-1] - bounds[0];
+
+  /* lay out the block */
+  heap = ( zone_cache_count < ZONE_CACHE_MAX );
+#define ZONE_ALIGN(x) ((( x ) + 7 ) & ~((size_t) 7 ))
+  off_rules = ZONE_ALIGN( sizeof(ZONE_CACHE) );
+  off_idx = off_rules + ZONE_ALIGN( nrules * sizeof(TZONE_RULE_STRUCT) );
+  off_start = off_idx + ZONE_ALIGN( sizeof(TZONE_RULE_INDEX) );
+  off_segrule = off_start + ZONE_ALIGN( ( nb + 1 ) * sizeof(Sint) );
+  off_year = off_segrule + 
+    ZONE_ALIGN( ( nb + 1 ) * sizeof(TZONE_RULE_STRUCT *) );
+  off_key = off_year + ZONE_ALIGN( nyears * sizeof(TZONE_RULE_STRUCT *) );
+  size = off_key + ( heap ? ( 2 + 14 * (size_t) nrules ) * sizeof(Sint) : 0 );
+#undef ZONE_ALIGN
+
+  block = heap ? (char *) malloc( size ) : (char *) R_alloc( size, 1 );
+  if( !block )
+    return NULL;
+
+  entry = (ZONE_CACHE *) block;
+  rules = (TZONE_RULE_STRUCT *) ( block + off_rules );
+  idx = (TZONE_RULE_INDEX *) ( block + off_idx );
+  tz = &(entry->zone);
+
+  /* the rules, oldest first */
+  for( i = 0; i < nrules; i++ )
   {
-    this_rule = (TZONE_RULE_STRUCT *) R_alloc( 1, sizeof(TZONE_RULE_STRUCT) );
-    this_rule->prev_rule = prev_rule;
-    prev_rule = this_rule;
-
-    this_rule->yearfrom =  yearfroms[i];
-    this_rule->yearto =  yeartos[i];
-    this_rule->hasdaylight =  hasdaylights[i];
-    this_rule->dsextra = dsextras[i];
-    this_rule->monthstart =  monthstarts[i];
-    this_rule->daystart =  daystarts[i];
-    this_rule->xdaystart =  xdaystarts[i];
-    this_rule->timestart = timestarts[i];
-    this_rule->monthend =  monthends[i];
-    this_rule->dayend =  dayends[i];
-    this_rule->xdayend =  xdayends[i];
-    this_rule->timeend = timeends[i];
-
-    switch( codestarts[i] )
+    rules[i].prev_rule = i ? &(rules[i-1]) : NULL;
+    rules[i].yearfrom = cols[0][i];
+    rules[i].yearto = cols[1][i];
+    rules[i].hasdaylight = cols[2][i];
+    rules[i].dsextra = cols[3][i];
+    rules[i].monthstart = cols[4][i];
+    rules[i].daystart = cols[6][i];
+    rules[i].xdaystart = cols[7][i];
+    rules[i].timestart = cols[8][i];
+    rules[i].monthend = cols[9][i];
+    rules[i].dayend = cols[11][i];
+    rules[i].xdayend = cols[12][i];
+    rules[i].timeend = cols[13][i];
+
+    if( !zone_code( cols[5][i], &(rules[i].codestart )) ||
+	!zone_code( cols[10][i], &(rules[i].codeend )))
     {
-    case 1:
-      this_rule->codestart = CODE_MONTHDAY;
-      break;
-    case 2:
-      this_rule->codestart = CODE_LAST_WEEKDAY;
-      break;
-    case 3:
-      this_rule->codestart = CODE_WEEKDAY_GE;
-      break;
-    case 4:
-      this_rule->codestart = CODE_WEEKDAY_LE;
-      break;
-    default:
-      UNPROTECT(14); 
-      return 0;
+      if( heap )
+	free( block );
+      return NULL;
     }
+  }
 
-    switch( codeends[i] )
-    {
-    case 1:
-      this_rule->codeend = CODE_MONTHDAY;
-      break;
-    case 2:
-      this_rule->codeend = CODE_LAST_WEEKDAY;
-      break;
-    case 3:
-      this_rule->codeend = CODE_WEEKDAY_GE;
-      break;
-    case 4:
-      this_rule->codeend = CODE_WEEKDAY_LE;
+  tz->offset = offset;
+  tz->rule = &(rules[nrules - 1]);
+  tz->trans = NULL;
+  tz->index = idx;
+
+  /* the rule in each segment, and each year of the direct table */
+  idx->nseg = nb + 1;
+  idx->seg_start = (Sint *) ( block + off_start );
+  idx->seg_rule = (TZONE_RULE_STRUCT **) ( block + off_segrule );
+  idx->seg_start[0] = 0;
+  idx->seg_rule[0] = rule_walk( tz->rule, nb ? bounds[0] - 1 : 0 );
+  for( k = 1; k <= nb; k++ )
+  {
+    idx->seg_start[k] = bounds[k-1];
+    idx->seg_rule[k] = rule_walk( tz->rule, bounds[k-1] );
+  }
+
+  idx->year0 = nb ? bounds[0] : 0;
+  idx->nyears = nyears;
+  idx->by_year = (TZONE_RULE_STRUCT **) ( block + off_year );
+  for( k = 1, y = 0; y < nyears; y++ )
+  {
+    if( k < nb && idx->year0 + y >= bounds[k] )
+      k++;
+    idx->by_year[y] = idx->seg_rule[k];
+  }
+
+  if( !heap )
+    return tz;
+
+  /* keep it, with the columns to match */
+  entry->key = (Sint *) ( block + off_key );
+  entry->key[0] = offset;
+  entry->key[1] = nrules;
+  for( i = 0; i < 14; i++ )
+    memcpy( entry->key + 2 + i * nrules, cols[i], nrules * sizeof(Sint) );
+  entry->next = zone_cache;
+  zone_cache = entry;
+  zone_cache_count++;
+  return tz;
+}
+
+/* the rule in effect in a year, walking back from the most recent */
+
+static TZONE_RULE_STRUCT *rule_walk( TZONE_RULE_STRUCT *rule, Sint year )
+{
+  while( rule )
+  {
+    if((( rule->yearto == -1 ) || ( rule->yearto >= year )) &&
+       (( rule->yearfrom == -1 ) || ( rule->yearfrom <= year )))
       break;
-    default: 
-      UNPROTECT(14);
-      return 0;
-    }
+    rule = rule->prev_rule;
   }
+  return rule;
+}
 
-  tz->rule = this_rule;
-  UNPROTECT(14);
-  return 1;
-  
+/* convert a rule code from the R rules data frame */
+
+static int zone_code( Sint code, TZONE_CODE *ret )
+{
+  switch( code )
+  {
+  case 1:
+    *ret = CODE_MONTHDAY;
+    return 1;
+  case 2:
+    *ret = CODE_LAST_WEEKDAY;
+    return 1;
+  case 3:
+    *ret = CODE_WEEKDAY_GE;
+    return 1;
+  case 4:
+    *ret = CODE_WEEKDAY_LE;
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static int compare_sint( const void *a, const void *b )
+{
+  Sint x = *(const Sint *) a, y = *(const Sint *) b;
+
+  return(( x > y ) - ( x < y ));
 }
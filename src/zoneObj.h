@@ -29,6 +29,7 @@
 #define TIMELIB_ZONEOBJ_H
 
 #include "timeUtils.h"
+#include <stdint.h>
 
 /**********************************************************************
  * R-DOCUMENTATION ************************************************
@@ -124,6 +125,89 @@ typedef struct tzone_rule
 } TZONE_RULE_STRUCT;
 
 
+/**********************************************************************
+ * R-DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME TZONE_RULE_INDEX
+
+   TYPE  typedef
+
+   DESCRIPTION  This structure finds the daylight savings rule in effect
+   in a year without walking the rule list.
+
+   ARGUMENTS
+   IARG  nseg       number of year segments with the same rule
+   IARG  seg_start  first year of each segment; the first segment starts
+                    at the beginning of time, so seg_start[0] is unused
+   IARG  seg_rule   rule in effect in each segment, or NULL
+   IARG  year0      first year of the direct table
+   IARG  nyears     number of years in the direct table, 0 if none
+   IARG  by_year    rule in effect in each year of the direct table
+
+   RETURN 
+
+   ALGORITHM 
+
+   EXCEPTIONS 
+
+   NOTE The segments begin at each yearfrom and after each yearto of the
+   rules.  The direct table covers the years from the first to the last
+   of these, if there are not too many; other years are found by binary
+   search of the segments.
+
+**********************************************************************/
+typedef struct tzone_rule_index
+{
+  Sint nseg;
+  Sint *seg_start;
+  TZONE_RULE_STRUCT **seg_rule;
+  Sint year0;
+  Sint nyears;
+  TZONE_RULE_STRUCT **by_year;
+} TZONE_RULE_INDEX;
+
+/* longest span of years given a direct table in TZONE_RULE_INDEX */
+#define TZONE_INDEX_MAX_YEARS 1024
+
+/**********************************************************************
+ * R-DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME TZONE_TRANS_STRUCT
+
+   TYPE  typedef
+
+   DESCRIPTION  This structure holds a table of the times at which a
+   time zone's offset from GMT changes, as read from a compiled
+   zoneinfo (TZif) file.
+
+   ARGUMENTS
+   IARG  count       number of transitions
+   IARG  times       GMT seconds since 1970 of each transition, increasing
+   IARG  offsets     seconds offset from GMT from each transition on
+   IARG  daylight    1/0 for daylight/standard time from each transition on
+   IARG  offset0     seconds offset from GMT before the first transition
+   IARG  daylight0   1/0 for daylight/standard time before the first one
+
+   RETURN 
+
+   ALGORITHM 
+
+   EXCEPTIONS 
+
+   NOTE The table is extended past the last transition in the file using
+   the file's POSIX TZ string, through the end of 2199.
+
+**********************************************************************/
+typedef struct tzone_trans
+{
+  Sint count;
+  int64_t *times;
+  Sint *offsets;
+  unsigned char *daylight;
+  Sint offset0;
+  int daylight0;
+} TZONE_TRANS_STRUCT;
+
 /**********************************************************************
  * R-DOCUMENTATION ************************************************
  **********************************************************************
@@ -136,6 +220,10 @@ typedef struct tzone_rule
    ARGUMENTS
    IARG  offset   seconds offset from GMT without daylight time
    IARG  rule     daylight savings rule for most recent time, NULL if none.
+   IARG  trans    transition table, NULL if none.  If present, it is used
+                  in place of offset and rule.
+   IARG  index    index of rule by year, NULL if none.  If present, it is
+                  used in place of walking the rule list.
 
    RETURN 
 
@@ -150,11 +238,16 @@ typedef struct tzone_struct
 {
   Sint offset;
   TZONE_RULE_STRUCT *rule;
+  TZONE_TRANS_STRUCT *trans;
+  TZONE_RULE_INDEX *index;
 } TZONE_STRUCT;
 
 
 int find_zone_info( const char *name, SEXP zone_list, void **zone_info, 
 		    int *is_R );
+TZONE_RULE_STRUCT *zone_rule_for_year( const TZONE_STRUCT *tzone, 
+				       Sint year );
+int zone_is_kept( const TZONE_STRUCT *tzone );
 
 /* internal functions */
 static void zone_init(void);
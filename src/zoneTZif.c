@@ -0,0 +1,746 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ *
+ * It contains C code utility functions for time zones read from
+ * compiled zoneinfo (TZif) files, such as the ones the system keeps
+ * in /usr/share/zoneinfo.  See zoneTZif.h for what is supported.
+ *
+ * A zone is read once, from a memory-mapped file, into a table of
+ * transition times (see TZONE_TRANS_STRUCT in zoneObj.h), which is
+ * kept for the rest of the session.  get_offset in zoneFuns.c looks
+ * up offsets in the table with tzif_offset.
+ *
+ * The exported functions here were written to be called with the
+ * .Call interface of R.  They include (see documentation below):
+  SEXP tzif_zone_info( SEXP dir, SEXP name );
+*************************************************************************/
+
+#include "zoneTZif.h"
+
+#include <ctype.h>
+#include <limits.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <stdio.h>
+#endif
+
+/* a zone that has been read, by path */
+
+typedef struct tzif_cache_struct
+{
+  char *path;
+  TZONE_STRUCT zone;
+  TZONE_TRANS_STRUCT trans;
+  struct tzif_cache_struct *next;
+} TZIF_CACHE;
+
+static TZIF_CACHE *tzif_cache = NULL;
+
+/* one end of daylight time in a POSIX TZ string: 'J' for a day 1-365
+   not counting February 29, 'N' for a day 0-365 counting it, or 'M'
+   for the week (1-5, 5 for last) and weekday of a month */
+
+typedef struct tzif_posix_rule_struct
+{
+  char kind;
+  Sint month;
+  Sint week;
+  Sint wkday;
+  Sint day;
+  Sint secs;
+} TZIF_POSIX_RULE;
+
+typedef struct tzif_posix_struct
+{
+  Sint std_offset;
+  Sint dst_offset;
+  int has_dst;
+  TZIF_POSIX_RULE start;
+  TZIF_POSIX_RULE end;
+} TZIF_POSIX;
+
+static int tzif_read( const char *path, TZONE_TRANS_STRUCT *trans,
+		      Sint *std_offset );
+static int tzif_parse( const unsigned char *p, size_t len,
+		       TZONE_TRANS_STRUCT *trans, Sint *std_offset );
+static int tzif_extend( TZONE_TRANS_STRUCT *trans, const TZIF_POSIX *tz );
+static int posix_parse( const char *s, const char *end, TZIF_POSIX *tz );
+static const char *posix_name( const char *s, const char *end );
+static const char *posix_hms( const char *s, const char *end, Sint *secs );
+static const char *posix_rule( const char *s, const char *end,
+			       TZIF_POSIX_RULE *rule );
+static int posix_when( const TZIF_POSIX_RULE *rule, Sint year,
+		       Sint offset, int64_t *secs );
+static int64_t tzif_get_be( const unsigned char *p, int nbytes );
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME tzif_zone
+
+   DESCRIPTION  Return the time zone read from a compiled zoneinfo file.
+
+   ARGUMENTS
+      IARG  dir    directory of zoneinfo files, or NULL for the default
+      IARG  name   zone name, such as "America/New_York"
+
+   RETURN Returns a pointer to the time zone, or NULL if the file could
+   not be read.
+
+   ALGORITHM The zones already read are searched by path.  Otherwise the
+   file is read with tzif_read, and the zone is added to the cache.  The
+   zone's offset is the standard time offset in effect at the end of the
+   file, and its rule is NULL, as the transition table is used for all
+   lookups.
+
+   EXCEPTIONS
+
+   NOTE The cached zones are never freed.  Names containing ".." are
+   refused, so that only files under dir can be read.
+   \\
+   \\
+   See also: find_zone, tzif_offset
+
+**********************************************************************/
+TZONE_STRUCT *tzif_zone( const char *dir, const char *name )
+{
+  TZIF_CACHE *entry;
+  size_t dlen, nlen;
+  char *path;
+
+  if( !name || !*name || strstr( name, ".." ))
+    return NULL;
+  if( !dir || !*dir )
+    dir = TZIF_DEFAULT_DIR;
+
+  dlen = strlen( dir );
+  nlen = strlen( name );
+  if( !( path = (char *) malloc( dlen + nlen + 2 )))
+    return NULL;
+  memcpy( path, dir, dlen );
+  path[dlen] = '/';
+  memcpy( path + dlen + 1, name, nlen + 1 );
+
+  for( entry = tzif_cache; entry; entry = entry->next )
+    if( !strcmp( entry->path, path ))
+    {
+      free( path );
+      return &(entry->zone);
+    }
+
+  if( !( entry = (TZIF_CACHE *) calloc( 1, sizeof( TZIF_CACHE ))))
+  {
+    free( path );
+    return NULL;
+  }
+  if( !tzif_read( path, &(entry->trans), &(entry->zone.offset) ))
+  {
+    free( path );
+    free( entry );
+    return NULL;
+  }
+
+  entry->path = path;
+  entry->zone.rule = NULL;
+  entry->zone.trans = &(entry->trans);
+  entry->next = tzif_cache;
+  tzif_cache = entry;
+  return &(entry->zone);
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME tzif_offset
+
+   DESCRIPTION  Find the offset from GMT to local time in a zone with a
+   transition table, in seconds.
+
+   ARGUMENTS
+      IARG  trans          transition table of the zone
+      IARG  tstruc         structure giving input time/date
+      IARG  in_local_time  1 if tstruc is in local time, 0 if in GMT
+      OARG  offset         seconds offset from GMT to local time
+      OARG  is_daylight    1/0 for in/out of daylight time
+
+   RETURN Returns 1/0 for success/failure.
+
+   ALGORITHM For a GMT time, the last transition at or before the time
+   is found by binary search with tzif_find.  For a local time, the
+   offsets in effect a day before and a day after are each tried: an
+   offset is valid if subtracting it gives a GMT time with that offset.
+   If both are valid, the time is ambiguous, and the daylight member of
+   tstruc picks the earlier time (1) or the later one (0).  If neither
+   is, the time is in a gap, and the later offset is used, as get_offset
+   does with daylight rules.
+
+   EXCEPTIONS
+
+   NOTE This assumes there are not two transitions within a day of each
+   other.
+   \\
+   \\
+   See also: get_offset, tzif_zone
+
+**********************************************************************/
+int tzif_offset( const TZONE_TRANS_STRUCT *trans,
+		 const TIME_DATE_STRUCT *tstruc, int in_local_time,
+		 Sint *offset, int *is_daylight )
+{
+  Sint jul, ms, ia, ib, ja, jb, oa, ob, pick;
+  int64_t secs;
+
+  if( !trans || !tstruc || !offset || !is_daylight ||
+      !julian_from_mdy( *tstruc, &jul ) || !ms_from_hms( *tstruc, &ms ))
+    return 0;
+
+  secs = ( (int64_t) jul - UNIX_EPOCH_JULIAN ) * ( MS_PER_DAY / 1000 ) +
+    ms / 1000;
+
+#define TRANS_OFFSET(i) (( i ) < 0 ? trans->offset0 : trans->offsets[i] )
+
+  if( !in_local_time )
+    pick = tzif_find( trans, secs );
+  else
+  {
+    ia = tzif_find( trans, secs - MS_PER_DAY / 1000 );
+    ib = tzif_find( trans, secs + MS_PER_DAY / 1000 );
+    oa = TRANS_OFFSET( ia );
+    ob = TRANS_OFFSET( ib );
+
+    ja = tzif_find( trans, secs - oa );
+    jb = tzif_find( trans, secs - ob );
+
+    if( TRANS_OFFSET( ja ) == oa && TRANS_OFFSET( jb ) == ob )
+      pick = tstruc->daylight ? ja : jb;
+    else if( TRANS_OFFSET( ja ) == oa )
+      pick = ja;
+    else if( TRANS_OFFSET( jb ) == ob )
+      pick = jb;
+    else
+      pick = ib;
+  }
+
+  *offset = TRANS_OFFSET( pick );
+  *is_daylight = ( pick < 0 ) ? trans->daylight0 : trans->daylight[pick];
+
+#undef TRANS_OFFSET
+
+  return 1;
+}
+
+/**********************************************************************
+ * C Code Documentation ************************************************
+ **********************************************************************
+   NAME tzif_find
+
+   DESCRIPTION  Find the transition in effect at a GMT time.
+
+   ARGUMENTS
+      IARG  trans  transition table of the zone
+      IARG  secs   GMT seconds since 1970
+
+   RETURN Returns the index of the last transition at or before secs,
+   or -1 if there is none.
+
+   ALGORITHM Binary search of the transition times.
+
+   EXCEPTIONS
+
+   NOTE See also: tzif_offset, date_floor_unit
+
+**********************************************************************/
+Sint tzif_find( const TZONE_TRANS_STRUCT *trans, int64_t secs )
+{
+  Sint lo = 0, hi = trans->count, mid;
+
+  while( lo < hi )
+  {
+    mid = lo + ( hi - lo ) / 2;
+    if( trans->times[mid] <= secs )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return( lo - 1 );
+}
+
+/**********************************************************************
+ * R-C  DOCUMENTATION ************************************************
+ **********************************************************************
+   NAME tzif_zone_info
+
+   DESCRIPTION  Read a compiled zoneinfo file, and describe the zone.
+   To be called from R as
+   \\
+   {\tt
+   .Call("tzif_zone_info", dir, name)
+   }
+
+   ARGUMENTS
+      IARG  dir   Directory of zoneinfo files, character of length 1
+      IARG  name  Zone name, character of length 1
+
+   RETURN Returns NULL if the file could not be read.  Otherwise returns
+   a list with components offset, the standard time offset in seconds
+   at the end of the file, and transitions, the number of transitions
+   in the table, including those made from the POSIX TZ string.
+
+   ALGORITHM The zone is found with tzif_zone, so it is read into the
+   cache if it has not been already.
+
+   EXCEPTIONS
+
+   NOTE See also: tzif_zone
+
+**********************************************************************/
+SEXP tzif_zone_info( SEXP dir, SEXP name )
+{
+  SEXP ret, names;
+  TZONE_STRUCT *zone;
+
+  if( !isString(dir) || length(dir) != 1 ||
+      STRING_ELT(dir, 0) == NA_STRING ||
+      !isString(name) || length(name) != 1 ||
+      STRING_ELT(name, 0) == NA_STRING )
+    error( "Invalid argument in C function tzif_zone_info" );
+
+  if( !( zone = tzif_zone( CHAR( STRING_ELT( dir, 0 )),
+			   CHAR( STRING_ELT( name, 0 )))))
+    return R_NilValue;
+
+  PROTECT( ret = NEW_LIST(2) );
+  PROTECT( names = NEW_CHARACTER(2) );
+  SET_STRING_ELT( names, 0, mkChar( "offset" ));
+  SET_STRING_ELT( names, 1, mkChar( "transitions" ));
+  SET_VECTOR_ELT( ret, 0, ScalarInteger( zone->offset ));
+  SET_VECTOR_ELT( ret, 1, ScalarInteger( zone->trans->count ));
+  setAttrib( ret, R_NamesSymbol, names );
+
+  UNPROTECT(2);
+  return ret;
+}
+
+/**********************
+  Internal functions
+  *********************/
+
+/* map or read the file and parse it; return 1/0 for success/failure */
+
+static int tzif_read( const char *path, TZONE_TRANS_STRUCT *trans,
+		      Sint *std_offset )
+{
+  int ok;
+
+#ifndef _WIN32
+  int fd;
+  struct stat st;
+  void *addr;
+
+  if(( fd = open( path, O_RDONLY )) < 0 )
+    return 0;
+  if( fstat( fd, &st ) < 0 || st.st_size < TZIF_HEADER )
+  {
+    close( fd );
+    return 0;
+  }
+  addr = mmap( NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if( addr == MAP_FAILED )
+    return 0;
+
+  ok = tzif_parse( (const unsigned char *) addr, (size_t) st.st_size,
+		   trans, std_offset );
+  munmap( addr, (size_t) st.st_size );
+#else
+  /* no mmap here, so read the whole file */
+  FILE *fp;
+  long size;
+  unsigned char *data = NULL;
+
+  if( !( fp = fopen( path, "rb" )))
+    return 0;
+  if( fseek( fp, 0, SEEK_END ) || ( size = ftell( fp )) < TZIF_HEADER ||
+      fseek( fp, 0, SEEK_SET ) ||
+      !( data = (unsigned char *) malloc( (size_t) size )) ||
+      fread( data, 1, (size_t) size, fp ) != (size_t) size )
+  {
+    free( data );
+    fclose( fp );
+    return 0;
+  }
+  fclose( fp );
+
+  ok = tzif_parse( data, (size_t) size, trans, std_offset );
+  free( data );
+#endif
+
+  return ok;
+}
+
+/* parse the bytes of a TZif file into a transition table, which is
+   malloc'ed; return 1/0 for success/failure */
+
+static int tzif_parse( const unsigned char *p, size_t len,
+		       TZONE_TRANS_STRUCT *trans, Sint *std_offset )
+{
+  uint64_t isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt;
+  uint64_t block, need, types, foot, k;
+  const unsigned char *tt;
+  int version, tsize, idx;
+  Sint i;
+  TZIF_POSIX tz;
+
+  if( len < TZIF_HEADER || memcmp( p, TZIF_MAGIC, 4 ))
+    return 0;
+  version = p[4] ? p[4] - '0' : 1;
+  block = 0;
+  tsize = 4;
+
+  /* version 2 and later files repeat the data with 64-bit times,
+     after the version 1 data */
+  for( ;; )
+  {
+    isutcnt = (uint32_t) tzif_get_be( p + block + 20, 4 );
+    isstdcnt = (uint32_t) tzif_get_be( p + block + 24, 4 );
+    leapcnt = (uint32_t) tzif_get_be( p + block + 28, 4 );
+    timecnt = (uint32_t) tzif_get_be( p + block + 32, 4 );
+    typecnt = (uint32_t) tzif_get_be( p + block + 36, 4 );
+    charcnt = (uint32_t) tzif_get_be( p + block + 40, 4 );
+    need = timecnt * ( tsize + 1 ) + typecnt * 6 + charcnt +
+      leapcnt * ( tsize + 4 ) + isstdcnt + isutcnt;
+    if( block + TZIF_HEADER + need > len )
+      return 0;
+    if( version < 2 || tsize == 8 )
+      break;
+    block += TZIF_HEADER + need;
+    tsize = 8;
+    if( block + TZIF_HEADER > len || memcmp( p + block, TZIF_MAGIC, 4 ))
+      return 0;
+  }
+
+  if( !typecnt || typecnt > 256 || leapcnt || timecnt > INT_MAX / 2 )
+    return 0;
+
+  /* the transition times, their type indexes, then the types: 4-byte
+     offset, daylight flag, and name index */
+  block += TZIF_HEADER;
+  types = block + timecnt * ( tsize + 1 );
+  tt = p + types;
+
+  trans->count = (Sint) timecnt;
+  trans->offset0 = (Sint) tzif_get_be( tt, 4 );
+  trans->daylight0 = ( tt[4] != 0 );
+  *std_offset = trans->offset0;
+
+  k = timecnt + 2 * ( TZIF_LAST_YEAR - 1900 + 2 );
+  trans->times = (int64_t *) malloc( k * sizeof( int64_t ));
+  trans->offsets = (Sint *) malloc( k * sizeof( Sint ));
+  trans->daylight = (unsigned char *) malloc( k );
+  if( !trans->times || !trans->offsets || !trans->daylight )
+    goto fail;
+
+  for( i = 0; i < trans->count; i++ )
+  {
+    idx = p[block + timecnt * tsize + i];
+    if( idx >= (int) typecnt )
+      goto fail;
+    trans->times[i] = tzif_get_be( p + block + i * tsize, tsize );
+    if( i && trans->times[i] < trans->times[i-1] )
+      goto fail;
+    trans->offsets[i] = (Sint) tzif_get_be( tt + 6 * idx, 4 );
+    trans->daylight[i] = ( tt[6 * idx + 4] != 0 );
+    if( !trans->daylight[i] )
+      *std_offset = trans->offsets[i];
+  }
+
+  /* the POSIX TZ string, between newlines after the data */
+  foot = block + need;
+  if( version >= 2 && foot < len && p[foot] == '\n' )
+  {
+    const char *s = (const char *) p + foot + 1;
+    const char *end = memchr( s, '\n', len - foot - 1 );
+
+    if( end && end > s && posix_parse( s, end, &tz ))
+    {
+      *std_offset = tz.std_offset;
+      if( tz.has_dst && !tzif_extend( trans, &tz ))
+	goto fail;
+    }
+  }
+
+  return 1;
+
+ fail:
+  free( trans->times );
+  free( trans->offsets );
+  free( trans->daylight );
+  trans->times = NULL;
+  trans->offsets = NULL;
+  trans->daylight = NULL;
+  trans->count = 0;
+  return 0;
+}
+
+/* add the transitions of a POSIX TZ string after the last one in the
+   table, through the end of TZIF_LAST_YEAR; the table has room for
+   two a year from 1900 */
+
+static int tzif_extend( TZONE_TRANS_STRUCT *trans, const TZIF_POSIX *tz )
+{
+  TIME_DATE_STRUCT td;
+  Sint year, first, jul, n;
+  int64_t last, start, end, t[2];
+  Sint off[2];
+  int dst[2], k;
+
+  n = trans->count;
+  first = 1970;
+  last = INT64_MIN;
+  if( n > 0 )
+  {
+    last = trans->times[n-1];
+    jul = (Sint) ( last / ( MS_PER_DAY / 1000 )) + UNIX_EPOCH_JULIAN;
+    if( !julian_to_mdy( jul, &td ))
+      return 0;
+    first = td.year;
+  }
+  if( first < 1900 )
+    first = 1900;
+
+  for( year = first; year <= TZIF_LAST_YEAR; year++ )
+  {
+    /* start is given in standard time, end in daylight time */
+    if( !posix_when( &(tz->start), year, tz->std_offset, &start ) ||
+	!posix_when( &(tz->end), year, tz->dst_offset, &end ))
+      return 0;
+
+    k = ( end < start );
+    t[k] = start;
+    off[k] = tz->dst_offset;
+    dst[k] = 1;
+    t[1-k] = end;
+    off[1-k] = tz->std_offset;
+    dst[1-k] = 0;
+
+    for( k = 0; k < 2; k++ )
+    {
+      if( t[k] <= last )
+	continue;
+      trans->times[n] = t[k];
+      trans->offsets[n] = off[k];
+      trans->daylight[n] = (unsigned char) dst[k];
+      n++;
+    }
+  }
+
+  trans->count = n;
+  return 1;
+}
+
+/* parse a POSIX TZ string, such as "EST5EDT,M3.2.0,M11.1.0"; return
+   1/0 for success/failure.  A string with a daylight name must have
+   rules. */
+
+static int posix_parse( const char *s, const char *end, TZIF_POSIX *tz )
+{
+  Sint secs;
+
+  tz->has_dst = 0;
+
+  /* POSIX offsets are west of GMT, so are negated */
+  if( !( s = posix_name( s, end )) || !( s = posix_hms( s, end, &secs )))
+    return 0;
+  tz->std_offset = -secs;
+  tz->dst_offset = tz->std_offset + 3600;
+  if( s == end )
+    return 1;
+
+  if( !( s = posix_name( s, end )))
+    return 0;
+  if( s < end && *s != ',' )
+  {
+    if( !( s = posix_hms( s, end, &secs )))
+      return 0;
+    tz->dst_offset = -secs;
+  }
+
+  if( s == end || *s != ',' ||
+      !( s = posix_rule( s + 1, end, &(tz->start) )) ||
+      s == end || *s != ',' ||
+      !( s = posix_rule( s + 1, end, &(tz->end) )) || s != end )
+    return 0;
+
+  tz->has_dst = 1;
+  return 1;
+}
+
+/* skip a zone abbreviation: letters, or anything in angle brackets */
+
+static const char *posix_name( const char *s, const char *end )
+{
+  const char *from = s;
+
+  if( s < end && *s == '<' )
+  {
+    while( s < end && *s != '>' )
+      s++;
+    return(( s < end ) ? s + 1 : NULL );
+  }
+  while( s < end && isalpha( (unsigned char) *s ))
+    s++;
+  return(( s > from ) ? s : NULL );
+}
+
+/* read [+-]hh[:mm[:ss]] into seconds */
+
+static const char *posix_hms( const char *s, const char *end, Sint *secs )
+{
+  Sint sign = 1, val, part, mult = 3600;
+
+  if( s < end && ( *s == '+' || *s == '-' ))
+    sign = ( *s++ == '-' ) ? -1 : 1;
+  if( s == end || !isdigit( (unsigned char) *s ))
+    return NULL;
+
+  val = 0;
+  for( ;; )
+  {
+    part = 0;
+    while( s < end && isdigit( (unsigned char) *s ) && part < 1000 )
+      part = 10 * part + ( *s++ - '0' );
+    val += mult * part;
+    if( mult == 1 || s == end || *s != ':' )
+      break;
+    s++;
+    mult /= 60;
+  }
+
+  /* hours may go to 167 in version 3 files */
+  if( val > 167 * 3600 + 59 * 60 + 59 )
+    return NULL;
+  *secs = sign * val;
+  return s;
+}
+
+/* read a rule date and optional /time, 2AM by default */
+
+static const char *posix_rule( const char *s, const char *end,
+			       TZIF_POSIX_RULE *rule )
+{
+  Sint *fields[3];
+  int i;
+
+  if( s == end )
+    return NULL;
+
+  rule->kind = 'N';
+  if( *s == 'J' || *s == 'M' )
+    rule->kind = *s++;
+
+  if( rule->kind == 'M' )
+  {
+    fields[0] = &(rule->month);
+    fields[1] = &(rule->week);
+    fields[2] = &(rule->wkday);
+    for( i = 0; i < 3; i++ )
+    {
+      if( i && ( s == end || *s++ != '.' ))
+	return NULL;
+      if( s == end || !isdigit( (unsigned char) *s ))
+	return NULL;
+      *fields[i] = 0;
+      while( s < end && isdigit( (unsigned char) *s ) && *fields[i] < 100 )
+	*fields[i] = 10 * *fields[i] + ( *s++ - '0' );
+    }
+    if( rule->month < 1 || rule->month > 12 || rule->week < 1 ||
+	rule->week > 5 || rule->wkday > 6 )
+      return NULL;
+  }
+  else
+  {
+    if( s == end || !isdigit( (unsigned char) *s ))
+      return NULL;
+    rule->day = 0;
+    while( s < end && isdigit( (unsigned char) *s ) && rule->day < 1000 )
+      rule->day = 10 * rule->day + ( *s++ - '0' );
+    if(( rule->kind == 'J' && ( rule->day < 1 || rule->day > 365 )) ||
+       rule->day > 365 )
+      return NULL;
+  }
+
+  rule->secs = 2 * 3600;
+  if( s < end && *s == '/' )
+    s = posix_hms( s + 1, end, &(rule->secs) );
+  return s;
+}
+
+/* GMT seconds since 1970 of a rule in a year, given the local offset
+   in effect before it; return 1/0 for success/failure */
+
+static int posix_when( const TZIF_POSIX_RULE *rule, Sint year,
+		       Sint offset, int64_t *secs )
+{
+  static const Sint month_start[] = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365
+  };
+  TIME_DATE_STRUCT td;
+  Sint jul;
+
+  td.year = year;
+  td.month = 1;
+  td.day = 1;
+
+  switch( rule->kind )
+  {
+  case 'M':
+    if( !julian_from_index( rule->month, rule->wkday,
+			    ( rule->week == 5 ) ? -1 : rule->week,
+			    year, &jul ))
+      return 0;
+    break;
+
+  case 'J':
+    /* February 29 is never counted */
+    while( month_start[td.month] < rule->day )
+      td.month++;
+    td.day = rule->day - month_start[td.month - 1];
+    if( !julian_from_mdy( td, &jul ))
+      return 0;
+    break;
+
+  default:
+    if( !julian_from_mdy( td, &jul ))
+      return 0;
+    jul += rule->day;
+    break;
+  }
+
+  *secs = ( (int64_t) jul - UNIX_EPOCH_JULIAN ) * ( MS_PER_DAY / 1000 ) +
+    rule->secs - offset;
+  return 1;
+}
+
+/* read a signed big-endian integer of 4 or 8 bytes */
+
+static int64_t tzif_get_be( const unsigned char *p, int nbytes )
+{
+  uint64_t val = 0;
+  int i;
+
+  for( i = 0; i < nbytes; i++ )
+    val = ( val << 8 ) | p[i];
+  if( nbytes == 4 )
+    return( (int64_t) (int32_t) (uint32_t) val );
+  return( (int64_t) val );
+}
@@ -0,0 +1,44 @@
+/*************************************************************************
+ *
+ * © 1998-2012 TIBCO Software Inc. All rights reserved.
+ * Confidential & Proprietary
+ *
+*************************************************************************/
+
+#ifndef TIMELIB_ZONETZIF_H
+#define TIMELIB_ZONETZIF_H
+
+#include "zoneObj.h"
+#include "mdy.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Compiled zoneinfo files follow RFC 8536.  Version 1 files are read
+   from their 32-bit data; version 2 and later files from the 64-bit
+   data, and the POSIX TZ string at the end of the file is used to
+   extend the transitions, through the end of TZIF_LAST_YEAR.  Files
+   with leap second records are not supported. */
+
+#define TZIF_MAGIC "TZif"
+#define TZIF_HEADER 44
+#define TZIF_LAST_YEAR 2199
+
+/* default directory of the system zoneinfo files */
+#define TZIF_DEFAULT_DIR "/usr/share/zoneinfo"
+
+/* zones are read once and cached by path */
+TZONE_STRUCT *tzif_zone( const char *dir, const char *name );
+
+/* offset lookup, used by get_offset for zones with a transition table */
+int tzif_offset( const TZONE_TRANS_STRUCT *trans,
+		 const TIME_DATE_STRUCT *tstruc, int in_local_time,
+		 Sint *offset, int *is_daylight );
+
+/* the transition in effect at a GMT time, used by zone_segment to
+   find the offset interval around a time */
+Sint tzif_find( const TZONE_TRANS_STRUCT *trans, int64_t secs );
+
+SEXP tzif_zone_info( SEXP dir, SEXP name );
+
+#endif  // TIMELIB_ZONETZIF_H
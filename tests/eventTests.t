@@ -54,3 +54,21 @@
     all(ste02[,2] ==
       c("02/05/2013 11:00:00.000", "02/09/2013 15:00:00.000", "0")) 
 }
+
+{
+  # subscripts gathered from all the columns at once
+  te03 <- timeEvent(start = timeCalendar(m=3, d=1:6, y=2013, h=9),
+    end = timeCalendar(m=3, d=1:6, y=2013, h=17), IDs = letters[1:6])
+  st03 <- te03@columns[[1]]
+  # compare with the raw julian day and ms columns, so the expected
+  # values don't go through the same subscripting
+  identical(te03[c(5, 2, 8)]@columns[[1]]@columns,
+            lapply(st03@columns, "[", c(5, 2, 8))) &&
+    identical(te03[c(5, 2, 8)]@columns[[3]], c("e", "b", NA)) &&
+    identical(te03[-c(1, 6)]@columns[[3]], letters[2:5]) &&
+    identical(te03[c(TRUE, FALSE)]@columns[[3]], c("a", "c", "e")) &&
+    identical(te03[c(TRUE, FALSE)]@columns[[2]]@columns,
+              lapply(te03@columns[[2]]@columns, "[", c(1, 3, 5))) &&
+    length(te03[0]) == 0 && length(te03[c(2.7, 0)]) == 1 &&
+    all(st03[te03[2:3]] == timeCalendar(m=3, d=2:3, y=2013, h=9))
+}
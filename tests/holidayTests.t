@@ -47,6 +47,80 @@
 	               "7/14/1998", "10/12/1998", "11/1/1998" ))))
 }
 
+{
+  # test NYSE and USFederal calendars, including the NYSE Saturday rule
+  # (New Years 2011 and 2022 fell on Saturdays after a month-end Friday)
+  a <- holiday.NYSE( 2021:2022 )
+  b <- holidays( 2010:2011, "USFederal" )
+  c1 <- holidays( 2010:2011, c( "NewYears", "Christmas" ), c( TRUE, FALSE ))
+  ( all( a == timeDate( c( "1/1/2021", "1/18/2021", "2/15/2021", "4/2/2021",
+                   "5/31/2021", "7/5/2021", "9/6/2021", "11/25/2021",
+                   "12/24/2021", "1/17/2022", "2/21/2022", "4/15/2022",
+                   "5/30/2022", "7/4/2022", "9/5/2022", "11/24/2022",
+                   "12/26/2022" ))) &&
+    length( holiday.NYSE( 1800:1884 )) == 0 &&
+    all( is.element( as( timeDate( c( "11/8/1960", "11/7/1972" )), "numeric" ),
+                     as( holiday.NYSE( 1960:1980 ), "numeric" ))) &&
+    !any( is.element( as( timeDate( c( "11/5/1974", "11/6/1984" )), "numeric" ),
+                      as( holiday.NYSE( 1960:1990 ), "numeric" ))) &&
+    length( b ) == 20 && all( b[10:11] == timeDate( c( "12/24/2010",
+                                                    "12/31/2010" ))) &&
+    all( c1 == timeDate( c( "1/1/2010", "12/25/2010", "12/31/2010",
+                        "12/25/2011" ))) &&
+    all( holidays( c( 1998, 2003, 1998 ), "NYSE" ) ==
+         sort( c( holiday.NYSE( 1998 ), holiday.NYSE( 2003 )))))
+}
+
+{
+  # test Easter inside and outside the tabulated years, and NA years
+  a <- holiday.Easter( c( 1818, 2024, 2300, 1800, NA ))
+  b <- holidays( c( 2024, 1800 ), c( "Easter", "GoodFriday" ))
+  ( all( a[1:4] == timeCalendar( y = c( 1818, 2024, 2300, 1800 ),
+                                m = c( 3, 3, 4, 4 ), d = c( 22, 31, 8, 13 ))) &&
+    is.na( a[5] ) &&
+    all( b == timeCalendar( y = c( 1800, 1800, 2024, 2024 ),
+                           m = c( 4, 4, 3, 3 ), d = c( 11, 13, 29, 31 ))))
+}
+
+{
+  # test business calendars against a NYSE holiday list; past the
+  # end of the calendar only weekends are skipped
+  hol <- holiday.NYSE( 2021:2022 )
+  cal <- bizCalendar( hol )
+  x <- timeDate( c( "7/2/2021", "7/3/2021", "7/5/2021", "12/31/2021" ))
+  a <- addBizdays( x, c( 1, -1, 1, 2 ), cal )
+  y <- timeSeq( "1/1/2021", "12/31/2022", by = "days" )
+  b <- bizdaysBetween( timeDate( "1/1/2021" ), y, cal )
+  ( all( isBizday( x, cal ) == c( TRUE, FALSE, FALSE, TRUE )) &&
+    all( a == timeDate( c( "7/6/2021", "7/2/2021", "7/6/2021",
+                          "1/4/2022" ))) &&
+    all( nextBizday( x, cal ) == x + timeRelative( "+1biz", holidays. = hol )) &&
+    all( prevBizday( x, cal ) == x + timeRelative( "-1biz", holidays. = cal )) &&
+    all( b == cumsum( isBizday( y, cal ))) &&
+    b[ length( b ) ] == 2 * 252 - 1 &&
+    all( bizdayOfMonth( timeDate( c( "1/4/2021", "1/3/2021", "7/6/2021" )),
+                        cal ) == c( 1, 0, 3 )) &&
+    all( addBizdays( timeDate( "12/30/2022" ), 1:2, cal ) ==
+         timeDate( c( "1/2/2023", "1/3/2023" ))))
+}
+
+{
+  # test business day holidays given unsorted, repeated, and in another
+  # zone; the converted dates are cached, so add twice
+  hol <- holiday.NYSE( 2021 )
+  h2 <- timeZoneConvert( c( rev( hol ), hol ), "US/Eastern" )
+  x <- timeDate( c( "7/2/2021", "12/23/2021" ))
+  r1 <- timeRelative( "+1biz", holidays. = hol )
+  r2 <- timeRelative( "+1biz", holidays. = h2 )
+  a <- x + r2
+  ( all( a == x + r1 ) && all( x + r2 == a ) &&
+    all( a == timeDate( c( "7/6/2021", "12/27/2021" ))) &&
+    all( timeSeq( "12/20/2021", by = "bizdays", length.out = 5,
+                 holidays = h2 ) ==
+         timeDate( c( "12/20/2021", "12/21/2021", "12/22/2021",
+                     "12/23/2021", "12/27/2021" ))))
+}
+
 {
   # cleanup
   timeDateOptions(save.timeDateOptions)
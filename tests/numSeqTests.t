@@ -104,3 +104,29 @@
     all( c( a, a ) == rep( a, 2 )))
 
 }
+
+{
+  # test matching and aligning to a sequence without making it
+  a <- numericSequence( 10, 1, by = -1.5 )
+  b <- as( a, "numeric" )
+  x <- c( 4, 11, 8.5, 1, 10, 5.5 )
+
+  ( identical( match( x, a ), match( x, b )) &&
+    identical( match( x, a, nomatch = 0 ), match( x, b, nomatch = 0 )) &&
+    identical( .numalign( a, sort( x ), "nearest", "NA" ),
+	       .numalign( b, sort( x ), "nearest", "NA" )) &&
+    identical( .numalign( a, sort( x ), "interp", "drop" ),
+	       .numalign( b, sort( x ), "interp", "drop" )))
+}
+
+{
+  # test findInterval on a sequence without making it
+  a <- numericSequence( 1, by = 0.25, length. = 9 )
+  b <- as( a, "numeric" )
+  x <- c( 0.5, 1, 1.1, 2.75, 3, 3.5, NA )
+
+  ( identical( findInterval( x, a ), findInterval( x, b )) &&
+    identical( findInterval( x, a ), c( 0L, 1L, 1L, 8L, 9L, 9L, NA )) &&
+    identical( findInterval( x, a, rightmost.closed = TRUE ),
+	       findInterval( x, b, rightmost.closed = TRUE )))
+}
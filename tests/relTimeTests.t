@@ -217,3 +217,40 @@
   a <- timeDate( "2/29/96" ) + timeRelative( "+a2tdy" )
   ( !is.na( a ) && ( a == timeDate( "3/1/1996" )))
 }
+
+{
+  # test month, quarter, and year steps on vectors in a daylight zone,
+  # with several relative times, the end of month clamp, and a bad one
+
+  x <- timeZoneConvert( timeDate( c( "1/31/2000 10:00", "3/31/2004 23:30",
+                                    "10/31/2011 01:30" ), zone = "GMT" ),
+                        "US/Eastern" )
+  a <- x + timeRelative( c( "+1mth", "-1qtr", "+2yr +1mth" ))
+  b <- mdy( a )
+  c1 <- hms( a )
+  ( all( b$month == c( 2, 12, 11 )) && all( b$day == c( 29, 31, 30 )) &&
+    all( b$year == c( 2000, 2003, 2013 )) &&
+    all( hms( x )$hour == c1$hour ) && all( hms( x )$minute == c1$minute ) &&
+    is.na( x[1] + timeRelative( "+1zzz" )) &&
+    all( is.na( x + timeRelative( c( "+1mth", "+1zz", "+1mth" )))
+         == c( FALSE, TRUE, FALSE )))
+}
+
+{
+  # test weekday and business day steps across weekends and holidays
+
+  x <- timeDate( c( "6/5/2020", "6/6/2020", "6/7/2020", "6/8/2020" ))
+  hol <- timeDate( c( "6/12/2020", "6/15/2020", "6/13/2020" ))
+  a <- x + timeRelative( "+6wkd" )
+  b <- x + timeRelative( "+5biz", holidays. = hol )
+  c1 <- x + timeRelative( "-3fri" )
+  d <- x + timeRelative( "-a0mon" )
+  ( all( a == timeDate( c( "6/15/2020", "6/15/2020", "6/15/2020",
+                          "6/16/2020" ))) &&
+    all( b == timeDate( c( "6/16/2020", "6/16/2020", "6/16/2020",
+                          "6/17/2020" ))) &&
+    all( c1 == timeDate( c( "5/15/2020", "5/22/2020", "5/22/2020",
+                           "5/22/2020" ))) &&
+    all( d == timeDate( c( "6/1/2020", "6/1/2020", "6/1/2020",
+                          "6/8/2020" ))))
+}
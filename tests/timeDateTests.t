@@ -323,6 +323,183 @@ c( "1/23/1998 14:05:06.624 Fri Friday Jan January 98 2 624 PM 1 I GMT GMT % Janu
 	 }, b, "PST" ))
 }
 
+{
+  # POSIXct and Date conversions count from 1970
+  p <- structure(c(0, 86400.25, -1.5, NA), class=c("POSIXct", "POSIXt"),
+                 tzone="GMT")
+  a <- as(p, "timeDate")
+  d <- structure(c(0, 365, -1), class="Date")
+  b <- as(d, "timeDate")
+  all(c(all.equal(as.numeric(a[1:3]) - 3653, c(0, 86400.25, -1.5)/86400),
+        is.na(a[4]), a@time.zone == "GMT",
+        all.equal(unclass(as(a, "POSIXct")), unclass(p), 
+                  check.attributes=FALSE),
+        all.equal(as.numeric(b), as.numeric(timeDate(c("1/1/1970", "1/1/1971",
+                                                        "12/31/1969")))),
+        identical(as(b, "Date"), d)))
+}
+
+{
+  # Date conversions use the local date in a zone other than GMT
+  oldopt <- timeDateOptions(time.zone = "US/Eastern")
+  d <- structure(c(0, 200, -1), class="Date")
+  b <- as(d, "timeDate")
+  timeDateOptions(oldopt)
+  all(c(b@time.zone == "US/Eastern", identical(as(b, "Date"), d),
+        all.equal(as.numeric(b),
+                  as.numeric(timeDate(c("1/1/1970", "7/20/1970", "12/31/1969"),
+                                      zone = "US/Eastern"))),
+        all(hms(b)$hour == 0)))
+}
+
+{
+  # Arrow C Data Interface round trips, with NA values
+  a <- timeDate(c("1/1/2020 10:30:00.250", NA, "12/31/1950"), zone = "GMT")
+  b <- timeSpan(julian = c(1, NA, -3), ms = c(7200000, 0, -5))
+  a2 <- timeFromArrow(timeToArrow(a))
+  b2 <- timeFromArrow(timeToArrow(b))
+  all(c(all.equal(as(a2, "numeric"), as(a, "numeric")), 
+        a2@time.zone == "GMT", is(b2, "timeSpan"),
+        all.equal(as(b2, "numeric"), as(b, "numeric"))))
+}
+
+{
+  # binary encoding round trips, whole, by block, and from a file
+  a <- timeDate(julian = c(20000, 20000, NA, 20001, 19000, -3),
+                ms = c(0, 1500, 0, 86399999, 7, 5), zone = "GMT")
+  b <- timeSpan(julian = c(1, NA, -3), ms = c(7200000, 0, -5))
+  enc <- timeEncode(a, block.size = 4)
+  f <- tempfile()
+  timeEncode(b, file = f)
+  b2 <- timeDecode(f)
+  unlink(f)
+  all(c(all.equal(as(timeDecode(enc), "numeric"), as(a, "numeric")),
+        timeDecode(enc)@time.zone == "GMT",
+        all.equal(as(timeDecode(enc, 2), "numeric"), as(a[5:6], "numeric")),
+        timeEncodeInfo(enc)$blocks == 2, is(b2, "timeSpan"),
+        all.equal(as(b2, "numeric"), as(b, "numeric"))))
+}
+
+{
+  # file-backed times, in both layouts, with contiguous subsets
+  a <- timeDate(julian = c(20000, 20000, NA, 20001, 19000, -3),
+                ms = c(0, 1500, 0, 86399999, 7, 5), zone = "GMT")
+  f1 <- tempfile()
+  f2 <- tempfile()
+  timeMapWrite(a, f1)
+  a1 <- timeMap(f1)
+  timeMapWrite(a, f2, packed = TRUE)
+  a2 <- timeMap(f2)
+  all(c(all.equal(as(a1, "numeric"), as(a, "numeric")),
+        all.equal(as(a2, "numeric"), as(a, "numeric")),
+        all.equal(as(a1[2:5], "numeric"), as(a[2:5], "numeric")),
+        all.equal(as(a2[c(6, 1)], "numeric"), as(a[c(6, 1)], "numeric")),
+        a1@time.zone == "GMT", 
+        all.equal(as(range(a2, na.rm = TRUE), "numeric"), 
+                  as(range(a, na.rm = TRUE), "numeric"))))
+}
+
+{
+  # packed storage: round trip, C entry points, compare, sort, range
+  a <- timeDate(julian = c(20000, 20000, NA, 20001, 19000, -3),
+                ms = c(0, 1500, 0, 86399999, 7, 5), zone = "GMT")
+  pa <- timePack(a)
+  b <- a
+  b[2] <- pa[5]
+  pb <- pa
+  pb[2] <- a[5]
+  validObject(pa)
+  all(c(timeIsPacked(pa), !timeIsPacked(a),
+        all.equal(timeUnpack(pa)@columns[[1]], a@columns[[1]]),
+        all.equal(timeUnpack(pa)@columns[[2]], a@columns[[2]]),
+        all.equal(as(pa, "numeric"), as(a, "numeric")),
+        identical(pa < pa[1], a < a[1]),
+        identical(sort.list(pa), sort.list(a)),
+        all.equal(as(range(pa, na.rm = TRUE), "numeric"),
+                  as(range(a, na.rm = TRUE), "numeric")),
+        all.equal(as(pb, "numeric"), as(b, "numeric")),
+        all.equal(as(months(pa[-3]), "character"), 
+                  as(months(a[-3]), "character"))))
+}
+
+{
+  # packed arithmetic stays packed and matches the split results
+  a <- timeDate(julian = c(20000, 20000, NA, 20001, 19000, -3),
+                ms = c(0, 1500, 0, 86399999, 7, 5), zone = "GMT")
+  pa <- timePack(a)
+  d <- pa - pa[1]
+  all(c(timeIsPacked(pa + 1.25), timeIsPacked(pa - 0.5), timeIsPacked(d),
+        timeIsPacked(pa[1] + d),
+        all.equal(as(pa + 1.25, "numeric"), as(a + 1.25, "numeric")),
+        all.equal(as(pa - c(0.5, -2), "numeric"), 
+                  as(a - c(0.5, -2), "numeric")),
+        all.equal(as(d, "numeric"), as(a - a[1], "numeric")),
+        all.equal(as(pa[1] + d, "numeric"), as(a, "numeric")),
+        is.na(as(d, "numeric")[3])))
+}
+
+{
+  # fixed-offset zone: local conversions in both directions
+  fmt <- "%02m/%02d/%Y %02H:%02M:%02S.%03N"
+  a <- timeDate(julian = c(20000, 20000, NA, -5),
+                ms = c(53999999, 54000000, 0, 3600000), 
+                format = fmt, zone = "JST")
+  b <- mdy(a[-3])
+  f <- floor(a[-3])
+  all(c(all.equal(hours(a[-3]), c(23, 0, 10)),
+        all.equal(b$day, c(4, 5, 27)),
+        all.equal(b$year, c(2014, 2014, 1959)),
+        all.equal(f@columns[[1]], c(19999, 20000, -6)),
+        all.equal(f@columns[[2]], rep(54000000, 3)),
+        identical(as(a[-3], "Date"), 
+                  as.Date(c("2014-10-04", "2014-10-05", "1959-12-27"))),
+        all.equal(as(timeDate(as(a[-3], "character"), in.format = fmt,
+                              zone = "JST"), "numeric"),
+                  as(a[-3], "numeric")),
+        all.equal(as(timeCalendar(m = 10, d = 5, y = 2014, zone = "JST"),
+                     "numeric"), as(a[2], "numeric"))))
+}
+
+{
+  # zoneinfo file time zones, from the bundled files
+  dir <- system.file("zoneinfo", package = "splusTimeDate")
+  timeZoneList(NYtzif = timeZoneTZif("America/New_York", dir),
+               SYtzif = timeZoneTZif("Australia/Sydney", dir))
+  jul <- rep(seq(11000, 51000, by = 37), each = 3)
+  a <- timeDate(julian = jul, 
+                ms = rep(c(0, 43200000, 72000000), length.out = length(jul)),
+                zone = "NYtzif")
+  b <- a
+  b@time.zone <- "Eastern"
+  s <- timeDate(julian = c(21929, 22111, 69411, 69592), 
+                ms = rep(43200000, 4), zone = "SYtzif")
+  all(c(identical(as(a, "character"), as(b, "character")),
+        all.equal(as(timeDate(as(a, "character"), zone = "NYtzif"), 
+                     "numeric"), as(a, "numeric")),
+        all.equal(hours(s), c(23, 22, 23, 22)),
+        inherits(try(timeZoneTZif("No/Such_Zone", dir), silent = TRUE),
+                 "try-error")))
+}
+
+{
+  # user time zone with rules far apart in years
+  b <- timeZoneR( offset = 0,
+		  yearfrom = c( -1, 1500, 2500 ), yearto = c( 1499, 2499, -1 ),
+		  hasdaylight = c( TRUE, FALSE, TRUE ), 
+		  dsextra = c( 3600, 0, 3600 ), 
+		  monthstart = c( 4, 4, 4 ), codestart = c( 2, 2, 2 ), 
+		  daystart = c( 0, 0, 0 ), xdaystart = c( 0, 0, 0 ),
+		  timestart = c( 7200, 7200, 7200 ), 
+		  monthend = c( 10, 10, 10 ), codeend = c( 2, 2, 2 ), 
+		  dayend = c( 0, 0, 0 ), xdayend = c( 0, 0, 0 ),
+		  timeend = c( 3*3600, 3*3600, 3*3600 ))
+  timeZoneList(sparsetz = b)
+  a <- timeCalendar( m = 7, d = 15, y = c( 1400, 2000, 2600, 2600 ), 
+		     h = c( 12, 12, 12, 12 ), zone = "GMT" )
+  a@time.zone <- "sparsetz"
+  all.equal( hours( a ), c( 13, 12, 13, 13 ))
+}
+
 {
   # cleanup
   timeZoneList(oldlist)
@@ -114,6 +114,139 @@ atU
     ##all( as.numeric( ordered( b )) == as.numeric(ordered(as(b,"numeric")))))
 }
 
+{
+  # test calendar bins, and cut using them
+  x <- timeCalendar( m = c( 1, 3, 1, 5, NA ), d = c( 31, 1, 2, 5, 1 ),
+		     y = 2001 )
+  b <- timeBin( x, "months" )
+  b2 <- timeBin( x, "2 months" )
+  m <- timeBin( timeDate( julian = 0, ms = 1000 * c( 0, 299, 300, 601 )),
+		"5 minutes" )
+
+  all( as.numeric( b$bins ) == c( 1, 3, 1, 5, NA ), na.rm = TRUE ) &&
+    is.na( b$bins[5] ) &&
+    all( b$starts == timeCalendar( m = 1:6, d = 1, y = 2001 )) &&
+    all( as.numeric( b2$bins[1:4] ) == c( 1, 2, 1, 3 )) &&
+    all( b2$starts == timeCalendar( m = c( 1, 3, 5, 7 ), d = 1, y = 2001 )) &&
+    all( as.numeric( m$bins ) == c( 1, 1, 2, 3 )) &&
+    all( as.numeric( cut( x, "months" )) == as.numeric( b$bins ),
+	 na.rm = TRUE )
+}
+
+{
+  # test aggregation over calendar bins, sorted and unsorted
+  x <- timeDate( julian = 0, ms = 60000 * c( 0, 3, 5, 9, 12 ))
+  v <- c( 4, 1, 7, NA, 2 )
+  a <- timeAggregate( x, v, by = "5 minutes" )
+  o <- c( 5, 2, 4, 1, 3 )
+  b <- timeAggregate( x[o], v[o], by = "5 minutes", na.rm = TRUE )
+  m <- timeAggregate( x, cbind( p = v, q = 1:5 ), by = "5 minutes",
+		      FUN = c( "last", "count" ))
+
+  all( a$starts == timeDate( julian = 0, ms = 60000 * c( 0, 5, 10 ))) &&
+    all( a$sum == c( 5, NA, 2 ), na.rm = TRUE ) && is.na( a$sum[2] ) &&
+    all( a$first == c( 4, 7, 2 )) &&
+    all( a$last == c( 1, NA, 2 ), na.rm = TRUE ) &&
+    all( a$count == c( 2, 2, 1 )) &&
+    all( b$starts == a$starts ) &&
+    all( b$sum == c( 5, 7, 2 )) && all( b$mean == c( 2.5, 7, 2 )) &&
+    all( b$max == c( 4, 7, 2 )) && all( b$last == c( 1, 7, 2 )) &&
+    all( b$count == c( 2, 1, 1 )) &&
+    all( dim( m$last ) == c( 3, 2 )) && all( m$last[, "q"] == c( 2, 4, 5 ))
+}
+
+{
+  # test rolling statistics over time windows, with ties and NA
+  x <- timeDate( julian = 0, ms = 1000 * c( 0, 1, 1, 2, 5, 6 ))
+  v <- c( 3, 1, 4, NA, 5, 9 )
+  a <- timeRolling( x, v, timeSpan( "2s" ))
+  o <- c( 6, 2, 4, 1, 5, 3 )
+  b <- timeRolling( x[o], v[o], timeSpan( "2s" ), na.rm = TRUE )
+
+  all( a$sum == c( 3, 8, 8, NA, 5, 14 ), na.rm = TRUE ) && is.na( a$sum[4] ) &&
+    all( a$max[-4] == c( 3, 4, 4, 5, 9 )) &&
+    all( a$first == c( 3, 3, 3, 1, 5, 5 )) &&
+    all( a$count == c( 1, 3, 3, 3, 1, 2 )) &&
+    all( b$sum == c( 3, 8, 8, 5, 5, 14 )[o] ) &&
+    all( b$min == c( 3, 1, 1, 1, 5, 5 )[o] ) &&
+    all( b$last == c( 3, 4, 4, 4, 5, 9 )[o] )
+}
+
+{
+  # test addition with equal lengths and with a single value on either
+  # side, with carries and NA
+  x <- timeDate( julian = c( 10, 11, NA, 12 ), ms = c( 0, 86399000, 5, 1000 ))
+  s <- timeSpan( julian = c( 1, 0, 1, -1 ), ms = c( 500, 2000, 0, -2000 ))
+  num <- function( julian, ms ) julian + ms / 86400000
+
+  all.equal( as( x + s, "numeric" ),
+	     num( c( 11, 12, NA, 10 ), c( 500, 1000, 0, 86399000 ))) &&
+    all.equal( as( x + s[1], "numeric" ),
+	       num( c( 11, 12, NA, 13 ), c( 500, 86399500, 0, 1500 ))) &&
+    all.equal( as( x[1] - s, "numeric" ),
+	       num( c( 8, 9, 9, 11 ), c( 86399500, 86398000, 0, 2000 ))) &&
+    all.equal( as( x + 1.5, "numeric" ),
+	       num( c( 11, 13, NA, 13 ), c( 43200000, 43199000, 0, 43201000 ))) &&
+    all.equal( as( x[1] - c( 0.25, 2 ), "numeric" ),
+	       num( c( 9, 8 ), c( 64800000, 0 ))) &&
+    all.equal( as( s - s[2], "numeric" ),
+	       num( c( 0, 0, 0, -1 ), c( 86398500, 0, 86398000, -4000 ))) &&
+    all( is.na( x + timeSpan( julian = NA, ms = 0 )))
+}
+
+{
+  # test floor and ceiling to calendar units across daylight savings
+  # changes in US/Eastern: 2010-11-07 (day 18573) falls back at 6:00 GMT,
+  # 2010-03-14 (day 18335) springs forward at 7:00 GMT
+  hr <- 3600000
+  fall <- timeDate( julian = 18573, ms = c( 5.5, 6, 6.5 ) * hr,
+		    zone = "US/Eastern" )
+  spring <- timeDate( julian = 18335, ms = c( 6.5, 6 + 50/60, 7.25 ) * hr,
+		      zone = "US/Eastern" )
+  num <- function( julian, ms ) julian + ms / 86400000
+
+  all.equal( as( timeFloorUnit( fall, "hours" ), "numeric" ),
+	     num( 18573, c( 5, 6, 6 ) * hr )) &&
+    all.equal( as( timeCeilingUnit( fall, "hours" ), "numeric" ),
+	       num( 18573, c( 6, 6, 7 ) * hr )) &&
+    all.equal( as( timeFloorUnit( spring, "15 minutes" ), "numeric" ),
+	       num( 18335, c( 6.5, 6.75, 7.25 ) * hr )) &&
+    all.equal( as( timeCeilingUnit( spring, "15 minutes" ), "numeric" ),
+	       num( 18335, c( 6.5, 7, 7.25 ) * hr )) &&
+    all.equal( as( timeCeilingUnit( spring, "hours" ), "numeric" ),
+	       num( 18335, c( 7, 7, 8 ) * hr )) &&
+    all.equal( as( timeFloorUnit( fall[3], "months" ), "numeric" ),
+	       num( 18567, 4 * hr )) &&
+    all.equal( as( timeFloorUnit( fall[3], "weeks", week.align = 1 ),
+		   "numeric" ), num( 18567, 4 * hr )) &&
+    all.equal( as( timeFloorUnit( fall, "hours", zone = "GMT" ), "numeric" ),
+	       num( 18573, c( 5, 6, 6 ) * hr )) &&
+    is.na( timeFloorUnit( timeDate( julian = NA, ms = 0 ), "hours" ))
+}
+
+{
+  # the same from a zoneinfo transition table, with bins that start in
+  # the spring gap, and timeFloor and timeCeiling to local midnight
+  dir <- system.file("zoneinfo", package = "splusTimeDate")
+  timeZoneList(NYtzif = timeZoneTZif("America/New_York", dir))
+  hr <- 3600000
+  fall <- timeDate( julian = 18573, ms = c( 5.5, 6, 6.5 ) * hr,
+		    zone = "NYtzif" )
+  gap <- timeDate( julian = 18335, ms = 7 * hr + 600000 )
+  num <- function( julian, ms ) julian + ms / 86400000
+
+  all.equal( as( timeFloorUnit( fall, "hours" ), "numeric" ),
+	     num( 18573, c( 5, 6, 6 ) * hr )) &&
+    all.equal( as( timeCeilingUnit( fall, "hours" ), "numeric" ),
+	       num( 18573, c( 6, 6, 7 ) * hr )) &&
+    all.equal( as( timeFloorUnit( gap, "25 minutes", zone = "NYtzif" ),
+		   "numeric" ), num( 18335, 7 * hr )) &&
+    all.equal( as( timeCeilingUnit( gap, "25 minutes", zone = "US/Eastern" ),
+		   "numeric" ), num( 18335, 7 * hr + 1200000 )) &&
+    all.equal( as( timeFloor( fall[3] ), "numeric" ), num( 18573, 4 * hr )) &&
+    all.equal( as( timeCeiling( fall[3] ), "numeric" ), num( 18574, 5 * hr ))
+}
+
 {
   # cleanup
   timeDateOptions(save.options)
@@ -32,3 +32,101 @@
     cuttd04b <- cut(ts04b, breakstd04)
     all.equal(cuttd04a, cuttd04b)
 }
+{
+    # elements of regular sequences found from their positions
+    ts05a <- timeSequence(from="1/15/2013", by="months", length.out=1000)
+    ts05b <- timeSequence(from="1/1/2013", to="12/31/2013", by="weeks")
+    ts05c <- timeSequence(to="1/1/2013 00:00", by="hours", length.out=50)
+    ts05d <- timeSequence(from="1/31/2013", to="12/31/2013", by="months")
+    length(ts05a) == 1000 && length(ts05b) == 53 && length(ts05d) == 12 &&
+        all(ts05a[c(1, 13, 1000)] ==
+            timeDate(c("1/15/2013", "1/15/2014", "4/15/2096"))) &&
+        is.na(ts05a[1001]) &&
+        ts05b[[53]] == timeDate("12/31/2013") &&
+        all(ts05c[c(1, 50)] == timeDate(c("12/29/2012 23:00", "1/1/2013 00:00"))) &&
+        all(head(ts05b, 3) == as(ts05b, "timeDate")[1:3]) &&
+        ts05d[3] == timeDate("3/28/2013")
+}
+{
+    # regular patterns found when converting times to sequences
+    td06a <- timeDate(c("1/1/2013 10:00", "1/1/2013 16:00", "1/1/2013 22:00",
+                        "1/2/2013 4:00"))
+    td06b <- timeDate(c("3/15/2012", "6/15/2012", "9/15/2012", "12/15/2012",
+                        "3/15/2013"))
+    td06c <- timeDate(c("1/31/2013", "2/28/2013", "3/31/2013", "4/30/2013"))
+    td06d <- timeDate(c("1/1/2013", "1/2/2013", "1/4/2013"))
+    td06e <- timeDate(c("5/31/2013 12:00", "3/31/2013 12:00",
+                        "1/31/2013 12:00", "11/30/2012 12:00"))
+    all(as(as(td06a, "timeSequence"), "timeDate") == td06a) &&
+        all(as(as(td06b, "timeSequence"), "timeDate") == td06b) &&
+        length(as(td06c, "timeSequence")) == 4 &&
+        all(as(as(td06c, "timeSequence"), "timeDate") == td06c) &&
+        all(as(as(td06e, "timeSequence"), "timeDate") == td06e) &&
+        inherits(try(as(td06d, "timeSequence"), silent=TRUE), "try-error") &&
+        all(shiftPositions(td06b) == timeDate(c("6/15/2012", "9/15/2012",
+                                   "12/15/2012", "3/15/2013", "6/15/2013")))
+}
+{
+    # regular sequences in a daylight savings zone agree with repeated
+    # addition, including a time of day the change skips
+    ts07a <- timeSequence(from="3/8/2013 02:30", by="days", length.out=5,
+                          zone="US/Eastern")
+    ts07b <- timeSequence(from="3/8/2013 12:00", by="days", length.out=5,
+                          zone="US/Eastern")
+    td07a <- td07b <- NULL
+    x07a <- timeDate("3/8/2013 02:30", zone="US/Eastern")
+    x07b <- timeDate("3/8/2013 12:00", zone="US/Eastern")
+    for(i in 1:5) {
+        td07a <- c(td07a, as(x07a, "numeric"))
+        td07b <- c(td07b, as(x07b, "numeric"))
+        x07a <- x07a + timeRelative("+1day")
+        x07b <- x07b + timeRelative("+1day")
+    }
+    is.null(.seqRegular(ts07a)) && !is.null(.seqRegular(ts07b)) &&
+        all.equal(as(as(ts07a, "timeDate"), "numeric"), td07a) &&
+        all.equal(as(as(ts07b, "timeDate"), "numeric"), td07b) &&
+        all.equal(as(ts07b[c(5, 2)], "numeric"), td07b[c(5, 2)])
+}
+{
+    # matching and aligning to a regular sequence without making it
+    ts08a <- timeSequence(from="1/1/2020", by="months", length.out=24)
+    td08a <- as(ts08a, "timeDate")
+    td08b <- timeDate(c("6/1/2021", "5/15/2020", "1/1/2020", "3/1/2022"))
+    identical(match(td08b, ts08a), match(td08b, td08a)) &&
+        identical(.timealign(ts08a, sort(td08b), "before", "NA"),
+                  .timealign(td08a, sort(td08b), "before", "NA"))
+}
+{
+    # the same in a zone from a zoneinfo transition table
+    dir <- system.file("zoneinfo", package="splusTimeDate")
+    timeZoneList(NYtzif=timeZoneTZif("America/New_York", dir))
+    ts09a <- timeSequence(from="3/6/2020 02:30", by="days", length.out=5,
+                          zone="NYtzif")
+    ts09b <- timeSequence(from="3/6/2020 12:00", by="days", length.out=5,
+                          zone="NYtzif")
+    td09a <- td09b <- NULL
+    x09a <- timeDate("3/6/2020 02:30", zone="NYtzif")
+    x09b <- timeDate("3/6/2020 12:00", zone="NYtzif")
+    for(i in 1:5) {
+        td09a <- c(td09a, as(x09a, "numeric"))
+        td09b <- c(td09b, as(x09b, "numeric"))
+        x09a <- x09a + timeRelative("+1day")
+        x09b <- x09b + timeRelative("+1day")
+    }
+    is.null(.seqRegular(ts09a)) && !is.null(.seqRegular(ts09b)) &&
+        all.equal(as(as(ts09a, "timeDate"), "numeric"), td09a) &&
+        all.equal(as(as(ts09b, "timeDate"), "numeric"), td09b) &&
+        all.equal(as(ts09b[c(5, 3)], "numeric"), td09b[c(5, 3)])
+}
+{
+    # findInterval on a regular sequence without making it
+    ts10a <- timeSequence(from="1/1/2020", by="months", length.out=24)
+    ts10b <- timeSequence(from="1/1/2020", by="days", length.out=30)
+    td10 <- timeDate(c("6/1/2021", "5/15/2020", "12/31/2019", "1/1/2020",
+                       "1/20/2020 12:00", "3/1/2022"))
+    identical(findInterval(td10, ts10a),
+              findInterval(as(td10, "numeric"), as(ts10a, "numeric"))) &&
+        identical(findInterval(td10, ts10b),
+                  findInterval(as(td10, "numeric"), as(ts10b, "numeric"))) &&
+        identical(findInterval(td10, ts10b), c(30L, 30L, 0L, 1L, 20L, 30L))
+}